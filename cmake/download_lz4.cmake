@@ -0,0 +1,68 @@
+# find or download lz4 (BSD 2-Clause license)
+
+if (${FG_ENABLE_LZ4})
+	set( FG_EXTERNAL_LZ4_PATH "" CACHE PATH "path to lz4 source" )
+	mark_as_advanced( FG_EXTERNAL_LZ4_PATH )
+
+	# reset to default
+	if (NOT EXISTS "${FG_EXTERNAL_LZ4_PATH}/lib/lz4.h")
+		message( STATUS "lz4 is not found in \"${FG_EXTERNAL_LZ4_PATH}\"" )
+		set( FG_EXTERNAL_LZ4_PATH "${FG_EXTERNALS_PATH}/lz4" CACHE PATH "" FORCE )
+	else ()
+		message( STATUS "lz4 found in \"${FG_EXTERNAL_LZ4_PATH}\"" )
+	endif ()
+	
+	# select version
+	if (${FG_EXTERNALS_USE_STABLE_VERSIONS})
+		set( LZ4_TAG "v1.9.2" )
+	else ()
+		set( LZ4_TAG "dev" )
+	endif ()
+
+	if (NOT EXISTS "${FG_EXTERNAL_LZ4_PATH}/lib/lz4.h")
+		set( FG_LZ4_REPOSITORY "https://github.com/lz4/lz4.git" )
+	else ()
+		set( FG_LZ4_REPOSITORY "" )
+	endif ()
+
+	# only 'lz4.c' is used, it is compiled by 'LZ4-lib'
+	set( LZ4_SOURCES "${FG_EXTERNAL_LZ4_PATH}/lib/lz4.c" "${FG_EXTERNAL_LZ4_PATH}/lib/lz4.h" )
+
+	ExternalProject_Add( "External.LZ4"
+		LIST_SEPARATOR		"${FG_LIST_SEPARATOR}"
+		LOG_OUTPUT_ON_FAILURE 1
+		# download
+		GIT_REPOSITORY		${FG_LZ4_REPOSITORY}
+		GIT_TAG				${LZ4_TAG}
+		GIT_PROGRESS		1
+		# update
+		PATCH_COMMAND		""
+		UPDATE_DISCONNECTED	1
+		# configure
+		SOURCE_DIR			"${FG_EXTERNAL_LZ4_PATH}"
+		CONFIGURE_COMMAND	""
+		LOG_CONFIGURE 		1
+		# build
+		BINARY_DIR			"${CMAKE_BINARY_DIR}/build-lz4"
+		BUILD_COMMAND		""
+		BUILD_BYPRODUCTS	${LZ4_SOURCES}
+		LOG_BUILD 			1
+		# install
+		INSTALL_DIR 		""
+		INSTALL_COMMAND		""
+		LOG_INSTALL 		1
+		# test
+		TEST_COMMAND		""
+	)
+	
+	set_property( TARGET "External.LZ4" PROPERTY FOLDER "External" )
+
+	# sources are downloaded in build step
+	set_source_files_properties( ${LZ4_SOURCES} PROPERTIES GENERATED TRUE )
+
+	add_library( "LZ4-lib" STATIC ${LZ4_SOURCES} )
+	set_property( TARGET "LZ4-lib" PROPERTY FOLDER "External" )
+	target_include_directories( "LZ4-lib" PUBLIC "${FG_EXTERNAL_LZ4_PATH}/lib" )
+	target_compile_definitions( "LZ4-lib" PUBLIC "FG_ENABLE_LZ4" )
+	add_dependencies( "LZ4-lib" "External.LZ4" )
+endif ()
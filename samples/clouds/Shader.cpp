@@ -24,6 +24,54 @@ namespace FG
 				buffer;
 	}
 
+	/// Uniform Arena
+
+	UniformArena::UniformArena(FrameGraph fg) : _fg{fg}
+	{
+		const BytesU	sizes[] = { SizeOf<UniformCameraObject>, SizeOf<UniformCameraObject>, SizeOf<UniformModelObject>,
+									SizeOf<UniformSunObject>, SizeOf<UniformSkyObject> };
+		STATIC_ASSERT( CountOf(sizes) == BLOCK_COUNT );
+
+		BytesU	offset;
+		for (uint i = 0; i < BLOCK_COUNT; ++i)
+		{
+			_offsets[i]	= offset;
+			_sizes[i]	= sizes[i];
+			offset		= AlignToLarger( offset + sizes[i], _Align );
+		}
+
+		_buffer = _fg->CreateBuffer( BufferDesc{}.Size( offset ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformArena" );
+		CHECK( _buffer );
+	}
+
+	UniformArena::~UniformArena()
+	{
+		cleanup();
+	}
+
+	void UniformArena::cleanup()
+	{
+		_fg->ReleaseResource( _buffer );
+	}
+
+	void UniformArena::updateUniformBuffers(const CommandBuffer &cmdbuf, const UniformCameraObject& cam, const UniformCameraObject& camPrev,
+											const UniformModelObject& model, const UniformSunObject& sun, const UniformSkyObject& sky)
+	{
+		// single transfer for all blocks
+		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _buffer )
+								.AddData( &cam,		1, _offsets[CAMERA] )
+								.AddData( &camPrev,	1, _offsets[CAMERA_PREV] )
+								.AddData( &model,	1, _offsets[MODEL] )
+								.AddData( &sun,		1, _offsets[SUN] )
+								.AddData( &sky,		1, _offsets[SKY] ));
+	}
+
+	void UniformArena::bind(PipelineResources &res, const UniformID &name, EBlock block) const
+	{
+		ASSERT( block < BLOCK_COUNT );
+		res.BindBuffer( name, _buffer, _offsets[block], _sizes[block] );
+	}
+
 	/// Mesh Shader
 	
 	void MeshShader::cleanup()
@@ -31,22 +79,14 @@ namespace FG
 		_fg->ReleaseResource( _pipeline );
 	}
 
-	void MeshShader::cleanupUniforms()
-	{
-		_fg->ReleaseResource( _uniformCameraBuffer );
-		_fg->ReleaseResource( _uniformModelBuffer );
-		_fg->ReleaseResource( _uniformSunBuffer );
-		_fg->ReleaseResource( _uniformSkyBuffer );
-	}
-
 	void MeshShader::createDescriptorSet()
 	{
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"0"}, OUT _descriptorSet ));
 
-		_descriptorSet.BindBuffer( UniformID{"UniformCameraObject"}, _uniformCameraBuffer );
-		_descriptorSet.BindBuffer( UniformID{"UniformModelObject"}, _uniformModelBuffer );
-		_descriptorSet.BindBuffer( UniformID{"UniformSunObject"}, _uniformSunBuffer );
-		_descriptorSet.BindBuffer( UniformID{"UniformSkyObject"}, _uniformSkyBuffer );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformCameraObject"}, UniformArena::CAMERA );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformModelObject"}, UniformArena::MODEL );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformSunObject"}, UniformArena::SUN );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformSkyObject"}, UniformArena::SKY );
 		_descriptorSet.BindTexture( UniformID{"texColor"}, _textures[ALBEDO]->Image(), _textures[ALBEDO]->Sampler() );
 		_descriptorSet.BindTexture( UniformID{"pbrInfo"}, _textures[ROUGH_METAL_AO_HEIGHT]->Image(), _textures[ROUGH_METAL_AO_HEIGHT]->Sampler() );
 		_descriptorSet.BindTexture( UniformID{"normalMap"}, _textures[NORMAL]->Image(), _textures[NORMAL]->Sampler() );
@@ -67,22 +107,6 @@ namespace FG
 		CHECK( _pipeline );
 	}
 
-	void MeshShader::createUniformBuffer()
-	{
-		_uniformCameraBuffer = _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformCameraObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformCameraObject" );
-		_uniformModelBuffer	 = _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformModelObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformModelObject" );
-		_uniformSunBuffer	 = _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformSunObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformSunObject" );
-		_uniformSkyBuffer	 = _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformSkyObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformSkyObject" );
-	}
-	
-	void MeshShader::updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject& cam, UniformModelObject& model, UniformSunObject& sun, UniformSkyObject& sky)
-	{
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformCameraBuffer ).AddData( &cam, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformModelBuffer ).AddData( &model, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformSunBuffer ).AddData( &sun, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformSkyBuffer ).AddData( &sky, 1 ));
-	}
-
 	/// Background Shader
 	
 	void BackgroundShader::cleanup()
@@ -90,11 +114,6 @@ namespace FG
 		_fg->ReleaseResource( _pipeline );
 	}
 
-	void BackgroundShader::cleanupUniforms()
-	{
-		// currently no uniforms, only a texture
-	}
-
 	void BackgroundShader::createDescriptorSet()
 	{
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"0"}, OUT _descriptorSet ));
@@ -113,11 +132,6 @@ namespace FG
 		CHECK( _pipeline );
 	}
 
-	void BackgroundShader::createUniformBuffer()
-	{
-		// currently no uniforms
-	}
-
 	/// Compute Shader
 	
 	void ComputeShader::cleanup()
@@ -125,14 +139,6 @@ namespace FG
 		_fg->ReleaseResource( _pipeline );
 	}
 
-	void ComputeShader::cleanupUniforms()
-	{
-		_fg->ReleaseResource( _uniformCameraBuffer );
-		_fg->ReleaseResource( _uniformCameraBufferPrev );
-		_fg->ReleaseResource( _uniformSunBuffer );
-		_fg->ReleaseResource( _uniformSkyBuffer );
-	}
-
 	void ComputeShader::createStorageDescriptorSets()
 	{
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"0"}, OUT _storageBufferSetA ));
@@ -142,10 +148,10 @@ namespace FG
 	{
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"1"}, OUT _descriptorSet ));
 
-		_descriptorSet.BindBuffer( UniformID{"UniformCameraObject"}, _uniformCameraBuffer );
-		_descriptorSet.BindBuffer( UniformID{"UniformCameraObjectPrev"}, _uniformCameraBufferPrev );
-		_descriptorSet.BindBuffer( UniformID{"UniformSunObject"}, _uniformSunBuffer );
-		_descriptorSet.BindBuffer( UniformID{"UniformSkyObject"}, _uniformSkyBuffer );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformCameraObject"}, UniformArena::CAMERA );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformCameraObjectPrev"}, UniformArena::CAMERA_PREV );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformSunObject"}, UniformArena::SUN );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformSkyObject"}, UniformArena::SKY );
 		_descriptorSet.BindTexture( UniformID{"cloudPlacement"}, _textures[2]->Image(), _textures[2]->Sampler() );
 		_descriptorSet.BindTexture( UniformID{"nightSkyMap"}, _textures[3]->Image(), _textures[3]->Sampler() );
 		_descriptorSet.BindTexture( UniformID{"curlNoise"}, _textures[4]->Image(), _textures[4]->Sampler() );
@@ -164,22 +170,6 @@ namespace FG
 		CHECK( _pipeline );
 	}
 
-	void ComputeShader::createUniformBuffer()
-	{
-		_uniformCameraBuffer	= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformCameraObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformCameraObject" );
-		_uniformCameraBufferPrev= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformCameraObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformCameraObjectPrev" );
-		_uniformSunBuffer		= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformSunObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformSunObject" );
-		_uniformSkyBuffer		= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformSkyObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformSkyObject" );
-	}
-
-	void ComputeShader::updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject &cam, UniformCameraObject &camPrev, UniformSkyObject &sky, UniformSunObject &sun)
-	{
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformCameraBuffer ).AddData( &cam, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformCameraBufferPrev ).AddData( &camPrev, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformSunBuffer ).AddData( &sun, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformSkyBuffer ).AddData( &sky, 1 ));
-	}
-
 	/// Post Process Shader
 	
 	void PostProcessShader::cleanup()
@@ -187,18 +177,12 @@ namespace FG
 		_fg->ReleaseResource( _pipeline );
 	}
 
-	void PostProcessShader::cleanupUniforms()
-	{
-		_fg->ReleaseResource( _uniformCameraBuffer );
-		_fg->ReleaseResource( _uniformSunBuffer );
-	}
-
 	void PostProcessShader::createDescriptorSet()
 	{
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"0"}, OUT _descriptorSet ));
 		
-		_descriptorSet.BindBuffer( UniformID{"UniformCameraObject"}, _uniformCameraBuffer );
-		_descriptorSet.BindBuffer( UniformID{"UniformSunObject"}, _uniformSunBuffer );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformCameraObject"}, UniformArena::CAMERA );
+		_uniforms->bind( _descriptorSet, UniformID{"UniformSunObject"}, UniformArena::SUN );
 	}
 
 	void PostProcessShader::createPipeline()
@@ -214,19 +198,6 @@ namespace FG
 		CHECK( _pipeline );
 	}
 
-	void PostProcessShader::createUniformBuffer()
-	{
-		_uniformCameraBuffer = _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformCameraObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformCameraObject" );
-		_uniformSunBuffer	 = _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformSunObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformSunObject" );
-	}
-
-	void PostProcessShader::updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject &cam, UniformSunObject &sun)
-	{
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformCameraBuffer ).AddData( &cam, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformSunBuffer ).AddData( &sun, 1 ));
-	}
-
-
 	/// Reproject shader
 
 	void ReprojectShader::cleanup()
@@ -234,43 +205,19 @@ namespace FG
 		_fg->ReleaseResource( _pipeline );
 	}
 
-	void ReprojectShader::cleanupUniforms()
-	{
-		_fg->ReleaseResource( _uniformSkyBuffer );
-		_fg->ReleaseResource( _uniformSunBuffer );
-		_fg->ReleaseResource( _uniformCameraBuffer );
-		_fg->ReleaseResource( _uniformCameraBufferPrev );
-	}
-
-	void ReprojectShader::updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject& cam, UniformCameraObject& camPrev, UniformSkyObject& sky, UniformSunObject& sun)
-	{
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformCameraBuffer ).AddData( &cam, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformCameraBufferPrev ).AddData( &camPrev, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformSkyBuffer ).AddData( &sky, 1 ));
-		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _uniformSunBuffer ).AddData( &sun, 1 ));
-	}
-
 	void ReprojectShader::createDescriptorSet()
 	{
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"0"}, OUT _descriptorSet ));
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"1"}, OUT _descriptorSetB ));
 		CHECK( _fg->InitPipelineResources( _pipeline, DescriptorSetID{"2"}, OUT _uniformSet ));
 		
-		_uniformSet.BindBuffer( UniformID{"UniformCameraObject"}, _uniformCameraBuffer );
-		_uniformSet.BindBuffer( UniformID{"UniformCameraObjectPrev"}, _uniformCameraBufferPrev );
-		_uniformSet.BindBuffer( UniformID{"UniformSunObject"}, _uniformSunBuffer );
-		_uniformSet.BindBuffer( UniformID{"UniformSkyObject"}, _uniformSkyBuffer );
+		_uniforms->bind( _uniformSet, UniformID{"UniformCameraObject"}, UniformArena::CAMERA );
+		_uniforms->bind( _uniformSet, UniformID{"UniformCameraObjectPrev"}, UniformArena::CAMERA_PREV );
+		_uniforms->bind( _uniformSet, UniformID{"UniformSunObject"}, UniformArena::SUN );
+		_uniforms->bind( _uniformSet, UniformID{"UniformSkyObject"}, UniformArena::SKY );
 	}
 
 
-	void ReprojectShader::createUniformBuffer()
-	{
-		_uniformSkyBuffer		= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformSkyObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformSkyObject" );
-		_uniformSunBuffer		= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformSunObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformSunObject" );
-		_uniformCameraBuffer	= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformCameraObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformCameraObject" );
-		_uniformCameraBufferPrev= _fg->CreateBuffer( BufferDesc{}.Size( sizeof(UniformCameraObject) ).Usage( EBufferUsage::Uniform | EBufferUsage::Transfer ), Default, "UniformCameraObject" );
-	}
-
 	void ReprojectShader::createPipeline()
 	{
 		auto computeShaderCode = readFile(_shaderFilePaths[0]);
@@ -23,17 +23,47 @@ namespace FG
 	struct UniformStorageImageObject {
 	};
 
+	/*
+	  Per-frame uniform storage shared by all shaders.
+	  Each block is written once per frame and bound to every consumer by offset.
+	*/
+	class UniformArena
+	{
+	public:
+		enum EBlock : uint
+		{
+			CAMERA = 0, CAMERA_PREV, MODEL, SUN, SKY, BLOCK_COUNT
+		};
+
+	private:
+		// max value of 'minUniformBufferOffsetAlignment' that is allowed by the Vulkan specification
+		static constexpr BytesU		_Align {256};
+
+		FrameGraph		_fg;
+		BufferID		_buffer;
+		BytesU			_offsets[BLOCK_COUNT];
+		BytesU			_sizes[BLOCK_COUNT];
+
+	public:
+		UniformArena(FrameGraph fg);
+		~UniformArena();
+
+		void cleanup();
+
+		void updateUniformBuffers(const CommandBuffer &cmdbuf, const UniformCameraObject& cam, const UniformCameraObject& camPrev,
+								  const UniformModelObject& model, const UniformSunObject& sun, const UniformSkyObject& sky);
+
+		void bind(PipelineResources &res, const UniformID &name, EBlock block) const;
+	};
+
 	class Shader
 	{
 	protected:
 		// All shaders have layouts and pipelines to delete.
 		virtual void cleanup() = 0;
 
-		// Different shaders will have different numbers of uniform buffers, need to implement cleanup for each.
-		virtual void cleanupUniforms() = 0;
-		
+		// Uniform buffers are not created per shader, see 'UniformArena'.
 		virtual void createDescriptorSet() = 0;
-		virtual void createUniformBuffer() = 0;
 		virtual void createPipeline() = 0;
 
 		std::vector<std::string> _shaderFilePaths;
@@ -46,11 +76,14 @@ namespace FG
 
 		FrameGraph              _fg;
 
+		// Uniform blocks are owned by the engine and shared between all shaders
+		UniformArena*           _uniforms = nullptr;
+
 	public:
 		// all shaders need a setup function, but will have variable # arguments...
 		// for now: make part of constructor
 
-		Shader(FrameGraph fg) : _fg{fg} {}
+		Shader(FrameGraph fg, UniformArena* uniforms = nullptr) : _fg{fg}, _uniforms{uniforms} {}
 
 		virtual ~Shader() {}
 	
@@ -78,22 +111,10 @@ namespace FG
 	
 	protected:
 		GPipelineID			_pipeline;
-
-		UniformCameraObject	_cameraUniforms;
-		UniformModelObject	_modelUniforms;
-		UniformSunObject	_sunUniforms;
-		UniformSkyObject	_skyUniforms;
-
-		BufferID			_uniformCameraBuffer;
-		BufferID			_uniformModelBuffer;
-		BufferID			_uniformSunBuffer;
-		BufferID			_uniformSkyBuffer;
 		
 		void cleanup() override;
 		void createDescriptorSet() override;
-		void createUniformBuffer() override;
 		void createPipeline() override;
-		void cleanupUniforms() override;
 
 	public:
 		void setupShader(std::string vertPath, std::string fragPath) {
@@ -101,14 +122,13 @@ namespace FG
 			_shaderFilePaths.push_back(fragPath);
 
 			createPipeline();
-			createUniformBuffer();
 			createDescriptorSet();
 		}
 	
 		MeshShader(FrameGraph fg) : Shader(fg) {}
 
-		MeshShader(FrameGraph fg, std::string vertPath, std::string fragPath, Texture* tex, Texture* pbrTex, Texture* normalTex, Texture* coverageTex, Texture3D* loResCloudShape) :
-			Shader(fg) {
+		MeshShader(FrameGraph fg, UniformArena* uniforms, std::string vertPath, std::string fragPath, Texture* tex, Texture* pbrTex, Texture* normalTex, Texture* coverageTex, Texture3D* loResCloudShape) :
+			Shader(fg, uniforms) {
 			addTexture(tex);
 			addTexture(pbrTex);
 			addTexture(normalTex);
@@ -118,12 +138,9 @@ namespace FG
 		}
 
 		virtual ~MeshShader() {
-			cleanupUniforms();
 			cleanup();
 		}
 
-		void updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject& cam, UniformModelObject& model, UniformSunObject& sun, UniformSkyObject& sky);
-
 		template <typename T>
 		void bindShader(T &task)
 		{
@@ -152,9 +169,7 @@ namespace FG
 	protected:
 		void cleanup() override;
 		void createDescriptorSet() override;
-		void createUniformBuffer() override;
 		void createPipeline() override;
-		void cleanupUniforms() override;
 		
 		GPipelineID			_pipeline;
 
@@ -166,7 +181,6 @@ namespace FG
 			_shaderFilePaths.push_back(fragPath);
 
 			createPipeline();
-			createUniformBuffer();
 			createDescriptorSet();
 		}
 
@@ -181,7 +195,6 @@ namespace FG
 		}
 
 		virtual ~BackgroundShader() {
-			cleanupUniforms();
 			cleanup();
 		}
 		
@@ -214,21 +227,13 @@ namespace FG
 	protected:
 		void cleanup() override;
 		void createDescriptorSet() override;
-		void createUniformBuffer() override;
 		void createPipeline() override;
-		void cleanupUniforms() override;
 		void createStorageDescriptorSets();
 		
 		CPipelineID			_pipeline;
 
 		UniformStorageImageObject	_storageImageUniform;
 		UniformStorageImageObject	_storageImageUniformPrev;
-		UniformCameraObject			_cameraUniforms;
-
-		BufferID			_uniformCameraBuffer;
-		BufferID			_uniformCameraBufferPrev;
-		BufferID			_uniformSunBuffer;
-		BufferID			_uniformSkyBuffer;
 
 		// need sets to ping-pong image buffers
 		PipelineResources	_storageBufferSetA;
@@ -241,16 +246,15 @@ namespace FG
 			_shaderFilePaths.push_back(path);
 
 			createPipeline();
-			createUniformBuffer();
 			createDescriptorSet();
 			createStorageDescriptorSets();
 		}
 
 		ComputeShader(FrameGraph fg) : Shader(fg) {}
 
-		ComputeShader(FrameGraph fg, bool reprojection, std::string path, Texture* storageTex, Texture* storageTexPrev, Texture* placementTex,
+		ComputeShader(FrameGraph fg, UniformArena* uniforms, bool reprojection, std::string path, Texture* storageTex, Texture* storageTexPrev, Texture* placementTex,
 					  Texture* nightSkyTex, Texture* curlTexture, Texture3D* lowResCloudShapeTex, Texture3D* hiResCloudShapeTex) :
-			Shader(fg), _reprojection{reprojection}
+			Shader(fg, uniforms), _reprojection{reprojection}
 		{
 			// Note: This texture is intended to be written to. In this application, it is set to be the sampled texture of a separate BackgroundShader.
 			addTexture(storageTex);
@@ -265,12 +269,9 @@ namespace FG
 		}
 
 		virtual ~ComputeShader() {
-			cleanupUniforms();
 			cleanup();
 		}
 
-		void updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject& cam, UniformCameraObject& camPrev, UniformSkyObject& sky, UniformSunObject& sun);
-		
 		template <typename T>
 		void bindShader(T &task)
 		{
@@ -295,9 +296,7 @@ namespace FG
 	protected:
 		void cleanup() override;
 		void createDescriptorSet() override;
-		void createUniformBuffer() override;
 		void createPipeline() override;
-		void cleanupUniforms() override;
 		
 		CPipelineID			_pipeline;
 
@@ -306,23 +305,17 @@ namespace FG
 
 		PipelineResources	_uniformSet;
 
-		BufferID	_uniformCameraBuffer;
-		BufferID	_uniformCameraBufferPrev;
-		BufferID	_uniformSkyBuffer;
-		BufferID	_uniformSunBuffer;
-
 	public:
 		void setupShader(std::string path) {
 			_shaderFilePaths.push_back(path);
 
 			createPipeline();
-			createUniformBuffer();
 			createDescriptorSet();
 		}
 
 		ReprojectShader(FrameGraph fg) : Shader(fg) {}
 
-		ReprojectShader(FrameGraph fg, std::string shaderPath, Texture* texA, Texture* texB) : Shader(fg)
+		ReprojectShader(FrameGraph fg, UniformArena* uniforms, std::string shaderPath, Texture* texA, Texture* texB) : Shader(fg, uniforms)
 		{
 			addTexture(texA);
 			addTexture(texB);
@@ -331,12 +324,9 @@ namespace FG
 		}
 
 		virtual ~ReprojectShader() {
-			cleanupUniforms();
 			cleanup();
 		}
 
-		void updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject& cam, UniformCameraObject& camPrev, UniformSkyObject& sky, UniformSunObject& sun);
-		
 		template <typename T>
 		void bindShader(T &task)
 		{
@@ -373,9 +363,7 @@ namespace FG
 	protected:
 		void cleanup() override;
 		void createDescriptorSet() override;
-		void createUniformBuffer() override;
 		void createPipeline() override;
-		void cleanupUniforms() override;
 		
 		GPipelineID			_pipeline;
 
@@ -384,9 +372,7 @@ namespace FG
 		// TODO: make this class's function virtual and override them in the subclass
 		// need a GodRayShader class that has these uniforms:
 	
-		// God ray shader uniforms
-		BufferID	_uniformSunBuffer;
-		BufferID	_uniformCameraBuffer;
+		// God ray shader uniforms are bound from the shared uniform arena
 
 	public:
 		void setupShader(std::string vertPath, std::string fragPath) {
@@ -394,26 +380,22 @@ namespace FG
 			_shaderFilePaths.push_back(fragPath);
 
 			createPipeline();
-			createUniformBuffer();
 			createDescriptorSet();
 		}
 
 		//TODO: change this constructor to take an image descriptor instead of a texture, or somehow create a texture from the framebuffer image descriptor
 		PostProcessShader(FrameGraph fg) : Shader(fg) {}
 
-		PostProcessShader(FrameGraph fg, std::string vertPath, std::string fragPath, Texture* texA) : Shader(fg)
+		PostProcessShader(FrameGraph fg, UniformArena* uniforms, std::string vertPath, std::string fragPath, Texture* texA) : Shader(fg, uniforms)
 		{
 			addTexture(texA);
 			setupShader(vertPath, fragPath);
 		}
 
 		virtual ~PostProcessShader() {
-			cleanupUniforms();
 			cleanup();
 		}
 
-		void updateUniformBuffers(const CommandBuffer &cmdbuf, UniformCameraObject& cam, UniformSunObject& sun);
-		
 		template <typename T>
 		void bindShader(T &task)
 		{
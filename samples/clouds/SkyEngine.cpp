@@ -153,7 +153,10 @@ namespace FG
 */
 	bool  SkyEngine::_InitializeShaders ()
 	{
-		_meshShader.reset( new MeshShader(_frameGraph, 
+		// uniforms are shared between all shaders
+		_uniformArena.reset( new UniformArena(_frameGraph));
+
+		_meshShader.reset( new MeshShader(_frameGraph, _uniformArena.get(),
 			std::string("Shaders/model.vert"), std::string("Shaders/model.frag"), _meshTexture.get(), _meshPBRInfo.get(), _meshNormals.get(),
 			_cloudPlacementTexture.get(), _lowResCloudShapeTexture3D.get()));
 	
@@ -161,22 +164,22 @@ namespace FG
 			std::string("Shaders/background.vert"), std::string("Shaders/background.frag"), _backgroundTexture.get(), _backgroundTexturePrev.get()));
 
 		// Note: we pass the background shader's texture with the intention of writing to it with the compute shader
-		_reprojectShader.reset( new ReprojectShader(_frameGraph,
+		_reprojectShader.reset( new ReprojectShader(_frameGraph, _uniformArena.get(),
 			std::string("Shaders/reproject.comp"), _backgroundTexture.get(), _backgroundTexturePrev.get()));
 
-		_computeShader.reset( new ComputeShader(_frameGraph, _reprojection,
+		_computeShader.reset( new ComputeShader(_frameGraph, _uniformArena.get(), _reprojection,
 			std::string("Shaders/compute-clouds.comp"), _backgroundTexture.get(), _backgroundTexturePrev.get(), _cloudPlacementTexture.get(),
 			_nightSkyTexture.get(), _cloudCurlNoise.get(), _lowResCloudShapeTexture3D.get(), _hiResCloudShapeTexture3D.get()));
 
 		// Post shaders: there will be many
 		// This is still offscreen, so the render pass is the offscreen render pass
-		_godRayShader.reset( new PostProcessShader(_frameGraph,
+		_godRayShader.reset( new PostProcessShader(_frameGraph, _uniformArena.get(),
 			std::string("Shaders/post-pass.vert"), std::string("Shaders/god-ray.frag"), _offscreenPass.colorBuffer[0].get()));
 
-		_radialBlurShader.reset( new PostProcessShader(_frameGraph,
+		_radialBlurShader.reset( new PostProcessShader(_frameGraph, _uniformArena.get(),
 			std::string("Shaders/post-pass.vert"), std::string("Shaders/radialBlur.frag"), _offscreenPass.colorBuffer[1].get()));
 
-		_toneMapShader.reset( new PostProcessShader(_frameGraph,
+		_toneMapShader.reset( new PostProcessShader(_frameGraph, _uniformArena.get(),
 			std::string("Shaders/post-pass.vert"), std::string("Shaders/tonemap.frag"), _offscreenPass.colorBuffer[2].get()));
 
 		return true;
@@ -196,6 +199,7 @@ namespace FG
 		_toneMapShader = null;
 		_godRayShader = null;
 		_radialBlurShader = null;
+		_uniformArena = null;
 	}
 	
 /*
@@ -326,11 +330,8 @@ namespace FG
 		// this channel already. Will probably change later.
 		sun.color.a = float((int(sun.color.a) + 1) % 16); // update every 16th pixel
 
-		_computeShader->updateUniformBuffers(cmdbuf, uco, ucoPrev, sky, sun);
-		_reprojectShader->updateUniformBuffers(cmdbuf, uco, ucoPrev, sky, sun);
-		_meshShader->updateUniformBuffers(cmdbuf, uco, umo, sun, sky);
-		_godRayShader->updateUniformBuffers(cmdbuf, uco, sun);
-		_radialBlurShader->updateUniformBuffers(cmdbuf, uco, sun);
+		// each block is uploaded once and shared by all shaders
+		_uniformArena->updateUniformBuffers(cmdbuf, uco, ucoPrev, umo, sun, sky);
 
 		_prevProjection	= GetCamera().projection;
 		_prevView		= GetCamera().ToViewMatrix();
@@ -41,6 +41,7 @@ namespace FG
 		UniquePtr<Geometry>		_backgroundGeometry;
 		
 		// 
+		UniquePtr<UniformArena>			_uniformArena;
 		UniquePtr<MeshShader>			_meshShader;
 		UniquePtr<BackgroundShader>		_backgroundShader;
 		UniquePtr<ComputeShader>		_computeShader;
@@ -0,0 +1,80 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "DepthSort.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	Sort
+----
+	same passes as on GPU: count digits, offsets from prefix sum, then stable scatter
+=================================================
+*/
+	void  DepthSort::Sort (INOUT Array<uint> &keys, INOUT Array<uint> &values)
+	{
+		CHECK_ERRV( keys.size() == values.size() );
+
+		Array<uint>	tmp_keys	( keys.size() );
+		Array<uint>	tmp_values	( values.size() );
+		uint		offsets		[RadixBins];
+
+		for (uint shift = 0; shift < 32; shift += RadixBits)
+		{
+			std::memset( offsets, 0, sizeof(offsets) );
+
+			for (uint key : keys) {
+				++offsets[ (key >> shift) & (RadixBins - 1) ];
+			}
+
+			uint	sum = 0;
+			for (uint& off : offsets)
+			{
+				const uint	n = off;
+				off  = sum;
+				sum += n;
+			}
+
+			for (size_t i = 0; i < keys.size(); ++i)
+			{
+				const uint	dst = offsets[ (keys[i] >> shift) & (RadixBins - 1) ]++;
+				tmp_keys[dst]	= keys[i];
+				tmp_values[dst]	= values[i];
+			}
+
+			std::swap( keys, tmp_keys );
+			std::swap( values, tmp_values );
+		}
+	}
+
+/*
+=================================================
+	FloatToOrderedUint
+----
+	negative values are inverted, sign bit is set for positive values
+=================================================
+*/
+	uint  DepthSort::FloatToOrderedUint (float value)
+	{
+		const uint	u = BitCast<uint>( value );
+		return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+	}
+
+/*
+=================================================
+	CountUnordered
+=================================================
+*/
+	uint  DepthSort::CountUnordered (ArrayView<uint> keys)
+	{
+		uint	count = 0;
+
+		for (size_t i = 1; i < keys.size(); ++i) {
+			count += uint(keys[i-1] > keys[i]);
+		}
+		return count;
+	}
+
+
+}	// FG
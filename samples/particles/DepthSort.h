@@ -0,0 +1,39 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	//
+	// Depth Sort
+	//
+	// CPU version of 'shaders/radix_sort.glsl' and 'shaders/depth_sort_*.glsl',
+	// must be updated when shaders are changed.
+	//
+
+	class DepthSort final
+	{
+	// types
+	public:
+		static constexpr uint	RadixBits	= 8;
+		static constexpr uint	RadixBins	= 1u << RadixBits;
+		static constexpr uint	TileSize	= 256;		// same as 'DEPTH_SORT_TILE_SIZE' and 'TILE_SIZE' in 'radix_sort.glsl'
+
+
+	// methods
+	public:
+		// stable LSD radix sort, GPU version must produce the same result
+		static void  Sort (INOUT Array<uint> &keys, INOUT Array<uint> &values);
+
+		// same as 'FloatToOrderedUint' in 'simulation_shared.glsl'
+		ND_ static uint  FloatToOrderedUint (float value);
+
+		// returns number of adjacent elements in wrong order
+		ND_ static uint  CountUnordered (ArrayView<uint> keys);
+	};
+
+
+}	// FG
@@ -0,0 +1,64 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "ExpandBenchmark.h"
+#include "stl/Algorithms/StringUtils.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	Start
+=================================================
+*/
+	EParticleExpand  ExpandBenchmark::Start ()
+	{
+		*this	= {};
+		_active	= true;
+		return EParticleExpand(_expand);
+	}
+
+/*
+=================================================
+	Update
+=================================================
+*/
+	EParticleExpand  ExpandBenchmark::Update (SecondsF gpuTime, uint particleCount)
+	{
+		CHECK_ERR( _active, EParticleExpand(_expand) );
+
+		if ( _frame++ >= WarmupFrames )
+			_gpuTime[_expand] += double(gpuTime.count());
+
+		if ( _frame < WarmupFrames + FrameCount )
+			return EParticleExpand(_expand);
+
+		_frame = 0;
+
+		if ( ++_expand < CountOf(_gpuTime) )
+			return EParticleExpand(_expand);
+
+		const double	gs_time	= AverageTime( EParticleExpand::GeometryShader );
+		const double	vp_time	= AverageTime( EParticleExpand::VertexPulling );
+
+		_active		= false;
+		_finished	= true;
+
+		FG_LOGI( "Particle expansion: "s << ToString( particleCount ) << " particles, GPU frame time, geometry shader: " << ToString( gs_time )
+				 << " ms, vertex pulling: " << ToString( vp_time ) << " ms" );
+
+		return vp_time < gs_time ? EParticleExpand::VertexPulling : EParticleExpand::GeometryShader;
+	}
+
+/*
+=================================================
+	AverageTime
+=================================================
+*/
+	double  ExpandBenchmark::AverageTime (EParticleExpand expand) const
+	{
+		ASSERT( expand < EParticleExpand::_Count );
+		return _gpuTime[uint(expand)] * 1.0e+3 / FrameCount;
+	}
+
+}	// FG
@@ -0,0 +1,63 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	// how particle is expanded to quad
+	enum class EParticleExpand : uint
+	{
+		GeometryShader,		// particle is a point
+		VertexPulling,		// particle is an instance of quad, particles are read from storage buffer
+		_Count,
+		Unknown		= GeometryShader,
+	};
+
+
+	//
+	// Expand Benchmark
+	//
+	// Measures GPU time of frames with each way of particle expansion.
+	// GPU time of the whole frame is used, simulation is the same for all ways of expansion.
+	//
+
+	class ExpandBenchmark final
+	{
+	// types
+	public:
+		static constexpr uint	WarmupFrames	= 30;	// pipelines are recreated when expansion is changed
+		static constexpr uint	FrameCount		= 120;
+
+
+	// variables
+	private:
+		uint		_frame		= 0;
+		uint		_expand		= 0;	// current 'EParticleExpand'
+		double		_gpuTime [uint(EParticleExpand::_Count)]	= {};
+		bool		_active		= false;
+		bool		_finished	= false;
+
+
+	// methods
+	public:
+		ExpandBenchmark () {}
+
+		// returns expansion for the first frame
+		ND_ EParticleExpand  Start ();
+
+		// returns expansion for the next frame, the fastest expansion after the last frame
+		ND_ EParticleExpand  Update (SecondsF gpuTime, uint particleCount);
+
+		// average GPU frame time in milliseconds
+		ND_ double  AverageTime (EParticleExpand expand) const;
+
+		ND_ uint	Current ()		const	{ return _expand; }
+		ND_ bool	IsActive ()		const	{ return _active; }
+		ND_ bool	IsFinished ()	const	{ return _finished; }
+	};
+
+
+}	// FG
@@ -0,0 +1,281 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "GpuDepthSort.h"
+#include "stl/Algorithms/StringUtils.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	destructor
+=================================================
+*/
+	GpuDepthSort::~GpuDepthSort ()
+	{
+		CHECK( not _histogram );
+		CHECK( not _keysPpln );
+	}
+
+/*
+=================================================
+	_Create
+=================================================
+*/
+	bool  GpuDepthSort::_Create (const FrameGraph &fg, uint maxParticles)
+	{
+		if ( _histogram )
+			return true;
+
+		const BytesU	size = SizeOf<uint> * maxParticles;
+
+		_keys[0]	= fg->CreateBuffer( BufferDesc{ size, EBufferUsage::Storage | EBufferUsage::TransferSrc }, Default, "SortKeys1" );
+		_keys[1]	= fg->CreateBuffer( BufferDesc{ size, EBufferUsage::Storage }, Default, "SortKeys2" );
+		_values[0]	= fg->CreateBuffer( BufferDesc{ size, EBufferUsage::Storage | EBufferUsage::Index | EBufferUsage::TransferSrc }, Default, "SortValues1" );
+		_values[1]	= fg->CreateBuffer( BufferDesc{ size, EBufferUsage::Storage }, Default, "SortValues2" );
+		_histogram	= fg->CreateBuffer( BufferDesc{ SizeOf<uint> * DepthSort::RadixBins * MaxGroups, EBufferUsage::Storage }, Default, "SortHistogram" );
+		CHECK_ERR( _keys[0] and _keys[1] and _values[0] and _values[1] and _histogram );
+
+		_sortedCount = 0;
+		return true;
+	}
+
+/*
+=================================================
+	Destroy
+=================================================
+*/
+	void  GpuDepthSort::Destroy (const FrameGraph &fg)
+	{
+		fg->ReleaseResource( _keys[0] );
+		fg->ReleaseResource( _keys[1] );
+		fg->ReleaseResource( _values[0] );
+		fg->ReleaseResource( _values[1] );
+		fg->ReleaseResource( _histogram );
+
+		fg->ReleaseResource( _keysPpln );
+		fg->ReleaseResource( _localPpln );
+
+		for (auto& ppln : _radixPpln) {
+			fg->ReleaseResource( ppln );
+		}
+		_sortedCount = 0;
+	}
+
+/*
+=================================================
+	ReloadShaders
+----
+	old pipelines are kept if compilation failed
+=================================================
+*/
+	void  GpuDepthSort::ReloadShaders (const FrameGraph &fg, const String &defines, const GpuParticles::ShaderLoader_t &loadShader)
+	{
+		ComputePipelineDesc	keys_desc;
+		keys_desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + loadShader( "shaders/depth_sort_keys.glsl" ));
+
+		ComputePipelineDesc	local_desc;
+		local_desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + loadShader( "shaders/depth_sort_local.glsl" ));
+
+		const String			radix_source	= loadShader( "shaders/radix_sort.glsl" );
+		decltype(_radixPpln)	radix_ppln;
+		bool					radix_ok		= true;
+
+		for (size_t i = 0; i < CountOf(radix_ppln); ++i)
+		{
+			ComputePipelineDesc	radix_desc;
+			radix_desc.AddShader( EShaderLangFormat::VKSL_110, "main", "#define RADIX_PASS "s + ToString(i) + "\n" + radix_source );
+
+			radix_ppln[i] = fg->CreatePipeline( radix_desc );
+			radix_ok &= bool(radix_ppln[i]);
+		}
+
+		CPipelineID	keys_ppln	= fg->CreatePipeline( keys_desc );
+		CPipelineID	local_ppln	= fg->CreatePipeline( local_desc );
+
+		if ( not (keys_ppln and local_ppln and radix_ok) )
+		{
+			fg->ReleaseResource( keys_ppln );
+			fg->ReleaseResource( local_ppln );
+
+			for (auto& ppln : radix_ppln) {
+				fg->ReleaseResource( ppln );
+			}
+			return;
+		}
+
+		fg->ReleaseResource( _keysPpln );
+		fg->ReleaseResource( _localPpln );
+		_keysPpln	= std::move(keys_ppln);
+		_localPpln	= std::move(local_ppln);
+
+		CHECK( fg->InitPipelineResources( _keysPpln,  DescriptorSetID{"0"}, OUT _keysRes ));
+		CHECK( fg->InitPipelineResources( _localPpln, DescriptorSetID{"0"}, OUT _localRes ));
+
+		for (size_t i = 0; i < CountOf(_radixPpln); ++i)
+		{
+			fg->ReleaseResource( _radixPpln[i] );
+			_radixPpln[i] = std::move(radix_ppln[i]);
+			CHECK( fg->InitPipelineResources( _radixPpln[i], DescriptorSetID{"0"}, OUT _radixRes[i] ));
+		}
+
+		// particle format may be changed
+		_sortedCount = 0;
+	}
+
+/*
+=================================================
+	Sort
+=================================================
+*/
+	void  GpuDepthSort::Sort (const CommandBuffer &cmdbuf, const GpuParticles &particles, RawBufferID cameraUB, uint count, uint interval, bool validate)
+	{
+		CHECK_ERRV( _Create( cmdbuf->GetFrameGraph(), particles.MaxParticles() ));
+
+		const uint	block_size	= particles.BlockSize();
+		const uint	tile_count	= (count + DepthSort::TileSize - 1) / DepthSort::TileSize;
+		const bool	full_sort	= validate or (_sortedCount != count) or (_frame % interval == 0);
+
+		++_frame;
+
+		const auto	BindParticles = [&particles, cameraUB] (PipelineResources &res)
+		{
+			res.BindBuffer( UniformID{"ParticleSSB"}, particles.Particles() );
+			res.BindBuffer( UniformID{"CameraUB"},    cameraUB );
+		};
+
+		// partial sort
+		if ( not full_sort )
+		{
+			DepthSortPushConst	pc;
+			pc.count	= count;
+			pc.offset	= (_frame & 1) ? DepthSort::TileSize / 2 : 0;
+
+			if ( pc.offset >= count )
+				return;
+
+			BindParticles( _localRes );
+			_localRes.BindBuffer( UniformID{"ValueSSB"}, _values[0] );
+
+			DispatchCompute		local;
+			local.SetPipeline( _localPpln );
+			local.AddResources( DescriptorSetID{"0"}, _localRes );
+			local.AddPushConstant( PushConstantID{"PushConst"}, pc );
+			local.Dispatch( uint2{(count - pc.offset + DepthSort::TileSize - 1) / DepthSort::TileSize, 1} );
+			cmdbuf->AddTask( local );
+			return;
+		}
+
+		auto	keys	= validate ? MakeShared<Array<uint>>() : null;
+		auto	order	= validate ? MakeShared<Array<uint>>() : null;
+
+		// order of the previous frame is used to measure quality of partial sort
+		if ( validate and _sortedCount == count )
+		{
+			cmdbuf->AddTask( ReadBuffer{}.SetBuffer( _values[0], 0_b, SizeOf<uint> * count )
+										 .SetCallback( [order, count] (const BufferView &view)
+										 {
+											CopyBufferView( view, count, OUT *order );
+										 }));
+		}
+
+		// keys
+		{
+			DepthSortPushConst	pc;
+			pc.count	= count;
+			pc.offset	= 0;
+
+			BindParticles( _keysRes );
+			_keysRes.BindBuffer( UniformID{"DstKeySSB"},   _keys[0] );
+			_keysRes.BindBuffer( UniformID{"DstValueSSB"}, _values[0] );
+
+			DispatchCompute		comp;
+			comp.SetPipeline( _keysPpln );
+			comp.AddResources( DescriptorSetID{"0"}, _keysRes );
+			comp.AddPushConstant( PushConstantID{"PushConst"}, pc );
+			comp.SetLocalSize( uint2{block_size, 1} );
+			comp.Dispatch( uint2{(count + block_size - 1) / block_size, 1} );
+			cmdbuf->AddTask( comp );
+		}
+
+		if ( validate )
+		{
+			cmdbuf->AddTask( ReadBuffer{}.SetBuffer( _keys[0], 0_b, SizeOf<uint> * count )
+										 .SetCallback( [keys, count] (const BufferView &view)
+										 {
+											CopyBufferView( view, count, OUT *keys );
+										 }));
+		}
+
+		// radix sort, each workgroup processes a range of tiles to keep histogram small
+		RadixSortPushConst	pc;
+		pc.count			= count;
+		pc.tilesPerGroup	= (tile_count + MaxGroups - 1) / MaxGroups;
+		pc.groupCount		= (tile_count + pc.tilesPerGroup - 1) / pc.tilesPerGroup;
+
+		// see 'RADIX_PASS' in 'radix_sort.glsl'
+		const uint	radix_groups[] = { pc.groupCount, 1, pc.groupCount };
+		STATIC_ASSERT( (32 / DepthSort::RadixBits) % 2 == 0 );	// result must be in '_keys[0]'
+
+		for (uint shift = 0, src = 0; shift < 32; shift += DepthSort::RadixBits, src = 1 - src)
+		{
+			pc.shift = shift;
+
+			for (size_t i = 0; i < CountOf(radix_groups); ++i)
+			{
+				_radixRes[i].BindBuffer( UniformID{"SrcKeySSB"},    _keys[src] );
+				_radixRes[i].BindBuffer( UniformID{"SrcValueSSB"},  _values[src] );
+				_radixRes[i].BindBuffer( UniformID{"DstKeySSB"},    _keys[1 - src] );
+				_radixRes[i].BindBuffer( UniformID{"DstValueSSB"},  _values[1 - src] );
+				_radixRes[i].BindBuffer( UniformID{"HistogramSSB"}, _histogram );
+
+				DispatchCompute		radix;
+				radix.SetPipeline( _radixPpln[i] );
+				radix.AddResources( DescriptorSetID{"0"}, _radixRes[i] );
+				radix.AddPushConstant( PushConstantID{"PushConst"}, pc );
+				radix.Dispatch( uint2{radix_groups[i], 1} );
+				cmdbuf->AddTask( radix );
+			}
+		}
+
+		_sortedCount = count;
+
+		if ( not validate )
+			return;
+
+		cmdbuf->AddTask( ReadBuffer{}.SetBuffer( _values[0], 0_b, SizeOf<uint> * count )
+									 .SetCallback( [keys, order, count, info = _info] (const BufferView &view)
+									 {
+										Array<uint>		sorted;
+										CopyBufferView( view, count, OUT sorted );
+
+										// keys of particles in order of the previous frame
+										Array<uint>		prev_keys;
+										for (uint idx : *order) {
+											prev_keys.push_back( (*keys)[idx] );
+										}
+
+										// radix sort is stable, so the result must be exactly the same
+										Array<uint>		values;
+										for (uint i = 0; i < count; ++i) {
+											values.push_back( i );
+										}
+										DepthSort::Sort( INOUT *keys, INOUT values );
+
+										uint	mismatched = 0;
+										for (uint i = 0; i < count; ++i) {
+											mismatched += uint(values[i] != sorted[i]);
+										}
+
+										info->count			= count;
+										info->unordered		= DepthSort::CountUnordered( prev_keys );
+										info->mismatched	= mismatched;
+										info->validated		= true;
+
+										FG_LOGI( "Depth sort: "s << ToString( count ) << " particles"
+												 << ", unordered before full sort: " << ToString( info->unordered )
+												 << ", mismatched: " << ToString( mismatched ));
+									 }));
+	}
+
+}	// FG
@@ -0,0 +1,99 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "GpuParticles.h"
+#include "DepthSort.h"
+
+namespace FG
+{
+
+	//
+	// GPU Depth Sort
+	//
+	// Particle indices are sorted by view depth from back to front for alpha blending.
+	// Full radix sort is too expensive for each frame, so it is used every 'interval' frames
+	// and in other frames only tiles of particles are re-sorted, tiles are shifted by half
+	// in odd frames so particles can move between neighbour tiles.
+	// Result can be validated with 'DepthSort'.
+	//
+
+	class GpuDepthSort final
+	{
+	// types
+	public:
+		// result of the last validation on CPU
+		struct Info
+		{
+			uint		count			= 0;
+			uint		unordered		= 0;	// particles in wrong order before full sort
+			uint		mismatched		= 0;	// difference between GPU and CPU sort
+			bool		validated		= false;
+		};
+
+		static constexpr uint	MaxGroups	= 256;	// workgroups of radix sort, histogram size depends on it
+
+	private:
+		// same layout as 'PushConst' in 'radix_sort.glsl'
+		struct RadixSortPushConst
+		{
+			uint		count;
+			uint		shift;
+			uint		groupCount;
+			uint		tilesPerGroup;
+		};
+
+		// same layout as 'PushConst' in 'depth_sort_keys.glsl' and 'depth_sort_local.glsl'
+		struct DepthSortPushConst
+		{
+			uint		count;
+			uint		offset;
+		};
+
+
+	// variables
+	private:
+		BufferID			_keys[2];			// ping-pong buffers for radix sort
+		BufferID			_values[2];			// '_values[0]' is a result
+		BufferID			_histogram;
+
+		CPipelineID			_keysPpln;
+		PipelineResources	_keysRes;
+		CPipelineID			_localPpln;
+		PipelineResources	_localRes;
+		CPipelineID			_radixPpln[3];		// see 'RADIX_PASS' in 'radix_sort.glsl'
+		PipelineResources	_radixRes[3];
+
+		uint				_frame			= 0;
+		uint				_sortedCount	= 0;	// number of particles in '_values[0]'
+		SharedPtr<Info>		_info;				// updated in 'ReadBuffer' callback
+
+
+	// methods
+	public:
+		GpuDepthSort () : _info{ MakeShared<Info>() } {}
+		~GpuDepthSort ();
+
+		void  Destroy (const FrameGraph &fg);
+
+		// resources are bound in 'Sort', order is invalidated
+		void  ReloadShaders (const FrameGraph &fg, const String &defines, const GpuParticles::ShaderLoader_t &loadShader);
+
+		// buffers are created on first use, in VR both eyes use the order of the left eye,
+		// if 'validate' is true then full sort is used and the result is compared with 'DepthSort'
+		void  Sort (const CommandBuffer &cmdbuf, const GpuParticles &particles, RawBufferID cameraUB, uint count, uint interval, bool validate);
+
+		// order must be recalculated, for example when particles are restored
+		void  Invalidate ()						{ _sortedCount = 0; }
+
+		ND_ bool		IsSorted (uint count)	const	{ return _sortedCount == count; }
+		ND_ RawBufferID	Indices ()				const	{ return _values[0]; }
+		ND_ Info const&	GetInfo ()				const	{ return *_info; }
+		ND_ bool		IsReady ()				const	{ return bool(_radixPpln[2]); }
+
+	private:
+		bool  _Create (const FrameGraph &fg, uint maxParticles);
+	};
+
+
+}	// FG
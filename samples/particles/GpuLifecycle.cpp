@@ -0,0 +1,153 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "GpuLifecycle.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	destructor
+=================================================
+*/
+	GpuLifecycle::~GpuLifecycle ()
+	{
+		CHECK( not _dstParticles );
+		CHECK( not _emitPpln );
+		CHECK( not _argsPpln );
+	}
+
+/*
+=================================================
+	Init
+----
+	'_srcIndex' is already written to uniform buffer for this frame, so it is kept
+=================================================
+*/
+	bool  GpuLifecycle::Init (const CommandBuffer &cmdbuf, const GpuParticles &particles, uint count, bool vertexPulling)
+	{
+		FrameGraph		fg			= cmdbuf->GetFrameGraph();
+		const BytesU	buf_size	= fg->GetDescription( particles.Particles() ).size;
+		const uint		block_size	= particles.BlockSize();
+
+		if ( not _dstParticles or fg->GetDescription( _dstParticles ).size != buf_size )
+		{
+			fg->ReleaseResource( _dstParticles );
+
+			_dstParticles = fg->CreateBuffer( BufferDesc{ buf_size, EBufferUsage::Storage | EBufferUsage::Vertex | EBufferUsage::Transfer },
+											  Default, "DstParticles" );
+			CHECK_ERR( _dstParticles );
+		}
+
+		ParticleCounters	counters = {};
+		counters.drawArgs		= (vertexPulling ? uint4{ 4, count, 0, 0 } : uint4{ count, 1, 0, 0 });
+		counters.dispatchArgs	= uint3{ (count + block_size - 1) / block_size, 1, 1 };
+		counters.aliveCount		= uint2{ 0, 0 };
+		counters.aliveCount[_srcIndex] = count;
+
+		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( particles.Counters() ).AddData( &counters, 1 ));
+		return true;
+	}
+
+/*
+=================================================
+	Destroy
+=================================================
+*/
+	void  GpuLifecycle::Destroy (const FrameGraph &fg)
+	{
+		fg->ReleaseResource( _dstParticles );
+		fg->ReleaseResource( _emitPpln );
+		fg->ReleaseResource( _argsPpln );
+	}
+
+/*
+=================================================
+	ReloadShaders
+----
+	old pipelines are kept if compilation failed
+=================================================
+*/
+	void  GpuLifecycle::ReloadShaders (const FrameGraph &fg, const String &defines, const GpuParticles::ShaderLoader_t &loadShader, const GpuParticles &particles)
+	{
+		ComputePipelineDesc	emit_desc;
+		emit_desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + loadShader( "shaders/emit_particles.glsl" ));
+
+		ComputePipelineDesc	args_desc;
+		args_desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + loadShader( "shaders/update_particle_args.glsl" ));
+
+		CPipelineID	emit_ppln = fg->CreatePipeline( emit_desc );
+		CPipelineID	args_ppln = fg->CreatePipeline( args_desc );
+
+		if ( not (emit_ppln and args_ppln) )
+		{
+			fg->ReleaseResource( emit_ppln );
+			fg->ReleaseResource( args_ppln );
+			return;
+		}
+
+		fg->ReleaseResource( _emitPpln );
+		fg->ReleaseResource( _argsPpln );
+		_emitPpln	= std::move(emit_ppln);
+		_argsPpln	= std::move(args_ppln);
+
+		CHECK( fg->InitPipelineResources( _emitPpln, DescriptorSetID{"0"}, OUT _emitRes ));
+		_emitRes.BindBuffer( UniformID{"ParticleCounterSSB"}, particles.Counters() );
+		_emitRes.BindBuffer( UniformID{"ParticleUB"},         particles.UniformBuffer() );
+
+		CHECK( fg->InitPipelineResources( _argsPpln, DescriptorSetID{"0"}, OUT _argsRes ));
+		_argsRes.BindBuffer( UniformID{"ParticleCounterSSB"}, particles.Counters() );
+		_argsRes.BindBuffer( UniformID{"ParticleUB"},         particles.UniformBuffer() );
+	}
+
+/*
+=================================================
+	Update
+----
+	update with compaction to '_dstParticles', then emit new particles,
+	then calculate arguments for indirect draw and for update in the next frame
+=================================================
+*/
+	void  GpuLifecycle::Update (const CommandBuffer &cmdbuf, INOUT GpuParticles &particles, RawCPipelineID updatePpln,
+								INOUT PipelineResources &updateRes, const ParticlesUB &params)
+	{
+		const uint	block_size = particles.BlockSize();
+
+		updateRes.BindBuffer( UniformID{"ParticleSSB"},    particles.Particles() );
+		updateRes.BindBuffer( UniformID{"DstParticleSSB"}, _dstParticles );
+
+		DispatchComputeIndirect		update;
+		update.SetPipeline( updatePpln );
+		update.AddResources( DescriptorSetID{"0"}, updateRes );
+		update.SetLocalSize( uint2{block_size, 1} );
+		update.SetIndirectBuffer( particles.Counters() );
+		update.Dispatch( OffsetOf( &ParticleCounters::dispatchArgs ));
+		cmdbuf->AddTask( update );
+
+		if ( params.emitCount > 0 and _emitPpln )
+		{
+			_emitRes.BindBuffer( UniformID{"DstParticleSSB"}, _dstParticles );
+
+			DispatchCompute		emit;
+			emit.SetPipeline( _emitPpln );
+			emit.AddResources( DescriptorSetID{"0"}, _emitRes );
+			emit.SetLocalSize( uint2{block_size, 1} );
+			emit.Dispatch( uint2{(params.emitCount + block_size - 1) / block_size, 1} );
+			cmdbuf->AddTask( emit );
+		}
+
+		if ( _argsPpln )
+		{
+			DispatchCompute		args;
+			args.SetPipeline( _argsPpln );
+			args.AddResources( DescriptorSetID{"0"}, _argsRes );
+			args.Dispatch( uint2{1, 1} );
+			cmdbuf->AddTask( args );
+		}
+
+		// alive particles are in particle buffer for draw and for the next frame
+		particles.SwapParticles( INOUT _dstParticles );
+		_srcIndex = 1 - _srcIndex;
+	}
+
+}	// FG
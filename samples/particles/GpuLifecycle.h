@@ -0,0 +1,59 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "GpuParticles.h"
+
+namespace FG
+{
+
+	//
+	// GPU Particle Lifecycle
+	//
+	// Particles are killed instead of restart, only alive particles are updated and drawn.
+	// Alive particles are compacted to the second buffer by 'simulation.glsl', then new particles
+	// are emitted by 'emit_particles.glsl' and arguments for indirect draw and for update
+	// in the next frame are calculated by 'update_particle_args.glsl'.
+	// Number of alive particles is known only on GPU.
+	//
+
+	class GpuLifecycle final
+	{
+	// types
+	public:
+		using ParticlesUB		= GpuParticles::ParticlesUB;
+		using ParticleCounters	= GpuParticles::ParticleCounters;
+
+
+	// variables
+	private:
+		BufferID			_dstParticles;		// swapped with particle buffer every frame
+		CPipelineID			_emitPpln;
+		PipelineResources	_emitRes;
+		CPipelineID			_argsPpln;
+		PipelineResources	_argsRes;
+		uint				_srcIndex	= 0;	// index of current particle buffer in 'ParticleCounters::aliveCount'
+
+
+	// methods
+	public:
+		GpuLifecycle () {}
+		~GpuLifecycle ();
+
+		// all particles must be initialized by 'init_simulation.glsl', first 'count' particles are alive
+		bool  Init (const CommandBuffer &cmdbuf, const GpuParticles &particles, uint count, bool vertexPulling);
+		void  Destroy (const FrameGraph &fg);
+
+		void  ReloadShaders (const FrameGraph &fg, const String &defines, const GpuParticles::ShaderLoader_t &loadShader, const GpuParticles &particles);
+
+		// 'updatePpln' is a simulation pipeline that is compiled with 'PARTICLE_LIFECYCLE',
+		// compacted particles become current particles
+		void  Update (const CommandBuffer &cmdbuf, INOUT GpuParticles &particles, RawCPipelineID updatePpln,
+					  INOUT PipelineResources &updateRes, const ParticlesUB &params);
+
+		ND_ uint  SrcIndex ()	const	{ return _srcIndex; }
+		ND_ bool  IsCreated ()	const	{ return bool(_dstParticles); }
+	};
+
+
+}	// FG
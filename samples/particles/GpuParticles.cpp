@@ -0,0 +1,135 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "GpuParticles.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	destructor
+=================================================
+*/
+	GpuParticles::~GpuParticles ()
+	{
+		CHECK( not _particlesUB );
+		CHECK( not _particles );
+		CHECK( not _counters );
+	}
+
+/*
+=================================================
+	Create
+=================================================
+*/
+	bool  GpuParticles::Create (const FrameGraph &fg, uint maxParticles, uint blockSize)
+	{
+		CHECK_ERR( maxParticles % blockSize == 0 );
+
+		_maxParticles	= maxParticles;
+		_blockSize		= blockSize;
+		_format			= EFormat::Float;
+
+		_particlesUB = fg->CreateBuffer( BufferDesc{ SizeOf<ParticlesUB>, EBufferUsage::Uniform | EBufferUsage::Transfer }, Default, "ParticlesUB" );
+		CHECK_ERR( _particlesUB );
+
+		_particles = fg->CreateBuffer( BufferDesc{ ParticleSize() * _maxParticles, EBufferUsage::Storage | EBufferUsage::Vertex | EBufferUsage::Transfer },
+									   Default, "Particles" );
+		CHECK_ERR( _particles );
+
+		_palette = fg->CreateBuffer( BufferDesc{ SizeOf<uint> * ParticleSimulator::PaletteSize, EBufferUsage::Storage }, Default, "ParticlePalette" );
+		CHECK_ERR( _palette );
+
+		_counters = fg->CreateBuffer( BufferDesc{ SizeOf<ParticleCounters>, EBufferUsage::Storage | EBufferUsage::Indirect | EBufferUsage::Transfer },
+									  Default, "ParticleCounters" );
+		CHECK_ERR( _counters );
+		return true;
+	}
+
+/*
+=================================================
+	Destroy
+=================================================
+*/
+	void  GpuParticles::Destroy (const FrameGraph &fg)
+	{
+		fg->ReleaseResource( _particlesUB );
+		fg->ReleaseResource( _particles );
+		fg->ReleaseResource( _palette );
+		fg->ReleaseResource( _counters );
+	}
+
+/*
+=================================================
+	Reset
+=================================================
+*/
+	bool  GpuParticles::Reset (const FrameGraph &fg, uint mode, EFormat format)
+	{
+		_mode	= mode;
+		_format	= format;
+
+		const BytesU	buf_size = ParticleSize() * _maxParticles;
+
+		if ( fg->GetDescription( _particles ).size == buf_size )
+			return true;
+
+		fg->ReleaseResource( _particles );
+		_particles = fg->CreateBuffer( BufferDesc{ buf_size, EBufferUsage::Storage | EBufferUsage::Vertex | EBufferUsage::Transfer },
+									   Default, "Particles" );
+		CHECK_ERR( _particles );
+		return true;
+	}
+
+/*
+=================================================
+	Read
+=================================================
+*/
+	void  GpuParticles::Read (const CommandBuffer &cmdbuf, uint count, ReadParticlesFn_t &&fn) const
+	{
+		STATIC_ASSERT( sizeof(ParticleVertex) == sizeof(ParticleSimulator::Particle) );
+		STATIC_ASSERT( sizeof(PackedParticleVertex) == 32 );
+
+		if ( _format == EFormat::Float )
+		{
+			cmdbuf->AddTask( ReadBuffer{}.SetBuffer( _particles, 0_b, SizeOf<ParticleVertex> * count )
+										 .SetCallback( [fn = std::move(fn), count] (const BufferView &view)
+										 {
+											Array<ParticleSimulator::Particle>	particles;
+											CopyBufferView( view, count, OUT particles );
+											fn( particles );
+										 }));
+			return;
+		}
+
+		cmdbuf->AddTask( ReadBuffer{}.SetBuffer( _particles, 0_b, SizeOf<PackedParticleVertex> * count )
+									 .SetCallback( [fn = std::move(fn), count, mode = _mode] (const BufferView &view)
+									 {
+										Array<PackedParticleVertex>			packed;
+										Array<ParticleSimulator::Particle>	particles;
+
+										CopyBufferView( view, count, OUT packed );
+										CHECK_ERRV( ParticleSimulator::Unpack( mode, packed, OUT particles ));
+										fn( particles );
+									 }));
+	}
+
+/*
+=================================================
+	ParticleSize
+=================================================
+*/
+	BytesU  GpuParticles::ParticleSize (EFormat format)
+	{
+		BEGIN_ENUM_CHECKS();
+		switch ( format )
+		{
+			case EFormat::Float :	return SizeOf<ParticleVertex>;
+			case EFormat::Packed :	return SizeOf<PackedParticleVertex>;
+		}
+		END_ENUM_CHECKS();
+		return 0_b;
+	}
+
+}	// FG
@@ -0,0 +1,136 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "ParticleSimulator.h"
+
+namespace FG
+{
+
+	//
+	// GPU Particles
+	//
+	// Particle buffers that are shared between simulation, sort, draw and snapshot stages.
+	// Particle buffer size depends on format, other buffers are allocated for max particle count.
+	//
+
+	class GpuParticles final
+	{
+	// types
+	public:
+		struct ParticlesUB
+		{
+			uint		steps;
+			float		timeDelta;
+			float		globalTime;
+			uint		emitCount;		// lifecycle only
+			float		maxLifetime;	// lifecycle only
+			uint		srcIndex;		// lifecycle only
+			uint		maxParticles;
+		};
+
+		// same layout as 'ParticleCounters' in 'simulation_shared.glsl'
+		struct ParticleCounters
+		{
+			uint4		drawArgs;
+			uint3		dispatchArgs;
+			uint		_padding;
+			uint2		aliveCount;
+		};
+
+		struct ParticleVertex
+		{
+			float3		position;
+			float		size;
+			float3		velocity;
+			RGBA8u		color;
+			float4		param;
+		};
+
+		using PackedParticleVertex = ParticleSimulator::PackedParticle;
+
+		enum class EFormat : uint
+		{
+			Float,		// 'ParticleVertex'
+			Packed,		// 'PackedParticleVertex', half precision with palette
+			Unknown		= Float,
+		};
+
+		using ReadParticlesFn_t = Function< void (ArrayView<ParticleSimulator::Particle>) >;
+
+		// returns shader source, path is relative to the sample directory
+		using ShaderLoader_t	= Function< String (NtStringView) >;
+
+
+	// variables
+	private:
+		BufferID		_particlesUB;
+		BufferID		_particles;
+		BufferID		_counters;
+		BufferID		_palette;			// colors for packed format
+
+		EFormat			_format			= Default;
+		uint			_mode			= 0;
+		uint			_maxParticles	= 0;
+		uint			_blockSize		= 0;	// workgroup size of all particle stages
+
+
+	// methods
+	public:
+		GpuParticles () {}
+		~GpuParticles ();
+
+		bool  Create (const FrameGraph &fg, uint maxParticles, uint blockSize);
+		void  Destroy (const FrameGraph &fg);
+
+		// must be called before particles are initialized for simulation 'mode',
+		// particle buffer is recreated if size is changed, content is undefined after that
+		bool  Reset (const FrameGraph &fg, uint mode, EFormat format);
+
+		// alive particles are swapped with compacted particles in lifecycle mode
+		void  SwapParticles (INOUT BufferID &other)		{ std::swap( _particles, other ); }
+
+		// packed particles are unpacked, 'fn' is called from 'ReadBuffer' callback
+		void  Read (const CommandBuffer &cmdbuf, uint count, ReadParticlesFn_t &&fn) const;
+
+		ND_ RawBufferID	UniformBuffer ()	const	{ return _particlesUB; }
+		ND_ RawBufferID	Particles ()		const	{ return _particles; }
+		ND_ RawBufferID	Counters ()			const	{ return _counters; }
+		ND_ RawBufferID	Palette ()			const	{ return _palette; }
+
+		ND_ EFormat		Format ()			const	{ return _format; }
+		ND_ uint		Mode ()				const	{ return _mode; }
+		ND_ bool		IsPacked ()			const	{ return _format == EFormat::Packed; }
+		ND_ uint		MaxParticles ()		const	{ return _maxParticles; }
+		ND_ uint		BlockSize ()		const	{ return _blockSize; }
+		ND_ BytesU		ParticleSize ()		const	{ return ParticleSize( _format ); }
+
+		ND_ static BytesU  ParticleSize (EFormat format);
+	};
+
+
+/*
+=================================================
+	CopyBufferView
+----
+	copies 'count' elements from parts of buffer view
+=================================================
+*/
+	template <typename T>
+	inline void  CopyBufferView (const BufferView &view, size_t count, OUT Array<T> &dst)
+	{
+		dst.resize( count );
+
+		auto*	ptr = Cast<uint8_t>( dst.data() );
+		auto*	end = ptr + sizeof(T) * count;
+
+		for (auto& part : view.Parts())
+		{
+			const size_t	size = Min( part.size(), size_t(end - ptr) );
+			std::memcpy( ptr, part.data(), size );
+			ptr += size;
+		}
+	}
+
+
+}	// FG
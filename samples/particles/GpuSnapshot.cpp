@@ -0,0 +1,161 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "GpuSnapshot.h"
+#include "stl/Algorithms/StringUtils.h"
+
+namespace FG
+{
+namespace
+{
+	using Clock		= std::chrono::high_resolution_clock;
+	using ESection	= ParticleSnapshot::ESection;
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	Save
+----
+	chunks are compressed and written in callbacks
+=================================================
+*/
+	void  GpuSnapshot::Save (const CommandBuffer &cmdbuf, const GpuParticles &particles, const Header &header, StringView filename)
+	{
+		struct Section
+		{
+			ESection		section;
+			RawBufferID		buffer;
+			BytesU			size;
+			uint			stride;
+		};
+
+		FrameGraph		fg = cmdbuf->GetFrameGraph();
+		Array<Section>	sections;
+
+		sections.push_back({ ESection::Particles, particles.Particles(), fg->GetDescription( particles.Particles() ).size, uint(particles.ParticleSize()) });
+
+		if ( header.lifecycle )
+			sections.push_back({ ESection::Counters, particles.Counters(), SizeOf<GpuParticles::ParticleCounters>, uint(sizeof(GpuParticles::ParticleCounters)) });
+
+		Header	hdr		= header;
+		hdr.format		= uint(particles.Format());
+		hdr.maxParticles= particles.MaxParticles();
+		hdr.blockSize	= particles.BlockSize();
+		hdr.sectionCount= uint(sections.size());
+
+		auto	writer = MakeShared<ParticleSnapshot::Writer>( String{filename} );
+		CHECK_ERRV( writer->IsOpen() and writer->WriteHeader( hdr ));
+
+		const auto	start_time = Clock::now();
+
+		for (auto& sect : sections)
+		{
+			const BytesU	chunk_size { ParticleSnapshot::ChunkSize / sect.stride * sect.stride };
+
+			for (BytesU offset; offset < sect.size; offset += chunk_size)
+			{
+				const BytesU	size	= Min( chunk_size, sect.size - offset );
+				const bool		first	= (offset == 0_b);
+				const bool		last	= (&sect == &sections.back() and offset + size == sect.size);
+
+				cmdbuf->AddTask( ReadBuffer{}.SetBuffer( sect.buffer, offset, size )
+											 .SetCallback( [writer, sect, size, first, last, start_time, name = String{filename}] (const BufferView &view)
+											 {
+												if ( first )
+													CHECK_ERRV( writer->BeginSection( sect.section, sect.stride, uint64_t(sect.size) ));
+
+												Array<uint8_t>	data;
+												CopyBufferView( view, size_t(size), OUT data );
+												CHECK_ERRV( writer->WriteChunk( data ));
+
+												if ( last )
+												{
+													const auto	dt = std::chrono::duration_cast<Nanoseconds>( Clock::now() - start_time );
+
+													FG_LOGI( "Particle snapshot saved to '"s << name << "'"
+															 << ", size: " << ToString( BytesU{writer->RawSize()} ) << ", compressed: " << ToString( BytesU{writer->PackedSize()} )
+															 << ", time: " << ToString( dt ));
+												}
+											 }));
+			}
+		}
+	}
+
+/*
+=================================================
+	Restore
+----
+	chunks are decompressed and uploaded one by one, data is copied to staging buffer in 'AddTask',
+	so only single chunk is kept in memory
+=================================================
+*/
+	GpuSnapshot::ERestore  GpuSnapshot::Restore (const CommandBuffer &cmdbuf, const GpuParticles &particles, INOUT Header &header, StringView filename)
+	{
+		ParticleSnapshot::Reader	reader{ String{filename} };
+		Header						snapshot;
+
+		if ( not reader.IsOpen()								or
+			 not reader.ReadHeader( OUT snapshot )				or
+			 snapshot.maxParticles	!= particles.MaxParticles()	or
+			 snapshot.blockSize		!= particles.BlockSize()	or
+			 snapshot.particleCount	 > particles.MaxParticles() )
+		{
+			FG_LOGI( "Failed to restore particle snapshot from '"s << filename << "'" );
+			return ERestore::Failed;
+		}
+
+		const uint	src_index	= header.srcIndex;
+		const bool	mismatch	= (snapshot.mode != header.mode or snapshot.format != header.format or snapshot.lifecycle != header.lifecycle);
+
+		header = snapshot;
+
+		if ( mismatch )
+			return ERestore::Mismatch;
+
+		FrameGraph		fg			= cmdbuf->GetFrameGraph();
+		const auto		start_time	= Clock::now();
+		Array<uint8_t>	data;
+
+		for (uint i = 0; i < snapshot.sectionCount; ++i)
+		{
+			ParticleSnapshot::SectionHeader	sect;
+			CHECK_ERR( reader.ReadSection( OUT sect ), ERestore::Failed );
+
+			RawBufferID		buffer;
+			BEGIN_ENUM_CHECKS();
+			switch ( sect.section )
+			{
+				case ESection::Particles :	buffer = particles.Particles();	break;
+				case ESection::Counters :	buffer = particles.Counters();	break;
+				case ESection::_Count :		break;
+			}
+			END_ENUM_CHECKS();
+			CHECK_ERR( buffer and fg->GetDescription( buffer ).size == BytesU{sect.size}, ERestore::Failed );
+
+			for (uint64_t offset = 0; offset < sect.size; offset += data.size())
+			{
+				CHECK_ERR( reader.ReadChunk( OUT data ) and not data.empty(), ERestore::Failed );
+
+				// alive count of source buffer must be at current source index, it is already written to uniform buffer
+				if ( sect.section == ESection::Counters and snapshot.srcIndex != src_index )
+				{
+					GpuParticles::ParticleCounters	counters;
+					CHECK_ERR( data.size() == sizeof(counters), ERestore::Failed );
+					std::memcpy( &counters, data.data(), sizeof(counters) );
+					std::swap( counters.aliveCount.x, counters.aliveCount.y );
+					std::memcpy( data.data(), &counters, sizeof(counters) );
+				}
+
+				cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( buffer ).AddData( data.data(), data.size(), BytesU{offset} ));
+			}
+		}
+
+		const auto	dt = std::chrono::duration_cast<Nanoseconds>( Clock::now() - start_time );
+		FG_LOGI( "Particle snapshot restored: "s << ToString( snapshot.particleCount ) << " particles, time: " << ToString( dt ));
+
+		return ERestore::Restored;
+	}
+
+}	// FG
@@ -0,0 +1,43 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "GpuParticles.h"
+#include "ParticleSnapshot.h"
+
+namespace FG
+{
+
+	//
+	// GPU Snapshot
+	//
+	// Saves particle buffers to 'ParticleSnapshot' file and restores them.
+	// Buffers are read back and uploaded by chunks, callbacks are called in the same order as tasks are added.
+	//
+
+	class GpuSnapshot final
+	{
+	// types
+	public:
+		using Header = ParticleSnapshot::Header;
+
+		enum class ERestore : uint
+		{
+			Failed,
+			Mismatch,		// particles must be reinitialized with settings of snapshot, then restored again
+			Restored,
+		};
+
+
+	// methods
+	public:
+		// 'header' - mode, lifecycle, srcIndex, particle count and global time,
+		// other fields are filled from 'particles'
+		static void  Save (const CommandBuffer &cmdbuf, const GpuParticles &particles, const Header &header, StringView filename);
+
+		// 'header' - current settings as input, snapshot header as output
+		ND_ static ERestore  Restore (const CommandBuffer &cmdbuf, const GpuParticles &particles, INOUT Header &header, StringView filename);
+	};
+
+
+}	// FG
@@ -0,0 +1,277 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "GpuSpatialHash.h"
+#include "stl/Algorithms/StringUtils.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	destructor
+=================================================
+*/
+	GpuSpatialHash::~GpuSpatialHash ()
+	{
+		CHECK( not _cellCounts );
+		CHECK( not _scatterPpln );
+	}
+
+/*
+=================================================
+	Create
+----
+	counters are cleared in 'spatial_hash_scan.glsl' after use,
+	so they are cleared only once
+=================================================
+*/
+	bool  GpuSpatialHash::Create (const CommandBuffer &cmdbuf, const GpuParticles &particles, uint cellCount)
+	{
+		if ( _cellCounts )
+			return true;
+
+		FrameGraph		fg				= cmdbuf->GetFrameGraph();
+		const uint		max_particles	= particles.MaxParticles();
+
+		CHECK_ERR( IsPowerOfTwo( cellCount ) and cellCount % particles.BlockSize() == 0 );
+		_cellCount = cellCount;
+
+		_hashUB				= fg->CreateBuffer( BufferDesc{ SizeOf<SpatialHashUB>, EBufferUsage::Uniform | EBufferUsage::TransferDst }, Default, "SpatialHashUB" );
+		_cellCounts			= fg->CreateBuffer( BufferDesc{ SizeOf<uint> * _cellCount, EBufferUsage::Storage | EBufferUsage::TransferDst }, Default, "CellCounts" );
+		_cellStart			= fg->CreateBuffer( BufferDesc{ SizeOf<uint> * (_cellCount + 1), EBufferUsage::Storage | EBufferUsage::TransferSrc }, Default, "CellStart" );
+		_blockSums			= fg->CreateBuffer( BufferDesc{ SizeOf<uint> * (_cellCount / particles.BlockSize()), EBufferUsage::Storage }, Default, "CellBlockSums" );
+		_particleCells		= fg->CreateBuffer( BufferDesc{ SizeOf<uint2> * max_particles, EBufferUsage::Storage }, Default, "ParticleCells" );
+		_sortedParticles	= fg->CreateBuffer( BufferDesc{ SizeOf<SortedParticle> * max_particles, EBufferUsage::Storage | EBufferUsage::TransferSrc }, Default, "SortedParticles" );
+		CHECK_ERR( _hashUB and _cellCounts and _cellStart and _blockSums and _particleCells and _sortedParticles );
+
+		Array<uint>	zeros;
+		zeros.resize( _cellCount, 0u );
+		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _cellCounts ).AddData( zeros ));
+
+		*_info = Info{};
+		return true;
+	}
+
+/*
+=================================================
+	Destroy
+=================================================
+*/
+	void  GpuSpatialHash::Destroy (const FrameGraph &fg)
+	{
+		fg->ReleaseResource( _hashUB );
+		fg->ReleaseResource( _cellCounts );
+		fg->ReleaseResource( _cellStart );
+		fg->ReleaseResource( _blockSums );
+		fg->ReleaseResource( _particleCells );
+		fg->ReleaseResource( _sortedParticles );
+
+		fg->ReleaseResource( _countPpln );
+		fg->ReleaseResource( _scatterPpln );
+
+		for (auto& ppln : _scanPpln) {
+			fg->ReleaseResource( ppln );
+		}
+	}
+
+/*
+=================================================
+	ReloadShaders
+----
+	old pipelines are kept if compilation failed
+=================================================
+*/
+	void  GpuSpatialHash::ReloadShaders (const FrameGraph &fg, const String &defines, const GpuParticles::ShaderLoader_t &loadShader, const GpuParticles &particles)
+	{
+		CHECK_ERRV( _cellCounts );
+
+		ComputePipelineDesc	count_desc;
+		count_desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + loadShader( "shaders/spatial_hash_count.glsl" ));
+
+		ComputePipelineDesc	scatter_desc;
+		scatter_desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + loadShader( "shaders/spatial_hash_scatter.glsl" ));
+
+		const String		scan_source	= loadShader( "shaders/spatial_hash_scan.glsl" );
+		decltype(_scanPpln)	scan_ppln;
+		bool				scan_ok		= true;
+
+		for (size_t i = 0; i < CountOf(scan_ppln); ++i)
+		{
+			ComputePipelineDesc	scan_desc;
+			scan_desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + "#define SCAN_PASS " + ToString(i) + "\n" + scan_source );
+
+			scan_ppln[i] = fg->CreatePipeline( scan_desc );
+			scan_ok &= bool(scan_ppln[i]);
+		}
+
+		CPipelineID	count_ppln		= fg->CreatePipeline( count_desc );
+		CPipelineID	scatter_ppln	= fg->CreatePipeline( scatter_desc );
+
+		if ( not (count_ppln and scatter_ppln and scan_ok) )
+		{
+			fg->ReleaseResource( count_ppln );
+			fg->ReleaseResource( scatter_ppln );
+
+			for (auto& ppln : scan_ppln) {
+				fg->ReleaseResource( ppln );
+			}
+			return;
+		}
+
+		fg->ReleaseResource( _countPpln );
+		fg->ReleaseResource( _scatterPpln );
+		_countPpln		= std::move(count_ppln);
+		_scatterPpln	= std::move(scatter_ppln);
+
+		CHECK( fg->InitPipelineResources( _countPpln, DescriptorSetID{"0"}, OUT _countRes ));
+		_countRes.BindBuffer( UniformID{"ParticleSSB"},      particles.Particles() );
+		_countRes.BindBuffer( UniformID{"SpatialHashUB"},    _hashUB );
+		_countRes.BindBuffer( UniformID{"CellCountSSB"},     _cellCounts );
+		_countRes.BindBuffer( UniformID{"ParticleCellSSB"},  _particleCells );
+
+		for (size_t i = 0; i < CountOf(_scanPpln); ++i)
+		{
+			fg->ReleaseResource( _scanPpln[i] );
+			_scanPpln[i] = std::move(scan_ppln[i]);
+
+			CHECK( fg->InitPipelineResources( _scanPpln[i], DescriptorSetID{"0"}, OUT _scanRes[i] ));
+			_scanRes[i].BindBuffer( UniformID{"CellCountSSB"},  _cellCounts );
+			_scanRes[i].BindBuffer( UniformID{"CellStartSSB"},  _cellStart );
+			_scanRes[i].BindBuffer( UniformID{"BlockSumSSB"},   _blockSums );
+			_scanRes[i].BindBuffer( UniformID{"SpatialHashUB"}, _hashUB );
+		}
+
+		CHECK( fg->InitPipelineResources( _scatterPpln, DescriptorSetID{"0"}, OUT _scatterRes ));
+		_scatterRes.BindBuffer( UniformID{"ParticleSSB"},       particles.Particles() );
+		_scatterRes.BindBuffer( UniformID{"SpatialHashUB"},     _hashUB );
+		_scatterRes.BindBuffer( UniformID{"ParticleCellSSB"},   _particleCells );
+		_scatterRes.BindBuffer( UniformID{"CellStartSSB"},      _cellStart );
+		_scatterRes.BindBuffer( UniformID{"SortedParticleSSB"}, _sortedParticles );
+	}
+
+/*
+=================================================
+	BindSimulation
+=================================================
+*/
+	void  GpuSpatialHash::BindSimulation (INOUT PipelineResources &res) const
+	{
+		res.BindBuffer( UniformID{"SpatialHashUB"},     _hashUB );
+		res.BindBuffer( UniformID{"CellStartSSB"},      _cellStart );
+		res.BindBuffer( UniformID{"SortedParticleSSB"}, _sortedParticles );
+	}
+
+/*
+=================================================
+	Update
+----
+	sorts particles by cell, see 'shaders/spatial_hash_shared.glsl'
+=================================================
+*/
+	void  GpuSpatialHash::Update (const CommandBuffer &cmdbuf, const GpuParticles &particles, uint count, float cellSize, bool validate)
+	{
+		const uint	block_size	= particles.BlockSize();
+		const uint	group_count	= (count + block_size - 1) / block_size;
+		const uint	cell_groups	= _cellCount / block_size;
+		auto		positions	= validate ? MakeShared<Array<float3>>() : null;
+		auto		cell_start	= validate ? MakeShared<Array<uint>>() : null;
+
+		SpatialHashUB	hash;
+		hash.cellSize		= cellSize;
+		hash.invCellSize	= 1.0f / cellSize;
+		hash.cellCount		= _cellCount;
+		hash.particleCount	= count;
+		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _hashUB ).AddData( &hash, 1 ));
+
+		// hash stages don't modify particles, callbacks are called in the same order as tasks are added
+		if ( validate )
+		{
+			particles.Read( cmdbuf, count, [positions] (ArrayView<ParticleSimulator::Particle> src)
+			{
+				positions->resize( src.size() );
+				for (size_t i = 0; i < src.size(); ++i) {
+					(*positions)[i] = src[i].position;
+				}
+			});
+		}
+
+		DispatchCompute		hash_count;
+		hash_count.SetPipeline( _countPpln );
+		hash_count.AddResources( DescriptorSetID{"0"}, _countRes );
+		hash_count.SetLocalSize( uint2{block_size, 1} );
+		hash_count.Dispatch( uint2{group_count, 1} );
+		cmdbuf->AddTask( hash_count );
+
+		// see 'SCAN_PASS' in 'spatial_hash_scan.glsl'
+		const uint	scan_groups[] = { cell_groups, 1, cell_groups };
+
+		for (size_t i = 0; i < CountOf(scan_groups); ++i)
+		{
+			DispatchCompute		scan;
+			scan.SetPipeline( _scanPpln[i] );
+			scan.AddResources( DescriptorSetID{"0"}, _scanRes[i] );
+			scan.Dispatch( uint2{scan_groups[i], 1} );
+			cmdbuf->AddTask( scan );
+		}
+
+		DispatchCompute		scatter;
+		scatter.SetPipeline( _scatterPpln );
+		scatter.AddResources( DescriptorSetID{"0"}, _scatterRes );
+		scatter.SetLocalSize( uint2{block_size, 1} );
+		scatter.Dispatch( uint2{group_count, 1} );
+		cmdbuf->AddTask( scatter );
+
+		if ( not validate )
+			return;
+
+		cmdbuf->AddTask( ReadBuffer{}.SetBuffer( _cellStart, 0_b, SizeOf<uint> * (_cellCount + 1) )
+									 .SetCallback( [cell_start, size = _cellCount + 1] (const BufferView &view)
+									 {
+										CopyBufferView( view, size, OUT *cell_start );
+									 }));
+
+		cmdbuf->AddTask( ReadBuffer{}.SetBuffer( _sortedParticles, 0_b, SizeOf<SortedParticle> * count )
+									 .SetCallback( [positions, cell_start, count, info = _info, cell_size = cellSize, cell_count = _cellCount] (const BufferView &view)
+									 {
+										Array<SortedParticle>	sorted;
+										CopyBufferView( view, count, OUT sorted );
+
+										SpatialHash		ref;
+										CHECK_ERRV( ref.Init( cell_size, cell_count ));
+										CHECK_ERRV( ref.Build( *positions ));
+
+										// order of particles in cell depends on order of atomic operations, so sets of particles are compared
+										const auto	ref_start	= ref.CellStart();
+										uint		mismatched	= 0;
+										Array<uint>	indices;
+
+										for (uint cell = 0; cell < cell_count; ++cell)
+										{
+											if ( ref_start[cell] != (*cell_start)[cell] or ref_start[cell+1] != (*cell_start)[cell+1] )
+											{
+												++mismatched;
+												continue;
+											}
+
+											indices.clear();
+											for (uint i = ref_start[cell]; i < ref_start[cell+1]; ++i) {
+												indices.push_back( BitCast<uint>( sorted[i].position.w ));
+											}
+
+											auto	ref_indices = ref.CellParticles( cell );
+											mismatched += uint(not std::is_permutation( indices.begin(), indices.end(), ref_indices.begin(), ref_indices.end() ));
+										}
+
+										info->timings			= ref.GetTimings();
+										info->stats				= ref.CalcStats();
+										info->mismatchedCells	= mismatched;
+										info->validated			= true;
+
+										FG_LOGI( "Spatial hash: "s << ToString( count ) << " particles, " << ToString( cell_count ) << " cells"
+												 << ", used cells: " << ToString( info->stats.usedCells )
+												 << ", max particles per cell: " << ToString( info->stats.maxPerCell )
+												 << ", mismatched cells: " << ToString( mismatched ));
+									 }));
+	}
+
+}	// FG
@@ -0,0 +1,92 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "GpuParticles.h"
+#include "SpatialHash.h"
+
+namespace FG
+{
+
+	//
+	// GPU Spatial Hash
+	//
+	// Particles are sorted by cell every frame for neighbour search, see 'shaders/spatial_hash_shared.glsl'.
+	// Result can be validated with 'SpatialHash'.
+	//
+
+	class GpuSpatialHash final
+	{
+	// types
+	public:
+		// result of the last validation on CPU
+		struct Info
+		{
+			SpatialHash::Timings	timings;
+			SpatialHash::Stats		stats;
+			uint					mismatchedCells	= 0;
+			bool					validated		= false;
+		};
+
+	private:
+		struct SpatialHashUB
+		{
+			float		cellSize;
+			float		invCellSize;
+			uint		cellCount;
+			uint		particleCount;
+		};
+
+		// same layout as 'SortedParticle' in 'spatial_hash_shared.glsl'
+		struct SortedParticle
+		{
+			float4		position;	// 'w' - particle index
+			float4		velocity;
+		};
+
+
+	// variables
+	private:
+		BufferID			_hashUB;
+		BufferID			_cellCounts;
+		BufferID			_cellStart;
+		BufferID			_blockSums;			// for prefix sum
+		BufferID			_particleCells;		// cell and rank in cell for each particle
+		BufferID			_sortedParticles;
+
+		CPipelineID			_countPpln;
+		PipelineResources	_countRes;
+		CPipelineID			_scanPpln[3];		// see 'SCAN_PASS' in 'spatial_hash_scan.glsl'
+		PipelineResources	_scanRes[3];
+		CPipelineID			_scatterPpln;
+		PipelineResources	_scatterRes;
+
+		uint				_cellCount		= 0;
+		SharedPtr<Info>		_info;				// updated in 'ReadBuffer' callback
+
+
+	// methods
+	public:
+		GpuSpatialHash () : _info{ MakeShared<Info>() } {}
+		~GpuSpatialHash ();
+
+		// 'cellCount' must be a power of 2 and a multiple of block size
+		bool  Create (const CommandBuffer &cmdbuf, const GpuParticles &particles, uint cellCount);
+		void  Destroy (const FrameGraph &fg);
+
+		void  ReloadShaders (const FrameGraph &fg, const String &defines, const GpuParticles::ShaderLoader_t &loadShader, const GpuParticles &particles);
+
+		// binds sorted particles for neighbour search in simulation
+		void  BindSimulation (INOUT PipelineResources &res) const;
+
+		// if 'validate' is true then the result is compared with 'SpatialHash'
+		void  Update (const CommandBuffer &cmdbuf, const GpuParticles &particles, uint count, float cellSize, bool validate);
+
+		ND_ Info const&	GetInfo ()		const	{ return *_info; }
+		ND_ uint		CellCount ()	const	{ return _cellCount; }
+		ND_ bool		IsCreated ()	const	{ return bool(_cellCounts); }
+		ND_ bool		IsReady ()		const	{ return bool(_scatterPpln); }
+	};
+
+
+}	// FG
@@ -0,0 +1,42 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "GpuStepScheduler.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	Advance
+----
+	GPU time of the previous frame is used to estimate cost of step
+=================================================
+*/
+	GpuStepScheduler::Frame const&  GpuStepScheduler::Advance (const FrameGraph &fg, SecondsF frameTime, const Config &cfg)
+	{
+		IFrameGraph::Statistics	stats;
+
+		if ( fg->GetStatistics( OUT stats ))
+		{
+			_gpuTime = stats.renderer.gpuTime;
+			_scheduler.UpdateStepCost( stats.renderer.gpuTime, _frame.steps );
+		}
+		else
+			_gpuTime.reset();
+
+		_frame = _scheduler.Advance( frameTime, cfg );
+		return _frame;
+	}
+
+/*
+=================================================
+	Restart
+=================================================
+*/
+	void  GpuStepScheduler::Restart ()
+	{
+		if ( not _scheduler.IsRecording() and not _scheduler.IsReplaying() )
+			_scheduler.Reset();
+	}
+
+}	// FG
@@ -0,0 +1,55 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "StepScheduler.h"
+
+namespace FG
+{
+
+	//
+	// GPU Step Scheduler
+	//
+	// Feeds GPU time of the previous frame to 'StepScheduler', so the number of
+	// simulation steps fits into GPU budget. Frame statistics are available
+	// only for the previous frame, they are kept for other consumers.
+	//
+
+	class GpuStepScheduler final
+	{
+	// types
+	public:
+		using Config	= StepScheduler::Config;
+		using Frame		= StepScheduler::Frame;
+
+
+	// variables
+	private:
+		StepScheduler		_scheduler;
+		Frame				_frame;
+		Optional<SecondsF>	_gpuTime;		// of the previous frame
+
+
+	// methods
+	public:
+		GpuStepScheduler () {}
+
+		// returns steps for the current frame
+		Frame const&  Advance (const FrameGraph &fg, SecondsF frameTime, const Config &cfg);
+
+		// simulation time starts from zero, but recording and replay are started together with simulation
+		void  Restart ();
+
+		// continues simulation from restored state, steps of the current frame start at 'globalTime'
+		void  Continue (double globalTime)		{ _scheduler.SetGlobalTime( globalTime + double(_frame.stepTime) * _frame.steps ); }
+
+		ND_ Frame const&				GetFrame ()		const	{ return _frame; }
+		ND_ Optional<SecondsF> const&	GpuTime ()		const	{ return _gpuTime; }
+
+		// record and replay
+		ND_ StepScheduler&				Scheduler ()			{ return _scheduler; }
+		ND_ StepScheduler const&		Scheduler ()	const	{ return _scheduler; }
+	};
+
+
+}	// FG
@@ -0,0 +1,917 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "ParticleSimulator.h"
+#include "Threading/ParallelFor.h"
+
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_AMD64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+#	define PARTICLE_SIMULATOR_SSE
+#	include <emmintrin.h>
+#endif
+
+namespace FG
+{
+
+	//
+	// Particle State
+	//
+	struct ParticleSimulator::State
+	{
+		float3		pos;
+		float3		vel;
+		float		sign			= 0.0f;
+		float		restartTime		= 0.0f;
+		float		lifeTime		= 0.0f;
+		float		size			= 0.0f;
+	};
+
+namespace {
+
+	struct GravityObject
+	{
+		float3		position;
+		float		gravity		= 0.0f;
+		float		radius		= 0.0f;
+	};
+
+	struct MagneticObject
+	{
+		float3		north;
+		float3		south;
+		float		induction	= 0.0f;
+	};
+
+	enum class EEmitter : uint
+	{
+		ConeZXY,		// modes 1, 4
+		Cone,			// mode 3
+		Sphere,			// mode 5
+	};
+
+	enum class EColor : uint
+	{
+		VelocityLength,
+		NormalizedVelocity,
+	};
+
+	//
+	// Mode Config
+	//
+	// constants from 'simulation_shared.glsl'
+	//
+	struct ModeConfig
+	{
+		StaticArray< GravityObject, 1 >		gravity;
+		StaticArray< MagneticObject, 2 >	magnetic;
+		uint		gravityCount	= 0;
+		uint		magneticCount	= 0;
+		float3		magneticField;				// linear field, if 'linearField' is true
+		bool		linearField		= false;
+		float3		boxMin			{ -10.0f };
+		float3		boxMax			{  10.0f };
+		EEmitter	emitter			= EEmitter::ConeZXY;
+		EColor		color			= EColor::VelocityLength;
+		bool		trackTime		= false;	// 'param.y' and 'param.z' are used
+	};
+
+	ND_ bool  GetModeConfig (uint mode, OUT ModeConfig &cfg)
+	{
+		cfg = {};
+		switch ( mode )
+		{
+			case 1 :
+			case 4 :
+				cfg.gravity[0]		= GravityObject{ float3{0.0f}, 0.1f, 0.1f };
+				cfg.gravityCount	= 1;
+				cfg.magnetic[0]		= MagneticObject{ float3{0.0f, 0.0f, 0.1f}, float3{0.0f, 0.0f, -0.1f}, 0.5f };
+				cfg.magneticCount	= 1;
+				cfg.emitter			= EEmitter::ConeZXY;
+				cfg.color			= (mode == 1 ? EColor::VelocityLength : EColor::NormalizedVelocity);
+				return true;
+
+			case 3 :
+				cfg.gravity[0]		= GravityObject{ float3{0.0f}, 0.1f, 0.05f };
+				cfg.gravityCount	= 1;
+				cfg.magneticField	= float3{ 1.0f, 0.0f, 0.0f };
+				cfg.linearField		= true;
+				cfg.emitter			= EEmitter::Cone;
+				cfg.color			= EColor::VelocityLength;
+				cfg.trackTime		= true;
+				return true;
+
+			case 5 :
+				cfg.magnetic[0]		= MagneticObject{ float3{0.0f, 0.0f, 0.9f}, float3{0.0f, 0.0f, -0.9f}, 0.1f };
+				cfg.magnetic[1]		= MagneticObject{ float3{0.0f, 0.9f, 0.0f}, float3{0.0f, -0.9f, 0.0f}, 0.3f };
+				cfg.magneticCount	= 2;
+				cfg.emitter			= EEmitter::Sphere;
+				cfg.color			= EColor::NormalizedVelocity;
+				return true;
+		}
+		return false;
+	}
+//-----------------------------------------------------------------------------
+
+
+	static constexpr float	GLPi = 3.14159265358979323846f;		// 'Pi' from 'Math.glsl'
+
+	// operations are in the same order as in GLSL functions with the same name,
+	// vectorized version must use the same order to produce the same result
+
+	ND_ forceinline float  GLFract (float x)			{ return x - std::floor( x ); }
+	ND_ forceinline float  GLMod (float x, float y)		{ return x - y * std::floor( x / y ); }
+	ND_ forceinline float  GLSign (float x)				{ return x < 0.0f ? -1.0f : 1.0f; }		// 'Sign' from 'Math.glsl'
+
+	ND_ forceinline float  GLDot (const float3 &a, const float3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	ND_ forceinline float3  GLNormalize (const float3 &v)
+	{
+		return v * (1.0f / std::sqrt( GLDot( v, v )));
+	}
+
+	ND_ forceinline float3  GLCross (const float3 &a, const float3 &b)
+	{
+		return float3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	ND_ float  DHash11 (float p)
+	{
+		float3	p3 { GLFract( p * 0.1031f )};
+		p3 = p3 + GLDot( p3, float3{ p3.y, p3.z, p3.x } + 19.19f );
+		return GLFract( (p3.x + p3.y) * p3.z );
+	}
+
+	ND_ float  DHash12 (const float2 &p)
+	{
+		float3	p3 { GLFract( p.x * 0.1031f ), GLFract( p.y * 0.1031f ), GLFract( p.x * 0.1031f )};
+		p3 = p3 + GLDot( p3, float3{ p3.y, p3.z, p3.x } + 19.19f );
+		return GLFract( (p3.x + p3.y) * p3.z );
+	}
+
+	ND_ uint  PackUNorm4x8 (const float4 &v)
+	{
+		const auto	Pack = [] (float x) { return uint(std::round( Clamp( x, 0.0f, 1.0f ) * 255.0f )); };
+		return Pack( v.x ) | (Pack( v.y ) << 8) | (Pack( v.z ) << 16) | (Pack( v.w ) << 24);
+	}
+
+	ND_ float3  HSVtoRGB (const float3 &hsv)
+	{
+		const float3	col { Abs( hsv.x * 6.0f - 3.0f ) - 1.0f, 2.0f - Abs( hsv.x * 6.0f - 2.0f ), 2.0f - Abs( hsv.x * 6.0f - 4.0f )};
+		const float3	sat	{ Clamp( col.x, 0.0f, 1.0f ), Clamp( col.y, 0.0f, 1.0f ), Clamp( col.z, 0.0f, 1.0f )};
+		return ((sat - 1.0f) * hsv.y + 1.0f) * hsv.z;
+	}
+
+/*
+=================================================
+	emitters
+=================================================
+*/
+	ND_ float2  ParticleEmitter_Plane (float pointIndex, float pointsCount)
+	{
+		const float	side = std::sqrt( pointsCount );
+		return float2{ GLMod( pointIndex, side ), std::floor( pointIndex / side )} / side * 2.0f - 1.0f;
+	}
+
+	ND_ float2  ParticleEmitter_Plane (float pointIndex, float pointsCount, float ratio)
+	{
+		const float	side_x		= std::sqrt( pointsCount * ratio );
+		const float	side_y		= pointsCount / side_x;
+		const float	max_side	= Max( side_x, side_y );
+
+		return float2{ (GLMod( pointIndex, side_x ) * 2.0f - side_x) / max_side, (std::floor( pointIndex / side_x ) * 2.0f - side_y) / max_side };
+	}
+
+	ND_ float3  ParticleEmitter_Sphere (float pointIndex, float pointsCount)
+	{
+		const float2	p		= ParticleEmitter_Plane( pointIndex, pointsCount, 0.5f );
+		const float2	angle	= float2{ p.y, p.x } * GLPi;
+
+		return float3{ std::sin( angle.x ) * std::cos( angle.y ), std::sin( angle.x ) * std::sin( angle.y ), std::cos( angle.x )};
+	}
+
+	ND_ float3  ParticleEmitter_ConeVector (float pointIndex, float pointsCount, float zLength)
+	{
+		const float2	p		= ParticleEmitter_Plane( pointIndex, pointsCount );
+		const float		angle	= GLPi * 2.0f * p.x;
+
+		return GLNormalize( float3{ std::sin( angle ) * p.y, std::cos( angle ) * p.y, zLength });
+	}
+
+/*
+=================================================
+	ParticleColor
+=================================================
+*/
+	ND_ uint  ParticleColor (const ModeConfig &cfg, const float3 &velocity)
+	{
+		BEGIN_ENUM_CHECKS();
+		switch ( cfg.color )
+		{
+			case EColor::VelocityLength : {
+				const float	vel = 1.0f - Clamp( std::sqrt( GLDot( velocity, velocity )), 0.0f, 1.0f );
+				return PackUNorm4x8( float4{ HSVtoRGB( float3{ vel, 1.0f, 1.0f }), 1.0f });
+			}
+			case EColor::NormalizedVelocity :
+				return PackUNorm4x8( float4{ GLNormalize( velocity ) * 0.5f + 0.5f, 1.0f });
+		}
+		END_ENUM_CHECKS();
+		return UMax;
+	}
+
+/*
+=================================================
+	PaletteIndex
+----
+	same as 'ParticlePaletteIndex_*' functions
+=================================================
+*/
+	ND_ uint  PaletteIndex (const ModeConfig &cfg, const float3 &velocity)
+	{
+		BEGIN_ENUM_CHECKS();
+		switch ( cfg.color )
+		{
+			case EColor::VelocityLength :
+				return uint( (1.0f - Clamp( std::sqrt( GLDot( velocity, velocity )), 0.0f, 1.0f )) * 255.0f + 0.5f );
+
+			case EColor::NormalizedVelocity : {
+				const float3	n = velocity / (Abs( velocity.x ) + Abs( velocity.y ) + Abs( velocity.z ));
+				const float2	e = n.z >= 0.0f ? float2{ n.x, n.y } : float2{ (1.0f - Abs( n.y )) * GLSign( n.x ), (1.0f - Abs( n.x )) * GLSign( n.y )};
+				const auto		ToIndex  = [] (float x) { return x == x ? Min( uint((x * 0.5f + 0.5f) * 15.0f + 0.5f), 15u ) : 0u; };
+				return ToIndex( e.x ) | (ToIndex( e.y ) << 4);
+			}
+		}
+		END_ENUM_CHECKS();
+		return 0;
+	}
+
+/*
+=================================================
+	PaletteColor
+----
+	same as 'ParticlePalette_*' functions
+=================================================
+*/
+	ND_ uint  PaletteColor (const ModeConfig &cfg, uint index)
+	{
+		BEGIN_ENUM_CHECKS();
+		switch ( cfg.color )
+		{
+			case EColor::VelocityLength :
+				return PackUNorm4x8( float4{ HSVtoRGB( float3{ float(index) / 255.0f, 1.0f, 1.0f }), 1.0f });
+
+			case EColor::NormalizedVelocity : {
+				const float2	e { float(index & 15) / 15.0f * 2.0f - 1.0f, float(index >> 4) / 15.0f * 2.0f - 1.0f };
+				float3			n { e.x, e.y, 1.0f - Abs( e.x ) - Abs( e.y )};
+
+				if ( n.z < 0.0f ) {
+					n.x = (1.0f - Abs( e.y )) * GLSign( e.x );
+					n.y = (1.0f - Abs( e.x )) * GLSign( e.y );
+				}
+				return ParticleColor( cfg, n );
+			}
+		}
+		END_ENUM_CHECKS();
+		return UMax;
+	}
+
+/*
+=================================================
+	FloatToHalf / HalfToFloat
+----
+	same as 'packHalf2x16' and 'unpackHalf2x16', round to nearest even
+=================================================
+*/
+	ND_ uint  FloatToHalf (float value)
+	{
+		const uint	bits	= BitCast<uint>( value );
+		const uint	sign	= (bits >> 16) & 0x8000;
+		const int	exp		= int((bits >> 23) & 0xFF) - 127 + 15;
+		uint		mant	= bits & 0x7FFFFF;
+
+		if ( ((bits >> 23) & 0xFF) == 0xFF )
+			return sign | 0x7C00 | (mant ? 0x200 : 0);	// inf or nan
+
+		if ( exp >= 31 )
+			return sign | 0x7C00;	// overflow
+
+		uint	shift	= 13;
+		uint	result	= (uint(exp) << 10);
+
+		if ( exp <= 0 )
+		{
+			// denormalized
+			if ( exp < -10 )
+				return sign;
+
+			mant	|= 0x800000;
+			shift	 = uint(14 - exp);
+			result	 = 0;
+		}
+
+		const uint	rem		= mant & ((1u << shift) - 1);
+		const uint	mid		= 1u << (shift - 1);
+
+		result |= (mant >> shift);
+		result += uint( rem > mid or (rem == mid and (result & 1)) );	// carry to exponent is valid
+		return sign | result;
+	}
+
+	ND_ float  HalfToFloat (uint value)
+	{
+		const uint	sign	= (value & 0x8000) << 16;
+		const uint	exp		= (value >> 10) & 0x1F;
+		const uint	mant	= value & 0x3FF;
+
+		if ( exp == 0 )
+			return BitCast<float>( sign | BitCast<uint>( float(mant) / float(1u << 24) ));
+
+		if ( exp == 31 )
+			return BitCast<float>( sign | 0x7F800000 | (mant << 13) );
+
+		return BitCast<float>( sign | ((exp + 112) << 23) | (mant << 13) );
+	}
+
+	ND_ uint  PackHalf2x16 (float x, float y)
+	{
+		return FloatToHalf( x ) | (FloatToHalf( y ) << 16);
+	}
+
+	ND_ float2  UnpackHalf2x16 (uint value)
+	{
+		return float2{ HalfToFloat( value & 0xFFFF ), HalfToFloat( value >> 16 )};
+	}
+//-----------------------------------------------------------------------------
+
+
+	using State = ParticleSimulator::State;
+
+/*
+=================================================
+	RestartParticle
+----
+	'index' and 'size' - global invocation index and size
+=================================================
+*/
+	void  RestartParticle (const ModeConfig &cfg, OUT State &state, float index, float size, float globalTime)
+	{
+		const float3	box_pos	= (cfg.boxMin + cfg.boxMax) * 0.5f + (cfg.boxMax - cfg.boxMin) * float3{ 0.1f, 0.0f, 0.0f } * 0.5f;
+
+		BEGIN_ENUM_CHECKS();
+		switch ( cfg.emitter )
+		{
+			case EEmitter::ConeZXY : {
+				const float3	cone = ParticleEmitter_ConeVector( index, size, 1.0f );
+				state.pos	= box_pos;
+				state.vel	= float3{ cone.z, cone.x, cone.y } * -0.5f;
+				break;
+			}
+			case EEmitter::Cone :
+				state.pos	= box_pos;
+				state.vel	= ParticleEmitter_ConeVector( index, size, 1.0f ) * 0.5f;
+				break;
+
+			case EEmitter::Sphere : {
+				const float	rnd = DHash12( float2{ index / size, globalTime + 2.28374f }) * size;
+				state.pos	= ParticleEmitter_Sphere( rnd, size ) * 1.0f;
+				state.vel	= GLNormalize( state.pos ) * 0.05f;
+				break;
+			}
+		}
+		END_ENUM_CHECKS();
+
+		state.size	= 8.0f;
+		state.sign	= GLSign( DHash12( float2{ globalTime, index / size }) * 2.0f - 1.0f );
+
+		if ( cfg.trackTime )
+		{
+			state.restartTime	= 0.0f;
+			state.lifeTime		= 0.0f;
+		}
+	}
+
+/*
+=================================================
+	GravityAccel
+=================================================
+*/
+	ND_ float3  GravityAccel (const float3 &position, const float3 &center, float gravity)
+	{
+		const float3	v = center - position;
+		return GLNormalize( v ) * gravity / GLDot( v, v );
+	}
+
+/*
+=================================================
+	SphericalMagneticFieldAccel
+=================================================
+*/
+	ND_ float3  SphericalMagneticFieldAccel (const float3 &velocity, const float3 &position, const MagneticObject &obj)
+	{
+		const float3	nv	= position - obj.north;
+		const float3	n	= GLNormalize( nv ) * obj.induction / GLDot( nv, nv );
+		const float3	sv	= obj.south - position;
+		const float3	s	= GLNormalize( sv ) * obj.induction / GLDot( sv, sv );
+		return GLCross( velocity, n + s );
+	}
+
+/*
+=================================================
+	UpdateStep
+----
+	single iteration of the loop in 'UpdateParticle'
+=================================================
+*/
+	void  UpdateStep (const ModeConfig &cfg, INOUT State &state, float stepTime, float globalTime, float index, float size)
+	{
+		float3	accel		{ 0.0f };
+		int		destroyed	= 0;
+
+		for (uint i = 0; i < cfg.gravityCount; ++i)
+		{
+			const auto&		obj	= cfg.gravity[i];
+			const float3	d	= state.pos - obj.position;
+
+			accel		 = accel + GravityAccel( state.pos, obj.position, obj.gravity );
+			destroyed	+= int( std::sqrt( GLDot( d, d )) < obj.radius );
+		}
+
+		for (uint i = 0; i < cfg.magneticCount; ++i) {
+			accel = accel + SphericalMagneticFieldAccel( state.vel, state.pos, cfg.magnetic[i] ) * state.sign;
+		}
+
+		if ( cfg.linearField )
+			accel = accel + GLCross( state.vel, cfg.magneticField ) * state.sign;
+
+		// UniformlyAcceleratedMotion
+		state.pos = state.pos + state.vel * stepTime * 0.5f;
+		state.vel = state.vel + accel * stepTime;
+		state.pos = state.pos + state.vel * stepTime * 0.5f;
+
+		if ( cfg.trackTime )
+		{
+			state.lifeTime		+= stepTime;
+			state.restartTime	 = globalTime;
+		}
+
+		const bool	inside	= All( state.pos >= cfg.boxMin ) and All( state.pos <= cfg.boxMax );
+
+		if ( not inside or destroyed > 0 )
+			RestartParticle( cfg, OUT state, index, size, globalTime );
+	}
+//-----------------------------------------------------------------------------
+
+
+#ifdef PARTICLE_SIMULATOR_SSE
+	struct Float3x4
+	{
+		__m128	x, y, z;
+	};
+
+	ND_ forceinline Float3x4  Set3 (const float3 &v)						{ return { _mm_set1_ps( v.x ), _mm_set1_ps( v.y ), _mm_set1_ps( v.z )}; }
+	ND_ forceinline Float3x4  Add3 (const Float3x4 &a, const Float3x4 &b)	{ return { _mm_add_ps( a.x, b.x ), _mm_add_ps( a.y, b.y ), _mm_add_ps( a.z, b.z )}; }
+	ND_ forceinline Float3x4  Sub3 (const Float3x4 &a, const Float3x4 &b)	{ return { _mm_sub_ps( a.x, b.x ), _mm_sub_ps( a.y, b.y ), _mm_sub_ps( a.z, b.z )}; }
+	ND_ forceinline Float3x4  Mul3 (const Float3x4 &a, const __m128 &b)	{ return { _mm_mul_ps( a.x, b ), _mm_mul_ps( a.y, b ), _mm_mul_ps( a.z, b )}; }
+	ND_ forceinline Float3x4  Div3 (const Float3x4 &a, const __m128 &b)	{ return { _mm_div_ps( a.x, b ), _mm_div_ps( a.y, b ), _mm_div_ps( a.z, b )}; }
+
+	ND_ forceinline __m128  Dot3 (const Float3x4 &a, const Float3x4 &b)
+	{
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( a.x, b.x ), _mm_mul_ps( a.y, b.y )), _mm_mul_ps( a.z, b.z ));
+	}
+
+	ND_ forceinline Float3x4  Normalize3 (const Float3x4 &v)
+	{
+		return Mul3( v, _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( Dot3( v, v ))));
+	}
+
+	ND_ forceinline Float3x4  Cross3 (const Float3x4 &a, const Float3x4 &b)
+	{
+		return { _mm_sub_ps( _mm_mul_ps( a.y, b.z ), _mm_mul_ps( a.z, b.y )),
+				 _mm_sub_ps( _mm_mul_ps( a.z, b.x ), _mm_mul_ps( a.x, b.z )),
+				 _mm_sub_ps( _mm_mul_ps( a.x, b.y ), _mm_mul_ps( a.y, b.x )) };
+	}
+
+	// returns mask
+	ND_ forceinline __m128  IsInside4 (const Float3x4 &p, const Float3x4 &boxMin, const Float3x4 &boxMax)
+	{
+		const __m128	ge = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( p.x, boxMin.x ), _mm_cmpge_ps( p.y, boxMin.y )), _mm_cmpge_ps( p.z, boxMin.z ));
+		const __m128	le = _mm_and_ps( _mm_and_ps( _mm_cmple_ps( p.x, boxMax.x ), _mm_cmple_ps( p.y, boxMax.y )), _mm_cmple_ps( p.z, boxMax.z ));
+		return _mm_and_ps( ge, le );
+	}
+#endif	// PARTICLE_SIMULATOR_SSE
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
+
+/*
+=================================================
+	IsSupported
+=================================================
+*/
+	bool  ParticleSimulator::IsSupported (uint mode)
+	{
+		ModeConfig	cfg;
+		return GetModeConfig( mode, OUT cfg );
+	}
+
+/*
+=================================================
+	_Resize
+=================================================
+*/
+	void  ParticleSimulator::_Resize (uint mode, uint count)
+	{
+		_mode	= mode;
+		_count	= count;
+
+		for (auto* arr : { &_posX, &_posY, &_posZ, &_velX, &_velY, &_velZ, &_sign, &_restartTime, &_lifeTime, &_size }) {
+			arr->assign( count, 0.0f );
+		}
+		_color.assign( count, 0 );
+	}
+
+/*
+=================================================
+	Init
+----
+	same as 'InitParticle'
+=================================================
+*/
+	bool  ParticleSimulator::Init (uint mode, uint count, uint indexSize, float globalTime)
+	{
+		ModeConfig	cfg;
+		CHECK_ERR( GetModeConfig( mode, OUT cfg ));
+		CHECK_ERR( indexSize >= count and indexSize > 1 );
+
+		_Resize( mode, count );
+
+		for (uint i = 0; i < count; ++i)
+		{
+			const float	unorm	= float(i) / float(indexSize - 1);
+			State		state;
+
+			RestartParticle( cfg, OUT state, float(i), float(indexSize), DHash11( globalTime + unorm * 1.6543324f ));
+
+			_Store( i, state );
+			_color[i] = 0xFFFFFFFF;
+		}
+		return true;
+	}
+
+/*
+=================================================
+	Load
+=================================================
+*/
+	bool  ParticleSimulator::Load (uint mode, ArrayView<Particle> particles)
+	{
+		CHECK_ERR( IsSupported( mode ));
+
+		_Resize( mode, uint(particles.size()) );
+
+		for (uint i = 0; i < _count; ++i)
+		{
+			auto&	p = particles[i];
+			_posX[i]		= p.position.x;
+			_posY[i]		= p.position.y;
+			_posZ[i]		= p.position.z;
+			_velX[i]		= p.velocity.x;
+			_velY[i]		= p.velocity.y;
+			_velZ[i]		= p.velocity.z;
+			_sign[i]		= p.param.x;
+			_restartTime[i]	= p.param.y;
+			_lifeTime[i]	= p.param.z;
+			_size[i]		= p.size;
+			_color[i]		= p.color;
+		}
+		return true;
+	}
+
+/*
+=================================================
+	Store
+=================================================
+*/
+	void  ParticleSimulator::Store (OUT Array<Particle> &particles) const
+	{
+		particles.resize( _count );
+
+		for (uint i = 0; i < _count; ++i)
+		{
+			auto&	p = particles[i];
+			p.position	= float3{ _posX[i], _posY[i], _posZ[i] };
+			p.velocity	= float3{ _velX[i], _velY[i], _velZ[i] };
+			p.size		= _size[i];
+			p.color		= _color[i];
+			p.param		= float4{ _sign[i], _restartTime[i], _lifeTime[i], 0.0f };
+		}
+	}
+
+/*
+=================================================
+	_Load / _Store
+=================================================
+*/
+	ParticleSimulator::State  ParticleSimulator::_Load (uint i) const
+	{
+		State	state;
+		state.pos			= float3{ _posX[i], _posY[i], _posZ[i] };
+		state.vel			= float3{ _velX[i], _velY[i], _velZ[i] };
+		state.sign			= _sign[i];
+		state.restartTime	= _restartTime[i];
+		state.lifeTime		= _lifeTime[i];
+		state.size			= _size[i];
+		return state;
+	}
+
+	void  ParticleSimulator::_Store (uint i, const State &state)
+	{
+		_posX[i]		= state.pos.x;
+		_posY[i]		= state.pos.y;
+		_posZ[i]		= state.pos.z;
+		_velX[i]		= state.vel.x;
+		_velY[i]		= state.vel.y;
+		_velZ[i]		= state.vel.z;
+		_sign[i]		= state.sign;
+		_restartTime[i]	= state.restartTime;
+		_lifeTime[i]	= state.lifeTime;
+		_size[i]		= state.size;
+	}
+
+/*
+=================================================
+	Update
+----
+	batches are independent, so they are processed in parallel
+=================================================
+*/
+	void  ParticleSimulator::Update (float stepTime, uint steps, float globalTime, uint indexSize)
+	{
+		const uint	num_batches = (_count + BatchSize - 1) / BatchSize;
+
+		ParallelFor( num_batches, 1, [&] (uint batch)
+		{
+			const uint	first = batch * BatchSize;
+			_UpdateRange( first, Min( BatchSize, _count - first ), stepTime, steps, globalTime, indexSize, true );
+		});
+	}
+
+/*
+=================================================
+	UpdateScalar
+=================================================
+*/
+	void  ParticleSimulator::UpdateScalar (float stepTime, uint steps, float globalTime, uint indexSize)
+	{
+		_UpdateRange( 0, _count, stepTime, steps, globalTime, indexSize, false );
+	}
+
+/*
+=================================================
+	_UpdateRange
+----
+	all steps are calculated for 4 particles in registers,
+	particles that must be restarted are processed by the scalar version
+	and then reloaded, remaining particles are processed by the scalar version
+=================================================
+*/
+	void  ParticleSimulator::_UpdateRange (uint first, uint count, float stepTime, uint steps, float globalTime, uint indexSize, bool vectorized)
+	{
+		ModeConfig	cfg;
+		CHECK_ERRV( GetModeConfig( _mode, OUT cfg ));
+
+		const float	size	= float(indexSize);
+		const uint	end		= first + count;
+		uint		i		= first;
+
+	#ifdef PARTICLE_SIMULATOR_SSE
+		if ( vectorized )
+		{
+			const __m128	dt			= _mm_set1_ps( stepTime );
+			const __m128	half		= _mm_set1_ps( 0.5f );
+			const __m128	gtime		= _mm_set1_ps( globalTime );
+			const Float3x4	box_min		= Set3( cfg.boxMin );
+			const Float3x4	box_max		= Set3( cfg.boxMax );
+			const Float3x4	field		= Set3( cfg.magneticField );
+
+			for (; i + 4 <= end; i += 4)
+			{
+				Float3x4	pos			{ _mm_loadu_ps( &_posX[i] ), _mm_loadu_ps( &_posY[i] ), _mm_loadu_ps( &_posZ[i] )};
+				Float3x4	vel			{ _mm_loadu_ps( &_velX[i] ), _mm_loadu_ps( &_velY[i] ), _mm_loadu_ps( &_velZ[i] )};
+				__m128		sign		= _mm_loadu_ps( &_sign[i] );
+				__m128		life_time	= _mm_loadu_ps( &_lifeTime[i] );
+				__m128		restart_time= _mm_loadu_ps( &_restartTime[i] );
+
+				for (uint t = 0; t < steps; ++t)
+				{
+					Float3x4	accel		{ _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+					__m128		destroyed	= _mm_setzero_ps();
+
+					for (uint j = 0; j < cfg.gravityCount; ++j)
+					{
+						const Float3x4	center	= Set3( cfg.gravity[j].position );
+						const Float3x4	v		= Sub3( center, pos );
+						const Float3x4	d		= Sub3( pos, center );
+
+						accel		= Add3( accel, Div3( Mul3( Normalize3( v ), _mm_set1_ps( cfg.gravity[j].gravity )), Dot3( v, v )));
+						destroyed	= _mm_or_ps( destroyed, _mm_cmplt_ps( _mm_sqrt_ps( Dot3( d, d )), _mm_set1_ps( cfg.gravity[j].radius )));
+					}
+
+					for (uint j = 0; j < cfg.magneticCount; ++j)
+					{
+						const auto&		obj		= cfg.magnetic[j];
+						const __m128	ind		= _mm_set1_ps( obj.induction );
+						const Float3x4	nv		= Sub3( pos, Set3( obj.north ));
+						const Float3x4	n		= Div3( Mul3( Normalize3( nv ), ind ), Dot3( nv, nv ));
+						const Float3x4	sv		= Sub3( Set3( obj.south ), pos );
+						const Float3x4	s		= Div3( Mul3( Normalize3( sv ), ind ), Dot3( sv, sv ));
+
+						accel = Add3( accel, Mul3( Cross3( vel, Add3( n, s )), sign ));
+					}
+
+					if ( cfg.linearField )
+						accel = Add3( accel, Mul3( Cross3( vel, field ), sign ));
+
+					// UniformlyAcceleratedMotion
+					pos = Add3( pos, Mul3( Mul3( vel, dt ), half ));
+					vel = Add3( vel, Mul3( accel, dt ));
+					pos = Add3( pos, Mul3( Mul3( vel, dt ), half ));
+
+					if ( cfg.trackTime )
+					{
+						life_time		= _mm_add_ps( life_time, dt );
+						restart_time	= gtime;
+					}
+
+					const int	restart = _mm_movemask_ps( _mm_or_ps( _mm_andnot_ps( IsInside4( pos, box_min, box_max ), _mm_castsi128_ps( _mm_set1_epi32( -1 ))), destroyed ));
+
+					if ( restart == 0 )
+						continue;
+
+					_mm_storeu_ps( &_posX[i], pos.x );		_mm_storeu_ps( &_posY[i], pos.y );		_mm_storeu_ps( &_posZ[i], pos.z );
+					_mm_storeu_ps( &_velX[i], vel.x );		_mm_storeu_ps( &_velY[i], vel.y );		_mm_storeu_ps( &_velZ[i], vel.z );
+					_mm_storeu_ps( &_lifeTime[i], life_time );
+					_mm_storeu_ps( &_restartTime[i], restart_time );
+
+					for (uint k = 0; k < 4; ++k)
+					{
+						if ( not (restart & (1 << k)) )
+							continue;
+
+						State	state = _Load( i + k );
+						RestartParticle( cfg, OUT state, float(i + k), size, globalTime );
+						_Store( i + k, state );
+					}
+
+					pos			= { _mm_loadu_ps( &_posX[i] ), _mm_loadu_ps( &_posY[i] ), _mm_loadu_ps( &_posZ[i] )};
+					vel			= { _mm_loadu_ps( &_velX[i] ), _mm_loadu_ps( &_velY[i] ), _mm_loadu_ps( &_velZ[i] )};
+					sign		= _mm_loadu_ps( &_sign[i] );
+					life_time	= _mm_loadu_ps( &_lifeTime[i] );
+					restart_time= _mm_loadu_ps( &_restartTime[i] );
+				}
+
+				_mm_storeu_ps( &_posX[i], pos.x );		_mm_storeu_ps( &_posY[i], pos.y );		_mm_storeu_ps( &_posZ[i], pos.z );
+				_mm_storeu_ps( &_velX[i], vel.x );		_mm_storeu_ps( &_velY[i], vel.y );		_mm_storeu_ps( &_velZ[i], vel.z );
+				_mm_storeu_ps( &_lifeTime[i], life_time );
+				_mm_storeu_ps( &_restartTime[i], restart_time );
+			}
+		}
+	#else
+		Unused( vectorized );
+	#endif
+
+		for (; i < end; ++i)
+		{
+			State	state = _Load( i );
+
+			for (uint t = 0; t < steps; ++t) {
+				UpdateStep( cfg, INOUT state, stepTime, globalTime, float(i), size );
+			}
+			_Store( i, state );
+		}
+
+		for (i = first; i < end; ++i) {
+			_color[i] = ParticleColor( cfg, float3{ _velX[i], _velY[i], _velZ[i] });
+		}
+	}
+
+/*
+=================================================
+	Compare
+=================================================
+*/
+	ParticleSimulator::CompareResult  ParticleSimulator::Compare (ArrayView<Particle> particles, float maxError) const
+	{
+		ModeConfig		cfg;
+		CompareResult	result;
+		CHECK_ERR( GetModeConfig( _mode, OUT cfg ), result );
+
+		const uint	count = Min( _count, uint(particles.size()) );
+		result.mismatched = Max( _count, uint(particles.size()) ) - count;
+
+		double		pos_err_sum = 0.0;
+
+		for (uint i = 0; i < count; ++i)
+		{
+			const auto&	p			= particles[i];
+			const float	pos_err		= Max( Max( Abs( p.position.x - _posX[i] ), Abs( p.position.y - _posY[i] )), Abs( p.position.z - _posZ[i] ));
+			const float	vel_err		= Max( Max( Abs( p.velocity.x - _velX[i] ), Abs( p.velocity.y - _velY[i] )), Abs( p.velocity.z - _velZ[i] ));
+			uint		col_err		= 0;
+
+			for (uint c = 0; c < 32; c += 8) {
+				col_err = Max( col_err, uint(Abs( int((p.color >> c) & 0xFF) - int((_color[i] >> c) & 0xFF) )));
+			}
+
+			bool	failed = (pos_err > maxError) or (vel_err > maxError) or (col_err > 2) or
+							 (p.size != _size[i]) or (p.param.x != _sign[i]);
+
+			if ( cfg.trackTime )
+				failed |= (Abs( p.param.z - _lifeTime[i] ) > maxError) or (p.param.y != _restartTime[i]);
+
+			pos_err_sum				+= pos_err;
+			result.maxPositionError	= Max( result.maxPositionError, pos_err );
+			result.maxVelocityError	= Max( result.maxVelocityError, vel_err );
+			result.maxColorError	= Max( result.maxColorError, col_err );
+			result.mismatched		+= uint(failed);
+		}
+
+		result.avgPositionError = count ? float(pos_err_sum / count) : 0.0f;
+		return result;
+	}
+
+/*
+=================================================
+	Pack
+=================================================
+*/
+	bool  ParticleSimulator::Pack (uint mode, ArrayView<Particle> particles, OUT Array<PackedParticle> &packed)
+	{
+		ModeConfig	cfg;
+		CHECK_ERR( GetModeConfig( mode, OUT cfg ));
+
+		packed.resize( particles.size() );
+
+		for (size_t i = 0; i < particles.size(); ++i)
+		{
+			const auto&	src	= particles[i];
+			auto&		dst	= packed[i];
+
+			dst.position		= src.position;
+			dst.sizeVelocity	= PackHalf2x16( src.size, src.velocity.x );
+			dst.velocity		= PackHalf2x16( src.velocity.y, src.velocity.z );
+			dst.colorParam		= PaletteIndex( cfg, src.velocity ) | (PackHalf2x16( 0.0f, src.param.x ) & 0xFFFF0000);
+			dst.paramY			= src.param.y;
+			dst.paramZW			= PackHalf2x16( src.param.z, src.param.w );
+		}
+		return true;
+	}
+
+/*
+=================================================
+	Unpack
+=================================================
+*/
+	bool  ParticleSimulator::Unpack (uint mode, ArrayView<PackedParticle> packed, OUT Array<Particle> &particles)
+	{
+		ModeConfig	cfg;
+		CHECK_ERR( GetModeConfig( mode, OUT cfg ));
+
+		particles.resize( packed.size() );
+
+		for (size_t i = 0; i < packed.size(); ++i)
+		{
+			const auto&		src			= packed[i];
+			auto&			dst			= particles[i];
+			const float2	size_vel	= UnpackHalf2x16( src.sizeVelocity );
+			const float2	vel_yz		= UnpackHalf2x16( src.velocity );
+			const float2	param_zw	= UnpackHalf2x16( src.paramZW );
+
+			dst.position	= src.position;
+			dst.size		= size_vel.x;
+			dst.velocity	= float3{ size_vel.y, vel_yz.x, vel_yz.y };
+			dst.color		= PaletteColor( cfg, src.colorParam & 0xFFFF );
+			dst.param		= float4{ HalfToFloat( src.colorParam >> 16 ), src.paramY, param_zw.x, param_zw.y };
+		}
+		return true;
+	}
+
+/*
+=================================================
+	Quantize
+=================================================
+*/
+	void  ParticleSimulator::Quantize ()
+	{
+		Array<Particle>			particles;
+		Array<PackedParticle>	packed;
+
+		Store( OUT particles );
+		CHECK_ERRV( Pack( _mode, particles, OUT packed ));
+		CHECK_ERRV( Unpack( _mode, packed, OUT particles ));
+		CHECK( Load( _mode, particles ));
+	}
+
+
+}	// FG
@@ -0,0 +1,116 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	//
+	// Particle Simulator
+	//
+	// CPU version of 'UpdateParticle' and 'InitParticle' from 'shaders/simulation_shared.glsl'
+	// for modes 1, 3, 4, 5, must be updated when shader is changed.
+	// Particles are stored as structure of arrays.
+	//
+
+	class ParticleSimulator final
+	{
+	// types
+	public:
+		// same layout as 'Particle' in 'simulation_shared.glsl'
+		struct Particle
+		{
+			float3		position;
+			float		size		= 0.0f;
+			float3		velocity;
+			uint		color		= 0;
+			float4		param;
+		};
+
+		// same layout as 'PackedParticle' in 'simulation_shared.glsl'
+		struct PackedParticle
+		{
+			float3		position;
+			uint		sizeVelocity	= 0;	// half size, half 'velocity.x'
+			uint		velocity		= 0;	// half 'velocity.yz'
+			uint		colorParam		= 0;	// 16 bit palette index, half 'param.x'
+			float		paramY			= 0.0f;
+			uint		paramZW			= 0;	// half 'param.zw'
+		};
+
+		struct CompareResult
+		{
+			float		maxPositionError	= 0.0f;
+			float		avgPositionError	= 0.0f;
+			float		maxVelocityError	= 0.0f;
+			uint		maxColorError		= 0;	// per channel
+			uint		mismatched			= 0;	// number of particles with error greater than 'maxError'
+		};
+
+		// state of single particle during update, see '.cpp'
+		struct State;
+
+		static constexpr uint	BatchSize	= 1u << 12;		// particles per task for multithreaded update
+		static constexpr uint	PaletteSize	= 256;			// colors in palette for packed particles
+
+
+	// variables
+	private:
+		Array<float>	_posX, _posY, _posZ;
+		Array<float>	_velX, _velY, _velZ;
+		Array<float>	_sign;				// 'param.x'
+		Array<float>	_restartTime;		// 'param.y', only for mode 3
+		Array<float>	_lifeTime;			// 'param.z', only for mode 3
+		Array<float>	_size;
+		Array<uint>		_color;
+		uint			_mode		= 0;
+		uint			_count		= 0;
+
+
+	// methods
+	public:
+		ParticleSimulator () {}
+
+		ND_ static bool  IsSupported (uint mode);
+
+		// same as 'init_simulation.glsl', 'indexSize' is a number of invocations in dispatch
+		bool  Init (uint mode, uint count, uint indexSize, float globalTime = 0.0f);
+
+		// copies particles from buffer, for example from readback of GPU buffer
+		bool  Load (uint mode, ArrayView<Particle> particles);
+
+		void  Store (OUT Array<Particle> &particles) const;
+
+		// same as 'simulation.glsl', vectorized and multithreaded
+		void  Update (float stepTime, uint steps, float globalTime, uint indexSize);
+
+		// reference version, single threaded without vectorization
+		void  UpdateScalar (float stepTime, uint steps, float globalTime, uint indexSize);
+
+		// rounds particles to the precision of packed format, same as 'Pack' and then 'Unpack'
+		void  Quantize ();
+
+		// compares with particles that are updated on GPU, only fields that are used in current mode are compared
+		ND_ CompareResult  Compare (ArrayView<Particle> particles, float maxError) const;
+
+		ND_ uint  Count ()	const	{ return _count; }
+		ND_ uint  Mode ()	const	{ return _mode; }
+
+		// same as 'PackParticle' in 'simulation_shared.glsl'
+		static bool  Pack (uint mode, ArrayView<Particle> particles, OUT Array<PackedParticle> &packed);
+
+		// same as 'UnpackParticle', color is taken from palette
+		static bool  Unpack (uint mode, ArrayView<PackedParticle> packed, OUT Array<Particle> &particles);
+
+	private:
+		void  _Resize (uint mode, uint count);
+		void  _UpdateRange (uint first, uint count, float stepTime, uint steps, float globalTime, uint indexSize, bool vectorized);
+
+		ND_ State  _Load (uint i) const;
+			void   _Store (uint i, const State &state);
+	};
+
+
+}	// FG
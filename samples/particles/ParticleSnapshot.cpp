@@ -0,0 +1,270 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "ParticleSnapshot.h"
+
+#ifdef FG_ENABLE_LZ4
+#	include "lz4.h"
+#endif
+
+namespace FG
+{
+namespace {
+	static constexpr size_t	ShuffleBlock	= 1u << 12;
+
+/*
+=================================================
+	Shuffle / Unshuffle
+----
+	bytes are grouped by index in element, so exponents and
+	constant fields of neighbour particles are placed together,
+	elements are processed by blocks to keep source data in cache
+=================================================
+*/
+	void  Shuffle (ArrayView<uint8_t> src, uint stride, OUT Array<uint8_t> &dst)
+	{
+		const size_t	count = src.size() / stride;
+
+		dst.resize( src.size() );
+
+		for (size_t first = 0; first < count; first += ShuffleBlock)
+		{
+			const size_t	last = Min( first + ShuffleBlock, count );
+
+			for (uint b = 0; b < stride; ++b)
+			for (size_t e = first; e < last; ++e) {
+				dst[ b * count + e ] = src[ e * stride + b ];
+			}
+		}
+	}
+
+	void  Unshuffle (ArrayView<uint8_t> src, uint stride, OUT Array<uint8_t> &dst)
+	{
+		const size_t	count = src.size() / stride;
+
+		dst.resize( src.size() );
+
+		for (size_t first = 0; first < count; first += ShuffleBlock)
+		{
+			const size_t	last = Min( first + ShuffleBlock, count );
+
+			for (uint b = 0; b < stride; ++b)
+			for (size_t e = first; e < last; ++e) {
+				dst[ e * stride + b ] = src[ b * count + e ];
+			}
+		}
+	}
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	Compress
+----
+	shuffled bytes are compressed by LZ4,
+	chunk is stored without compression if it is not smaller or if LZ4 is not available
+=================================================
+*/
+	void  ParticleSnapshot::Compress (ArrayView<uint8_t> src, uint stride, OUT Array<uint8_t> &dst)
+	{
+		ASSERT( stride > 0 and src.size() % stride == 0 );
+		ASSERT( src.size() <= ChunkSize );
+
+		Array<uint8_t>	shuffled;
+		Shuffle( src, stride, OUT shuffled );
+
+	#ifdef FG_ENABLE_LZ4
+		dst.resize( size_t(LZ4_compressBound( int(shuffled.size()) )));
+
+		const int	size = LZ4_compress_default( reinterpret_cast<const char*>( shuffled.data() ), OUT reinterpret_cast<char*>( dst.data() ),
+											 int(shuffled.size()), int(dst.size()) );
+
+		if ( size > 0 and size_t(size) < shuffled.size() )
+		{
+			dst.resize( size_t(size) );
+			return;
+		}
+	#endif
+
+		dst = std::move(shuffled);
+	}
+
+/*
+=================================================
+	Decompress
+----
+	chunk with the same size as uncompressed data is stored without compression
+=================================================
+*/
+	bool  ParticleSnapshot::Decompress (ArrayView<uint8_t> src, uint stride, size_t rawSize, OUT Array<uint8_t> &dst)
+	{
+		CHECK_ERR( stride > 0 and rawSize % stride == 0 and rawSize <= ChunkSize );
+
+		if ( src.size() == rawSize )
+		{
+			Unshuffle( src, stride, OUT dst );
+			return true;
+		}
+
+	#ifdef FG_ENABLE_LZ4
+		Array<uint8_t>	shuffled;
+		shuffled.resize( rawSize );
+
+		const int	size = LZ4_decompress_safe( reinterpret_cast<const char*>( src.data() ), OUT reinterpret_cast<char*>( shuffled.data() ),
+											int(src.size()), int(rawSize) );
+		CHECK_ERR( size >= 0 and size_t(size) == rawSize );
+
+		Unshuffle( shuffled, stride, OUT dst );
+		return true;
+	#else
+		RETURN_ERR( "snapshot is compressed by LZ4, but LZ4 is not available" );
+	#endif
+	}
+
+/*
+=================================================
+	LoadSection
+=================================================
+*/
+	bool  ParticleSnapshot::LoadSection (StringView filename, ESection section, OUT Header &header, OUT Array<uint8_t> &data)
+	{
+		Reader	reader{ String{filename} };
+		CHECK_ERR( reader.IsOpen() );
+		CHECK_ERR( reader.ReadHeader( OUT header ));
+
+		Array<uint8_t>	chunk;
+
+		for (uint i = 0; i < header.sectionCount; ++i)
+		{
+			SectionHeader	sect;
+			CHECK_ERR( reader.ReadSection( OUT sect ));
+
+			data.clear();
+			data.reserve( size_t(sect.size) );
+
+			// chunks of other sections must be read too, there is no offset table
+			for (uint64_t offset = 0; offset < sect.size; offset += chunk.size())
+			{
+				CHECK_ERR( reader.ReadChunk( OUT chunk ) and not chunk.empty() );
+
+				if ( sect.section == section )
+					data.insert( data.end(), chunk.begin(), chunk.end() );
+			}
+
+			if ( sect.section == section )
+				return true;
+		}
+		return false;
+	}
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	Writer::WriteHeader
+=================================================
+*/
+	bool  ParticleSnapshot::Writer::WriteHeader (const Header &header)
+	{
+		Header	hdr		= header;
+		hdr.magic		= Magic;
+		hdr.version		= Version;
+
+		CHECK_ERR( _file.IsOpen() );
+		CHECK_ERR( _file.Write( &hdr, BytesU::SizeOf(hdr) ));
+		return true;
+	}
+
+/*
+=================================================
+	Writer::BeginSection
+=================================================
+*/
+	bool  ParticleSnapshot::Writer::BeginSection (ESection section, uint stride, uint64_t size)
+	{
+		CHECK_ERR( stride > 0 and size % stride == 0 );
+
+		SectionHeader	hdr;
+		hdr.section	= section;
+		hdr.stride	= stride;
+		hdr.size	= size;
+
+		CHECK_ERR( _file.Write( &hdr, BytesU::SizeOf(hdr) ));
+
+		_stride = stride;
+		return true;
+	}
+
+/*
+=================================================
+	Writer::WriteChunk
+=================================================
+*/
+	bool  ParticleSnapshot::Writer::WriteChunk (ArrayView<uint8_t> data)
+	{
+		CHECK_ERR( _stride > 0 and data.size() <= ChunkSize and data.size() % _stride == 0 );
+
+		Compress( data, _stride, OUT _packed );
+
+		ChunkHeader	hdr;
+		hdr.rawSize		= uint(data.size());
+		hdr.packedSize	= uint(_packed.size());
+
+		CHECK_ERR( _file.Write( &hdr, BytesU::SizeOf(hdr) ));
+		CHECK_ERR( _file.Write( _packed.data(), ArraySizeOf(_packed) ));
+
+		_rawSize	+= hdr.rawSize;
+		_packedSize	+= hdr.packedSize + sizeof(hdr);
+		return true;
+	}
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	Reader::ReadHeader
+=================================================
+*/
+	bool  ParticleSnapshot::Reader::ReadHeader (OUT Header &header)
+	{
+		CHECK_ERR( _file.IsOpen() );
+		CHECK_ERR( _file.Read( &header, BytesU::SizeOf(header) ));
+		CHECK_ERR( header.magic == Magic and header.version == Version );
+		return true;
+	}
+
+/*
+=================================================
+	Reader::ReadSection
+=================================================
+*/
+	bool  ParticleSnapshot::Reader::ReadSection (OUT SectionHeader &section)
+	{
+		CHECK_ERR( _file.Read( &section, BytesU::SizeOf(section) ));
+		CHECK_ERR( section.section < ESection::_Count and section.stride > 0 );
+
+		_stride = section.stride;
+		return true;
+	}
+
+/*
+=================================================
+	Reader::ReadChunk
+=================================================
+*/
+	bool  ParticleSnapshot::Reader::ReadChunk (OUT Array<uint8_t> &data)
+	{
+		ChunkHeader	hdr;
+		CHECK_ERR( _stride > 0 );
+		CHECK_ERR( _file.Read( &hdr, BytesU::SizeOf(hdr) ));
+		CHECK_ERR( hdr.rawSize <= ChunkSize and hdr.packedSize <= hdr.rawSize );
+
+		_packed.resize( hdr.packedSize );
+		CHECK_ERR( _file.Read( _packed.data(), ArraySizeOf(_packed) ));
+
+		return Decompress( _packed, _stride, hdr.rawSize, OUT data );
+	}
+
+
+}	// FG
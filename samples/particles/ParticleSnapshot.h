@@ -0,0 +1,121 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+#include "stl/Stream/FileStream.h"
+
+namespace FG
+{
+
+	//
+	// Particle Snapshot
+	//
+	// Binary file with particle buffers, so evolved state can be restored without simulating it again.
+	// File layout: 'Header', then for each section: 'SectionHeader' and compressed chunks.
+	// Buffers are read back and uploaded by chunks, so only a single chunk is kept in memory.
+	// Chunks are compressed independently: bytes of elements are grouped by byte index,
+	// so exponents and constant fields are placed together, then bytes are compressed by LZ4.
+	//
+
+	class ParticleSnapshot final
+	{
+	// types
+	public:
+		struct Header
+		{
+			uint		magic			= 0;
+			uint		version			= 0;
+			uint		mode			= 0;
+			uint		format			= 0;
+			uint		lifecycle		= 0;
+			uint		srcIndex		= 0;		// lifecycle only
+			uint		particleCount	= 0;
+			uint		maxParticles	= 0;
+			uint		blockSize		= 0;
+			uint		sectionCount	= 0;
+			double		globalTime		= 0.0;
+		};
+
+		enum class ESection : uint
+		{
+			Particles,
+			Counters,			// lifecycle only
+			_Count
+		};
+
+		struct SectionHeader
+		{
+			ESection	section		= ESection::_Count;
+			uint		stride		= 0;		// size of element for compression
+			uint64_t	size		= 0;		// uncompressed size
+		};
+
+		struct ChunkHeader
+		{
+			uint		rawSize		= 0;
+			uint		packedSize	= 0;
+		};
+
+		static constexpr uint	Magic		= 0x53545350;	// 'PSTS'
+		static constexpr uint	Version		= 4;
+		static constexpr uint	ChunkSize	= 16u << 20;	// max size, chunk must contain whole elements
+
+
+		//
+		// Writer
+		//
+		class Writer final
+		{
+		private:
+			FileWStream		_file;
+			Array<uint8_t>	_packed;
+			uint			_stride		= 0;
+			uint64_t		_rawSize	= 0;
+			uint64_t		_packedSize	= 0;
+
+		public:
+			explicit Writer (const String &filename) : _file{ filename } {}
+
+			bool  WriteHeader (const Header &header);
+			bool  BeginSection (ESection section, uint stride, uint64_t size);
+			bool  WriteChunk (ArrayView<uint8_t> data);
+
+			ND_ bool		IsOpen ()		const	{ return _file.IsOpen(); }
+			ND_ uint64_t	RawSize ()		const	{ return _rawSize; }
+			ND_ uint64_t	PackedSize ()	const	{ return _packedSize; }
+		};
+
+
+		//
+		// Reader
+		//
+		class Reader final
+		{
+		private:
+			FileRStream		_file;
+			Array<uint8_t>	_packed;
+			uint			_stride		= 0;
+
+		public:
+			explicit Reader (const String &filename) : _file{ filename } {}
+
+			ND_ bool  ReadHeader (OUT Header &header);
+			ND_ bool  ReadSection (OUT SectionHeader &section);
+			ND_ bool  ReadChunk (OUT Array<uint8_t> &data);
+
+			ND_ bool  IsOpen ()	const	{ return _file.IsOpen(); }
+		};
+
+
+	// methods
+	public:
+		static void  Compress (ArrayView<uint8_t> src, uint stride, OUT Array<uint8_t> &dst);
+		ND_ static bool  Decompress (ArrayView<uint8_t> src, uint stride, size_t rawSize, OUT Array<uint8_t> &dst);
+
+		// reads whole section, can be used to compare GPU results with 'ParticleSimulator'
+		ND_ static bool  LoadSection (StringView filename, ESection section, OUT Header &header, OUT Array<uint8_t> &data);
+	};
+
+
+}	// FG
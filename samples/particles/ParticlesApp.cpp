@@ -6,7 +6,68 @@
 
 namespace FG
 {
-	
+namespace
+{
+	// recorded simulation steps for reproducible benchmarks
+	static constexpr char	StepsFilename[] = FG_DATA_PATH "particle_steps.bin";
+
+	// evolved particle state, see 'ParticleSnapshot'
+	static constexpr char	SnapshotFilename[] = FG_DATA_PATH "particle_snapshot.bin";
+
+/*
+=================================================
+	CompareParticleFormats
+----
+	simulates the same particles in float and packed formats,
+	packed particles are quantized after each frame as on GPU,
+	the largest position error over all frames is reported as drift
+=================================================
+*/
+	void  CompareParticleFormats (uint mode, ArrayView<ParticleSimulator::Particle> particles, float stepTime, uint steps, float globalTime,
+								  uint indexSize)
+	{
+		static constexpr uint	num_frames	= 60;
+		static constexpr float	max_error	= 1.0e-2f;
+
+		ParticleSimulator	ref, packed;
+		CHECK_ERRV( ref.Load( mode, particles ));
+		CHECK_ERRV( packed.Load( mode, particles ));
+		packed.Quantize();
+
+		Array<ParticleSimulator::Particle>	result;
+		ParticleSimulator::CompareResult	cmp;
+		float								max_drift	= 0.0f;
+		uint								drift_frame	= 0;
+
+		for (uint i = 0; i < num_frames; ++i)
+		{
+			ref.Update( stepTime, steps, globalTime + stepTime * steps * i, indexSize );
+			packed.Update( stepTime, steps, globalTime + stepTime * steps * i, indexSize );
+			packed.Quantize();
+
+			packed.Store( OUT result );
+			cmp = ref.Compare( result, max_error );
+
+			if ( cmp.maxPositionError > max_drift )
+			{
+				max_drift	= cmp.maxPositionError;
+				drift_frame	= i;
+			}
+		}
+
+		FG_LOGI( "Particle formats: "s << ToString( particles.size() ) << " particles, " << ToString( num_frames ) << " frames, " << ToString( steps ) << " steps per frame"
+				 << ", size: " << ToString( sizeof(ParticleSimulator::Particle) ) << " / " << ToString( sizeof(ParticleSimulator::PackedParticle) ) << " bytes"
+				 << ", max position drift: " << ToString( max_drift ) << " at frame " << ToString( drift_frame )
+				 << ", max position error: " << ToString( cmp.maxPositionError )
+				 << ", avg position error: " << ToString( cmp.avgPositionError )
+				 << ", max velocity error: " << ToString( cmp.maxVelocityError )
+				 << ", particles with error > " << ToString( max_error ) << ": " << ToString( cmp.mismatched ));
+	}
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
 /*
 =================================================
 	destructor
@@ -19,11 +80,14 @@ namespace FG
 			_frameGraph->ReleaseResource( _colorBuffer[0] );
 			_frameGraph->ReleaseResource( _colorBuffer[1] );
 			_frameGraph->ReleaseResource( _depthBuffer );
-
 			_frameGraph->ReleaseResource( _cameraUB[0] );
 			_frameGraph->ReleaseResource( _cameraUB[1] );
-			_frameGraph->ReleaseResource( _particlesUB );
-			_frameGraph->ReleaseResource( _particlesBuf );
+
+			_particles.Destroy( _frameGraph );
+			_lifecycle.Destroy( _frameGraph );
+			_spatialHash.Destroy( _frameGraph );
+			_depthSort.Destroy( _frameGraph );
+			_stereo.Destroy( _frameGraph );
 			
 			_frameGraph->ReleaseResource( _updateParticlesPpln );
 			_frameGraph->ReleaseResource( _dotsParticlesPpln );
@@ -55,19 +119,15 @@ namespace FG
 		_cameraUB[1] = _frameGraph->CreateBuffer( BufferDesc{ SizeOf<CameraUB>, EBufferUsage::Uniform | EBufferUsage::Transfer }, Default, "CameraUB" );
 		CHECK_ERR( _cameraUB[0] and _cameraUB[1] );
 		
-		_particlesUB = _frameGraph->CreateBuffer( BufferDesc{ SizeOf<ParticlesUB>, EBufferUsage::Uniform | EBufferUsage::Transfer }, Default, "ParticlesUB" );
-		CHECK_ERR( _particlesUB );
-
-		_particlesBuf = _frameGraph->CreateBuffer( BufferDesc{ SizeOf<ParticleVertex> * _maxParticles, EBufferUsage::Storage | EBufferUsage::Vertex }, Default, "Particles" );
-		CHECK_ERR( _particlesBuf );
+		CHECK_ERR( _particles.Create( _frameGraph, _maxParticles, _localSize ));
 		
 		_initialized	= false;
 		_reloadShaders	= true;
 		_particleMode	= EParticleDrawMode::Rays;
 		_blendMode		= EBlendMode::Additive;
 		_numParticles	= _maxParticles / 4;
-		_startTime		= CurrentTime();
 		_numSteps		= 20;
+		_emitCount		= _maxParticles / 256;
 
 		_ResetPosition();
 		return true;
@@ -86,6 +146,19 @@ namespace FG
 		
 		_UpdateCamera();
 
+		// fixed simulation steps
+		GpuStepScheduler::Config	step_cfg;
+		step_cfg.stepTime	= _GetTimeStep();
+		step_cfg.maxSteps	= _numSteps;
+		step_cfg.maxBacklog	= _numSteps;
+		step_cfg.gpuBudget	= SecondsF{ _stepBudget * 1.0e-3f };
+
+		const auto&		step_frame	= _stepScheduler.Advance( _frameGraph, FrameTime(), step_cfg );
+
+		// expansion may be changed in UI during benchmark
+		if ( _expandBench.IsActive() and _stepScheduler.GpuTime() )
+			_particleExpand = _expandBench.Update( *_stepScheduler.GpuTime(), _numParticles );
+
 		// update camera
 		if ( IsActiveVR() )
 		{
@@ -99,6 +172,7 @@ namespace FG
 			camera.modelViewProj= vr.ToModelViewProjMatrix()[0];
 			camera.viewport		= float2(surf_dim);
 			camera.clipPlanes	= VecCast(GetViewRange());
+			camera.timeOffset	= step_frame.timeOffset;
 			cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _cameraUB[0] ).AddData( &camera, 1 ));
 			
 			camera.proj			= vr.ToProjectionMatrix()[1];
@@ -114,32 +188,160 @@ namespace FG
 			camera.modelViewProj= GetCamera().ToModelViewProjMatrix();
 			camera.viewport		= float2(surf_dim);
 			camera.clipPlanes	= VecCast(GetViewRange());
+			camera.timeOffset	= step_frame.timeOffset;
 			cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _cameraUB[0] ).AddData( &camera, 1 ));
 		}
 
 		// update particles
+		ParticlesUB		particle;
 		{
-			ParticlesUB			particle;
-			particle.timeDelta	= _GetTimeStep();
-			particle.steps		= Clamp( uint(FrameTime().count() / particle.timeDelta + 0.5f), 1u, _numSteps );
-			particle.globalTime	= std::chrono::duration_cast<SecondsF>(CurrentTime() - _startTime).count();
-			cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _particlesUB ).AddData( &particle, 1 ));
+			particle.timeDelta	= step_frame.stepTime;
+			particle.steps		= step_frame.steps;
+			particle.globalTime	= step_frame.globalTime;
+			particle.emitCount	= Min( _emitCount * step_frame.steps, _maxParticles );	// emission rate is per simulation step
+			particle.maxLifetime= _maxLifetime;
+			particle.srcIndex	= _lifecycle.SrcIndex();
+			particle.maxParticles= _maxParticles;
+
+			// burst is postponed until simulation step
+			if ( _emitBurst and step_frame.steps > 0 )
+			{
+				particle.emitCount	= _maxParticles / 8;
+				_emitBurst			= false;
+			}
+			cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _particles.UniformBuffer() ).AddData( &particle, 1 ));
+		}
+
+		// particle expansion and single pass stereo use different draw shaders
+		if ( _curExpand != _particleExpand )
+		{
+			_curExpand		= _particleExpand;
+			_reloadShaders	= true;
+		}
+
+		if ( _curStereo != (IsActiveVR() and _singlePassStereo and _curExpand == EParticleExpand::GeometryShader) )
+		{
+			_curStereo		= not _curStereo;
+			_reloadShaders	= true;
+		}
+
+		if ( _curSortedPulling != (_curExpand == EParticleExpand::VertexPulling and _UsesDepthSort()) )
+		{
+			_curSortedPulling	= not _curSortedPulling;
+			_reloadShaders		= true;
 		}
 
 		_ReloadShaders( cmdbuf );
 
-		// update
+		// snapshot replaces initial state, so it is restored after initialization
+		if ( _restoreSnapshot and _initialized )
+			_RestoreSnapshot( cmdbuf, INOUT particle );
+
+		// state before simulation in this frame is saved
+		if ( _saveSnapshot and _initialized )
+		{
+			GpuSnapshot::Header	header;
+			header.mode				= _curMode;
+			header.lifecycle		= uint(_curLifecycle);
+			header.srcIndex			= _lifecycle.SrcIndex();
+			header.particleCount	= _numParticles;
+			header.globalTime		= particle.globalTime;
+
+			_saveSnapshot = false;
+			GpuSnapshot::Save( cmdbuf, _particles, header, SnapshotFilename );
+		}
+
+		// sort particles by cell for neighbour search, CPU version of simulation is not supported for these modes
+		if ( _spatialHash.IsReady() and _UsesSpatialHash() )
+		{
+			_spatialHash.Update( cmdbuf, _particles, _numParticles, _hashCellSize, _validateSimulation );
+			_validateSimulation = false;
+		}
+
+		// update alive particles
+		if ( _updateParticlesPpln and _curLifecycle )
+		{
+			// particles are reordered by compaction, so CPU version can not be used
+			if ( _validateSimulation or _compareFormats )
+				FG_LOGI( "CPU validation is not supported in lifecycle mode" );
+
+			_validateSimulation	= false;
+			_compareFormats		= false;
+
+			// particles are not changed and not emitted without simulation steps
+			if ( particle.steps > 0 )
+				_lifecycle.Update( cmdbuf, INOUT _particles, _updateParticlesPpln, INOUT _updateParticlesRes, particle );
+		}
+		else
+		// update all particles
 		if ( _updateParticlesPpln )
 		{
+			const uint	group_count	= (_numParticles + _localSize - 1) / _localSize;
+			const uint	index_size	= group_count * _localSize;
+			const bool	supported	= ParticleSimulator::IsSupported( _curMode );
+			const bool	validate	= _validateSimulation and supported;
+			auto		simulator	= validate ? MakeShared<ParticleSimulator>() : null;
+
+			// all particles in workgroup are updated, so whole workgroups are compared
+			if ( validate )
+			{
+				_particles.Read( cmdbuf, index_size, [simulator, mode = _curMode] (ArrayView<ParticleSimulator::Particle> particles)
+				{
+					CHECK( simulator->Load( mode, particles ));
+				});
+			}
+
+			if ( _compareFormats and supported )
+			{
+				_compareFormats = false;
+				_particles.Read( cmdbuf, Min( group_count, _maxCompareBlocks ) * _localSize,
+								[particle, index_size, mode = _curMode] (ArrayView<ParticleSimulator::Particle> particles)
+								{
+									CompareParticleFormats( mode, particles, particle.timeDelta, particle.steps, particle.globalTime, index_size );
+								});
+			}
+
 			DispatchCompute		comp;
 			comp.SetPipeline( _updateParticlesPpln );
 			comp.AddResources( DescriptorSetID{"0"}, _updateParticlesRes );
 			comp.SetLocalSize( uint2{_localSize, 1} );
-			comp.Dispatch( uint2{(_numParticles + _localSize - 1) / _localSize, 1} );
+			comp.Dispatch( uint2{group_count, 1} );
 
 			cmdbuf->AddTask( comp );
+
+			// particles after update, callbacks are called in the same order as tasks are added
+			if ( validate )
+			{
+				_validateSimulation = false;
+				_particles.Read( cmdbuf, index_size, [simulator, particle, index_size, packed = (_curFormat == EParticleFormat::Packed)]
+								(ArrayView<ParticleSimulator::Particle> particles)
+				{
+					static constexpr float	max_error	= 1.0e-3f;
+
+					simulator->Update( particle.timeDelta, particle.steps, particle.globalTime, index_size );
+
+					if ( packed )
+						simulator->Quantize();
+
+					const auto	result = simulator->Compare( particles, max_error );
+
+					FG_LOGI( "Particle simulation: "s << ToString( particles.size() ) << " particles, " << ToString( particle.steps ) << " steps"
+							 << ", max position error: " << ToString( result.maxPositionError )
+							 << ", max velocity error: " << ToString( result.maxVelocityError )
+							 << ", max color error: " << ToString( result.maxColorError )
+							 << ", particles with error > " << ToString( max_error ) << ": " << ToString( result.mismatched ));
+				});
+			}
 		}
 
+		// sort particles for alpha blending, particles are reordered by compaction in lifecycle mode
+		if ( _depthSort.IsReady() and _UsesDepthSort() )
+			_depthSort.Sort( cmdbuf, _particles, _cameraUB[0], _numParticles, _sortInterval, _validateSort );
+		else
+			_depthSort.Invalidate();
+
+		_validateSort = false;
+
 		// draw
 		{
 			// resize
@@ -163,8 +365,17 @@ namespace FG
 
 			if ( IsActiveVR() )
 			{
-				_DrawParticles( cmdbuf, 0 );
-				_DrawParticles( cmdbuf, 1 );
+				// both eyes are drawn in a single pass and copied to '_colorBuffer'
+				if ( _curStereo )
+				{
+					CHECK( _stereo.Resize( _frameGraph, surf_dim ));
+					_DrawParticles( cmdbuf, 0 );
+				}
+				else
+				{
+					_DrawParticles( cmdbuf, 0 );
+					_DrawParticles( cmdbuf, 1 );
+				}
 
 				CHECK_ERR( _frameGraph->Execute( cmdbuf ));
 				CHECK_ERR( _frameGraph->Flush() );
@@ -194,9 +405,61 @@ namespace FG
 		return true;
 	}
 	
+/*
+=================================================
+	_RestoreSnapshot
+----
+	if settings are different then particles are reinitialized with settings of snapshot
+	and snapshot is restored in the next frame
+=================================================
+*/
+	void  ParticlesApp::_RestoreSnapshot (const CommandBuffer &cmdbuf, INOUT ParticlesUB &params)
+	{
+		using ERestore = GpuSnapshot::ERestore;
+
+		GpuSnapshot::Header		header;
+		header.mode			= _curMode;
+		header.format		= uint(_curFormat);
+		header.lifecycle	= uint(_curLifecycle);
+		header.srcIndex		= _lifecycle.SrcIndex();
+
+		BEGIN_ENUM_CHECKS();
+		switch ( GpuSnapshot::Restore( cmdbuf, _particles, INOUT header, SnapshotFilename ))
+		{
+			case ERestore::Failed :
+				_restoreSnapshot = false;
+				return;
+
+			case ERestore::Mismatch :
+				_curMode		= _newMode		= header.mode;
+				_curFormat		= _newFormat	= EParticleFormat(header.format);
+				_curLifecycle	= _newLifecycle	= bool(header.lifecycle);
+				_reloadShaders	= true;
+				_initialized	= false;
+				return;
+
+			case ERestore::Restored :
+				break;
+		}
+		END_ENUM_CHECKS();
+
+		_restoreSnapshot = false;
+
+		// continue simulation from time of snapshot
+		params.globalTime = float(header.globalTime);
+		cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _particles.UniformBuffer() ).AddData( &params, 1 ));
+
+		_stepScheduler.Continue( header.globalTime );
+		_numParticles = header.particleCount;
+		_depthSort.Invalidate();
+	}
+
 /*
 =================================================
 	_DrawParticles
+----
+	in single pass stereo mode 'eye' is ignored, both eyes are drawn
+	to layers of '_stereo' and copied to '_colorBuffer'
 =================================================
 */
 	void  ParticlesApp::_DrawParticles (const CommandBuffer &cmdbuf, uint eye)
@@ -204,53 +467,158 @@ namespace FG
 		if ( _dotsParticlesPpln and _raysParticlesPpln )
 		{
 			const uint2		surf_dim = _frameGraph->GetDescription( _colorBuffer[eye] ).dimension.xy();
+			RenderPassDesc	rp_desc{ surf_dim };
+			rp_desc.AddViewport( surf_dim );
+
+			if ( _curStereo )
+			{
+				_stereo.AddTargets( INOUT rp_desc );
+
+				_drawParticlesRes.BindBuffer( UniformID{"CameraUB"},      _cameraUB[0] );
+				_drawParticlesRes.BindBuffer( UniformID{"RightCameraUB"}, _cameraUB[1] );
+			}
+			else
+			{
+				rp_desc.AddTarget( RenderTargetID::Color_0, _colorBuffer[eye], RGBA32f{0.0f}, EAttachmentStoreOp::Store )
+					   .AddTarget( RenderTargetID::Depth, _depthBuffer, DepthStencil{1.0f}, EAttachmentStoreOp::Store );
 
-			LogicalPassID	pass_id = cmdbuf->CreateRenderPass( RenderPassDesc{ surf_dim }
-										.AddViewport( surf_dim )
-										.AddTarget( RenderTargetID::Color_0, _colorBuffer[eye], RGBA32f{0.0f}, EAttachmentStoreOp::Store )
-										.AddTarget( RenderTargetID::Depth, _depthBuffer, DepthStencil{1.0f}, EAttachmentStoreOp::Store ));
+				_drawParticlesRes.BindBuffer( UniformID{"CameraUB"}, _cameraUB[eye] );
+			}
+
+			LogicalPassID	pass_id = cmdbuf->CreateRenderPass( rp_desc );
 			CHECK_ERRV( pass_id );
-			
-			_drawParticlesRes.BindBuffer( UniformID{"CameraUB"}, _cameraUB[eye] );
-
-			DrawVertices	draw;
-			draw.AddVertexBuffer( Default, _particlesBuf );
-			draw.SetVertexInput( VertexInputState{}.Bind( Default, SizeOf<ParticleVertex> )
-									.Add( VertexID{"in_Position"},	&ParticleVertex::position )
-									.Add( VertexID{"in_Color"},		&ParticleVertex::color )
-									.Add( VertexID{"in_Size"},		&ParticleVertex::size )
-									.Add( VertexID{"in_Velocity"},	&ParticleVertex::velocity ));
-			draw.SetTopology( EPrimitive::Point );
-			draw.AddResources( DescriptorSetID{"0"}, _drawParticlesRes );
-			draw.SetDepthTestEnabled( false );
-			draw.SetDepthWriteEnabled( false );
-			draw.Draw( _numParticles );
+
+			// returns 'false' if draw mode is not supported
+			const auto	SetupDraw = [this] (auto &draw) -> bool
+			{
+				const bool	pulling = (_curExpand == EParticleExpand::VertexPulling);
+
+				if ( pulling )
+				{
+					_drawParticlesRes.BindBuffer( UniformID{"ParticleSSB"}, _particles.Particles() );
+
+					if ( _curSortedPulling )
+						_drawParticlesRes.BindBuffer( UniformID{"ParticleOrderSSB"}, _depthSort.Indices() );
+				}
+				else
+					draw.AddVertexBuffer( Default, _particles.Particles() );
+
+				BEGIN_ENUM_CHECKS();
+				switch ( _curFormat )
+				{
+					case EParticleFormat::Float :
+						if ( pulling )
+							break;
+
+						draw.SetVertexInput( VertexInputState{}.Bind( Default, SizeOf<ParticleVertex> )
+												.Add( VertexID{"in_Position"},	&ParticleVertex::position )
+												.Add( VertexID{"in_Color"},		&ParticleVertex::color )
+												.Add( VertexID{"in_Size"},		&ParticleVertex::size )
+												.Add( VertexID{"in_Velocity"},	&ParticleVertex::velocity ));
+						break;
+
+					// size and velocity are packed to 'Half4', because 'Half3' is not supported as vertex format on many devices
+					case EParticleFormat::Packed :
+						if ( not pulling )
+						{
+							draw.SetVertexInput( VertexInputState{}.Bind( Default, SizeOf<PackedParticleVertex> )
+													.Add( VertexID{"in_Position"},		&PackedParticleVertex::position )
+													.Add( VertexID{"in_SizeVelocity"},	EVertexType::Half4,		OffsetOf( &PackedParticleVertex::sizeVelocity ))
+													.Add( VertexID{"in_ColorIndex"},	EVertexType::UShort,	OffsetOf( &PackedParticleVertex::colorParam )));
+						}
+						_drawParticlesRes.BindBuffer( UniformID{"ParticlePaletteSSB"},	_particles.Palette() );
+						break;
+				}
+				END_ENUM_CHECKS();
+
+				draw.SetTopology( pulling ? EPrimitive::TriangleStrip : EPrimitive::Point );
+				draw.AddResources( DescriptorSetID{"0"}, _drawParticlesRes );
+				draw.SetDepthTestEnabled( false );
+				draw.SetDepthWriteEnabled( false );
 				
-			BEGIN_ENUM_CHECKS();
-			switch ( _particleMode )
+				BEGIN_ENUM_CHECKS();
+				switch ( _particleMode )
+				{
+					case EParticleDrawMode::Dots :		draw.SetPipeline( _dotsParticlesPpln );		break;
+					case EParticleDrawMode::Rays :		draw.SetPipeline( _raysParticlesPpln );		break;
+					case EParticleDrawMode::Unknown :
+					default :							return false;
+				}
+				END_ENUM_CHECKS();
+
+				BEGIN_ENUM_CHECKS();
+				switch ( _blendMode )
+				{
+					case EBlendMode::None :		break;
+					case EBlendMode::Additive :	draw.AddColorBuffer( RenderTargetID::Color_0, EBlendFactor::One, EBlendFactor::One, EBlendOp::Add );	break;
+					case EBlendMode::Alpha :	draw.AddColorBuffer( RenderTargetID::Color_0, EBlendFactor::One, EBlendFactor::OneMinusSrcAlpha, EBlendOp::Add );	break;
+				}
+				END_ENUM_CHECKS();
+				return true;
+			};
+
+			// number of alive particles is known only on GPU, see 'update_particle_args.glsl'
+			if ( _curLifecycle )
 			{
-				case EParticleDrawMode::Dots :		draw.SetPipeline( _dotsParticlesPpln );		break;
-				case EParticleDrawMode::Rays :		draw.SetPipeline( _raysParticlesPpln );		break;
-				case EParticleDrawMode::Unknown :
-				default :							return;
+				DrawVerticesIndirect	draw;
+				draw.SetIndirectBuffer( _particles.Counters() );
+				draw.Draw( 1 );
+
+				if ( not SetupDraw( draw ))
+					return;
+
+				cmdbuf->AddTask( pass_id, draw );
 			}
-			END_ENUM_CHECKS();
+			else
+			// particle is an instance of quad, sorted indices are read in vertex shader
+			if ( _curExpand == EParticleExpand::VertexPulling )
+			{
+				// indices are not initialized until the first sort
+				if ( _curSortedPulling and not _depthSort.IsSorted( _numParticles ))
+					return;
+
+				DrawVertices	draw;
+				draw.Draw( 4, _numParticles );
 
-			BEGIN_ENUM_CHECKS();
-			switch ( _blendMode )
+				if ( not SetupDraw( draw ))
+					return;
+
+				cmdbuf->AddTask( pass_id, draw );
+			}
+			else
+			// sorted indices are used as index buffer, so 'gl_VertexIndex' is the particle index
+			if ( _UsesDepthSort() and _depthSort.IsSorted( _numParticles ))
 			{
-				case EBlendMode::None :		break;
-				case EBlendMode::Additive :	draw.AddColorBuffer( RenderTargetID::Color_0, EBlendFactor::One, EBlendFactor::One, EBlendOp::Add );	break;
+				DrawIndexed		draw;
+				draw.SetIndexBuffer( _depthSort.Indices(), 0_b, EIndex::UInt );
+				draw.Draw( _numParticles );
+
+				if ( not SetupDraw( draw ))
+					return;
+
+				cmdbuf->AddTask( pass_id, draw );
 			}
-			END_ENUM_CHECKS();
+			else
+			{
+				DrawVertices	draw;
+				draw.Draw( _numParticles );
 
-			cmdbuf->AddTask( pass_id, draw );
+				if ( not SetupDraw( draw ))
+					return;
+
+				cmdbuf->AddTask( pass_id, draw );
+			}
 
 			cmdbuf->AddTask( SubmitRenderPass{ pass_id });
+
+			if ( _curStereo )
+				_stereo.CopyTo( cmdbuf, _colorBuffer[0], _colorBuffer[1] );
 		}
 		else
 		{
-			cmdbuf->AddTask( ClearColorImage{}.SetImage( _colorBuffer[eye] ).Clear( RGBA32f{0.2f} ).AddRange( 0_mipmap, 1, 0_layer, 1 ));
+			for (uint i = 0; i < (_curStereo ? CountOf(_colorBuffer) : 1); ++i) {
+				cmdbuf->AddTask( ClearColorImage{}.SetImage( _colorBuffer[_curStereo ? i : eye] ).Clear( RGBA32f{0.2f} ).AddRange( 0_mipmap, 1, 0_layer, 1 ));
+			}
 		}
 	}
 
@@ -269,6 +637,9 @@ namespace FG
 			if ( key == "I" )	{ _reloadShaders = true;  _initialized = false; }
 			if ( key == "U" )	{ _debugPixel = GetMousePos() / vec2(GetSurfaceSize().x, GetSurfaceSize().y); }
 			if ( key == "P" )	_ResetPosition();
+			if ( key == "V" )	{ _validateSimulation = true;  _validateSort = true; }
+			if ( key == "F" )	_compareFormats = true;
+			if ( key == "B" )	_emitBurst = true;
 		}
 	}
 	
@@ -286,11 +657,16 @@ namespace FG
 
 		_reloadShaders = false;
 
+		const String	defines = _ShaderDefines();
+
 		// init particles for simulation
 		if ( not _initialized )
 		{
+			// buffer size depends on particle format
+			CHECK_ERRV( _particles.Reset( _frameGraph, _curMode, _curFormat ));
+
 			ComputePipelineDesc	desc;
-			desc.AddShader( EShaderLangFormat::VKSL_110, "main", "#define MODE "s + ToString(_curMode) + "\n"s + _LoadShader("shaders/init_simulation.glsl") );
+			desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + _LoadShader("shaders/init_simulation.glsl") );
 
 			CPipelineID	ppln = _frameGraph->CreatePipeline( desc );
 			if ( ppln )
@@ -298,7 +674,10 @@ namespace FG
 				PipelineResources	res;
 				CHECK( _frameGraph->InitPipelineResources( ppln, DescriptorSetID{"0"}, OUT res ));
 
-				res.BindBuffer( UniformID{"ParticleSSB"}, _particlesBuf );
+				res.BindBuffer( UniformID{"ParticleSSB"}, _particles.Particles() );
+
+				if ( _particles.IsPacked() )
+					res.BindBuffer( UniformID{"ParticlePaletteSSB"}, _particles.Palette() );
 				
 				DispatchCompute		comp;
 				comp.SetPipeline( ppln );
@@ -309,8 +688,18 @@ namespace FG
 
 				_frameGraph->ReleaseResource( ppln );
 
-				_initialized	= true;
-				_startTime		= CurrentTime();
+				if ( _curLifecycle )
+					CHECK( _lifecycle.Init( cmdbuf, _particles, _numParticles, _curExpand == EParticleExpand::VertexPulling ));
+				else
+					_lifecycle.Destroy( _frameGraph );
+
+				if ( _UsesSpatialHash() )
+					CHECK( _spatialHash.Create( cmdbuf, _particles, _hashCellCount ));
+				else
+					_spatialHash.Destroy( _frameGraph );
+
+				_initialized = true;
+				_stepScheduler.Restart();
 			}
 		}
 
@@ -318,7 +707,7 @@ namespace FG
 		if ( _initialized )
 		{
 			ComputePipelineDesc	desc;
-			desc.AddShader( EShaderLangFormat::VKSL_110, "main", "#define MODE "s + ToString(_curMode) + "\n"s + _LoadShader("shaders/simulation.glsl") );
+			desc.AddShader( EShaderLangFormat::VKSL_110, "main", defines + _LoadShader("shaders/simulation.glsl") );
 
 			CPipelineID	ppln = _frameGraph->CreatePipeline( desc );
 			if ( ppln )
@@ -327,18 +716,37 @@ namespace FG
 				_updateParticlesPpln = std::move(ppln);
 				
 				CHECK( _frameGraph->InitPipelineResources( _updateParticlesPpln, DescriptorSetID{"0"}, OUT _updateParticlesRes ));
-				_updateParticlesRes.BindBuffer( UniformID{"ParticleSSB"}, _particlesBuf );
-				_updateParticlesRes.BindBuffer( UniformID{"ParticleUB"},  _particlesUB );
+				_updateParticlesRes.BindBuffer( UniformID{"ParticleSSB"}, _particles.Particles() );
+				_updateParticlesRes.BindBuffer( UniformID{"ParticleUB"},  _particles.UniformBuffer() );
+
+				if ( _curLifecycle )
+					_updateParticlesRes.BindBuffer( UniformID{"ParticleCounterSSB"}, _particles.Counters() );
+
+				if ( _UsesSpatialHash() )
+					_spatialHash.BindSimulation( INOUT _updateParticlesRes );
 			}
 		}
 
+		// spatial hash
+		if ( _initialized and _UsesSpatialHash() )
+			_spatialHash.ReloadShaders( _frameGraph, defines, &_LoadShader, _particles );
+
+		// particle lifecycle
+		if ( _initialized and _curLifecycle )
+			_lifecycle.ReloadShaders( _frameGraph, defines, &_LoadShader, _particles );
+
+		// depth sort, blend mode can be changed without reloading shaders
+		if ( _initialized )
+			_depthSort.ReloadShaders( _frameGraph, defines, &_LoadShader );
+
 		// dot particles
 		{
 			GraphicsPipelineDesc	desc;
 
-			String	sh_source = _LoadShader("shaders/particles_dots.glsl");
+			String	sh_source = defines + _LoadShader("shaders/particles_dots.glsl");
 			desc.AddShader( EShader::Vertex,   EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_VERTEX\n"   + sh_source );
-			desc.AddShader( EShader::Geometry, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_GEOMETRY\n" + sh_source );
+			if ( _curExpand == EParticleExpand::GeometryShader )
+				desc.AddShader( EShader::Geometry, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_GEOMETRY\n" + sh_source );
 			desc.AddShader( EShader::Fragment, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_FRAGMENT\n" + sh_source );
 
 			GPipelineID	ppln = _frameGraph->CreatePipeline( desc );
@@ -354,9 +762,10 @@ namespace FG
 		{
 			GraphicsPipelineDesc	desc;
 
-			String	sh_source = _LoadShader("shaders/particles_rays.glsl");
+			String	sh_source = defines + _LoadShader("shaders/particles_rays.glsl");
 			desc.AddShader( EShader::Vertex,   EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_VERTEX\n"   + sh_source );
-			desc.AddShader( EShader::Geometry, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_GEOMETRY\n" + sh_source );
+			if ( _curExpand == EParticleExpand::GeometryShader )
+				desc.AddShader( EShader::Geometry, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_GEOMETRY\n" + sh_source );
 			desc.AddShader( EShader::Fragment, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_FRAGMENT\n" + sh_source );
 
 			GPipelineID	ppln = _frameGraph->CreatePipeline( desc );
@@ -399,6 +808,36 @@ namespace FG
 		return 0.01f * (_timeScale >= -0.0f ? Lerp( 1.0f, 10.0f, _timeScale ) : Lerp( 0.001f, 1.0f, 1.0f + _timeScale ));
 	}
 
+/*
+=================================================
+	_ShaderDefines
+=================================================
+*/
+	String  ParticlesApp::_ShaderDefines () const
+	{
+		String	str = "#define MODE "s + ToString(_curMode) + "\n";
+
+		if ( _curFormat == EParticleFormat::Packed )
+			str << "#define PACKED_PARTICLES\n";
+
+		if ( _curLifecycle )
+			str << "#define PARTICLE_LIFECYCLE\n#define UPDATE_LOCAL_SIZE " << ToString(_localSize) << "\n";
+
+		if ( _UsesSpatialHash() )
+			str << "#define SPATIAL_HASH\n#define SPATIAL_HASH_LOCAL_SIZE " << ToString(_localSize) << "\n";
+
+		if ( _curStereo )
+			str << "#define STEREO\n";
+
+		if ( _curExpand == EParticleExpand::VertexPulling )
+			str << "#define VERTEX_PULLING\n";
+
+		if ( _curSortedPulling )
+			str << "#define SORTED_PARTICLES\n";
+
+		return str;
+	}
+
 
 /*
 =================================================
@@ -416,14 +855,118 @@ namespace FG
 		ImGui::Text( "Blend mode:" );
 		ImGui::RadioButton( " none",     INOUT Cast<int>(&_blendMode), int(EBlendMode::None) );
 		ImGui::RadioButton( " additive", INOUT Cast<int>(&_blendMode), int(EBlendMode::Additive) );
+		ImGui::RadioButton( " alpha",    INOUT Cast<int>(&_blendMode), int(EBlendMode::Alpha) );
+
+		if ( _blendMode == EBlendMode::Alpha )
+		{
+			if ( _curLifecycle )
+				ImGui::Text( "Particles are not sorted in lifecycle mode" );
+			else
+			{
+				const auto&	info = _depthSort.GetInfo();
+
+				ImGui::Text( "Full sort interval (frames):" );
+				ImGui::SliderInt( "##SortInterval", INOUT Cast<int>(&_sortInterval), 1, 120 );
+
+				if ( info.validated )
+					ImGui::Text( ("Sorted: "s << ToString( info.count ) << ", unordered: " << ToString( info.unordered )
+								  << ", mismatched: " << ToString( info.mismatched )).c_str() );
+			}
+		}
 		ImGui::Separator();
 			
+		ImGui::Text( "Particle format:" );
+		ImGui::RadioButton( " float",  INOUT Cast<int>(&_newFormat), int(EParticleFormat::Float) );
+		ImGui::RadioButton( " packed", INOUT Cast<int>(&_newFormat), int(EParticleFormat::Packed) );
+		ImGui::Separator();
+
+		ImGui::Text( "Particle expansion:" );
+		ImGui::RadioButton( " geometry shader", INOUT Cast<int>(&_particleExpand), int(EParticleExpand::GeometryShader) );
+		ImGui::RadioButton( " vertex pulling",  INOUT Cast<int>(&_particleExpand), int(EParticleExpand::VertexPulling) );
+
+		if ( _expandBench.IsActive() )
+			ImGui::Text( ("Benchmark: "s << ToString( _expandBench.Current() + 1 ) << " / " << ToString( uint(EParticleExpand::_Count) )).c_str() );
+		else
+		if ( ImGui::Button( "Benchmark expansion" ))
+			_particleExpand = _expandBench.Start();
+
+		if ( _expandBench.IsFinished() )
+		{
+			ImGui::Text( ("GPU frame time, geometry shader: "s << ToString( _expandBench.AverageTime( EParticleExpand::GeometryShader ))
+						  << " ms, vertex pulling: " << ToString( _expandBench.AverageTime( EParticleExpand::VertexPulling )) << " ms").c_str() );
+		}
+
+		if ( IsActiveVR() and _particleExpand == EParticleExpand::GeometryShader )
+			ImGui::Checkbox( "Single pass stereo", INOUT &_singlePassStereo );
+
+		ImGui::Separator();
+
+		ImGui::Checkbox( "Particle lifecycle", INOUT &_newLifecycle );
+		if ( _curLifecycle )
+		{
+			ImGui::Text( "Emit per step:" );
+			ImGui::SliderInt( "##EmitCount", INOUT Cast<int>(&_emitCount), 0, _maxParticles / 16 );
+			ImGui::Text( "Lifetime:" );
+			ImGui::SliderFloat( "##Lifetime", INOUT &_maxLifetime, 0.1f, 60.0f );
+
+			if ( ImGui::Button( "Burst (B)" ))
+				_emitBurst = true;
+		}
+		ImGui::Separator();
+
+		// particles are read and written in simulation and read in each draw
+		const double	traffic		= double(uint64_t(_particles.ParticleSize()) * (IsActiveVR() and not _curStereo ? 4 : 3) * _numParticles) / double(1 << 20);
+
 		ImGui::Text( "Particle count:" );
 		ImGui::SliderInt( "##ParticleCount", INOUT Cast<int>(&_numParticles), 1, _maxParticles );
+		ImGui::Text( ("Particle size: "s << ToString( uint64_t(_particles.ParticleSize()) ) << " bytes, traffic: " << ToString( traffic ) << " MB/frame").c_str() );
 		ImGui::Text( ("Time step: "s + ToString(_GetTimeStep())).c_str() );
 		ImGui::SliderFloat( "##TimeScale", INOUT &_timeScale, -1.0f, 1.0f );
 		ImGui::Text( "Max steps:" );
 		ImGui::SliderInt( "##MaxSteps", INOUT Cast<int>(&_numSteps), 1, _maxSteps );
+		ImGui::Text( "GPU budget (ms), 0 - unlimited:" );
+		ImGui::SliderFloat( "##StepBudget", INOUT &_stepBudget, 0.0f, 16.0f );
+		auto&	scheduler = _stepScheduler.Scheduler();
+
+		ImGui::Text( ("Steps: "s << ToString( _stepScheduler.GetFrame().steps ) << ", step cost: " << ToString( scheduler.StepCost() * 1.0e+3f ) << " ms"
+					  << ", dropped: " << ToString( scheduler.GetStats().droppedSteps )).c_str() );
+
+		// recording and replay restart simulation, so results are reproducible
+		if ( scheduler.IsRecording() )
+		{
+			ImGui::Text( ("Recorded frames: "s << ToString( scheduler.Recorded().size() )).c_str() );
+
+			if ( ImGui::Button( "Stop recording" ))
+				scheduler.StopRecording();
+		}
+		else
+		if ( scheduler.IsReplaying() )
+		{
+			ImGui::Text( ("Replay: "s << ToString( scheduler.ReplayPos() ) << " / " << ToString( scheduler.Recorded().size() )).c_str() );
+		}
+		else
+		{
+			if ( ImGui::Button( "Record steps" ))
+			{
+				scheduler.StartRecording();
+				_reloadShaders	= true;
+				_initialized	= false;
+			}
+
+			ImGui::SameLine();
+			if ( ImGui::Button( "Replay" ) and scheduler.StartReplay() )
+			{
+				_reloadShaders	= true;
+				_initialized	= false;
+			}
+
+			if ( ImGui::Button( "Save steps" ))
+				scheduler.Save( StepsFilename );
+
+			ImGui::SameLine();
+			if ( ImGui::Button( "Load steps" ) and not scheduler.Load( StepsFilename ))
+				FG_LOGI( "Failed to load '"s << StepsFilename << "'" );
+		}
 		ImGui::Separator();
 			
 		ImGui::Text( "Surface scale" );
@@ -435,6 +978,7 @@ namespace FG
 		ImGui::RadioButton( " 2", INOUT Cast<int>(&_newMode), 3 );
 		ImGui::RadioButton( " 3", INOUT Cast<int>(&_newMode), 4 );
 		ImGui::RadioButton( " 4", INOUT Cast<int>(&_newMode), 5 );
+		ImGui::RadioButton( " 5 (boids)", INOUT Cast<int>(&_newMode), 6 );
 			
 		ImGui::Separator();
 
@@ -450,11 +994,64 @@ namespace FG
 		if ( ImGui::Button( "Reset orientation" ))
 			_ResetOrientation();
 
+		if ( ImGui::Button( "Validate on CPU (V)" ))
+			_validateSimulation = true;
+
+		if ( ImGui::Button( "Compare formats (F)" ))
+			_compareFormats = true;
+
+		if ( ImGui::Button( "Save snapshot" ))
+			_saveSnapshot = true;
+
+		ImGui::SameLine();
+		if ( ImGui::Button( "Restore snapshot" ))
+			_restoreSnapshot = true;
+
 		ImGui::Separator();
 
-		if ( _newMode != _curMode )
+		if ( _UsesSpatialHash() )
+		{
+			const auto&	info = _spatialHash.GetInfo();
+
+			ImGui::Text( "Interaction radius:" );
+			ImGui::SliderFloat( "##HashCellSize", INOUT &_hashCellSize, 0.01f, 0.5f );
+			ImGui::Text( ("Spatial hash: "s << ToString( _hashCellCount ) << " cells").c_str() );
+
+			// GPU time of separate tasks is not available, so timings of CPU version are shown
+			if ( info.validated )
+			{
+				ImGui::Text( ("CPU count: "s << ToString( info.timings.count ) << ", prefix sum: " << ToString( info.timings.prefixSum )
+							  << ", scatter: " << ToString( info.timings.scatter )).c_str() );
+				ImGui::Text( ("Used cells: "s << ToString( info.stats.usedCells ) << ", max per cell: " << ToString( info.stats.maxPerCell )
+							  << ", mismatched: " << ToString( info.mismatchedCells )).c_str() );
+			}
+			else
+				ImGui::Text( "Press 'Validate on CPU' to measure" );
+
+			ImGui::Separator();
+		}
+
+		// spatial hash reads float particles and uses '_numParticles' as particle count
+		if ( _newMode == 6 )
+		{
+			_newFormat		= EParticleFormat::Float;
+			_newLifecycle	= false;
+		}
+
+		// lifecycle shaders support only float particles
+		if ( _newLifecycle and _newFormat == EParticleFormat::Packed )
+		{
+			if ( not _curLifecycle )
+				_newFormat = EParticleFormat::Float;
+			else
+				_newLifecycle = false;
+		}
+
+		if ( _newMode != _curMode or _newFormat != _curFormat or _newLifecycle != _curLifecycle )
 		{
 			_curMode		= _newMode;
+			_curFormat		= _newFormat;
+			_curLifecycle	= _newLifecycle;
 			_reloadShaders	= true;
 			_initialized	= false;
 		}
@@ -464,6 +1061,20 @@ namespace FG
 
 }	// FG
 
+
+// unit tests
+extern void UnitTest_ParticleSimulator ();
+extern void UnitTest_SpatialHash ();
+extern void UnitTest_DepthSort ();
+extern void UnitTest_StepScheduler ();
+extern void UnitTest_ParticleSnapshot ();
+
+// performance tests
+extern void PerfTest_ParticleSimulator ();
+extern void PerfTest_SpatialHash ();
+extern void PerfTest_DepthSort ();
+
+
 /*
 =================================================
 	main
@@ -473,6 +1084,15 @@ int main ()
 {
 	using namespace FG;
 
+	UnitTest_ParticleSimulator();
+	UnitTest_SpatialHash();
+	UnitTest_DepthSort();
+	UnitTest_StepScheduler();
+	UnitTest_ParticleSnapshot();
+	//PerfTest_ParticleSimulator();
+	//PerfTest_SpatialHash();
+	//PerfTest_DepthSort();
+
 	auto	app = MakeShared<ParticlesApp>();
 
 	CHECK_ERR( app->Initialize(), -1 );
@@ -480,4 +1100,4 @@ int main ()
 	for (; app->Update();) {}
 	
 	return 0;
-}
+}
\ No newline at end of file
@@ -3,6 +3,13 @@
 #pragma once
 
 #include "BaseSample.h"
+#include "GpuLifecycle.h"
+#include "GpuSpatialHash.h"
+#include "GpuDepthSort.h"
+#include "GpuStepScheduler.h"
+#include "GpuSnapshot.h"
+#include "StereoTarget.h"
+#include "ExpandBenchmark.h"
 
 namespace FG
 {
@@ -15,12 +22,10 @@ namespace FG
 	{
 	// types
 	private:
-		struct ParticlesUB
-		{
-			uint		steps;
-			float		timeDelta;
-			float		globalTime;
-		};
+		using ParticlesUB			= GpuParticles::ParticlesUB;
+		using ParticleVertex		= GpuParticles::ParticleVertex;
+		using PackedParticleVertex	= GpuParticles::PackedParticleVertex;
+		using EParticleFormat		= GpuParticles::EFormat;
 
 		struct CameraUB
 		{
@@ -29,15 +34,7 @@ namespace FG
 			mat4x4		modelViewProj;
 			float2		viewport;
 			float2		clipPlanes;
-		};
-		
-		struct ParticleVertex
-		{
-			float3		position;
-			float		size;
-			float3		velocity;
-			RGBA8u		color;
-			float4		param;
+			float		timeOffset;		// time since the last simulation step
 		};
 
 		enum class EParticleDrawMode : uint
@@ -51,6 +48,7 @@ namespace FG
 		{
 			None,
 			Additive,
+			Alpha,		// premultiplied alpha, particles are sorted by depth
 			Unknown		= None,
 		};
 
@@ -59,10 +57,15 @@ namespace FG
 	private:
 		ImageID					_colorBuffer[2];
 		ImageID					_depthBuffer;
-
 		BufferID				_cameraUB[2];
-		BufferID				_particlesUB;
-		BufferID				_particlesBuf;
+
+		GpuParticles			_particles;
+		GpuLifecycle			_lifecycle;
+		GpuSpatialHash			_spatialHash;
+		GpuDepthSort			_depthSort;
+		GpuStepScheduler		_stepScheduler;
+		StereoTarget			_stereo;				// layer per eye for single pass stereo
+		ExpandBenchmark			_expandBench;
 		
 		CPipelineID				_updateParticlesPpln;
 		PipelineResources		_updateParticlesRes;
@@ -81,17 +84,48 @@ namespace FG
 		uint					_curMode			= 1;
 		uint					_newMode			= 1;
 
+		EParticleFormat			_curFormat			= Default;
+		EParticleFormat			_newFormat			= Default;
+
+		// vertex pulling doesn't support single pass stereo, sorted particles are read from storage buffer
+		EParticleExpand			_particleExpand		= Default;
+		EParticleExpand			_curExpand			= Default;
+		bool					_curSortedPulling	= false;
+
+		// lifecycle: particles are killed instead of restart, only alive particles are updated and drawn
+		bool					_curLifecycle		= false;
+		bool					_newLifecycle		= false;
+		bool					_emitBurst			= false;
+		uint					_emitCount			= 0;		// per simulation step
+		float					_maxLifetime		= 10.0f;	// in seconds
+
+		// spatial hash: particles are sorted by cell every frame for neighbour search
+		float					_hashCellSize		= 0.05f;	// interaction radius
+
+		// depth sort: full sort every '_sortInterval' frames, partial sort of tiles in other frames
+		uint					_sortInterval		= 16;
+		bool					_validateSort		= false;
+
+		bool					_saveSnapshot		= false;
+		bool					_restoreSnapshot	= false;
+
 		bool					_initialized;
 		bool					_reloadShaders;
+		bool					_validateSimulation	= false;
+		bool					_compareFormats		= false;
+		bool					_singlePassStereo	= true;
+		bool					_curStereo			= false;
 		int						_sufaceScaleIdx		= 0;
 
 		float					_timeScale			= 0.0f;
-		Nanoseconds				_startTime;
+		float					_stepBudget			= 0.0f;		// GPU time for simulation in milliseconds, 0 - unlimited
 
 		// config
 		const uint				_maxSteps			= 512;
 		const uint				_maxParticles 		= 1u << 22;
 		const uint				_localSize			= 64;
+		const uint				_maxCompareBlocks	= 1024;
+		const uint				_hashCellCount		= 1u << 20;	// must be a power of 2 and a multiple of '_localSize'
 
 		
 	// methods
@@ -119,12 +153,17 @@ namespace FG
 
 	private:
 		void  _ReloadShaders (const CommandBuffer &cmdbuf);
+		void  _RestoreSnapshot (const CommandBuffer &cmdbuf, INOUT ParticlesUB &params);
 		void  _DrawParticles (const CommandBuffer &cmdbuf, uint eye);
 		void  _ResetPosition ();
 		void  _ResetOrientation ();
 
 		float _GetTimeStep () const;
 
+		ND_ bool    _UsesSpatialHash () const	{ return _curMode == 6; }
+		ND_ bool    _UsesDepthSort () const		{ return _blendMode == EBlendMode::Alpha and not _curLifecycle; }
+		ND_ String  _ShaderDefines () const;
+
 		ND_ static String  _LoadShader (NtStringView filename)	{ return BaseSample::_LoadShader( String{FG_DATA_PATH} + filename.c_str()); }
 	};
 
@@ -0,0 +1,179 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SpatialHash.h"
+#include <chrono>
+
+namespace FG
+{
+namespace {
+	using Clock	= std::chrono::high_resolution_clock;
+
+	ND_ forceinline int  CellCoord (float x, float invCellSize)
+	{
+		return int(std::floor( x * invCellSize ));
+	}
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	Init
+=================================================
+*/
+	bool  SpatialHash::Init (float cellSize, uint cellCount)
+	{
+		CHECK_ERR( cellSize > 0.0f );
+		CHECK_ERR( cellCount > 0 and (cellCount & (cellCount - 1)) == 0 );
+
+		_cellSize		= cellSize;
+		_invCellSize	= 1.0f / cellSize;
+		_cellCount		= cellCount;
+
+		_cellStart.clear();
+		_cellStart.resize( cellCount + 1, 0 );
+		_sortedIndices.clear();
+		_particleCells.clear();
+		return true;
+	}
+
+/*
+=================================================
+	CellIndex
+----
+	large primes from "Optimized Spatial Hashing for Collision Detection of Deformable Objects",
+	negative coordinates are hashed as two's complement like in GLSL
+=================================================
+*/
+	uint  SpatialHash::CellIndex (int x, int y, int z, uint cellCount)
+	{
+		return ((uint(x) * 73856093u) ^ (uint(y) * 19349663u) ^ (uint(z) * 83492791u)) & (cellCount - 1);
+	}
+
+	uint  SpatialHash::CellIndex (const float3 &position) const
+	{
+		return CellIndex( CellCoord( position.x, _invCellSize ), CellCoord( position.y, _invCellSize ), CellCoord( position.z, _invCellSize ), _cellCount );
+	}
+
+/*
+=================================================
+	Build
+----
+	GPU version uses atomics, so order of particles in cell is different,
+	but 'CellStart' must be the same
+=================================================
+*/
+	bool  SpatialHash::Build (ArrayView<float3> positions)
+	{
+		CHECK_ERR( _cellCount > 0 );
+
+		const uint	count = uint(positions.size());
+
+		_particleCells.resize( count );
+		_sortedIndices.resize( count );
+
+		// count particles per cell, same as 'spatial_hash_count.glsl'
+		auto	t0 = Clock::now();
+
+		std::fill( _cellStart.begin(), _cellStart.end(), 0u );
+
+		for (uint i = 0; i < count; ++i)
+		{
+			const uint	cell = CellIndex( positions[i] );
+			_particleCells[i] = uint2{ cell, _cellStart[cell]++ };
+		}
+
+		// exclusive prefix sum, same as 'spatial_hash_scan.glsl'
+		auto	t1 = Clock::now();
+		uint	sum	= 0;
+
+		for (auto& start : _cellStart)
+		{
+			const uint	n = start;
+			start = sum;
+			sum  += n;
+		}
+		ASSERT( sum == count );
+
+		// scatter, same as 'spatial_hash_scatter.glsl'
+		auto	t2 = Clock::now();
+
+		for (uint i = 0; i < count; ++i)
+		{
+			const uint2	c = _particleCells[i];
+			_sortedIndices[ _cellStart[c.x] + c.y ] = i;
+		}
+
+		auto	t3 = Clock::now();
+
+		_timings.count		= std::chrono::duration_cast<Nanoseconds>( t1 - t0 );
+		_timings.prefixSum	= std::chrono::duration_cast<Nanoseconds>( t2 - t1 );
+		_timings.scatter	= std::chrono::duration_cast<Nanoseconds>( t3 - t2 );
+		return true;
+	}
+
+/*
+=================================================
+	NeighbourCells
+----
+	same as 'SpatialHash_NeighbourCells' in 'spatial_hash_shared.glsl',
+	neighbour cells may have the same hash, duplicates are skipped
+=================================================
+*/
+	uint  SpatialHash::NeighbourCells (const float3 &position, OUT NeighbourCells_t &cells) const
+	{
+		const int	cx		= CellCoord( position.x, _invCellSize );
+		const int	cy		= CellCoord( position.y, _invCellSize );
+		const int	cz		= CellCoord( position.z, _invCellSize );
+		uint		count	= 0;
+
+		for (int z = -1; z <= 1; ++z)
+		for (int y = -1; y <= 1; ++y)
+		for (int x = -1; x <= 1; ++x)
+		{
+			const uint	cell	= CellIndex( cx + x, cy + y, cz + z, _cellCount );
+			bool		unique	= true;
+
+			for (uint i = 0; i < count; ++i) {
+				unique &= (cells[i] != cell);
+			}
+
+			if ( unique )
+				cells[count++] = cell;
+		}
+		return count;
+	}
+
+/*
+=================================================
+	CellParticles
+=================================================
+*/
+	ArrayView<uint>  SpatialHash::CellParticles (uint cell) const
+	{
+		ASSERT( cell < _cellCount );
+		return ArrayView<uint>{ _sortedIndices.data() + _cellStart[cell], _cellStart[cell+1] - _cellStart[cell] };
+	}
+
+/*
+=================================================
+	CalcStats
+=================================================
+*/
+	SpatialHash::Stats  SpatialHash::CalcStats () const
+	{
+		Stats	result;
+
+		for (uint i = 0; i < _cellCount; ++i)
+		{
+			const uint	n = _cellStart[i+1] - _cellStart[i];
+
+			result.usedCells	+= uint(n > 0);
+			result.maxPerCell	 = Max( result.maxPerCell, n );
+		}
+		return result;
+	}
+
+
+}	// FG
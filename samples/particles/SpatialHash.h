@@ -0,0 +1,108 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	//
+	// Spatial Hash
+	//
+	// CPU version of 'shaders/spatial_hash_*.glsl', must be updated when shaders are changed.
+	// Particles are sorted by cell using counting sort: count particles per cell,
+	// exclusive prefix sum of counts gives the first particle in each cell, then particles are scattered.
+	// Infinite uniform grid is mapped to 'cellCount' cells by hash of cell coordinates,
+	// so different cells may share the same hash.
+	//
+
+	class SpatialHash final
+	{
+	// types
+	public:
+		struct Timings
+		{
+			Nanoseconds		count		{0};
+			Nanoseconds		prefixSum	{0};
+			Nanoseconds		scatter		{0};
+		};
+
+		struct Stats
+		{
+			uint			usedCells		= 0;	// cells with at least one particle
+			uint			maxPerCell		= 0;
+		};
+
+		static constexpr uint	MaxNeighbourCells	= 27;
+
+		using NeighbourCells_t	= StaticArray< uint, MaxNeighbourCells >;
+
+
+	// variables
+	private:
+		Array<uint>		_cellStart;			// 'cellCount + 1' elements, particles of cell 'i' are in [cellStart[i], cellStart[i+1])
+		Array<uint>		_sortedIndices;		// particle indices sorted by cell
+		Array<uint2>	_particleCells;		// cell and rank in cell for each particle
+		float			_cellSize		= 0.0f;
+		float			_invCellSize	= 0.0f;
+		uint			_cellCount		= 0;
+		Timings			_timings;
+
+
+	// methods
+	public:
+		SpatialHash () {}
+
+		// 'cellCount' must be a power of 2
+		bool  Init (float cellSize, uint cellCount);
+
+		// same as 'spatial_hash_count.glsl', 'spatial_hash_scan.glsl' and 'spatial_hash_scatter.glsl'
+		bool  Build (ArrayView<float3> positions);
+
+		// returns unique indices of cells around 'position', all particles closer than 'cellSize' are in these cells
+		ND_ uint  NeighbourCells (const float3 &position, OUT NeighbourCells_t &cells) const;
+
+		// returns indices of particles in cell
+		ND_ ArrayView<uint>  CellParticles (uint cell) const;
+
+		// calls 'fn(index)' for each particle in neighbour cells, particles may be farther than 'cellSize'
+		template <typename Fn>
+		void  ForEachNeighbour (const float3 &position, Fn &&fn) const;
+
+		ND_ Stats  CalcStats () const;
+
+		ND_ ArrayView<uint>		CellStart ()		const	{ return _cellStart; }
+		ND_ ArrayView<uint>		SortedIndices ()	const	{ return _sortedIndices; }
+		ND_ Timings const&		GetTimings ()		const	{ return _timings; }
+		ND_ float				CellSize ()			const	{ return _cellSize; }
+		ND_ float				InvCellSize ()		const	{ return _invCellSize; }
+		ND_ uint				CellCount ()		const	{ return _cellCount; }
+
+		// same as 'SpatialHash_CellIndex' in 'spatial_hash_shared.glsl'
+		ND_ static uint  CellIndex (int x, int y, int z, uint cellCount);
+		ND_ uint		 CellIndex (const float3 &position) const;
+	};
+
+
+/*
+=================================================
+	ForEachNeighbour
+=================================================
+*/
+	template <typename Fn>
+	inline void  SpatialHash::ForEachNeighbour (const float3 &position, Fn &&fn) const
+	{
+		NeighbourCells_t	cells;
+		const uint			count = NeighbourCells( position, OUT cells );
+
+		for (uint i = 0; i < count; ++i)
+		{
+			for (uint idx : CellParticles( cells[i] )) {
+				fn( idx );
+			}
+		}
+	}
+
+
+}	// FG
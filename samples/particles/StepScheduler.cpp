@@ -0,0 +1,233 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "StepScheduler.h"
+#include "stl/Algorithms/StringUtils.h"
+#include "stl/Stream/FileStream.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	Reset
+=================================================
+*/
+	void  StepScheduler::Reset ()
+	{
+		_accumulator	= 0.0;
+		_globalTime		= 0.0;
+		_mode			= EMode::Realtime;
+		_replayPos		= 0;
+		_stats			= Stats{};
+	}
+
+/*
+=================================================
+	Advance
+=================================================
+*/
+	StepScheduler::Frame  StepScheduler::Advance (SecondsF frameTime, const Config &cfg)
+	{
+		if ( _mode == EMode::Replay )
+		{
+			if ( _replayPos < _frames.size() )
+			{
+				const Frame&	frame = _frames[ _replayPos++ ];
+				_globalTime = double(frame.globalTime) + double(frame.steps) * frame.stepTime;
+				return frame;
+			}
+
+			FG_LOGI( "Replay finished: "s << ToString( _frames.size() ) << " frames" );
+			_mode			= EMode::Realtime;
+			_accumulator	= 0.0;
+		}
+
+		ASSERT( cfg.stepTime > 0.0f );
+
+		const double	step_time	= double(cfg.stepTime);
+		const uint		budget		= StepBudget( cfg );
+
+		_accumulator += double(frameTime.count());
+
+		const uint	required	= uint(_accumulator / step_time);
+		const uint	steps		= Min( required, budget );
+
+		_accumulator			-= step_time * steps;
+		_stats.budgetLimited	+= uint(required > budget);
+
+		// time that can not be simulated in the next frames is dropped, the fraction of step is kept
+		const uint	backlog	= required - steps;
+		if ( backlog > cfg.maxBacklog )
+		{
+			const uint	dropped = backlog - cfg.maxBacklog;
+			_accumulator		-= step_time * dropped;
+			_stats.droppedSteps	+= dropped;
+		}
+
+		Frame	frame;
+		frame.steps			= steps;
+		frame.stepTime		= cfg.stepTime;
+		frame.globalTime	= float(_globalTime);
+		frame.timeOffset	= float(Min( _accumulator, step_time ));
+
+		_globalTime += step_time * steps;
+
+		if ( _mode == EMode::Record )
+			_frames.push_back( frame );
+
+		return frame;
+	}
+
+/*
+=================================================
+	UpdateStepCost
+----
+	gpu time is 'fixed cost + step cost * steps', step cost is a slope
+	of least squares line over the last frames. Dividing the whole frame time
+	by steps overestimates step cost, so budget decreases the number of steps
+	and the next estimate becomes even greater.
+	Slope is undefined if all frames have the same number of steps,
+	then previous value is kept.
+=================================================
+*/
+	void  StepScheduler::UpdateStepCost (SecondsF gpuTime, uint steps)
+	{
+		if ( gpuTime.count() <= 0.0f )
+			return;
+
+		_costSamples[_costSamplePos] = CostSample{ float(steps), gpuTime.count() };
+		_costSamplePos	 = (_costSamplePos + 1) % CostSampleCount;
+		_costSampleCount = Min( _costSampleCount + 1, CostSampleCount );
+
+		double	mean_s = 0.0;
+		double	mean_t = 0.0;
+
+		for (uint i = 0; i < _costSampleCount; ++i)
+		{
+			mean_s += _costSamples[i].steps;
+			mean_t += _costSamples[i].gpuTime;
+		}
+		mean_s /= _costSampleCount;
+		mean_t /= _costSampleCount;
+
+		double	cov = 0.0;
+		double	var = 0.0;
+
+		for (uint i = 0; i < _costSampleCount; ++i)
+		{
+			const double	ds = _costSamples[i].steps - mean_s;
+			cov += ds * (_costSamples[i].gpuTime - mean_t);
+			var += ds * ds;
+		}
+
+		if ( var > 0.0 )
+		{
+			// negative slope is a measurement noise
+			if ( cov > 0.0 )
+				_stepCost = float(cov / var);
+			return;
+		}
+
+		// first estimation, fixed cost is unknown, so step cost is overestimated and budget is not exceeded
+		if ( _stepCost <= 0.0f and steps > 0 )
+			_stepCost = gpuTime.count() / float(steps);
+	}
+
+/*
+=================================================
+	StepBudget
+=================================================
+*/
+	uint  StepScheduler::StepBudget (const Config &cfg) const
+	{
+		if ( cfg.gpuBudget.count() <= 0.0f or _stepCost <= 0.0f )
+			return cfg.maxSteps;
+
+		// at least one step is required to measure step cost
+		return Clamp( uint(cfg.gpuBudget.count() / _stepCost), 1u, cfg.maxSteps );
+	}
+
+/*
+=================================================
+	StartRecording
+=================================================
+*/
+	void  StepScheduler::StartRecording ()
+	{
+		Reset();
+		_frames.clear();
+		_mode = EMode::Record;
+	}
+
+/*
+=================================================
+	StopRecording
+=================================================
+*/
+	void  StepScheduler::StopRecording ()
+	{
+		if ( _mode == EMode::Record )
+			_mode = EMode::Realtime;
+	}
+
+/*
+=================================================
+	StartReplay
+=================================================
+*/
+	bool  StepScheduler::StartReplay ()
+	{
+		if ( _frames.empty() )
+			return false;
+
+		Reset();
+		_mode = EMode::Replay;
+		return true;
+	}
+
+/*
+=================================================
+	Save
+=================================================
+*/
+	bool  StepScheduler::Save (StringView filename) const
+	{
+		FileWStream		file{ filename };
+		CHECK_ERR( file.IsOpen() );
+
+		FileHeader	header;
+		header.magic		= Magic;
+		header.version		= Version;
+		header.frameCount	= uint(_frames.size());
+
+		CHECK_ERR( file.Write( &header, BytesU::SizeOf(header) ));
+		CHECK_ERR( file.Write( _frames.data(), ArraySizeOf(_frames) ));
+		return true;
+	}
+
+/*
+=================================================
+	Load
+=================================================
+*/
+	bool  StepScheduler::Load (StringView filename)
+	{
+		FileRStream		file{ filename };
+		if ( not file.IsOpen() )
+			return false;
+
+		FileHeader	header;
+		CHECK_ERR( file.Read( &header, BytesU::SizeOf(header) ));
+		CHECK_ERR( header.magic == Magic and header.version == Version );
+
+		Array<Frame>	frames;
+		frames.resize( header.frameCount );
+		CHECK_ERR( file.Read( frames.data(), ArraySizeOf(frames) ));
+
+		StopRecording();
+		_frames = std::move(frames);
+		return true;
+	}
+
+
+}	// FG
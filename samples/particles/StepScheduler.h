@@ -0,0 +1,131 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	//
+	// Step Scheduler
+	//
+	// Fixed timestep accumulator for particle simulation.
+	// Frame time is accumulated and simulated by whole steps, so the result doesn't depend on frame rate.
+	// Number of steps per frame is limited by GPU time budget, steps that don't fit are postponed
+	// to the next frames up to 'maxBacklog', the rest of accumulated time is dropped.
+	// Frames can be recorded and replayed, so benchmark runs are reproducible.
+	//
+
+	class StepScheduler final
+	{
+	// types
+	public:
+		struct Config
+		{
+			float		stepTime	= 0.01f;	// seconds of simulation per step
+			uint		maxSteps	= 20;		// hard limit of steps per frame
+			uint		maxBacklog	= 20;		// steps that can be postponed to the next frames
+			SecondsF	gpuBudget	{0.0f};		// GPU time per frame for simulation, 0 - unlimited
+		};
+
+		// same values are used in 'ParticlesUB'
+		struct Frame
+		{
+			uint		steps		= 0;
+			float		stepTime	= 0.0f;
+			float		globalTime	= 0.0f;		// simulation time before the first step
+			float		timeOffset	= 0.0f;		// time since the last step, rendered particles are extrapolated by this time
+		};
+
+		struct Stats
+		{
+			uint		budgetLimited	= 0;	// frames where budget was less than required steps
+			uint		droppedSteps	= 0;
+		};
+
+	private:
+		enum class EMode
+		{
+			Realtime,
+			Record,
+			Replay,
+		};
+
+		struct FileHeader
+		{
+			uint		magic		= 0;
+			uint		version		= 0;
+			uint		frameCount	= 0;
+			uint		_padding	= 0;
+		};
+
+		// GPU time of the frame, includes drawing
+		struct CostSample
+		{
+			float		steps		= 0.0f;
+			float		gpuTime		= 0.0f;
+		};
+
+		static constexpr uint	Magic	= 0x53505453;	// 'STPS'
+		static constexpr uint	Version	= 1;
+
+		// step cost is estimated from the last frames to ignore single slow frames
+		static constexpr uint	CostSampleCount	= 32;
+
+
+	// variables
+	private:
+		double			_accumulator	= 0.0;
+		double			_globalTime		= 0.0;
+		float			_stepCost		= 0.0f;		// GPU seconds per step, 0 - unknown
+		StaticArray< CostSample, CostSampleCount >
+						_costSamples;
+		uint			_costSampleCount = 0;
+		uint			_costSamplePos	= 0;
+		EMode			_mode			= EMode::Realtime;
+		Array<Frame>	_frames;					// recorded frames
+		size_t			_replayPos		= 0;
+		Stats			_stats;
+
+
+	// methods
+	public:
+		StepScheduler () {}
+
+		// resets time, recording is stopped, recorded frames are kept
+		void  Reset ();
+
+		// continues simulation from restored state
+		void  SetGlobalTime (double time)	{ _globalTime = time; }
+
+		// returns steps for the current frame
+		ND_ Frame  Advance (SecondsF frameTime, const Config &cfg);
+
+		// 'gpuTime' includes drawing, only the part that grows with the number of steps is used as step cost,
+		// frames without steps are used too
+		void  UpdateStepCost (SecondsF gpuTime, uint steps);
+
+		// returns maximum number of steps that fits into GPU budget
+		ND_ uint  StepBudget (const Config &cfg) const;
+
+		// recording starts from zero time, simulation must be restarted too
+		void  StartRecording ();
+		void  StopRecording ();
+
+		// returns 'false' if nothing is recorded, replay stops after the last recorded frame
+		ND_ bool  StartReplay ();
+
+		bool  Save (StringView filename) const;
+		bool  Load (StringView filename);
+
+		ND_ bool				IsRecording ()	const	{ return _mode == EMode::Record; }
+		ND_ bool				IsReplaying ()	const	{ return _mode == EMode::Replay; }
+		ND_ ArrayView<Frame>	Recorded ()		const	{ return _frames; }
+		ND_ size_t				ReplayPos ()	const	{ return _replayPos; }
+		ND_ float				StepCost ()		const	{ return _stepCost; }
+		ND_ Stats const&		GetStats ()		const	{ return _stats; }
+	};
+
+
+}	// FG
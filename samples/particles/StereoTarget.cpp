@@ -0,0 +1,83 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "StereoTarget.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	destructor
+=================================================
+*/
+	StereoTarget::~StereoTarget ()
+	{
+		CHECK( not _color );
+		CHECK( not _depth );
+	}
+
+/*
+=================================================
+	Resize
+=================================================
+*/
+	bool  StereoTarget::Resize (const FrameGraph &fg, const uint2 &dim)
+	{
+		if ( _color and not Any( fg->GetDescription( _color ).dimension.xy() != dim ))
+			return true;
+
+		fg->ReleaseResource( _color );
+		fg->ReleaseResource( _depth );
+
+		_color = fg->CreateImage( ImageDesc{}.SetView( EImage_2DArray ).SetDimension( dim ).SetArrayLayers( 2 )
+											 .SetFormat( EPixelFormat::RGBA8_UNorm )
+											 .SetUsage( EImageUsage::ColorAttachment | EImageUsage::Transfer ),
+								  Default, "StereoColorBuffer" );
+		_depth = fg->CreateImage( ImageDesc{}.SetView( EImage_2DArray ).SetDimension( dim ).SetArrayLayers( 2 )
+											 .SetFormat( EPixelFormat::Depth24_Stencil8 )
+											 .SetUsage( EImageUsage::DepthStencilAttachment ),
+								  Default, "StereoDepthBuffer" );
+		CHECK_ERR( _color and _depth );
+		return true;
+	}
+
+/*
+=================================================
+	Destroy
+=================================================
+*/
+	void  StereoTarget::Destroy (const FrameGraph &fg)
+	{
+		fg->ReleaseResource( _color );
+		fg->ReleaseResource( _depth );
+	}
+
+/*
+=================================================
+	AddTargets
+=================================================
+*/
+	void  StereoTarget::AddTargets (INOUT RenderPassDesc &desc) const
+	{
+		desc.AddTarget( RenderTargetID::Color_0, _color, ImageViewDesc{}.SetArrayLayers( 0, 2 ), RGBA32f{0.0f}, EAttachmentStoreOp::Store )
+			.AddTarget( RenderTargetID::Depth, _depth, ImageViewDesc{}.SetArrayLayers( 0, 2 ), DepthStencil{1.0f}, EAttachmentStoreOp::Store );
+	}
+
+/*
+=================================================
+	CopyTo
+=================================================
+*/
+	void  StereoTarget::CopyTo (const CommandBuffer &cmdbuf, RawImageID left, RawImageID right) const
+	{
+		const uint2			dim		= cmdbuf->GetFrameGraph()->GetDescription( _color ).dimension.xy();
+		const RawImageID	dst[]	= { left, right };
+
+		for (uint i = 0; i < CountOf(dst); ++i)
+		{
+			cmdbuf->AddTask( BlitImage{}.From( _color ).To( dst[i] ).SetFilter( EFilter::Nearest )
+										.AddRegion( { MipmapLevel{0}, ImageLayer{i} }, int2(0), int2(dim), {}, int2(0), int2(dim) ));
+		}
+	}
+
+}	// FG
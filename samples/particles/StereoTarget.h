@@ -0,0 +1,42 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	//
+	// Stereo Target
+	//
+	// Render target with layer per eye for single pass stereo,
+	// both eyes are drawn with layered rendering and then copied to images of each eye.
+	//
+
+	class StereoTarget final
+	{
+	// variables
+	private:
+		ImageID		_color;
+		ImageID		_depth;
+
+
+	// methods
+	public:
+		StereoTarget () {}
+		~StereoTarget ();
+
+		// images are recreated only if dimension is changed
+		bool  Resize (const FrameGraph &fg, const uint2 &dim);
+		void  Destroy (const FrameGraph &fg);
+
+		// adds color and depth targets with both layers
+		void  AddTargets (INOUT RenderPassDesc &desc) const;
+
+		// copies layer of each eye to 'left' and 'right'
+		void  CopyTo (const CommandBuffer &cmdbuf, RawImageID left, RawImageID right) const;
+	};
+
+
+}	// FG
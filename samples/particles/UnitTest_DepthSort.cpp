@@ -0,0 +1,91 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "DepthSort.h"
+#include "stl/Algorithms/StringUtils.h"
+#include <chrono>
+#include <random>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Clock	= std::chrono::high_resolution_clock;
+
+
+	void Test_FloatToOrderedUint ()
+	{
+		const float	values[] = { -1.0e30f, -2.0f, -1.0f, -1.0e-30f, -0.0f, 0.0f, 1.0e-30f, 1.0f, 2.0f, 1.0e30f };
+
+		for (size_t i = 1; i < CountOf(values); ++i)
+		{
+			TEST( DepthSort::FloatToOrderedUint( values[i-1] ) <= DepthSort::FloatToOrderedUint( values[i] ));
+		}
+		TEST( DepthSort::FloatToOrderedUint( -1.0f ) < DepthSort::FloatToOrderedUint( 1.0f ));
+	}
+
+
+	// must be the same as stable sort
+	void Test_Sort ()
+	{
+		std::mt19937	gen{ 1234 };
+
+		for (size_t count : {0u, 1u, 255u, 256u, 1000u, 70000u})
+		{
+			for (uint max_key : {3u, ~0u})
+			{
+				std::uniform_int_distribution<uint>	dist{ 0, max_key };
+				Array<uint>		keys	( count );
+				Array<uint>		values	( count );
+
+				for (size_t i = 0; i < count; ++i) {
+					keys[i]		= dist( gen );
+					values[i]	= uint(i);
+				}
+
+				Array<uint>		ref_values = values;
+				std::stable_sort( ref_values.begin(), ref_values.end(), [&keys] (uint a, uint b) { return keys[a] < keys[b]; });
+
+				DepthSort::Sort( INOUT keys, INOUT values );
+
+				TEST( DepthSort::CountUnordered( keys ) == 0 );
+				TEST( values == ref_values );
+			}
+		}
+	}
+}
+
+extern void UnitTest_DepthSort ()
+{
+	Test_FloatToOrderedUint();
+	Test_Sort();
+
+	FG_LOGI( "UnitTest_DepthSort" );
+}
+
+
+extern void PerfTest_DepthSort ()
+{
+	std::mt19937						gen{ 1234 };
+	std::uniform_int_distribution<uint>	dist;
+	Array<uint>							keys	( 1u << 22 );
+	Array<uint>							values	( keys.size() );
+
+	for (size_t i = 0; i < keys.size(); ++i) {
+		keys[i]		= dist( gen );
+		values[i]	= uint(i);
+	}
+
+	Array<uint>		ref_keys = keys;
+
+	auto	t0 = Clock::now();
+	DepthSort::Sort( INOUT keys, INOUT values );
+	auto	t1 = Clock::now();
+	std::sort( ref_keys.begin(), ref_keys.end() );
+	auto	t2 = Clock::now();
+
+	FG_LOGI( "PerfTest_DepthSort: "s << ToString( keys.size() ) << " keys"
+			 << ", radix sort: " << ToString( std::chrono::duration_cast<Nanoseconds>( t1 - t0 ))
+			 << ", std::sort: " << ToString( std::chrono::duration_cast<Nanoseconds>( t2 - t1 )));
+}
@@ -0,0 +1,252 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "ParticleSimulator.h"
+#include "stl/Algorithms/StringUtils.h"
+#include <chrono>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Clock		= std::chrono::high_resolution_clock;
+	using Particle	= ParticleSimulator::Particle;
+
+	static constexpr uint	Modes[]		= { 1, 3, 4, 5 };
+	static constexpr float	StepTime	= 0.01f;
+
+
+	void Test_Init ()
+	{
+		ParticleSimulator	sim;
+		Array<Particle>		particles;
+
+		TEST( not ParticleSimulator::IsSupported( 2 ));
+		TEST( sim.Init( 1, 1000, 1024 ));
+		sim.Store( OUT particles );
+
+		TEST( particles.size() == 1000 );
+
+		for (auto& p : particles)
+		{
+			TEST( p.position.x == 1.0f and p.position.y == 0.0f and p.position.z == 0.0f );
+			TEST( Abs( Length( p.velocity ) - 0.5f ) < 1.0e-5f );
+			TEST( p.size == 8.0f );
+			TEST( p.color == 0xFFFFFFFF );
+			TEST( p.param.x == 1.0f or p.param.x == -1.0f );
+		}
+	}
+
+
+	void Test_LoadStore ()
+	{
+		ParticleSimulator	sim;
+		Array<Particle>		src, dst;
+
+		TEST( sim.Init( 5, 100, 128 ));
+		sim.UpdateScalar( StepTime, 4, 1.0f, 128 );
+		sim.Store( OUT src );
+
+		ParticleSimulator	sim2;
+		TEST( sim2.Load( 5, src ));
+		sim2.Store( OUT dst );
+
+		TEST( sim.Compare( dst, 0.0f ).mismatched == 0 );
+		TEST( sim2.Compare( src, 0.0f ).mismatched == 0 );
+	}
+
+
+	void Test_Restart ()
+	{
+		ParticleSimulator	sim;
+		Array<Particle>		particles;
+
+		TEST( sim.Init( 3, 4, 4 ));
+		sim.Store( OUT particles );
+
+		// outside of bounding box
+		particles[1].position	= float3{ 0.0f, 20.0f, 0.0f };
+		particles[1].param.z	= 5.0f;
+
+		TEST( sim.Load( 3, particles ));
+		sim.UpdateScalar( StepTime, 1, 2.0f, 4 );
+		sim.Store( OUT particles );
+
+		TEST( particles[1].position.x == 1.0f and particles[1].position.y == 0.0f );
+		TEST( particles[1].param.z == 0.0f );
+		TEST( particles[0].param.z == StepTime );
+		TEST( particles[0].param.y == 2.0f );
+	}
+
+
+	void Test_Pack ()
+	{
+		Array<Particle>		src, dst;
+		Array<ParticleSimulator::PackedParticle>	packed;
+
+		TEST( sizeof(ParticleSimulator::PackedParticle) == 32 );
+
+		src.resize( 3 );
+		src[0].position	= float3{ 1000.0f, 2.0f, 3.0f };
+		src[0].size		= 8.0f;
+		src[0].param	= float4{ -1.0f, 1000.1f, 65504.0f, 3.0f / float(1u << 24) };	// max and denormalized half
+
+		src[1].position	= float3{ 0.1f, 2.0f, 3.0f };
+		src[1].velocity	= float3{ 1.0f, -2.0f, 0.5f };
+
+		// rounding to nearest even
+		src[2].velocity	= float3{ 0.0f, 1.0f + 1.0f / 2048.0f, 1.0f + 3.0f / 2048.0f };
+
+		TEST( ParticleSimulator::Pack( 1, src, OUT packed ));
+		TEST( packed.size() == 3 );
+
+		TEST( packed[0].sizeVelocity == 0x00004800 );
+		TEST( packed[0].colorParam == 0xBC0000FF );		// zero velocity has last index in palette
+		TEST( packed[0].paramZW == 0x00037BFF );
+		TEST( packed[1].sizeVelocity == 0x3C000000 and packed[1].velocity == 0x3800C000 );
+		TEST( packed[2].velocity == 0x3C023C00 );
+
+		TEST( ParticleSimulator::Unpack( 1, packed, OUT dst ));
+		TEST( dst.size() == 3 );
+
+		// position and 'param.y' have full precision
+		for (size_t i = 0; i < 2; ++i)
+		{
+			TEST( dst[i].position.x == src[i].position.x and dst[i].position.y == src[i].position.y and dst[i].position.z == src[i].position.z );
+			TEST( dst[i].velocity.x == src[i].velocity.x and dst[i].velocity.y == src[i].velocity.y and dst[i].velocity.z == src[i].velocity.z );
+			TEST( dst[i].size == src[i].size );
+			TEST( dst[i].param.x == src[i].param.x and dst[i].param.y == src[i].param.y and dst[i].param.z == src[i].param.z and dst[i].param.w == src[i].param.w );
+		}
+		TEST( dst[0].color == 0xFF0000FF );
+	}
+
+
+	// packed format must keep enough precision for simulation
+	void Test_Quantize ()
+	{
+		for (uint mode : Modes)
+		{
+			const uint			count	= 1000;
+			ParticleSimulator	sim;
+			Array<Particle>		ref;
+
+			TEST( sim.Init( mode, count, count ));
+			sim.UpdateScalar( StepTime, 64, 1.0f, count );
+			sim.Store( OUT ref );
+			sim.Quantize();
+
+			// position is stored with full precision
+			const auto	result = sim.Compare( ref, 1.0e-3f );
+			TEST( result.maxPositionError == 0.0f );
+			TEST( result.maxVelocityError <= 1.0f / 1024.0f );
+		}
+	}
+
+
+	// motion per frame that is less than half precision of position must not be lost
+	void Test_QuantizeDrift ()
+	{
+		const float			delta	= 1.0e-4f;
+		ParticleSimulator	sim;
+		Array<Particle>		particles;
+
+		// half precision step at 10 is 1/128, it is much greater than motion per frame
+		particles.resize( 64 );
+		for (size_t i = 0; i < particles.size(); ++i)
+		{
+			particles[i].position	= float3{ (i & 1) ? 10.0f : 0.0f, 0.0f, 0.0f };
+			particles[i].param		= float4{ 1.0f, 1000.1f, 0.0f, 0.0f };	// absolute time
+		}
+
+		for (uint frame = 0; frame < 100; ++frame)
+		{
+			for (auto& p : particles) {
+				p.position.x += delta;
+			}
+			TEST( sim.Load( 3, particles ));
+			sim.Quantize();
+			sim.Store( OUT particles );
+		}
+
+		for (size_t i = 0; i < particles.size(); ++i)
+		{
+			const float	expected = ((i & 1) ? 10.0f : 0.0f) + delta * 100.0f;
+			TEST( Abs( particles[i].position.x - expected ) < 1.0e-5f );
+			TEST( particles[i].param.y == 1000.1f );
+		}
+	}
+
+
+	// vectorized and multithreaded version must produce the same result as reference version
+	void Test_Update ()
+	{
+		for (uint mode : Modes)
+		{
+			const uint			count		= ParticleSimulator::BatchSize + 1003;
+			const uint			index_size	= count + 21;
+			ParticleSimulator	ref, sim;
+			Array<Particle>		particles;
+			float				time		= 0.0f;
+
+			TEST( ref.Init( mode, count, index_size ));
+			TEST( sim.Init( mode, count, index_size ));
+
+			for (uint frame = 0; frame < 16; ++frame)
+			{
+				time += StepTime * 32;
+
+				ref.UpdateScalar( StepTime, 32, time, index_size );
+				sim.Update( StepTime, 32, time, index_size );
+			}
+
+			sim.Store( OUT particles );
+
+			const auto	result = ref.Compare( particles, 0.0f );
+			TEST( result.mismatched == 0 );
+			TEST( result.maxPositionError == 0.0f );
+			TEST( result.maxVelocityError == 0.0f );
+		}
+	}
+}
+
+extern void UnitTest_ParticleSimulator ()
+{
+	Test_Init();
+	Test_LoadStore();
+	Test_Restart();
+	Test_Pack();
+	Test_Quantize();
+	Test_QuantizeDrift();
+	Test_Update();
+
+	FG_LOGI( "UnitTest_ParticleSimulator" );
+}
+
+
+extern void PerfTest_ParticleSimulator ()
+{
+	const uint	count	= 1u << 18;
+	const uint	steps	= 20;
+
+	for (uint mode : Modes)
+	{
+		ParticleSimulator	ref, sim;
+		CHECK( ref.Init( mode, count, count ));
+		CHECK( sim.Init( mode, count, count ));
+
+		auto	t0 = Clock::now();
+		ref.UpdateScalar( StepTime, steps, 1.0f, count );
+		auto	t1 = Clock::now();
+		sim.Update( StepTime, steps, 1.0f, count );
+		auto	t2 = Clock::now();
+
+		const double	ref_time	= double(std::chrono::duration_cast<Nanoseconds>( t1 - t0 ).count()) * 1.0e-9;
+		const double	sim_time	= double(std::chrono::duration_cast<Nanoseconds>( t2 - t1 ).count()) * 1.0e-9;
+		const double	total		= double(count) * steps;
+
+		FG_LOGI( "PerfTest_ParticleSimulator: mode "s << ToString( mode ) << ", " << ToString( count ) << " particles, " << ToString( steps ) << " steps"
+				 << ", scalar: " << ToString( total / ref_time ) << " particle steps/s"
+				 << ", vectorized: " << ToString( total / sim_time ) << " particle steps/s" );
+	}
+}
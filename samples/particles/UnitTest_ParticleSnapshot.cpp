@@ -0,0 +1,81 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "ParticleSnapshot.h"
+#include "ParticleSimulator.h"
+#include <random>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	void Test_Codec ()
+	{
+		std::mt19937	gen{ 1234 };
+		Array<uint8_t>	src, packed, dst;
+
+		// empty, random, constant and mixed data
+		for (uint i = 0; i < 4; ++i)
+		{
+			const uint	stride	= 4 + i * 4;
+			const uint	count	= (i == 0 ? 0 : 1000 + i * 7);
+
+			src.resize( stride * count );
+			for (size_t j = 0; j < src.size(); ++j) {
+				src[j] = uint8_t( i == 1 ? gen() : i == 2 ? 0x3F : (j % stride < 2 ? gen() : j % stride) );
+			}
+
+			ParticleSnapshot::Compress( src, stride, OUT packed );
+			TEST( ParticleSnapshot::Decompress( packed, stride, src.size(), OUT dst ));
+			TEST( dst == src );
+
+			// incompressible chunk is stored as is
+			TEST( packed.size() <= src.size() );
+
+		#ifdef FG_ENABLE_LZ4
+			if ( i == 2 )
+				TEST( packed.size() * 50 < src.size() );
+		#endif
+		}
+
+		// corrupted data
+		src.assign( 64, 0 );
+		ParticleSnapshot::Compress( src, 4, OUT packed );
+		TEST( not ParticleSnapshot::Decompress( packed, 4, src.size() + 4, OUT dst ));
+		TEST( not ParticleSnapshot::Decompress( ArrayView<uint8_t>{ packed.data(), 1 }, 4, src.size(), OUT dst ));
+	}
+
+
+	// particles of the simulator have constant size, color and many equal exponents
+	void Test_Particles ()
+	{
+		using Particle = ParticleSimulator::Particle;
+
+		ParticleSimulator	sim;
+		Array<Particle>		particles;
+
+		TEST( sim.Init( 1, 10000, 10000 ));
+		sim.UpdateScalar( 0.01f, 16, 1.0f, 10000 );
+		sim.Store( OUT particles );
+
+		const ArrayView<uint8_t>	src{ reinterpret_cast<const uint8_t*>( particles.data() ), particles.size() * sizeof(Particle) };
+		Array<uint8_t>				packed, dst;
+
+		ParticleSnapshot::Compress( src, sizeof(Particle), OUT packed );
+		TEST( ParticleSnapshot::Decompress( packed, sizeof(Particle), src.size(), OUT dst ));
+		TEST( std::equal( dst.begin(), dst.end(), src.begin(), src.end() ));
+
+	#ifdef FG_ENABLE_LZ4
+		TEST( packed.size() < src.size() * 3 / 4 );
+	#endif
+	}
+}
+
+extern void UnitTest_ParticleSnapshot ()
+{
+	Test_Codec();
+	Test_Particles();
+
+	FG_LOGI( "UnitTest_ParticleSnapshot" );
+}
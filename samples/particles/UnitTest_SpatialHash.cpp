@@ -0,0 +1,145 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SpatialHash.h"
+#include "stl/Algorithms/StringUtils.h"
+#include <random>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	void GenRandomPositions (size_t count, float size, std::mt19937 &gen, OUT Array<float3> &positions)
+	{
+		std::uniform_real_distribution<float>	dist{ -size, size };
+
+		positions.resize( count );
+		for (auto& p : positions) {
+			p = float3{ dist(gen), dist(gen), dist(gen) };
+		}
+	}
+
+
+	void Test_CellIndex ()
+	{
+		SpatialHash		hash;
+		TEST( not hash.Init( 0.0f, 16 ));
+		TEST( not hash.Init( 1.0f, 15 ));
+		TEST( hash.Init( 0.5f, 1u << 10 ));
+
+		TEST( SpatialHash::CellIndex( 0, 0, 0, 1u << 10 ) == 0 );
+		TEST( SpatialHash::CellIndex( -1, 2, -3, 1u << 10 ) < (1u << 10) );
+
+		// cell coordinates are rounded down
+		TEST( hash.CellIndex( float3{ 0.1f, 0.4f, 0.2f }) == SpatialHash::CellIndex( 0, 0, 0, 1u << 10 ));
+		TEST( hash.CellIndex( float3{ -0.1f, 0.6f, 1.2f }) == SpatialHash::CellIndex( -1, 1, 2, 1u << 10 ));
+	}
+
+
+	void Test_Build ()
+	{
+		std::mt19937	gen{ 1234 };
+		Array<float3>	positions;
+		SpatialHash		hash;
+
+		for (size_t count : {0u, 1u, 100u, 10000u})
+		{
+			GenRandomPositions( count, 4.0f, gen, OUT positions );
+
+			TEST( hash.Init( 0.25f, 1u << 12 ));
+			TEST( hash.Build( positions ));
+
+			const auto	cell_start	= hash.CellStart();
+			const auto	indices		= hash.SortedIndices();
+
+			TEST( cell_start.size() == hash.CellCount() + 1 );
+			TEST( cell_start[0] == 0 and cell_start[hash.CellCount()] == count );
+			TEST( indices.size() == count );
+
+			Array<bool>	found( count, false );
+
+			for (uint cell = 0; cell < hash.CellCount(); ++cell)
+			{
+				TEST( cell_start[cell] <= cell_start[cell+1] );
+
+				for (uint idx : hash.CellParticles( cell ))
+				{
+					TEST( idx < count and not found[idx] );
+					TEST( hash.CellIndex( positions[idx] ) == cell );
+					found[idx] = true;
+				}
+			}
+			TEST( std::all_of( found.begin(), found.end(), [](bool b) { return b; }));
+
+			const auto	stats = hash.CalcStats();
+			TEST( (count == 0) == (stats.usedCells == 0) );
+			TEST( stats.maxPerCell <= count );
+		}
+	}
+
+
+	// must find the same neighbours as brute force search
+	void Test_Neighbours ()
+	{
+		std::mt19937	gen{ 4321 };
+		Array<float3>	positions;
+		SpatialHash		hash;
+		const float		radius	= 0.5f;
+
+		for (uint cell_count : {4u, 1u << 12})
+		{
+			GenRandomPositions( 2000, 3.0f, gen, OUT positions );
+
+			TEST( hash.Init( radius, cell_count ));
+			TEST( hash.Build( positions ));
+
+			for (size_t i = 0; i < positions.size(); i += 7)
+			{
+				SpatialHash::NeighbourCells_t	cells;
+				const uint						num_cells = hash.NeighbourCells( positions[i], OUT cells );
+				TEST( num_cells > 0 and num_cells <= Min( SpatialHash::MaxNeighbourCells, cell_count ));
+
+				Array<uint>		visited( positions.size(), 0 );
+				hash.ForEachNeighbour( positions[i], [&visited] (uint idx) { ++visited[idx]; });
+
+				for (size_t j = 0; j < positions.size(); ++j)
+				{
+					// each particle is visited once even if neighbour cells have the same hash
+					TEST( visited[j] <= 1 );
+
+					if ( Distance( positions[i], positions[j] ) < radius )
+						TEST( visited[j] == 1 );
+				}
+			}
+		}
+	}
+}
+
+extern void UnitTest_SpatialHash ()
+{
+	Test_CellIndex();
+	Test_Build();
+	Test_Neighbours();
+
+	FG_LOGI( "UnitTest_SpatialHash" );
+}
+
+
+extern void PerfTest_SpatialHash ()
+{
+	std::mt19937	gen{ 1234 };
+	Array<float3>	positions;
+	SpatialHash		hash;
+
+	GenRandomPositions( 1u << 20, 10.0f, gen, OUT positions );
+	CHECK( hash.Init( 0.1f, 1u << 20 ));
+	CHECK( hash.Build( positions ));
+
+	const auto&	t		= hash.GetTimings();
+	const auto	stats	= hash.CalcStats();
+
+	FG_LOGI( "PerfTest_SpatialHash: "s << ToString( positions.size() ) << " particles, " << ToString( hash.CellCount() ) << " cells"
+			 << ", count: " << ToString( t.count ) << ", prefix sum: " << ToString( t.prefixSum ) << ", scatter: " << ToString( t.scatter )
+			 << ", used cells: " << ToString( stats.usedCells ) << ", max per cell: " << ToString( stats.maxPerCell ));
+}
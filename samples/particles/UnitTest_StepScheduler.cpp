@@ -0,0 +1,186 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "StepScheduler.h"
+#include <random>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Frame	= StepScheduler::Frame;
+
+
+	// simulation time must not depend on frame rate
+	void Test_FixedStep ()
+	{
+		StepScheduler::Config	cfg;
+		cfg.stepTime	= 0.01f;
+		cfg.maxSteps	= 100;
+
+		std::mt19937							gen{ 1234 };
+		std::uniform_real_distribution<float>	dist{ 0.001f, 0.05f };
+
+		StepScheduler	sched;
+		uint			total_steps	= 0;
+		double			total_time	= 0.0;
+
+		for (uint i = 0; i < 1000; ++i)
+		{
+			const float	dt		= dist( gen );
+			const Frame	frame	= sched.Advance( SecondsF{dt}, cfg );
+
+			TEST( frame.stepTime == cfg.stepTime );
+			TEST( Abs( frame.globalTime - float(total_steps) * cfg.stepTime ) < 1.0e-3f );
+			TEST( frame.timeOffset >= 0.0f and frame.timeOffset < cfg.stepTime );
+
+			total_steps	+= frame.steps;
+			total_time	+= dt;
+		}
+
+		TEST( total_steps == uint(total_time / cfg.stepTime) );
+		TEST( sched.GetStats().droppedSteps == 0 );
+	}
+
+
+	// steps that exceed budget are postponed, the rest is dropped
+	void Test_Backlog ()
+	{
+		StepScheduler::Config	cfg;
+		cfg.stepTime	= 0.01f;
+		cfg.maxSteps	= 10;
+		cfg.maxBacklog	= 5;
+
+		StepScheduler	sched;
+		Frame			frame;
+
+		frame = sched.Advance( SecondsF{1.005f}, cfg );
+		TEST( frame.steps == 10 );
+		TEST( sched.GetStats().budgetLimited == 1 );
+		TEST( sched.GetStats().droppedSteps == 85 );
+
+		frame = sched.Advance( SecondsF{0.0f}, cfg );
+		TEST( frame.steps == 5 );
+		TEST( Abs( frame.timeOffset - 0.005f ) < 1.0e-4f );
+
+		frame = sched.Advance( SecondsF{0.0f}, cfg );
+		TEST( frame.steps == 0 );
+	}
+
+
+	void Test_GpuBudget ()
+	{
+		StepScheduler::Config	cfg;
+		cfg.maxSteps	= 100;
+		cfg.gpuBudget	= SecondsF{0.004f};
+
+		StepScheduler	sched;
+		TEST( sched.StepBudget( cfg ) == 100 );		// step cost is unknown
+
+		sched.UpdateStepCost( SecondsF{0.002f}, 4 );
+		TEST( sched.StepBudget( cfg ) == 8 );
+
+		sched.UpdateStepCost( SecondsF{0.0f}, 0 );	// ignored
+		TEST( sched.StepBudget( cfg ) == 8 );
+
+		// at least one step per frame
+		StepScheduler	slow;
+		slow.UpdateStepCost( SecondsF{1.0f}, 1 );
+		TEST( slow.StepBudget( cfg ) == 1 );
+	}
+
+
+	// GPU time has fixed cost of drawing, only cost of steps must be limited by budget
+	void Test_FixedCost ()
+	{
+		StepScheduler::Config	cfg;
+		cfg.stepTime	= 0.01f;
+		cfg.maxSteps	= 20;
+		cfg.maxBacklog	= 100;
+		cfg.gpuBudget	= SecondsF{0.002f};
+
+		const float		draw_cost	= 0.003f;
+		const float		step_cost	= 0.00005f;
+
+		StepScheduler	sched;
+		uint			steps	= 0;
+
+		// simulation is behind, so number of steps is limited only by budget
+		for (uint i = 0; i < 20; ++i)
+		{
+			steps = sched.Advance( SecondsF{0.5f}, cfg ).steps;
+			sched.UpdateStepCost( SecondsF{draw_cost + step_cost * float(steps)}, steps );
+		}
+
+		TEST( Abs( sched.StepCost() - step_cost ) < 1.0e-6f );
+		TEST( sched.StepBudget( cfg ) == cfg.maxSteps );
+		TEST( steps == cfg.maxSteps );
+
+		// frames without steps and with different number of steps
+		StepScheduler	sched2;
+		for (uint i = 0; i < 100; ++i)
+		{
+			steps = sched2.Advance( SecondsF{0.007f}, cfg ).steps;
+			sched2.UpdateStepCost( SecondsF{draw_cost + step_cost * float(steps)}, steps );
+		}
+		TEST( Abs( sched2.StepCost() - step_cost ) < 1.0e-6f );
+		TEST( sched2.StepBudget( cfg ) == cfg.maxSteps );
+	}
+
+
+	// replay must return exactly the same frames regardless of frame time
+	void Test_Replay ()
+	{
+		StepScheduler::Config	cfg;
+		cfg.stepTime	= 0.004f;
+		cfg.maxSteps	= 8;
+
+		std::mt19937							gen{ 4321 };
+		std::uniform_real_distribution<float>	dist{ 0.0f, 0.05f };
+
+		StepScheduler	sched;
+		Array<Frame>	frames;
+
+		TEST( not sched.StartReplay() );
+
+		sched.StartRecording();
+		TEST( sched.IsRecording() );
+
+		for (uint i = 0; i < 100; ++i) {
+			frames.push_back( sched.Advance( SecondsF{dist( gen )}, cfg ));
+		}
+		sched.StopRecording();
+		TEST( sched.Recorded().size() == frames.size() );
+
+		TEST( sched.StartReplay() );
+		cfg.stepTime = 0.1f;
+
+		for (auto& ref : frames)
+		{
+			TEST( sched.IsReplaying() );
+
+			const Frame	frame = sched.Advance( SecondsF{1.0f}, cfg );
+			TEST( frame.steps == ref.steps );
+			TEST( frame.stepTime == ref.stepTime );
+			TEST( frame.globalTime == ref.globalTime );
+			TEST( frame.timeOffset == ref.timeOffset );
+		}
+
+		// continues in realtime after replay
+		const Frame	frame = sched.Advance( SecondsF{0.25f}, cfg );
+		TEST( not sched.IsReplaying() );
+		TEST( frame.steps == 2 and frame.stepTime == cfg.stepTime );
+	}
+}
+
+extern void UnitTest_StepScheduler ()
+{
+	Test_FixedStep();
+	Test_Backlog();
+	Test_GpuBudget();
+	Test_FixedCost();
+	Test_Replay();
+
+	FG_LOGI( "UnitTest_StepScheduler" );
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : require
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
+
+#include "depth_sort_shared.glsl"
+
+layout(set=0, binding=3, std430) writeonly buffer DstKeySSB
+{
+	uint		dstKeys[];
+};
+
+layout(set=0, binding=4, std430) writeonly buffer DstValueSSB
+{
+	uint		dstValues[];
+};
+
+// same layout as in 'depth_sort_local.glsl'
+layout(push_constant, std140) uniform PushConst {
+	uint		count;
+	uint		offset;		// unused
+} pc;
+
+
+// keys and values for full sort, see 'depth_sort_shared.glsl'
+void main ()
+{
+	const uint	index = GetGlobalIndex();
+
+	if ( index >= pc.count )
+		return;
+
+	dstKeys[index]		= DepthSortKey( index );
+	dstValues[index]	= index;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Partial sort: particles move slowly, so order from the previous frame is almost correct.
+	Each workgroup sorts one tile of values by current depth using bitonic sort,
+	tiles are shifted by half of tile size in odd frames, so particles can move between tiles.
+*/
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : require
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+#include "depth_sort_shared.glsl"
+
+layout (local_size_x = DEPTH_SORT_TILE_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+layout(set=0, binding=3, std430) buffer ValueSSB
+{
+	uint		values[];
+};
+
+layout(push_constant, std140) uniform PushConst {
+	uint		count;
+	uint		offset;		// first element of the first tile
+} pc;
+
+
+shared uint  s_Keys[DEPTH_SORT_TILE_SIZE];
+shared uint  s_Values[DEPTH_SORT_TILE_SIZE];
+
+
+void main ()
+{
+	const uint	local	= gl_LocalInvocationIndex;
+	const uint	index	= pc.offset + gl_WorkGroupID.x * DEPTH_SORT_TILE_SIZE + local;
+	const bool	valid	= index < pc.count;
+
+	// invalid elements are at the end of the last tile and stay there after sorting
+	s_Values[local]	= valid ? values[index] : 0;
+	s_Keys[local]	= valid ? DepthSortKey( s_Values[local] ) : ~0u;
+	memoryBarrierShared();
+	barrier();
+
+	[[unroll]] for (uint size = 2; size <= DEPTH_SORT_TILE_SIZE; size <<= 1)
+	{
+		[[unroll]] for (uint stride = size >> 1; stride > 0; stride >>= 1)
+		{
+			const uint	other = local ^ stride;
+
+			if ( other > local )
+			{
+				const bool	ascending	= (local & size) == 0;
+				const uint	a			= s_Keys[local];
+				const uint	b			= s_Keys[other];
+
+				if ( (a > b) == ascending )
+				{
+					s_Keys[local]	= b;
+					s_Keys[other]	= a;
+
+					const uint	v	= s_Values[local];
+					s_Values[local]	= s_Values[other];
+					s_Values[other]	= v;
+				}
+			}
+			memoryBarrierShared();
+			barrier();
+		}
+	}
+
+	if ( valid )
+		values[index] = s_Values[local];
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Depth sorting of particles for alpha blending.
+
+	Key is a view space depth converted to ordered uint, value is an index of particle.
+	Sorted values are used as index buffer, so particles are drawn from back to front.
+	Full sort:		'depth_sort_keys.glsl' then 'radix_sort.glsl' for each 8 bits of key.
+	Partial sort:	'depth_sort_local.glsl' sorts tiles of previously sorted values.
+	Must be synchronized with 'DepthSort' class.
+*/
+
+#include "simulation_shared.glsl"
+
+#define DEPTH_SORT_TILE_SIZE	256
+
+#ifdef PACKED_PARTICLES
+layout(set=0, binding=0, std430) readonly buffer ParticleSSB
+{
+	PackedParticle	particles[];
+};
+#else
+layout(set=0, binding=0, std430) readonly buffer ParticleSSB
+{
+	Particle	particles[];
+};
+#endif
+
+float3  ParticlePosition (const uint index)
+{
+	return particles[index].position;
+}
+
+layout(set=0, binding=2, std140) uniform CameraUB
+{
+	float4x4		proj;
+	float4x4		modelView;
+	float4x4		modelViewProj;
+	float2			viewport;
+	float2			clipPlanes;
+} camera;
+
+
+// camera looks along -Z axis, so the farthest particle has the minimal key
+uint  DepthSortKey (const uint index)
+{
+	return FloatToOrderedUint( (camera.modelView * float4( ParticlePosition( index ), 1.0 )).z );
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : require
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
+
+#include "simulation_shared.glsl"
+
+layout(set=0, binding=0, std430) writeonly buffer DstParticleSSB
+{
+	Particle	dstParticles[];
+};
+
+layout(set=0, binding=1, std430) buffer ParticleCounterSSB
+{
+	ParticleCounters	counters;
+};
+
+layout(set=0, binding=2, std140) uniform ParticleUB
+{
+	uint		steps;
+	float		timeDelta;
+	float		globalTime;
+	uint		emitCount;
+	float		maxLifetime;
+	uint		srcIndex;
+	uint		maxParticles;
+} ub;
+
+
+// appends new particles to the destination buffer, see 'Particle lifecycle' in 'simulation_shared.glsl'
+void main ()
+{
+	if ( uint(GetGlobalIndex()) >= ub.emitCount )
+		return;
+
+	const uint	slot = atomicAdd( counters.aliveCount[1 - ub.srcIndex], 1 );
+
+	// buffer is full, counter will be clamped in 'update_particle_args.glsl'
+	if ( slot >= ub.maxParticles )
+		return;
+
+	Particle	particle;
+	InitParticle( OUT particle, ub.globalTime );
+	particle.param.w = 0.0;		// age
+
+	dstParticles[slot] = particle;
+}
@@ -9,12 +9,43 @@ layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
 
 #include "simulation_shared.glsl"
 
+#ifdef PACKED_PARTICLES
+layout(set=0, binding=0, std430) writeonly buffer ParticleSSB
+{
+	PackedParticle	particles[];
+};
+
+layout(set=0, binding=1, std430) writeonly buffer ParticlePaletteSSB
+{
+	uint		palette[];
+};
+
+#else
 layout(set=0, binding=0, std430) writeonly buffer ParticleSSB
 {
 	Particle	particles[];
 };
+#endif
 
 void main ()
 {
-	InitParticle( OUT particles[GetGlobalIndex()], 0.0 );
+#ifdef PACKED_PARTICLES
+	const int	index	= GetGlobalIndex();
+	Particle	particle;
+
+	InitParticle( OUT particle, 0.0 );
+	particle.param.w = 0.0;
+
+	if ( uint(index) < ParticlePaletteSize )
+		palette[index] = ParticlePaletteColor( uint(index) );
+
+	particles[index] = PackParticle( particle );
+
+#else
+	Particle	particle;
+	InitParticle( OUT particle, 0.0 );
+	particle.param.w = 0.0;		// age in lifecycle mode
+
+	particles[GetGlobalIndex()] = particle;
+#endif
 }
@@ -0,0 +1,49 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Camera for particle rendering.
+	In 'STEREO' mode both eyes are rendered in a single pass: vertex shader outputs world space position,
+	geometry shader expands each particle for both eyes and writes eye index to 'gl_Layer'.
+*/
+
+layout(set=0, binding=0, std140) uniform CameraUB {
+	float4x4		proj;
+	float4x4		modelView;
+	float4x4		modelViewProj;
+	float2			viewport;
+	float2			clipPlanes;
+	float			timeOffset;		// time since the last simulation step
+} ub;
+
+#ifdef STEREO
+	// same layout as 'CameraUB'
+	layout(set=0, binding=3, std140) uniform RightCameraUB {
+		float4x4		proj;
+		float4x4		modelView;
+		float4x4		modelViewProj;
+		float2			viewport;
+		float2			clipPlanes;
+		float			timeOffset;
+	} ub_right;
+
+#	define EYE_COUNT	2
+
+	float4x4  EyeModelView (const int eye)	{ return eye == 0 ? ub.modelView : ub_right.modelView; }
+	float4x4  EyeProj (const int eye)		{ return eye == 0 ? ub.proj : ub_right.proj; }
+
+#else
+#	define EYE_COUNT	1
+
+	float4x4  EyeModelView (const int eye)	{ return ub.modelView; }
+	float4x4  EyeProj (const int eye)		{ return ub.proj; }
+#endif
+
+
+#if SHADER & SH_GEOMETRY
+	// must be called for each vertex
+	void  SetEyeLayer (const int eye)
+	{
+	#ifdef STEREO
+		gl_Layer = eye;
+	#endif
+	}
+#endif
@@ -13,31 +13,41 @@
 
 #include "Math.glsl"
 
-layout(set=0, binding=0, std140) uniform CameraUB {
-	float4x4		proj;
-	float4x4		modelView;
-	float4x4		modelViewProj;
-	float2			viewport;
-	float2			clipPlanes;
-} ub;
+#include "particles_camera.glsl"
 //-----------------------------------------------------------------------------
 
 
 #if SHADER & SH_VERTEX
-	layout(location=0) in  float3	in_Position;
-	layout(location=1) in  float3	in_Velocity;
-	layout(location=2) in  float4	in_Color;
-	layout(location=3) in  float	in_Size;
+#include "particles_vertex.glsl"
 
+#ifdef VERTEX_PULLING
+	layout(location=0) out float2	out_UV;
+	layout(location=1) out float4	out_Color;
+
+	// same quad as in geometry shader
+	void main ()
+	{
+		const uint		corner	= QuadCorner();
+		const float4	pos		= ub.modelView * float4(ParticlePosition() + ParticleVelocity() * ub.timeOffset, 1.0);
+		const float		size	= ParticleSize() * 4.0 / Max( ub.viewport.x, ub.viewport.y );
+
+		out_UV		= float2( corner >> 1, corner & 1 );
+		out_Color	= ParticleColor();
+		gl_Position	= ub.proj * float4(pos.xy + ToSNorm(out_UV) * 0.5 * size, pos.zw);
+	}
+
+#else
 	layout(location=0) out float4	out_Color;
 	layout(location=1) out float	out_Size;
 
 	void main ()
 	{
-		gl_Position		= ub.modelView * float4(in_Position, 1.0);
-		out_Color		= in_Color;
-		out_Size		= in_Size * 4.0 / Max( ub.viewport.x, ub.viewport.y );
+		// particles are extrapolated between fixed simulation steps, position is in world space
+		gl_Position		= float4(ParticlePosition() + ParticleVelocity() * ub.timeOffset, 1.0);
+		out_Color		= ParticleColor();
+		out_Size		= ParticleSize() * 4.0 / Max( ub.viewport.x, ub.viewport.y );
 	}
+#endif
 #endif	// SH_VERTEX
 //-----------------------------------------------------------------------------
 
@@ -45,7 +55,7 @@ layout(set=0, binding=0, std140) uniform CameraUB {
 
 #if SHADER & SH_GEOMETRY
 	layout (points) in;
-	layout (triangle_strip, max_vertices = 4) out;
+	layout (triangle_strip, max_vertices = 4 * EYE_COUNT) out;
 	
 	layout(location=0) in  float4	in_Color[];
 	layout(location=1) in  float	in_Size[];
@@ -56,39 +66,47 @@ layout(set=0, binding=0, std140) uniform CameraUB {
 
 	void main ()
 	{
-		float4	pos		= gl_in[0].gl_Position;
-		float	size	= in_Size[0];
-
-
-		// a: left-bottom
-		float2	va	= pos.xy + float2(-0.5, -0.5) * size;
-		gl_Position	= ub.proj * float4(va, pos.zw);
-		out_UV		= float2(0.0, 0.0);
-		out_Color	= in_Color[0];
-		EmitVertex();
-
-		// b: left-top
-		float2	vb	= pos.xy + float2(-0.5, 0.5) * size;
-		gl_Position	= ub.proj * float4(vb, pos.zw);
-		out_UV		= float2(0.0, 1.0);
-		out_Color	= in_Color[0];
-		EmitVertex();
-
-		// d: right-bottom
-		float2	vd	= pos.xy + float2(0.5, -0.5) * size;
-		gl_Position	= ub.proj * float4(vd, pos.zw);
-		out_UV		= float2(1.0, 0.0);
-		out_Color	= in_Color[0];
-		EmitVertex();
-
-		// c: right-top
-		float2	vc	= pos.xy + float2(0.5, 0.5) * size;
-		gl_Position	= ub.proj * float4(vc, pos.zw);
-		out_UV		= float2(1.0, 1.0);
-		out_Color	= in_Color[0];
-		EmitVertex();
-
-		EndPrimitive();
+		[[unroll]] for (int eye = 0; eye < EYE_COUNT; ++eye)
+		{
+			float4		pos		= EyeModelView( eye ) * gl_in[0].gl_Position;
+			float4x4	proj	= EyeProj( eye );
+			float		size	= in_Size[0];
+
+
+			// a: left-bottom
+			float2	va	= pos.xy + float2(-0.5, -0.5) * size;
+			gl_Position	= proj * float4(va, pos.zw);
+			out_UV		= float2(0.0, 0.0);
+			out_Color	= in_Color[0];
+			SetEyeLayer( eye );
+			EmitVertex();
+
+			// b: left-top
+			float2	vb	= pos.xy + float2(-0.5, 0.5) * size;
+			gl_Position	= proj * float4(vb, pos.zw);
+			out_UV		= float2(0.0, 1.0);
+			out_Color	= in_Color[0];
+			SetEyeLayer( eye );
+			EmitVertex();
+
+			// d: right-bottom
+			float2	vd	= pos.xy + float2(0.5, -0.5) * size;
+			gl_Position	= proj * float4(vd, pos.zw);
+			out_UV		= float2(1.0, 0.0);
+			out_Color	= in_Color[0];
+			SetEyeLayer( eye );
+			EmitVertex();
+
+			// c: right-top
+			float2	vc	= pos.xy + float2(0.5, 0.5) * size;
+			gl_Position	= proj * float4(vc, pos.zw);
+			out_UV		= float2(1.0, 1.0);
+			out_Color	= in_Color[0];
+			SetEyeLayer( eye );
+			EmitVertex();
+
+			EndPrimitive();
+		}
 	}
 #endif	// SH_GEOMETRY
 //-----------------------------------------------------------------------------
@@ -102,7 +120,8 @@ layout(set=0, binding=0, std140) uniform CameraUB {
 
 	void main ()
 	{
-		out_Color = in_Color * (1.0 - Distance( ToSNorm(in_UV), float2(0.0) ));
+		// color is premultiplied by alpha
+		out_Color = in_Color * Max( 0.0, 1.0 - Distance( ToSNorm(in_UV), float2(0.0) ));
 	}
 #endif	// SH_FRAGMENT
 //-----------------------------------------------------------------------------
@@ -13,22 +13,107 @@
 
 #include "Math.glsl"
 
-layout(set=0, binding=0, std140) uniform CameraUB {
-	float4x4		proj;
-	float4x4		modelView;
-	float4x4		modelViewProj;
-	float2			viewport;
-	float2			clipPlanes;
-} ub;
+#include "particles_camera.glsl"
+//-----------------------------------------------------------------------------
+
+
+// check is point inside oriented rectangle
+bool IsPointInside (in float2 a, in float2 b, in float2 c, in float2 m)
+{
+	float2	ab		= b - a;
+	float2	bc		= c - b;
+	float2	am		= m - a;
+	float2	bm		= m - b;
+
+	float	ab_am	= Dot( ab, am );
+	float	ab_ab	= Dot( ab, ab );
+	float	bc_bm	= Dot( bc, bm );
+	float	bc_bc	= Dot( bc, bc );
+
+	return	ab_am >= 0.0f  and bc_bm >= 0.0f and
+			ab_am <= ab_ab and bc_bm <= bc_bc;
+}
+
+const float2	RayQuadUV[] = float2[](
+	float2(0.0, 1.0),
+	float2(0.0, 0.0),
+	float2(1.0, 1.0),
+	float2(1.0, 0.0)
+);
+
+// returns quad in triangle strip order, 'start' and 'end' are in view space
+void  RayQuad (const float4 start, const float4 end, const float size, out float4 quad[4])
+{
+	//        _ _
+	//      /\ / \		    \ /
+	//     /  s  /		     s
+	//    /  / \/		    / \
+	//   /\ /  /		 \ /
+	//  \  e  /			  e
+	//   \/_\/			 / \
+	
+	float2	dir		= Normalize( end.xy - start.xy );
+	float2	norm	= float2( -dir.y, dir.x );
+
+	float	side	= size * 0.95;			// size with error
+	
+	float2	rect_a	= start.xy + norm * size;
+	float2	rect_b	= start.xy - norm * size;
+	float2	rect_c	= end.xy - norm * size;
+
+	float4	points[]	= float4[](
+		start + float4( norm + dir, 0.0, 0.0) * side,
+		start + float4( norm - dir, 0.0, 0.0) * side,
+		start + float4(-norm - dir, 0.0, 0.0) * side,
+		start + float4(-norm + dir, 0.0, 0.0) * side,
+		end   + float4( norm + dir, 0.0, 0.0) * side,
+		end   + float4( norm - dir, 0.0, 0.0) * side,
+		end   + float4(-norm - dir, 0.0, 0.0) * side,
+		end   + float4(-norm + dir, 0.0, 0.0) * side
+	);
+
+	[[unroll]] for (int j = 0; j < 4; ++j) {
+		quad[j] = start;
+	}
+
+	// find external points (must be 4 points)
+	for (int i = 0, j = 0; i < points.length() and j < 4; ++i)
+	{
+		if ( not IsPointInside( rect_a, rect_b, rect_c, points[i].xy ))
+		{
+			quad[j] = points[i];
+			++j;
+		}
+	}
+}
 //-----------------------------------------------------------------------------
 
 
 #if SHADER & SH_VERTEX
-	layout(location=0) in  float3	in_Position;
-	layout(location=1) in  float3	in_Velocity;
-	layout(location=2) in  float4	in_Color;
-	layout(location=3) in  float	in_Size;
+#include "particles_vertex.glsl"
+
+#ifdef VERTEX_PULLING
+	layout(location=0) out float2	out_UV;
+	layout(location=1) out float4	out_Color;
 
+	// same quad as in geometry shader, whole ray is calculated for each vertex
+	void main ()
+	{
+		const float3	vel		= ParticleVelocity();
+		const float3	pos		= ParticlePosition() + vel * ub.timeOffset;
+		const float		size	= ParticleSize() * 2.0 / Max( ub.viewport.x, ub.viewport.y );
+		const float3	v		= Normalize(vel) * Min( Length(vel), size * 25.0 );
+		const uint		corner	= QuadCorner();
+
+		float4	quad[4];
+		RayQuad( ub.modelView * float4(pos - v * 0.5, 1.0), ub.modelView * float4(pos, 1.0), size * 0.5, OUT quad );
+
+		gl_Position	= ub.proj * quad[corner];
+		out_UV		= RayQuadUV[corner];
+		out_Color	= ParticleColor();
+	}
+
+#else
 	layout(location=0) out float4	out_StartPos;
 	layout(location=1) out float4	out_EndPos;
 	layout(location=2) out float4	out_Color;
@@ -36,13 +121,19 @@ layout(set=0, binding=0, std140) uniform CameraUB {
 
 	void main ()
 	{
-		out_EndPos		= ub.modelView * float4(in_Position, 1.0);
-		out_Color		= in_Color;
-		out_Size		= in_Size * 2.0 / Max( ub.viewport.x, ub.viewport.y );
+		// particles are extrapolated between fixed simulation steps
+		const float3	vel	= ParticleVelocity();
+		const float3	pos	= ParticlePosition() + vel * ub.timeOffset;
 
-		float3	v		= Normalize(in_Velocity) * Min( Length(in_Velocity), out_Size * 25.0 );
-		out_StartPos	= ub.modelView * float4(in_Position - v * 0.5, 1.0);
+		// positions are in world space, view matrix doesn't change length of ray
+		out_EndPos		= float4(pos, 1.0);
+		out_Color		= ParticleColor();
+		out_Size		= ParticleSize() * 2.0 / Max( ub.viewport.x, ub.viewport.y );
+
+		float3	v		= Normalize(vel) * Min( Length(vel), out_Size * 25.0 );
+		out_StartPos	= float4(pos - v * 0.5, 1.0);
 	}
+#endif
 #endif	// SH_VERTEX
 //-----------------------------------------------------------------------------
 
@@ -50,7 +141,7 @@ layout(set=0, binding=0, std140) uniform CameraUB {
 
 #if SHADER & SH_GEOMETRY
 	layout (points) in;
-	layout (triangle_strip, max_vertices = 4) out;
+	layout (triangle_strip, max_vertices = 4 * EYE_COUNT) out;
 	
 	layout(location=0) in  float4	in_StartPos[];
 	layout(location=1) in  float4	in_EndPos[];
@@ -61,80 +152,32 @@ layout(set=0, binding=0, std140) uniform CameraUB {
 	layout(location=1) out float4	out_Color;
 
 
-	// check is point inside oriented rectangle
-	bool IsPointInside (in float2 a, in float2 b, in float2 c, in float2 m)
+	void  EmitRay (const int eye)
 	{
-		float2	ab		= b - a;
-		float2	bc		= c - b;
-		float2	am		= m - a;
-		float2	bm		= m - b;
-
-		float	ab_am	= Dot( ab, am );
-		float	ab_ab	= Dot( ab, ab );
-		float	bc_bm	= Dot( bc, bm );
-		float	bc_bc	= Dot( bc, bc );
-
-		return	ab_am >= 0.0f  and bc_bm >= 0.0f and
-				ab_am <= ab_ab and bc_bm <= bc_bc;
-	}
+		const float4x4	proj	= EyeProj( eye );
+		float4			quad[4];
 
-	void main ()
-	{
-		//        _ _
-		//      /\ / \		    \ /
-		//     /  s  /		     s
-		//    /  / \/		    / \
-		//   /\ /  /		 \ /
-		//  \  e  /			  e
-		//   \/_\/			 / \
-		
-		float4	start	= in_StartPos[0];
-		float4	end		= in_EndPos[0];
-		float2	dir		= Normalize( end.xy - start.xy );
-		float2	norm	= float2( -dir.y, dir.x );
-
-		float	size	= in_Size[0] * 0.5;	// rotated rectangle size
-		float	side	= size * 0.95;			// size with error
-		float4	color	= in_Color[0];
-		
-		float2	rect_a	= start.xy + norm * size;
-		float2	rect_b	= start.xy - norm * size;
-		float2	rect_c	= end.xy - norm * size;
-
-		float4	points[]	= float4[](
-			start + float4( norm + dir, 0.0, 0.0) * side,
-			start + float4( norm - dir, 0.0, 0.0) * side,
-			start + float4(-norm - dir, 0.0, 0.0) * side,
-			start + float4(-norm + dir, 0.0, 0.0) * side,
-			end   + float4( norm + dir, 0.0, 0.0) * side,
-			end   + float4( norm - dir, 0.0, 0.0) * side,
-			end   + float4(-norm - dir, 0.0, 0.0) * side,
-			end   + float4(-norm + dir, 0.0, 0.0) * side
-		);
-
-		const float2	uv_coords[] = float2[](
-			float2(0.0, 1.0),
-			float2(0.0, 0.0),
-			float2(1.0, 1.0),
-			float2(1.0, 0.0)
-		);
-
-		// find external points (must be 4 points)
-		for (int i = 0, j = 0; i < points.length() and j < 4; ++i)
+		RayQuad( EyeModelView( eye ) * in_StartPos[0], EyeModelView( eye ) * in_EndPos[0], in_Size[0] * 0.5, OUT quad );
+
+		[[unroll]] for (int j = 0; j < 4; ++j)
 		{
-			if ( not IsPointInside( rect_a, rect_b, rect_c, points[i].xy ))
-			{
-				gl_Position	 = ub.proj * points[i];
-				out_UV		 = uv_coords[j];
-				out_Color	 = color;
-
-				EmitVertex();
-				++j;
-			}
+			gl_Position	 = proj * quad[j];
+			out_UV		 = RayQuadUV[j];
+			out_Color	 = in_Color[0];
+			SetEyeLayer( eye );
+
+			EmitVertex();
 		}
 
 		EndPrimitive();
 	}
+
+	void main ()
+	{
+		[[unroll]] for (int eye = 0; eye < EYE_COUNT; ++eye) {
+			EmitRay( eye );
+		}
+	}
 #endif	// SH_GEOMETRY
 //-----------------------------------------------------------------------------
 
@@ -147,7 +190,8 @@ layout(set=0, binding=0, std140) uniform CameraUB {
 
 	void main ()
 	{
-		out_Color = in_Color * (1.0 - Distance( ToSNorm(in_UV), float2(0.0) ));
+		// color is premultiplied by alpha
+		out_Color = in_Color * Max( 0.0, 1.0 - Distance( ToSNorm(in_UV), float2(0.0) ));
 	}
 #endif	// SH_FRAGMENT
 //-----------------------------------------------------------------------------
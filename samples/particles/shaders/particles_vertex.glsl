@@ -0,0 +1,95 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Particle input for vertex shader.
+	By default particle is a vertex and expanded to quad in geometry shader.
+	In 'VERTEX_PULLING' mode particle is an instance of quad with 4 vertices,
+	particle is read from storage buffer and quad is expanded in vertex shader.
+*/
+
+#ifdef VERTEX_PULLING
+#ifdef SORTED_PARTICLES
+	// same indices as used for index buffer
+	layout(set=0, binding=5, std430) readonly buffer ParticleOrderSSB {
+		uint		particleOrder[];
+	};
+
+	uint  ParticleIndex ()	{ return particleOrder[gl_InstanceIndex]; }
+#else
+	uint  ParticleIndex ()	{ return uint(gl_InstanceIndex); }
+#endif
+
+	// triangle strip: left-bottom, left-top, right-bottom, right-top
+	uint  QuadCorner ()		{ return uint(gl_VertexIndex) & 3; }
+#endif	// VERTEX_PULLING
+
+
+#ifdef PACKED_PARTICLES
+	layout(set=0, binding=2, std430) readonly buffer ParticlePaletteSSB {
+		uint		palette[];
+	};
+
+#ifdef VERTEX_PULLING
+	// see 'PackedParticle' in 'simulation_shared.glsl'
+	struct PackedParticle
+	{
+		float3		position;
+		uint		sizeVelocity;	// half size, half 'velocity.x'
+		uint		velocity;		// half 'velocity.yz'
+		uint		colorParam;		// 16 bit palette index, half 'param.x'
+		float		paramY;
+		uint		paramZW;		// half 'param.zw'
+	};
+
+	layout(set=0, binding=4, std430) readonly buffer ParticleSSB {
+		PackedParticle	particles[];
+	};
+
+	float3  ParticlePosition ()	{ return particles[ParticleIndex()].position; }
+	float3  ParticleVelocity ()	{ const PackedParticle p = particles[ParticleIndex()];  return float3( unpackHalf2x16( p.sizeVelocity ).y, unpackHalf2x16( p.velocity )); }
+	float4  ParticleColor ()	{ return unpackUnorm4x8( palette[ particles[ParticleIndex()].colorParam & 0xFFFF ]); }
+	float   ParticleSize ()		{ return unpackHalf2x16( particles[ParticleIndex()].sizeVelocity ).x; }
+
+#else
+	layout(location=0) in  float3	in_Position;
+	layout(location=1) in  float4	in_SizeVelocity;	// half size, half3 velocity
+	layout(location=2) in  uint		in_ColorIndex;
+
+	float3  ParticlePosition ()	{ return in_Position; }
+	float3  ParticleVelocity ()	{ return in_SizeVelocity.yzw; }
+	float4  ParticleColor ()	{ return unpackUnorm4x8( palette[in_ColorIndex] ); }
+	float   ParticleSize ()		{ return in_SizeVelocity.x; }
+#endif
+
+#else
+#ifdef VERTEX_PULLING
+	// see 'Particle' in 'simulation_shared.glsl'
+	struct Particle
+	{
+		float3		position;
+		float		size;
+		float3		velocity;
+		uint		color;
+		float4		param;
+	};
+
+	layout(set=0, binding=4, std430) readonly buffer ParticleSSB {
+		Particle	particles[];
+	};
+
+	float3  ParticlePosition ()	{ return particles[ParticleIndex()].position; }
+	float3  ParticleVelocity ()	{ return particles[ParticleIndex()].velocity; }
+	float4  ParticleColor ()	{ return unpackUnorm4x8( particles[ParticleIndex()].color ); }
+	float   ParticleSize ()		{ return particles[ParticleIndex()].size; }
+
+#else
+	layout(location=0) in  float3	in_Position;
+	layout(location=1) in  float3	in_Velocity;
+	layout(location=2) in  float4	in_Color;
+	layout(location=3) in  float	in_Size;
+
+	float3  ParticlePosition ()	{ return in_Position; }
+	float3  ParticleVelocity ()	{ return in_Velocity; }
+	float4  ParticleColor ()	{ return in_Color; }
+	float   ParticleSize ()		{ return in_Size; }
+#endif
+#endif	// PACKED_PARTICLES
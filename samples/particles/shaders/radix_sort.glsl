@@ -0,0 +1,183 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Stable LSD radix sort of 32 bit keys with 32 bit values, 8 bits per pass.
+	Each pass sorts from 'Src*' to 'Dst*' buffers in 3 dispatches:
+		RADIX_PASS 0 - each workgroup counts digits in its range of tiles,
+		RADIX_PASS 1 - single workgroup computes offset of each digit for each workgroup,
+		RADIX_PASS 2 - each workgroup sorts its tiles by digit in shared memory and scatters them.
+	Workgroups process sequential ranges of tiles, so order of elements with the same digit is preserved.
+	Must be synchronized with 'DepthSort::Sort'.
+*/
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : require
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+#include "Math.glsl"
+
+#define RADIX_BITS		8
+#define RADIX_BINS		(1 << RADIX_BITS)
+#define TILE_SIZE		RADIX_BINS		// each invocation processes one element of tile and one digit
+
+layout (local_size_x = TILE_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+#define WORKGROUP_SCAN_SIZE		TILE_SIZE
+#include "workgroup_scan.glsl"
+
+layout(set=0, binding=0, std430) readonly buffer SrcKeySSB
+{
+	uint		srcKeys[];
+};
+
+layout(set=0, binding=1, std430) readonly buffer SrcValueSSB
+{
+	uint		srcValues[];
+};
+
+layout(set=0, binding=2, std430) writeonly buffer DstKeySSB
+{
+	uint		dstKeys[];
+};
+
+layout(set=0, binding=3, std430) writeonly buffer DstValueSSB
+{
+	uint		dstValues[];
+};
+
+layout(set=0, binding=4, std430) buffer HistogramSSB
+{
+	uint		histogram[];	// [digit * groupCount + group]
+};
+
+layout(push_constant, std140) uniform PushConst {
+	uint		count;
+	uint		shift;			// first bit of digit
+	uint		groupCount;
+	uint		tilesPerGroup;
+} pc;
+
+
+uint  Digit (const uint key)
+{
+	return (key >> pc.shift) & (RADIX_BINS - 1);
+}
+
+
+#if RADIX_PASS == 0
+	shared uint  s_Histogram[RADIX_BINS];
+
+	void main ()
+	{
+		const uint	local	= gl_LocalInvocationIndex;
+		const uint	first	= gl_WorkGroupID.x * pc.tilesPerGroup * TILE_SIZE;
+		const uint	last	= Min( first + pc.tilesPerGroup * TILE_SIZE, pc.count );
+
+		s_Histogram[local] = 0;
+		memoryBarrierShared();
+		barrier();
+
+		for (uint i = first + local; i < last; i += TILE_SIZE) {
+			atomicAdd( s_Histogram[ Digit( srcKeys[i] )], 1 );
+		}
+		memoryBarrierShared();
+		barrier();
+
+		histogram[ local * pc.groupCount + gl_WorkGroupID.x ] = s_Histogram[local];
+	}
+
+#elif RADIX_PASS == 1
+	void main ()
+	{
+		const uint	digit	= gl_LocalInvocationIndex;
+		const uint	first	= digit * pc.groupCount;
+		uint		count	= 0;
+
+		for (uint g = 0; g < pc.groupCount; ++g) {
+			count += histogram[ first + g ];
+		}
+
+		// elements with smaller digit are placed first
+		uint	offset = WorkgroupInclusiveScan( count ) - count;
+
+		for (uint g = 0; g < pc.groupCount; ++g)
+		{
+			const uint	n = histogram[ first + g ];
+			histogram[ first + g ] = offset;
+			offset += n;
+		}
+	}
+
+#elif RADIX_PASS == 2
+	shared uint  s_Offset[RADIX_BINS];		// where the next element with this digit is written
+	shared uint  s_DigitStart[RADIX_BINS];	// first element with this digit in sorted tile
+	shared uint  s_Keys[TILE_SIZE];
+	shared uint  s_Values[TILE_SIZE];
+
+	void main ()
+	{
+		const uint	local = gl_LocalInvocationIndex;
+
+		s_Offset[local] = histogram[ local * pc.groupCount + gl_WorkGroupID.x ];
+
+		for (uint t = 0; t < pc.tilesPerGroup; ++t)
+		{
+			const uint	tile_start = (gl_WorkGroupID.x * pc.tilesPerGroup + t) * TILE_SIZE;
+
+			// uniform for workgroup
+			if ( tile_start >= pc.count )
+				break;
+
+			// invalid elements have the maximal digit and stay at the end of tile after stable sort
+			const uint	tile_count	= Min( pc.count - tile_start, TILE_SIZE );
+			uint		key			= local < tile_count ? srcKeys[ tile_start + local ] : ~0u;
+			uint		value		= local < tile_count ? srcValues[ tile_start + local ] : 0;
+
+			// stable sort by digit, 1 bit per iteration
+			[[unroll]] for (uint b = 0; b < RADIX_BITS; ++b)
+			{
+				const uint	bit		= (key >> (pc.shift + b)) & 1;
+				const uint	zeros	= WorkgroupInclusiveScan( 1 - bit ) - (1 - bit);
+				const uint	dst		= bit == 0 ? zeros : WorkgroupScanTotal() + (local - zeros);
+
+				s_Keys[dst]		= key;
+				s_Values[dst]	= value;
+				memoryBarrierShared();
+				barrier();
+
+				key		= s_Keys[local];
+				value	= s_Values[local];
+			}
+
+			const uint	digit	= Digit( key );
+			const bool	first	= local == 0 or Digit( s_Keys[local-1] ) != digit;
+			const bool	last	= local+1 == tile_count or (local+1 < TILE_SIZE and Digit( s_Keys[local+1] ) != digit);
+
+			if ( first )
+				s_DigitStart[digit] = local;
+
+			memoryBarrierShared();
+			barrier();
+
+			const uint	rank = local - s_DigitStart[digit];
+
+			if ( local < tile_count )
+			{
+				dstKeys[ s_Offset[digit] + rank ]	= key;
+				dstValues[ s_Offset[digit] + rank ]	= value;
+			}
+			memoryBarrierShared();
+			barrier();
+
+			// one invocation per digit updates offset for the next tile
+			if ( local < tile_count and last )
+				s_Offset[digit] += rank + 1;
+
+			memoryBarrierShared();
+			barrier();
+		}
+	}
+
+#else
+#	error unknown RADIX_PASS
+#endif
@@ -9,20 +9,117 @@ layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
 
 #include "simulation_shared.glsl"
 
+#ifdef PACKED_PARTICLES
 layout(set=0, binding=0, std430) buffer ParticleSSB
+{
+	PackedParticle	particles[];
+};
+
+#elif defined(PARTICLE_LIFECYCLE)
+layout(set=0, binding=0, std430) readonly buffer ParticleSSB
 {
 	Particle	particles[];
 };
 
+layout(set=0, binding=2, std430) writeonly buffer DstParticleSSB
+{
+	Particle	dstParticles[];
+};
+
+layout(set=0, binding=3, std430) buffer ParticleCounterSSB
+{
+	ParticleCounters	counters;
+};
+
+#else
+layout(set=0, binding=0, std430) buffer ParticleSSB
+{
+	Particle	particles[];
+};
+#endif
+
 layout(set=0, binding=1, std140) uniform ParticleUB
 {
 	uint		steps;
 	float		timeDelta;
 	float		globalTime;
+	uint		emitCount;		// lifecycle only
+	float		maxLifetime;	// lifecycle only
+	uint		srcIndex;		// lifecycle only, index of source buffer in 'aliveCount'
+	uint		maxParticles;
 } ub;
 
+#ifdef SPATIAL_HASH
+layout(set=0, binding=4, std140) uniform SpatialHashUB
+{
+	float		cellSize;
+	float		invCellSize;
+	uint		cellCount;
+	uint		particleCount;
+} grid;
+
+layout(set=0, binding=5, std430) readonly buffer CellStartSSB
+{
+	uint		cellStart[];
+};
+
+layout(set=0, binding=6, std430) readonly buffer SortedParticleSSB
+{
+	SortedParticle	sortedParticles[];
+};
+
+float  SpatialHash_CellSize ()
+{
+	return grid.cellSize;
+}
+
+uint  SpatialHash_FindNeighbourCells (const float3 position, out uint cells[SPATIAL_HASH_NEIGHBOUR_CELLS])
+{
+	return SpatialHash_NeighbourCells( position, grid.invCellSize, grid.cellCount, OUT cells );
+}
+
+uint2  SpatialHash_CellRange (const uint cell)
+{
+	return uint2( cellStart[cell], cellStart[cell+1] );
+}
+
+SortedParticle  SpatialHash_GetParticle (const uint index)
+{
+	return sortedParticles[index];
+}
+#endif
+
 
 void main ()
 {
+#ifdef PACKED_PARTICLES
+	const int	index	= GetGlobalIndex();
+	Particle	particle;
+
+	UnpackParticle( particles[index], OUT particle );
+	UpdateParticle( INOUT particle, ub.timeDelta, ub.steps, ub.globalTime );
+	particles[index] = PackParticle( particle );
+
+#elif defined(PARTICLE_LIFECYCLE)
+	const uint	index = GetGlobalIndex();
+
+	// number of invocations is rounded up to the workgroup size
+	if ( index >= counters.aliveCount[ub.srcIndex] )
+		return;
+
+	Particle	particle = particles[index];
+
+	UpdateParticle( INOUT particle, ub.timeDelta, ub.steps, ub.globalTime );
+	particle.param.w += ub.timeDelta * ub.steps;	// age
+
+	// stream compaction, destination buffer has enough space for all source particles
+	if ( IsAliveParticle( particle ) and particle.param.w < ub.maxLifetime )
+	{
+		const uint	slot = atomicAdd( counters.aliveCount[1 - ub.srcIndex], 1 );
+		dstParticles[slot] = particle;
+	}
+
+#else
 	UpdateParticle( INOUT particles[GetGlobalIndex()], ub.timeDelta, ub.steps, ub.globalTime );
+#endif
 }
@@ -5,6 +5,7 @@
 #include "AABB.glsl"
 #include "GlobalIndex.glsl"
 #include "Color.glsl"
+#include "spatial_hash_shared.glsl"
 
 
 //-----------------------------------------------------------------------------
@@ -42,8 +43,14 @@ struct Emitter
 };
 
 void  InitParticle (out Particle particle, const float globalTime);
+void  RestartParticle (out Particle particle, const float globalTime);
 void  UpdateParticle (inout Particle outParticle, const float stepTime, const uint steps, const float globalTime);
 
+// palette for packed particles, color in palette must be the same as 'particle.color' in 'UpdateParticle'
+const uint  ParticlePaletteSize = 256;
+uint  ParticlePaletteIndex (const float3 velocity);
+uint  ParticlePaletteColor (const uint index);
+
 
 //-----------------------------------------------------------------------------
 // Utils
@@ -82,6 +89,29 @@ void  UniformlyAcceleratedMotion (inout float3 pos, inout float3 vel, const floa
 }
 
 
+// restarts particle, in lifecycle mode particle is killed instead and 'true' is returned
+bool  KillParticle (inout Particle particle, const float globalTime)
+{
+#ifdef PARTICLE_LIFECYCLE
+	particle.size = 0.0;
+	return true;
+#else
+	RestartParticle( OUT particle, globalTime );
+	return false;
+#endif
+}
+
+
+bool  IsAliveParticle (const Particle particle)
+{
+	return particle.size > 0.0;
+}
+
+
+// order preserving conversion for sorting
+uint   FloatToOrderedUint (const float x)	{ const uint u = floatBitsToUint( x );  return (u & 0x80000000u) != 0 ? ~u : (u | 0x80000000u); }
+
+
 uint  ParticleColor_FromNormalizedVelocity (const float3 velocity)
 {
 	return packUnorm4x8( float4( ToUNorm( Normalize( velocity )), 1.0 ));
@@ -101,6 +131,38 @@ uint  ParticleColor_FromVelocityLength (const float3 velocity)
 }
 
 
+// direction in octahedral encoding with 16x16 cells
+uint  ParticlePaletteIndex_FromNormalizedVelocity (const float3 velocity)
+{
+	const float3	n = velocity / (Abs( velocity.x ) + Abs( velocity.y ) + Abs( velocity.z ));
+	const float2	e = n.z >= 0.0 ? n.xy : (1.0 - Abs( n.yx )) * float2( Sign( n.x ), Sign( n.y ));
+	const uint2		i = Min( uint2(ToUNorm( e ) * 15.0 + 0.5), uint2(15) );
+	return i.x | (i.y << 4);
+}
+
+uint  ParticlePalette_FromNormalizedVelocity (const uint index)
+{
+	const float2	e = ToSNorm( float2( index & 15, index >> 4 ) / 15.0 );
+	float3			n = float3( e, 1.0 - Abs( e.x ) - Abs( e.y ));
+
+	if ( n.z < 0.0 )
+		n.xy = (1.0 - Abs( n.yx )) * float2( Sign( n.x ), Sign( n.y ));
+
+	return ParticleColor_FromNormalizedVelocity( n );
+}
+
+
+uint  ParticlePaletteIndex_FromVelocityLength (const float3 velocity)
+{
+	return uint( (1.0 - Clamp( Length( velocity ), 0.0, 1.0 )) * 255.0 + 0.5 );
+}
+
+uint  ParticlePalette_FromVelocityLength (const uint index)
+{
+	return packUnorm4x8( float4( HSVtoRGB( float3( float(index) / 255.0, 1.0, 1.0 )), 1.0 ));
+}
+
+
 float3  ParticleEmitter_Plane (const float pointIndex, const float pointsCount)
 {
 	const float side = Sqrt( pointsCount );
@@ -183,6 +245,10 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 	}
 
 
+	uint  ParticlePaletteIndex (const float3 velocity)	{ return ParticlePaletteIndex_FromVelocityLength( velocity ); }
+	uint  ParticlePaletteColor (const uint index)		{ return ParticlePalette_FromVelocityLength( index ); }
+
+
 	void  UpdateParticle (inout Particle outParticle, const float stepTime, const uint steps, const float globalTime)
 	{
 		for (uint t = 0; t < steps; ++t)
@@ -208,7 +274,8 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 
 			if ( not AABB_IsInside( g_BoundingBox, outParticle.position ) or destroyed > 0 )
 			{
-				RestartParticle( outParticle, globalTime );
+				if ( KillParticle( INOUT outParticle, globalTime ))
+					break;
 			}
 		}
 
@@ -250,6 +317,10 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 	}
 
 	
+	uint  ParticlePaletteIndex (const float3 velocity)	{ return ParticlePaletteIndex_FromVelocityLength( velocity ); }
+	uint  ParticlePaletteColor (const uint index)		{ return ParticlePalette_FromVelocityLength( index ); }
+
+
 	void  UpdateParticle (inout Particle outParticle, const float stepTime, const uint steps, const float globalTime)
 	{
 		for (uint t = 0; t < steps; ++t)
@@ -273,7 +344,8 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 
 			if ( not AABB_IsInside( g_BoundingBox, outParticle.position ) or destroyed > 0 )
 			{
-				RestartParticle( outParticle, globalTime );
+				if ( KillParticle( INOUT outParticle, globalTime ))
+					break;
 			}
 		}
 
@@ -317,6 +389,10 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 	}
 
 	
+	uint  ParticlePaletteIndex (const float3 velocity)	{ return ParticlePaletteIndex_FromNormalizedVelocity( velocity ); }
+	uint  ParticlePaletteColor (const uint index)		{ return ParticlePalette_FromNormalizedVelocity( index ); }
+
+
 	void  UpdateParticle (inout Particle outParticle, const float stepTime, const uint steps, const float globalTime)
 	{
 		for (uint t = 0; t < steps; ++t)
@@ -342,7 +418,8 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 
 			if ( not AABB_IsInside( g_BoundingBox, outParticle.position ) or destroyed > 0 )
 			{
-				RestartParticle( outParticle, globalTime );
+				if ( KillParticle( INOUT outParticle, globalTime ))
+					break;
 			}
 		}
 
@@ -384,6 +461,10 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 	}
 
 	
+	uint  ParticlePaletteIndex (const float3 velocity)	{ return ParticlePaletteIndex_FromNormalizedVelocity( velocity ); }
+	uint  ParticlePaletteColor (const uint index)		{ return ParticlePalette_FromNormalizedVelocity( index ); }
+
+
 	void  UpdateParticle (inout Particle outParticle, const float stepTime, const uint steps, const float globalTime)
 	{
 		for (uint t = 0; t < steps; ++t)
@@ -402,7 +483,120 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 
 			if ( not AABB_IsInside( g_BoundingBox, outParticle.position ))
 			{
-				RestartParticle( outParticle, globalTime );
+				if ( KillParticle( INOUT outParticle, globalTime ))
+					break;
+			}
+		}
+
+		outParticle.color = ParticleColor_FromNormalizedVelocity( outParticle.velocity );
+	}
+
+#endif
+//-----------------------------------------------------------------------------
+
+
+#if MODE == 6
+	// boids, particles interact with neighbours that are found using spatial hash
+
+#	ifndef SPATIAL_HASH
+#		error mode 6 requires spatial hash
+#	endif
+
+	const AABB				g_BoundingBox		= { float3(-10.0), float3(10.0) };
+	const uint				g_MaxNeighbours		= 32;		// limits cost in dense regions
+	const float				g_Separation		= 0.002;
+	const float				g_Alignment			= 1.0;
+	const float				g_Cohesion			= 0.5;
+	const float				g_CenterAttraction	= 0.05;
+	const float2			g_SpeedRange		= float2( 0.1, 0.5 );
+
+
+	void  RestartParticle (out Particle particle, const float globalTime)
+	{
+		float	index	= float(GetGlobalIndex());
+		float	size	= float(GetGlobalIndexSize());
+		float	rnd		= DHash12(float2( index / size, globalTime + 2.28374 ));
+		float3	pos		= ParticleEmitter_Sphere( rnd * size, size ) * (0.5 + 1.5 * DHash12(float2( globalTime, index / size )));
+
+		particle.position	= pos;
+		particle.size		= 8.0;
+		particle.color		= 0xFFFFFFFF;
+		particle.velocity	= Normalize( Cross( pos, float3( 0.0, 0.0, 1.0 )) + float3( 0.0, 0.0, 0.01 )) * g_SpeedRange.x;
+		particle.param.x	= 1.0;
+	}
+
+	
+	void  InitParticle (out Particle particle, const float globalTime)
+	{
+		RestartParticle( particle, DHash11( globalTime + GetGlobalIndexUNorm() * 1.6543324 ));
+	}
+
+	
+	uint  ParticlePaletteIndex (const float3 velocity)	{ return ParticlePaletteIndex_FromNormalizedVelocity( velocity ); }
+	uint  ParticlePaletteColor (const uint index)		{ return ParticlePalette_FromNormalizedVelocity( index ); }
+
+
+	// separation, alignment and cohesion
+	float3  NeighbourAccel (const float3 position, const float3 velocity)
+	{
+		uint			cells[SPATIAL_HASH_NEIGHBOUR_CELLS];
+		const uint		cell_count	= SpatialHash_FindNeighbourCells( position, OUT cells );
+		const float		radius_sq	= Square( SpatialHash_CellSize() );
+		float3			separation	= float3( 0.0 );
+		float3			avg_pos		= float3( 0.0 );
+		float3			avg_vel		= float3( 0.0 );
+		uint			count		= 0;
+
+		for (uint c = 0; c < cell_count and count < g_MaxNeighbours; ++c)
+		{
+			const uint2	range = SpatialHash_CellRange( cells[c] );
+
+			for (uint i = range.x; i < range.y and count < g_MaxNeighbours; ++i)
+			{
+				const SortedParticle	other	= SpatialHash_GetParticle( i );
+				const float3			dir		= position - other.position.xyz;
+				const float				dist_sq	= Dot( dir, dir );
+
+				// skip self and particles outside of radius
+				if ( dist_sq >= radius_sq or dist_sq < 1.0e-12 )
+					continue;
+
+				separation	+= dir / dist_sq;
+				avg_pos		+= other.position.xyz;
+				avg_vel		+= other.velocity.xyz;
+				++count;
+			}
+		}
+
+		if ( count == 0 )
+			return float3( 0.0 );
+
+		const float	inv_count = 1.0 / float(count);
+		return	separation * g_Separation +
+				(avg_vel * inv_count - velocity) * g_Alignment +
+				(avg_pos * inv_count - position) * g_Cohesion;
+	}
+
+
+	void  UpdateParticle (inout Particle outParticle, const float stepTime, const uint steps, const float globalTime)
+	{
+		// neighbours are read from sorted copy that is updated once per frame,
+		// so interaction is constant during all steps
+		const float3	interaction = NeighbourAccel( outParticle.position, outParticle.velocity );
+
+		for (uint t = 0; t < steps; ++t)
+		{
+			const float3	accel = interaction - outParticle.position * g_CenterAttraction;
+			
+			UniformlyAcceleratedMotion( INOUT outParticle.position, INOUT outParticle.velocity, accel, stepTime );
+
+			const float		speed = Length( outParticle.velocity );
+			outParticle.velocity *= Clamp( speed, g_SpeedRange.x, g_SpeedRange.y ) / Max( speed, 1.0e-6 );
+
+			if ( not AABB_IsInside( g_BoundingBox, outParticle.position ))
+			{
+				if ( KillParticle( INOUT outParticle, globalTime ))
+					break;
 			}
 		}
 
@@ -411,3 +605,78 @@ float3  ParticleEmitter_ConeVector (const float pointIndex, const float pointsCo
 
 #endif
 //-----------------------------------------------------------------------------
+
+
+#ifdef PARTICLE_LIFECYCLE
+//-----------------------------------------------------------------------------
+// Particle lifecycle
+//
+// Alive particles are stored without gaps in one of two buffers.
+// Update reads particles from the source buffer and appends particles that are still alive
+// to the destination buffer, then emitter appends new particles to the destination buffer.
+// In the next frame buffers are swapped.
+
+#ifdef PACKED_PARTICLES
+#	error lifecycle supports only float particles
+#endif
+
+// same layout as 'ParticlesApp::ParticleCounters'
+struct ParticleCounters
+{
+	uint	drawArgs[4];		// 'VkDrawIndirectCommand' for destination buffer
+	uint	dispatchArgs[3];	// 'VkDispatchIndirectCommand' to update destination buffer in the next frame
+	uint	_padding;
+	uint	aliveCount[2];		// per buffer, may be greater than buffer size while particles are appended
+};
+
+#endif	// PARTICLE_LIFECYCLE
+//-----------------------------------------------------------------------------
+
+
+#ifdef PACKED_PARTICLES
+//-----------------------------------------------------------------------------
+// Packed particles
+//
+// 32 bytes instead of 48 bytes:
+//	position and 'param.y' (absolute time in mode 3) have full precision, because motion per frame
+//	and time delta may be less than half precision of the absolute value,
+//	size, velocity and other params have half precision, color is replaced by index in palette.
+// Must be synchronized with 'ParticleSimulator::Pack' and 'ParticleSimulator::Unpack'.
+
+struct PackedParticle
+{
+	float3		position;
+	uint		sizeVelocity;	// half size, half 'velocity.x'
+	uint		velocity;		// half 'velocity.yz'
+	uint		colorParam;		// 16 bit palette index, half 'param.x'
+	float		paramY;
+	uint		paramZW;		// half 'param.zw'
+};
+
+
+void  UnpackParticle (const PackedParticle packed, out Particle particle)
+{
+	const float2	size_vel = unpackHalf2x16( packed.sizeVelocity );
+
+	particle.position	= packed.position;
+	particle.size		= size_vel.x;
+	particle.velocity	= float3( size_vel.y, unpackHalf2x16( packed.velocity ));
+	particle.color		= ParticlePaletteColor( packed.colorParam & 0xFFFF );
+	particle.param		= float4( unpackHalf2x16( packed.colorParam ).y, packed.paramY, unpackHalf2x16( packed.paramZW ));
+}
+
+
+PackedParticle  PackParticle (const Particle particle)
+{
+	PackedParticle	packed;
+	packed.position		= particle.position;
+	packed.sizeVelocity	= packHalf2x16( float2( particle.size, particle.velocity.x ));
+	packed.velocity		= packHalf2x16( particle.velocity.yz );
+	packed.colorParam	= ParticlePaletteIndex( particle.velocity ) | (packHalf2x16( float2( 0.0, particle.param.x )) & 0xFFFF0000);
+	packed.paramY		= particle.param.y;
+	packed.paramZW		= packHalf2x16( particle.param.zw );
+	return packed;
+}
+
+#endif	// PACKED_PARTICLES
+//-----------------------------------------------------------------------------
@@ -0,0 +1,91 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Exclusive prefix sum of particle count per cell in 3 passes:
+		SCAN_PASS 0 - scan inside each workgroup, total count of workgroup is written to 'blockSums',
+		SCAN_PASS 1 - single workgroup scans 'blockSums', each invocation processes sequential range of blocks,
+		SCAN_PASS 2 - adds offset of block to each cell and clears counters for the next frame.
+	'cellCount' must be a multiple of 'SPATIAL_HASH_LOCAL_SIZE'.
+*/
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : require
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (local_size_x = SPATIAL_HASH_LOCAL_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+#include "Math.glsl"
+
+#define WORKGROUP_SCAN_SIZE		SPATIAL_HASH_LOCAL_SIZE
+#include "workgroup_scan.glsl"
+
+layout(set=0, binding=0, std430) buffer CellCountSSB
+{
+	uint		cellCounts[];
+};
+
+layout(set=0, binding=1, std430) buffer CellStartSSB
+{
+	uint		cellStart[];	// 'cellCount + 1' elements
+};
+
+layout(set=0, binding=2, std430) buffer BlockSumSSB
+{
+	uint		blockSums[];	// 'cellCount / SPATIAL_HASH_LOCAL_SIZE' elements
+};
+
+layout(set=0, binding=3, std140) uniform SpatialHashUB
+{
+	float		cellSize;
+	float		invCellSize;
+	uint		cellCount;
+	uint		particleCount;
+} grid;
+
+
+void main ()
+{
+#if SCAN_PASS == 0
+	const uint	index	= gl_GlobalInvocationID.x;
+	const uint	count	= cellCounts[index];
+	const uint	sum		= WorkgroupInclusiveScan( count );
+
+	cellStart[index] = sum - count;
+
+	if ( gl_LocalInvocationIndex == SPATIAL_HASH_LOCAL_SIZE-1 )
+		blockSums[gl_WorkGroupID.x] = sum;
+
+#elif SCAN_PASS == 1
+	const uint	block_count	= grid.cellCount / SPATIAL_HASH_LOCAL_SIZE;
+	const uint	range		= (block_count + SPATIAL_HASH_LOCAL_SIZE-1) / SPATIAL_HASH_LOCAL_SIZE;
+	const uint	first		= Min( gl_LocalInvocationIndex * range, block_count );
+	const uint	last		= Min( first + range, block_count );
+	uint		count		= 0;
+
+	for (uint i = first; i < last; ++i) {
+		count += blockSums[i];
+	}
+
+	const uint	sum		= WorkgroupInclusiveScan( count );
+	uint		offset	= sum - count;
+
+	for (uint i = first; i < last; ++i)
+	{
+		const uint	n = blockSums[i];
+		blockSums[i] = offset;
+		offset += n;
+	}
+
+	if ( gl_LocalInvocationIndex == SPATIAL_HASH_LOCAL_SIZE-1 )
+		cellStart[grid.cellCount] = sum;
+
+#elif SCAN_PASS == 2
+	const uint	index = gl_GlobalInvocationID.x;
+
+	cellStart[index]	+= blockSums[gl_WorkGroupID.x];
+	cellCounts[index]	 = 0;
+
+#else
+#	error unknown SCAN_PASS
+#endif
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : require
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
+
+#include "simulation_shared.glsl"
+
+layout(set=0, binding=0, std430) readonly buffer ParticleSSB
+{
+	Particle	particles[];
+};
+
+layout(set=0, binding=1, std140) uniform SpatialHashUB
+{
+	float		cellSize;
+	float		invCellSize;
+	uint		cellCount;
+	uint		particleCount;
+} grid;
+
+layout(set=0, binding=2, std430) readonly buffer ParticleCellSSB
+{
+	uint2		particleCells[];
+};
+
+layout(set=0, binding=3, std430) readonly buffer CellStartSSB
+{
+	uint		cellStart[];
+};
+
+layout(set=0, binding=4, std430) writeonly buffer SortedParticleSSB
+{
+	SortedParticle	sortedParticles[];
+};
+
+
+// see 'spatial_hash_shared.glsl'
+void main ()
+{
+	const uint	index = GetGlobalIndex();
+
+	if ( index >= grid.particleCount )
+		return;
+
+	const uint2		cell		= particleCells[index];
+	const Particle	particle	= particles[index];
+
+	sortedParticles[ cellStart[cell.x] + cell.y ] = SortedParticle( float4( particle.position, uintBitsToFloat( index )),
+																	 float4( particle.velocity, 0.0 ));
+}
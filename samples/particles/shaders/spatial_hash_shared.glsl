@@ -0,0 +1,74 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Spatial hash for particle-particle interactions.
+
+	Particles are sorted by cell using counting sort:
+		'spatial_hash_count.glsl'	- counts particles per cell and remembers rank of particle in cell,
+		'spatial_hash_scan.glsl'	- exclusive prefix sum of counts gives the first particle in each cell,
+		'spatial_hash_scatter.glsl'	- copies particles to sorted buffer.
+	Infinite uniform grid is mapped to 'cellCount' cells by hash of cell coordinates.
+	Must be synchronized with 'SpatialHash' class.
+*/
+
+#include "Math.glsl"
+
+// hash stages read float particles and use '_numParticles' as particle count
+#if defined(SPATIAL_HASH) && (defined(PACKED_PARTICLES) || defined(PARTICLE_LIFECYCLE))
+#	error spatial hash is not supported for packed particles and in lifecycle mode
+#endif
+
+#define SPATIAL_HASH_NEIGHBOUR_CELLS	27
+
+// copy of particle in sorted buffer, neighbours are read from this buffer
+// so particles can be updated in-place without data races
+struct SortedParticle
+{
+	float4		position;	// 'w' - index of particle as uint bits
+	float4		velocity;
+};
+
+
+int3  SpatialHash_CellCoord (const float3 position, const float invCellSize)
+{
+	return int3(Floor( position * invCellSize ));
+}
+
+
+// 'cellCount' must be a power of 2
+uint  SpatialHash_CellIndex (const int3 coord, const uint cellCount)
+{
+	const uint3	c = uint3(coord);
+	return ((c.x * 73856093u) ^ (c.y * 19349663u) ^ (c.z * 83492791u)) & (cellCount - 1);
+}
+
+
+// returns number of unique cells around 'position', neighbour cells may have the same hash
+uint  SpatialHash_NeighbourCells (const float3 position, const float invCellSize, const uint cellCount,
+								  out uint cells[SPATIAL_HASH_NEIGHBOUR_CELLS])
+{
+	const int3	center	= SpatialHash_CellCoord( position, invCellSize );
+	uint		count	= 0;
+
+	for (int z = -1; z <= 1; ++z)
+	for (int y = -1; y <= 1; ++y)
+	for (int x = -1; x <= 1; ++x)
+	{
+		const uint	cell	= SpatialHash_CellIndex( center + int3(x, y, z), cellCount );
+		bool		unique	= true;
+
+		for (uint i = 0; i < count; ++i) {
+			unique = unique and (cells[i] != cell);
+		}
+
+		if ( unique )
+			cells[count++] = cell;
+	}
+	return count;
+}
+
+
+// access to spatial hash for modes with particle interaction, implemented in 'simulation.glsl'
+float			SpatialHash_CellSize ();
+uint			SpatialHash_FindNeighbourCells (const float3 position, out uint cells[SPATIAL_HASH_NEIGHBOUR_CELLS]);
+uint2			SpatialHash_CellRange (const uint cell);
+SortedParticle	SpatialHash_GetParticle (const uint index);
@@ -0,0 +1,52 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : require
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+#include "simulation_shared.glsl"
+
+layout(set=0, binding=0, std430) buffer ParticleCounterSSB
+{
+	ParticleCounters	counters;
+};
+
+layout(set=0, binding=1, std140) uniform ParticleUB
+{
+	uint		steps;
+	float		timeDelta;
+	float		globalTime;
+	uint		emitCount;
+	float		maxLifetime;
+	uint		srcIndex;
+	uint		maxParticles;
+} ub;
+
+
+// updates arguments for indirect draw and dispatch, see 'Particle lifecycle' in 'simulation_shared.glsl'
+void main ()
+{
+	const uint	dst		= 1 - ub.srcIndex;
+	const uint	count	= Min( counters.aliveCount[dst], ub.maxParticles );
+
+	counters.aliveCount[dst]			= count;
+	counters.aliveCount[ub.srcIndex]	= 0;	// destination buffer in the next frame
+
+#ifdef VERTEX_PULLING
+	// particle is an instance of quad
+	counters.drawArgs[0]		= 4;		// vertexCount
+	counters.drawArgs[1]		= count;	// instanceCount
+#else
+	counters.drawArgs[0]		= count;	// vertexCount
+	counters.drawArgs[1]		= 1;		// instanceCount
+#endif
+	counters.drawArgs[2]		= 0;		// firstVertex
+	counters.drawArgs[3]		= 0;		// firstInstance
+
+	counters.dispatchArgs[0]	= (count + UPDATE_LOCAL_SIZE - 1) / UPDATE_LOCAL_SIZE;
+	counters.dispatchArgs[1]	= 1;
+	counters.dispatchArgs[2]	= 1;
+}
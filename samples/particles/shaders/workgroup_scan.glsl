@@ -0,0 +1,40 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Prefix sum in shared memory.
+	'WORKGROUP_SCAN_SIZE' must be equal to the number of invocations in workgroup,
+	functions must be called in uniform control flow.
+*/
+
+shared uint  s_Scan[WORKGROUP_SCAN_SIZE];
+
+
+// Hillis-Steele scan, can be called multiple times
+uint  WorkgroupInclusiveScan (const uint value)
+{
+	const uint	local = gl_LocalInvocationIndex;
+
+	// previous results may be still in use
+	barrier();
+
+	s_Scan[local] = value;
+	memoryBarrierShared();
+	barrier();
+
+	[[unroll]] for (uint offset = 1; offset < WORKGROUP_SCAN_SIZE; offset <<= 1)
+	{
+		const uint	prev = (local >= offset ? s_Scan[local - offset] : 0);
+		barrier();
+
+		s_Scan[local] += prev;
+		memoryBarrierShared();
+		barrier();
+	}
+	return s_Scan[local];
+}
+
+
+// sum of all values in the last scan
+uint  WorkgroupScanTotal ()
+{
+	return s_Scan[WORKGROUP_SCAN_SIZE-1];
+}
@@ -13,12 +13,109 @@ namespace {
 	static constexpr uint	Lod			= 9;
 	static constexpr uint	FaceSize	= 2048;
 	static constexpr float	TessLevel	= 12.0f;
+	static constexpr float	Radius		= 10.0f;
+	static constexpr float	MaxHeight	= PlanetTerrain::MaxHeight;	// relative to radius, see 'gen_height.glsl'
+	static constexpr float	MinCameraHeight	= 0.01f;	// relative to radius, above the terrain
+
+	// if enabled then planet is drawn by chunks of the quad tree with LOD and culling instead of single 'Lod'
+	static constexpr bool	UseQuadTree	= true;
+
+	// if enabled then surface maps are generated by pages for visible chunks, memory usage depends only on page cache size
+	static constexpr bool	UseVirtualTexture	= UseQuadTree;
+	static constexpr uint	VirtualFaceSize		= 1u << 14;
+
+	// if enabled then generated maps are stored on disk and reused while shaders, included files and parameters are not changed
+	static constexpr bool	UseMapCache	= true;
+
+	// edited regions of the face maps are regenerated by tiles, see 'PlanetEditor'
+	static constexpr uint	EditTilesPerSide	= 16;
+	static constexpr float	CraterRadius		= 0.02f;	// relative to radius
+	static constexpr float	CraterDepth			= 0.004f;
+
+	static const String		ShaderChunks = (UseQuadTree ? "#define USE_CHUNKS 1\n"s : "#define USE_CHUNKS 0\n"s);
+
+	static const String		ShaderVirtualTexture = (UseVirtualTexture ? "#define USE_VIRTUAL_TEXTURE 1\n"s : "#define USE_VIRTUAL_TEXTURE 0\n"s);
+
+	// 'Tangents' layout enables curved patches when quad tree is disabled
+	static constexpr auto	VertexLayout	= SphericalCube::EVertexLayout::Packed;
+
+	static const String		ShaderVertexLayout = (VertexLayout == SphericalCube::EVertexLayout::Packed ? "#define PACKED_VERTICES 1\n"s : "#define PACKED_VERTICES 0\n"s) +
+												 (VertexLayout == SphericalCube::EVertexLayout::Tangents ? "#define TANGENT_VERTICES 1\n"s : "#define TANGENT_VERTICES 0\n"s);
 
 	static const String		ShaderProjection = 
 		IsSameTypes< SphericalCube::Projection_t, IdentitySphericalCube >   ?	"#define PROJECTION  CM_IdentitySC_Forward\n\n"s :
 		IsSameTypes< SphericalCube::Projection_t, OriginCube >				?	"#define PROJECTION  CM_IdentitySC_Forward\n\n"s :
 		IsSameTypes< SphericalCube::Projection_t, TangentialSphericalCube > ?	"#define PROJECTION  CM_TangentialSC_Forward\n\n"s :
+		IsSameTypes< SphericalCube::Projection_t, AdjustedSphericalCube >   ?	"#define PROJECTION  CM_AdjustedSC_Forward\n\n"s :
 																				"unknown projection\n\n"s;
+
+	// push constants for 'gen_height.glsl' and 'gen_color.glsl'
+	struct GenMapPushConst
+	{
+		int2	faceDim;
+		int		face		= 0;
+		int		_padding	= 0;
+		int2	srcOffset;
+		int2	dstOffset;
+		int2	regionDim;
+		int		craterCount	= 0;
+	};
+
+/*
+=================================================
+	UpdateMipmaps
+----
+	same as 'GenerateMipmaps' but only for region of single layer,
+	dimension must be power of 2
+=================================================
+*/
+	void  UpdateMipmaps (const CommandBuffer &cmdbuf, RawImageID image, const ImageDesc &desc, uint layer, const uint2 &offset, const uint2 &dimension)
+	{
+		int2	begin	= int2(offset);
+		int2	end		= int2(offset + dimension);
+
+		for (uint level = 1; level < desc.maxLevel.Get(); ++level)
+		{
+			const int2	src_dim		{ Max( 1, int(desc.dimension.x >> (level-1)) ), Max( 1, int(desc.dimension.y >> (level-1)) )};
+			const int2	dst_dim		{ Max( 1, int(desc.dimension.x >> level) ), Max( 1, int(desc.dimension.y >> level) )};
+			const int2	dst_begin	= begin / 2;
+			const int2	dst_end		= Min( (end + 1) / 2, dst_dim );
+
+			// source region is aligned to destination texels
+			cmdbuf->AddTask( BlitImage{}.From( image ).To( image ).SetFilter( EFilter::Linear )
+										.AddRegion( { MipmapLevel{level-1}, ImageLayer{layer} }, dst_begin * 2, Min( dst_end * 2, src_dim ),
+													{ MipmapLevel{level},   ImageLayer{layer} }, dst_begin, dst_end ));
+			begin	= dst_begin;
+			end		= dst_end;
+		}
+	}
+
+/*
+=================================================
+	ExtractFrustum
+----
+	extracts planes from 'viewProj' with depth in [0, 1] and transforms them to planet space
+	where planet radius is 1, world position is 'position + p * radius', see 'planet.glsl'
+=================================================
+*/
+	ND_ PatchCulling::Frustum_t  ExtractFrustum (const mat4x4 &viewProj, const vec3 &position, float radius)
+	{
+		const auto	row = [&viewProj] (int i) { return vec4{ viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i] }; };
+
+		const vec4	planes[] = {
+			row(3) + row(0),	row(3) - row(0),	// left, right
+			row(3) + row(1),	row(3) - row(1),	// bottom, top
+			row(2),				row(3) - row(2)		// near, far
+		};
+
+		PatchCulling::Frustum_t		result;
+		for (size_t i = 0; i < CountOf(planes); ++i)
+		{
+			const vec3	n = vec3(planes[i]);
+			result[i] = float4{ n.x * radius, n.y * radius, n.z * radius, dot( n, position ) + planes[i].w };
+		}
+		return PatchCulling::NormalizePlanes( result );
+	}
 }
 	
 /*
@@ -31,13 +128,18 @@ namespace {
 		if ( _frameGraph )
 		{
 			_planet.cube.Destroy( _frameGraph );
+			_planet.quadTree.Destroy( _frameGraph );
+			_planet.virtualTexture.Destroy( _frameGraph );
 
 			_frameGraph->ReleaseResource( _planet.pipeline );
 			_frameGraph->ReleaseResource( _planet.heightMap );
 			_frameGraph->ReleaseResource( _planet.normalMap );
 			_frameGraph->ReleaseResource( _planet.albedoMap );
 			_frameGraph->ReleaseResource( _planet.emissionMap );
+			_frameGraph->ReleaseResource( _planet.craterBuffer );
 			_frameGraph->ReleaseResource( _planet.ubuffer );
+			_frameGraph->ReleaseResource( _pageGen.heightPpln );
+			_frameGraph->ReleaseResource( _pageGen.colorPpln );
 			
 			_frameGraph->ReleaseResource( _colorBuffer );
 			_frameGraph->ReleaseResource( _depthBuffer );
@@ -62,6 +164,10 @@ namespace {
 		CHECK_ERR( _InitUI() );
 		CHECK_ERR( _CreateSamplers() );
 
+		// with virtual texture only pinned pages are cached, streamed pages are generated on demand
+		if ( UseMapCache )
+			_cache.reset( new PlanetCache{ _frameGraph, FG_DATA_PATH "_cache" });
+
 		GetFPSCamera().SetPosition({ 0.0f, 0.0f, 20.0f });
 		_SetupCamera( 60_deg, vec2(0.1f, 200.0f) );
 		
@@ -76,13 +182,38 @@ namespace {
 	bool  GenPlanetApp::_CreatePlanet (const CommandBuffer &cmdbuf)
 	{
 		const uint2		face_size { FaceSize };
+		ImageDesc		map_desc;
+		ImageDesc		mipmapped_desc;
 
-		CHECK_ERR( _planet.cube.Create( cmdbuf, Lod, Lod, true ));
+		if ( UseQuadTree ) {
+			CHECK_ERR( _planet.quadTree.Create( cmdbuf ));
+		} else {
+			CHECK_ERR( _planet.cube.Create( cmdbuf, Lod, Lod, true, VertexLayout ));
+		}
+
+		// all pages are invalidated, coarsest mipmap will be generated in '_GeneratePages'
+		if ( UseVirtualTexture )
+		{
+			SphericalCubeVirtualTexture::Settings	settings;
+			settings.faceSize		= VirtualFaceSize;
+			settings.chunkTexels	= float(SphericalCubeQuadTree::GridSize) * TessLevel;
+
+			CHECK_ERR( _planet.virtualTexture.Create( _frameGraph, settings ));
+
+			// mipmaps are separate pages
+			map_desc.SetDimension( _planet.virtualTexture.AtlasDimension() );
+			mipmapped_desc = map_desc;
+		}
+		else
+		{
+			map_desc.SetView( EImage_Cube ).SetDimension( face_size ).SetArrayLayers( 6 );
+			mipmapped_desc = ImageDesc{map_desc}.SetAllMipmaps();
+		}
 
 		// create height map
 		if ( not _planet.heightMap )
 		{
-			_planet.heightMap = _frameGraph->CreateImage( ImageDesc{}.SetView( EImage_Cube ).SetDimension( face_size ).SetArrayLayers( 6 ).SetFormat( EPixelFormat::R16F )
+			_planet.heightMap = _frameGraph->CreateImage( ImageDesc{map_desc}.SetFormat( EPixelFormat::R16F )
 																.SetUsage( EImageUsage::Storage | EImageUsage::Transfer | EImageUsage::Sampled ),
 														  Default, "Planet.HeightMap" );
 			CHECK_ERR( _planet.heightMap );
@@ -91,7 +222,7 @@ namespace {
 		// create normal map
 		if ( not _planet.normalMap )
 		{
-			_planet.normalMap = _frameGraph->CreateImage( ImageDesc{}.SetView( EImage_Cube ).SetDimension( face_size ).SetArrayLayers( 6 ).SetFormat( EPixelFormat::RGBA16F )
+			_planet.normalMap = _frameGraph->CreateImage( ImageDesc{map_desc}.SetFormat( EPixelFormat::RGBA16F )
 																.SetUsage( EImageUsage::Storage | EImageUsage::Transfer | EImageUsage::Sampled ),
 														  Default, "Planet.NormalMap" );
 			CHECK_ERR( _planet.normalMap );
@@ -100,8 +231,8 @@ namespace {
 		// create albedo map
 		if ( not _planet.albedoMap )
 		{
-			_planet.albedoMap = _frameGraph->CreateImage( ImageDesc{}.SetView( EImage_Cube ).SetDimension( face_size ).SetArrayLayers( 6 ).SetFormat( EPixelFormat::RGBA8_UNorm )
-																.SetUsage( EImageUsage::Storage | EImageUsage::Transfer | EImageUsage::Sampled ).SetAllMipmaps(),
+			_planet.albedoMap = _frameGraph->CreateImage( ImageDesc{mipmapped_desc}.SetFormat( EPixelFormat::RGBA8_UNorm )
+																.SetUsage( EImageUsage::Storage | EImageUsage::Transfer | EImageUsage::Sampled ),
 														  Default, "Planet.AlbedoMap" );
 			CHECK_ERR( _planet.albedoMap );
 		}
@@ -109,8 +240,8 @@ namespace {
 		// create material map
 		if ( not _planet.emissionMap )
 		{
-			_planet.emissionMap = _frameGraph->CreateImage( ImageDesc{}.SetView( EImage_Cube ).SetDimension( face_size ).SetArrayLayers( 6 ).SetFormat( EPixelFormat::RG16F )
-																.SetUsage( EImageUsage::Storage | EImageUsage::Transfer | EImageUsage::Sampled ).SetAllMipmaps(),
+			_planet.emissionMap = _frameGraph->CreateImage( ImageDesc{mipmapped_desc}.SetFormat( EPixelFormat::RG16F )
+																.SetUsage( EImageUsage::Storage | EImageUsage::Transfer | EImageUsage::Sampled ),
 														    Default, "Planet.EmissionMap" );
 			CHECK_ERR( _planet.emissionMap );
 		}
@@ -123,15 +254,33 @@ namespace {
 			CHECK_ERR( _planet.ubuffer );
 		}
 
+		// create crater buffer
+		if ( not _planet.craterBuffer )
+		{
+			_planet.craterBuffer = _frameGraph->CreateBuffer( BufferDesc{ SizeOf<PlanetEditor::Crater> * PlanetEditor::MaxCraters,
+																		  EBufferUsage::Storage | EBufferUsage::TransferDst },
+															  Default, "Planet.Craters" );
+			CHECK_ERR( _planet.craterBuffer );
+		}
+
+		// all maps will be regenerated
+		_editor.Reset( UseVirtualTexture ? VirtualFaceSize : FaceSize, EditTilesPerSide );
+
+		if ( _editor.GetCraters().size() )
+		{
+			auto	craters = _editor.GetCraters();
+			cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _planet.craterBuffer ).AddData( craters.data(), craters.size(), 0_b ));
+		}
+
 		// create pipeline
 		{
 			const String			shader = _LoadShader( "shaders/planet.glsl" );
 			GraphicsPipelineDesc	ppln;
 
-			ppln.AddShader( EShader::Vertex,		 EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_VERTEX\n#define USE_QUADS 1\n"s + shader );
-			ppln.AddShader( EShader::TessControl,	 EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_TESS_CONTROL\n#define USE_QUADS 1\n"s + shader );
-			ppln.AddShader( EShader::TessEvaluation, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_TESS_EVALUATION\n#define USE_QUADS 1\n"s + shader );
-			ppln.AddShader( EShader::Fragment,		 EShaderLangFormat::VKSL_110 | EShaderLangFormat::EnableTimeMap | EShaderLangFormat::EnableDebugTrace, "main", "#define SHADER SH_FRAGMENT\n#define USE_QUADS 1\n"s + shader );
+			ppln.AddShader( EShader::Vertex,		 EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_VERTEX\n#define USE_QUADS 1\n"s + ShaderVertexLayout + ShaderChunks + ShaderProjection + shader );
+			ppln.AddShader( EShader::TessControl,	 EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_TESS_CONTROL\n#define USE_QUADS 1\n"s + ShaderVertexLayout + ShaderChunks + shader );
+			ppln.AddShader( EShader::TessEvaluation, EShaderLangFormat::VKSL_110, "main", "#define SHADER SH_TESS_EVALUATION\n#define USE_QUADS 1\n"s + ShaderVertexLayout + ShaderChunks + ShaderVirtualTexture + ShaderProjection + shader );
+			ppln.AddShader( EShader::Fragment,		 EShaderLangFormat::VKSL_110 | EShaderLangFormat::EnableTimeMap | EShaderLangFormat::EnableDebugTrace, "main", "#define SHADER SH_FRAGMENT\n#define USE_QUADS 1\n"s + ShaderVirtualTexture + shader );
 
 			GPipelineID	id = _frameGraph->CreatePipeline( ppln );
 			if ( id )
@@ -147,15 +296,80 @@ namespace {
 			CHECK_ERR( _frameGraph->InitPipelineResources( _planet.pipeline, DescriptorSetID{"0"}, OUT _planet.resources ));
 
 			_planet.resources.BindBuffer(  UniformID{"un_PlanetData"},  _planet.ubuffer );
-			_planet.resources.BindTexture( UniformID{"un_HeightMap"},   _planet.heightMap,   _sampler.linear );
-			_planet.resources.BindTexture( UniformID{"un_NormalMap"},   _planet.normalMap,   _sampler.linear );
-			_planet.resources.BindTexture( UniformID{"un_AlbedoMap"},   _planet.albedoMap,   _sampler.anisotropy );
-			_planet.resources.BindTexture( UniformID{"un_EmissionMap"}, _planet.emissionMap, _sampler.anisotropy );
+
+			if ( UseVirtualTexture )
+			{
+				// atlas has no mipmaps, filtering between pages is not supported
+				_planet.resources.BindTexture( UniformID{"un_HeightMap"},   _planet.heightMap,   _sampler.linearClamp );
+				_planet.resources.BindTexture( UniformID{"un_NormalMap"},   _planet.normalMap,   _sampler.linearClamp );
+				_planet.resources.BindTexture( UniformID{"un_AlbedoMap"},   _planet.albedoMap,   _sampler.linearClamp );
+				_planet.resources.BindTexture( UniformID{"un_EmissionMap"}, _planet.emissionMap, _sampler.linearClamp );
+				_planet.resources.BindTexture( UniformID{"un_PageTable"},   _planet.virtualTexture.GetPageTable(), _sampler.linearClamp );
+			}
+			else
+			{
+				_planet.resources.BindTexture( UniformID{"un_HeightMap"},   _planet.heightMap,   _sampler.linear );
+				_planet.resources.BindTexture( UniformID{"un_NormalMap"},   _planet.normalMap,   _sampler.linear );
+				_planet.resources.BindTexture( UniformID{"un_AlbedoMap"},   _planet.albedoMap,   _sampler.anisotropy );
+				_planet.resources.BindTexture( UniformID{"un_EmissionMap"}, _planet.emissionMap, _sampler.anisotropy );
+			}
 		}
 
 		return true;
 	}
 	
+/*
+=================================================
+	_HashIncludes
+----
+	resolves '#include' directives recursively in the same
+	order as 'shaderDirectories' and hashes content of each file once
+=================================================
+*/
+	HashVal  GenPlanetApp::_HashIncludes (StringView source)
+	{
+		static constexpr StringView	directories[]	= { FG_DATA_PATH "../shaderlib/", FG_DATA_PATH "shaders/" };
+		static constexpr StringView	directive		= "#include \"";
+
+		HashSet<String>		visited;
+		Array<String>		pending		{ String{source} };
+		HashVal				result;
+
+		while ( not pending.empty() )
+		{
+			const String	text = std::move( pending.back() );
+			pending.pop_back();
+
+			for (size_t pos = text.find( directive ); pos != String::npos; pos = text.find( directive, pos ))
+			{
+				pos += directive.size();
+
+				const size_t	end = text.find( '"', pos );
+				CHECK_ERR( end != String::npos );
+
+				String	name = text.substr( pos, end - pos );
+				pos = end;
+
+				if ( not visited.insert( name ).second )
+					continue;
+
+				for (auto& dir : directories)
+				{
+					FileRStream		file{ String{dir} << name };
+					String			content;
+
+					if ( file.IsOpen() and file.Read( size_t(file.Size()), OUT content ))
+					{
+						result << HashOf( name ) << HashOf( content );
+						pending.push_back( std::move(content) );
+						break;
+					}
+				}
+			}
+		}
+		return result;
+	}
+
 /*
 =================================================
 	_GenerateHeightMap
@@ -163,17 +377,41 @@ namespace {
 */
 	bool  GenPlanetApp::_GenerateHeightMap (const CommandBuffer &cmdbuf)
 	{
+		const String	source	= ShaderProjection + _LoadShader( "shaders/gen_height.glsl" );
+		const auto		craters	= _editor.GetCraters();
+		
+		_heightMapKey = HashOf( source ) + _HashIncludes( source ) + HashOf( FaceSize ) + HashOf( craters.data(), size_t(craters.size() * sizeof(craters[0])) );
+
 		ComputePipelineDesc	desc;
-		desc.AddShader( EShaderLangFormat::VKSL_110,
-						"main",
-						ShaderProjection + _LoadShader( "shaders/gen_height.glsl" ));
+		desc.AddShader( EShaderLangFormat::VKSL_110, "main", String{source} );
 
 		CPipelineID		gen_height_ppln = _frameGraph->CreatePipeline( desc );
 		if ( not gen_height_ppln )
 			return false;
 
-		PipelineResources	ppln_res;
-		CHECK_ERR( _frameGraph->InitPipelineResources( gen_height_ppln, DescriptorSetID{"0"}, OUT ppln_res ));
+		// pipeline is reused to generate pages or edited tiles
+		_frameGraph->ReleaseResource( _pageGen.heightPpln );
+		_pageGen.heightPpln = std::move(gen_height_ppln);
+
+		auto&	ppln_res = _pageGen.heightRes;
+		CHECK_ERR( _frameGraph->InitPipelineResources( _pageGen.heightPpln, DescriptorSetID{"0"}, OUT ppln_res ));
+
+		ppln_res.BindBuffer( UniformID{"un_CraterBuffer"}, _planet.craterBuffer );
+
+		// pages are generated on demand, see '_GeneratePages'
+		if ( UseVirtualTexture )
+		{
+			ppln_res.BindImage( UniformID{"un_OutHeight"}, _planet.heightMap );
+			ppln_res.BindImage( UniformID{"un_OutNormal"}, _planet.normalMap );
+			return true;
+		}
+
+		if ( _cache												and
+			 _cache->Load( cmdbuf, _planet.heightMap, "height", _heightMapKey )	and
+			 _cache->Load( cmdbuf, _planet.normalMap, "normal", _heightMapKey ))
+		{
+			return true;
+		}
 
 		const uint2		local_size	{8,8};
 		const uint2		face_size	= _frameGraph->GetDescription( _planet.heightMap ).dimension.xy();
@@ -185,18 +423,26 @@ namespace {
 			ppln_res.BindImage( UniformID{"un_OutNormal"}, _planet.normalMap, ImageViewDesc{}.SetArrayLayers( face, 1 ));
 
 			DispatchCompute	comp;
-			const uint3		pc_data{ face_size.x, face_size.y, face };
+			GenMapPushConst	pc_data;
+			pc_data.faceDim		= int2(face_size);
+			pc_data.face		= int(face);
+			pc_data.regionDim	= int2(face_size);
+			pc_data.craterCount	= int(craters.size());
 
 			comp.AddPushConstant( PushConstantID{"PushConst"}, pc_data );
 			comp.AddResources( DescriptorSetID{"0"}, ppln_res );
 			comp.SetLocalSize( local_size );
 			comp.Dispatch( group_count );
-			comp.SetPipeline( gen_height_ppln );
+			comp.SetPipeline( _pageGen.heightPpln );
 
 			cmdbuf->AddTask( comp );
 		}
 
-		_frameGraph->ReleaseResource( gen_height_ppln );
+		if ( _cache )
+		{
+			_cache->Store( cmdbuf, _planet.heightMap, "height", _heightMapKey );
+			_cache->Store( cmdbuf, _planet.normalMap, "normal", _heightMapKey );
+		}
 		return true;
 	}
 	
@@ -207,17 +453,41 @@ namespace {
 */
 	bool  GenPlanetApp::_GenerateColorMap (const CommandBuffer &cmdbuf)
 	{
+		const String	source	= ShaderProjection + _LoadShader( "shaders/gen_color.glsl" );
+
+		// color depends on height map
+		const HashVal	key		= _heightMapKey + HashOf( source ) + _HashIncludes( source );
+		_colorMapKey = key;
+
 		ComputePipelineDesc	desc;
-		desc.AddShader( EShaderLangFormat::VKSL_110,
-						"main",
-						ShaderProjection + _LoadShader( "shaders/gen_color.glsl" ));
+		desc.AddShader( EShaderLangFormat::VKSL_110, "main", String{source} );
 
 		CPipelineID		gen_color_ppln = _frameGraph->CreatePipeline( desc );
 		if ( not gen_color_ppln )
 			return false;
 
-		PipelineResources	ppln_res;
-		CHECK_ERR( _frameGraph->InitPipelineResources( gen_color_ppln, DescriptorSetID{"0"}, OUT ppln_res ));
+		// pipeline is reused to generate pages or edited tiles
+		_frameGraph->ReleaseResource( _pageGen.colorPpln );
+		_pageGen.colorPpln = std::move(gen_color_ppln);
+
+		auto&	ppln_res = _pageGen.colorRes;
+		CHECK_ERR( _frameGraph->InitPipelineResources( _pageGen.colorPpln, DescriptorSetID{"0"}, OUT ppln_res ));
+
+		if ( UseVirtualTexture )
+		{
+			ppln_res.BindImage( UniformID{"un_HeightMap"},   _planet.heightMap );
+			ppln_res.BindImage( UniformID{"un_NormalMap"},   _planet.normalMap );
+			ppln_res.BindImage( UniformID{"un_OutAlbedo"},   _planet.albedoMap );
+			ppln_res.BindImage( UniformID{"un_OutEmission"}, _planet.emissionMap );
+			return true;
+		}
+
+		if ( _cache												and
+			 _cache->Load( cmdbuf, _planet.albedoMap, "albedo", key )		and
+			 _cache->Load( cmdbuf, _planet.emissionMap, "emission", key ))
+		{
+			return true;
+		}
 
 		const uint2		local_size	{8,8};
 		const uint2		face_size	= _frameGraph->GetDescription( _planet.heightMap ).dimension.xy();
@@ -231,13 +501,16 @@ namespace {
 			ppln_res.BindImage( UniformID{"un_OutEmission"}, _planet.emissionMap, ImageViewDesc{}.SetArrayLayers( face, 1 ));
 
 			DispatchCompute	comp;
-			const uint3		pc_data{ face_size.x, face_size.y, face };
+			GenMapPushConst	pc_data;
+			pc_data.faceDim		= int2(face_size);
+			pc_data.face		= int(face);
+			pc_data.regionDim	= int2(face_size);
 
 			comp.AddPushConstant( PushConstantID{"PushConst"}, pc_data );
 			comp.AddResources( DescriptorSetID{"0"}, ppln_res );
 			comp.SetLocalSize( local_size );
 			comp.Dispatch( group_count );
-			comp.SetPipeline( gen_color_ppln );
+			comp.SetPipeline( _pageGen.colorPpln );
 
 			cmdbuf->AddTask( comp );
 		}
@@ -245,10 +518,266 @@ namespace {
 		cmdbuf->AddTask( GenerateMipmaps{}.SetImage( _planet.albedoMap ));
 		cmdbuf->AddTask( GenerateMipmaps{}.SetImage( _planet.emissionMap ));
 
-		_frameGraph->ReleaseResource( gen_color_ppln );
+		if ( _cache )
+		{
+			_cache->Store( cmdbuf, _planet.albedoMap, "albedo", key );
+			_cache->Store( cmdbuf, _planet.emissionMap, "emission", key );
+		}
 		return true;
 	}
 
+/*
+=================================================
+	_GeneratePages
+----
+	generates missing pages for visible chunks, both passes
+	use the same atlas slot, so color pass reads height and normal of the page
+=================================================
+*/
+	void  GenPlanetApp::_GeneratePages (const CommandBuffer &cmdbuf)
+	{
+		// pages can't be generated, don't mark them as resident
+		if ( not (_pageGen.heightPpln and _pageGen.colorPpln) )
+			return;
+
+		auto&	vt = _planet.virtualTexture;
+		vt.Update( _planet.quadTree.GetChunks() );
+
+		const uint2		local_size {8,8};
+
+		// pinned pages are cached until planet is edited, edited pages don't match the key
+		const bool		use_cache	= _cache and _editor.GetCraters().empty();
+		const HashVal	page_key	= HashOf( VirtualFaceSize ) + HashOf( vt.MaxMipmap() ) + HashOf( vt.GetSettings().pageSize ) + HashOf( vt.GetSettings().pageBorder );
+
+		for (auto& page : vt.GetPendingPages())
+		{
+			const uint2		region	{ page.dimension };
+			const bool		pinned	= (page.mip == vt.MaxMipmap());
+			const String	suffix	= "_page"s << ToString( page.face );
+			const int2		offset	= int2(page.dstOffset);
+
+			if ( pinned and use_cache														and
+				 _cache->LoadRegion( cmdbuf, _planet.heightMap,   offset, region, "height"s << suffix,   _heightMapKey + page_key )	and
+				 _cache->LoadRegion( cmdbuf, _planet.normalMap,   offset, region, "normal"s << suffix,   _heightMapKey + page_key )	and
+				 _cache->LoadRegion( cmdbuf, _planet.albedoMap,   offset, region, "albedo"s << suffix,   _colorMapKey + page_key )	and
+				 _cache->LoadRegion( cmdbuf, _planet.emissionMap, offset, region, "emission"s << suffix, _colorMapKey + page_key ))
+			{
+				continue;
+			}
+
+			GenMapPushConst	pc_data;
+			pc_data.faceDim		= int2(page.faceSize);
+			pc_data.face		= int(page.face);
+			pc_data.srcOffset	= page.srcOffset;
+			pc_data.dstOffset	= int2(page.dstOffset);
+			pc_data.regionDim	= int2(region);
+			pc_data.craterCount	= int(_editor.GetCraters().size());
+
+			DispatchCompute	gen_height;
+			gen_height.AddPushConstant( PushConstantID{"PushConst"}, pc_data );
+			gen_height.AddResources( DescriptorSetID{"0"}, _pageGen.heightRes );
+			gen_height.SetLocalSize( local_size );
+			gen_height.Dispatch( (region + local_size - 3) / (local_size - 2) );
+			gen_height.SetPipeline( _pageGen.heightPpln );
+
+			DispatchCompute	gen_color;
+			gen_color.AddPushConstant( PushConstantID{"PushConst"}, pc_data );
+			gen_color.AddResources( DescriptorSetID{"0"}, _pageGen.colorRes );
+			gen_color.SetLocalSize( local_size );
+			gen_color.Dispatch( IntCeil( region, local_size ));
+			gen_color.SetPipeline( _pageGen.colorPpln );
+
+			cmdbuf->AddTask( gen_height );
+			cmdbuf->AddTask( gen_color );
+
+			if ( pinned and use_cache )
+			{
+				_cache->StoreRegion( cmdbuf, _planet.heightMap,   offset, region, "height"s << suffix,   _heightMapKey + page_key );
+				_cache->StoreRegion( cmdbuf, _planet.normalMap,   offset, region, "normal"s << suffix,   _heightMapKey + page_key );
+				_cache->StoreRegion( cmdbuf, _planet.albedoMap,   offset, region, "albedo"s << suffix,   _colorMapKey + page_key );
+				_cache->StoreRegion( cmdbuf, _planet.emissionMap, offset, region, "emission"s << suffix, _colorMapKey + page_key );
+			}
+		}
+
+		vt.Upload( cmdbuf );
+	}
+
+/*
+=================================================
+	_RegenerateTiles
+----
+	only edited tiles are generated and mipmaps are updated
+	only for modified regions, with virtual texture resident
+	pages are regenerated in '_GeneratePages'
+=================================================
+*/
+	void  GenPlanetApp::_RegenerateTiles (const CommandBuffer &cmdbuf)
+	{
+		if ( not (_editor.HasDirtyTiles() and _pageGen.heightPpln and _pageGen.colorPpln) )
+			return;
+
+		_editor.FlushDirtyTiles( OUT _dirtyTiles );
+		_regeneratedTiles = uint(_dirtyTiles.size());
+
+		const auto	craters = _editor.GetCraters();
+		if ( craters.size() )
+			cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _planet.craterBuffer ).AddData( craters.data(), craters.size(), 0_b ));
+
+		if ( UseVirtualTexture )
+		{
+			for (auto& tile : _dirtyTiles) {
+				_planet.virtualTexture.Invalidate( ECubeFace(tile.face), tile.offset, tile.dimension );
+			}
+			return;
+		}
+
+		const uint2			local_size	{8,8};
+		const ImageDesc&	albedo_desc	= _frameGraph->GetDescription( _planet.albedoMap );
+		const ImageDesc&	emission_desc = _frameGraph->GetDescription( _planet.emissionMap );
+
+		for (auto& tile : _dirtyTiles)
+		{
+			GenMapPushConst	pc_data;
+			pc_data.faceDim		= int2(_editor.FaceSize());
+			pc_data.face		= int(tile.face);
+			pc_data.srcOffset	= int2(tile.offset);
+			pc_data.dstOffset	= int2(tile.offset);
+			pc_data.regionDim	= int2(tile.dimension);
+			pc_data.craterCount	= int(craters.size());
+
+			_pageGen.heightRes.BindImage( UniformID{"un_OutHeight"}, _planet.heightMap, ImageViewDesc{}.SetArrayLayers( tile.face, 1 ));
+			_pageGen.heightRes.BindImage( UniformID{"un_OutNormal"}, _planet.normalMap, ImageViewDesc{}.SetArrayLayers( tile.face, 1 ));
+
+			DispatchCompute	gen_height;
+			gen_height.AddPushConstant( PushConstantID{"PushConst"}, pc_data );
+			gen_height.AddResources( DescriptorSetID{"0"}, _pageGen.heightRes );
+			gen_height.SetLocalSize( local_size );
+			gen_height.Dispatch( (tile.dimension + local_size - 3) / (local_size - 2) );
+			gen_height.SetPipeline( _pageGen.heightPpln );
+			cmdbuf->AddTask( gen_height );
+
+			_pageGen.colorRes.BindImage( UniformID{"un_HeightMap"},   _planet.heightMap, ImageViewDesc{}.SetArrayLayers( tile.face, 1 ));
+			_pageGen.colorRes.BindImage( UniformID{"un_NormalMap"},   _planet.normalMap, ImageViewDesc{}.SetArrayLayers( tile.face, 1 ));
+			_pageGen.colorRes.BindImage( UniformID{"un_OutAlbedo"},   _planet.albedoMap, ImageViewDesc{}.SetArrayLayers( tile.face, 1 ));
+			_pageGen.colorRes.BindImage( UniformID{"un_OutEmission"}, _planet.emissionMap, ImageViewDesc{}.SetArrayLayers( tile.face, 1 ));
+
+			DispatchCompute	gen_color;
+			gen_color.AddPushConstant( PushConstantID{"PushConst"}, pc_data );
+			gen_color.AddResources( DescriptorSetID{"0"}, _pageGen.colorRes );
+			gen_color.SetLocalSize( local_size );
+			gen_color.Dispatch( IntCeil( tile.dimension, local_size ));
+			gen_color.SetPipeline( _pageGen.colorPpln );
+			cmdbuf->AddTask( gen_color );
+
+			UpdateMipmaps( cmdbuf, _planet.albedoMap, albedo_desc, tile.face, tile.offset, tile.dimension );
+			UpdateMipmaps( cmdbuf, _planet.emissionMap, emission_desc, tile.face, tile.offset, tile.dimension );
+		}
+	}
+
+/*
+=================================================
+	_AddCrater
+----
+	ray from camera is intersected with surface on CPU,
+	points are transformed to planet space, see 'ExtractFrustum'
+=================================================
+*/
+	void  GenPlanetApp::_AddCrater (const vec2 &mousePos)
+	{
+		const vec2		surf_size	{ float(GetSurfaceSize().x), float(GetSurfaceSize().y) };
+		const vec2		ndc			= mousePos / surf_size * 2.0f - 1.0f;
+		const mat4x4	inv_vp		= glm::inverse( GetCamera().ToViewProjMatrix() );
+		const vec3		position	= GetCamera().transform.position;
+
+		const auto	Unproject = [&] (float depth) {
+			const vec4	p = inv_vp * vec4{ ndc.x, ndc.y, depth, 1.0f };
+			const vec3	w = (vec3(p) / p.w - position) / Radius;
+			return float3{ w.x, w.y, w.z };
+		};
+
+		const auto	craters	= _editor.GetCraters();
+		const auto	height	= [craters] (const float3 &dir) {
+			return PlanetTerrain::AddCraters( dir, PlanetTerrain::Height( dir ), craters );
+		};
+
+		float3	hit;
+		if ( not SphericalCube::RayCastSurface( float3{0.0f}, 1.0f, MaxHeight, height, Unproject( 0.0f ), Unproject( 1.0f ), OUT hit ))
+			return;
+
+		if ( not _editor.AddCrater( hit, CraterRadius, CraterDepth ))
+			FG_LOGI( "Too many craters" );
+	}
+
+/*
+=================================================
+	_ValidateHeightMap
+----
+	compares generated height map with CPU version,
+	only coarsest mipmap is checked if virtual texture is used
+=================================================
+*/
+	void  GenPlanetApp::_ValidateHeightMap (const CommandBuffer &cmdbuf)
+	{
+		using Page = SphericalCubeVirtualTexture::Page;
+
+		for (uint face = 0; face < 6; ++face)
+		{
+			Page	page;
+			uint	layer	= 0;
+
+			if ( UseVirtualTexture )
+				page = _planet.virtualTexture.GetPinnedPage( ECubeFace(face) );
+			else
+			{
+				page.dimension	= _frameGraph->GetDescription( _planet.heightMap ).dimension.x;
+				page.faceSize	= page.dimension;
+				page.face		= face;
+				layer			= face;
+			}
+
+			cmdbuf->AddTask( ReadImage{}.SetImage( _planet.heightMap, int2(page.dstOffset), uint2{page.dimension}, ImageLayer{layer}, MipmapLevel{0} )
+										.SetCallback( [page, craters = Array<PlanetEditor::Crater>{ _editor.GetCraters() }] (const ImageView &view)
+										{
+											static constexpr float	max_error	= 1.0e-4f;
+
+											Array<float>	dir_x;		dir_x.resize( page.dimension );
+											Array<float>	dir_y;		dir_y.resize( page.dimension );
+											Array<float>	dir_z;		dir_z.resize( page.dimension );
+											Array<float>	height;		height.resize( page.dimension );
+											float			err			= 0.0f;
+											size_t			failed		= 0;
+
+											for (uint y = 0; y < page.dimension; ++y)
+											{
+												for (uint x = 0; x < page.dimension; ++x)
+												{
+													// same as in 'gen_height.glsl'
+													const float2	ncoord	= float2(page.srcOffset + int2{int(x), int(y)}) / float(page.faceSize - 1) * 2.0f - 1.0f;
+													const float3	dir		= SphericalCube::ForwardProjection( ncoord, ECubeFace(page.face) );
+
+													dir_x[x] = dir.x;	dir_y[x] = dir.y;	dir_z[x] = dir.z;
+												}
+
+												PlanetTerrain::Height( dir_x.data(), dir_y.data(), dir_z.data(), page.dimension, OUT height.data() );
+
+												for (uint x = 0; x < page.dimension; ++x)
+												{
+													RGBA32f		col;
+													view.Load( uint3{x, y, 0}, OUT col );
+
+													const float3	dir		{ dir_x[x], dir_y[x], dir_z[x] };
+													const float		diff	= Abs( col.r - PlanetTerrain::AddCraters( dir, height[x], craters ));
+													err		 = Max( err, diff );
+													failed	+= size_t(diff > max_error);
+												}
+											}
+
+											FG_LOGI( "Height map face "s << ToString( page.face ) << ": max error " << ToString( err )
+													 << ", texels with error > " << ToString( max_error ) << ": " << ToString( failed ));
+										}));
+		}
+	}
+
 /*
 =================================================
 	DrawScene
@@ -262,12 +791,35 @@ namespace {
 		{
 			_UpdateCamera();
 
+			// keep camera above the terrain, height is calculated on CPU
+			{
+				const vec3	pos		= GetCamera().transform.position;
+				const float	dist	= length( pos ) / Radius;
+
+				if ( dist > 0.0f )
+				{
+					// camera position in planet space is '-pos / Radius'
+					const vec3	dir			= -pos / (dist * Radius);
+					const float3	sdir		{ dir.x, dir.y, dir.z };
+					const float		min_dist	= 1.0f + PlanetTerrain::AddCraters( sdir, PlanetTerrain::Height( sdir ), _editor.GetCraters() ) + MinCameraHeight;
+
+					if ( dist < min_dist )
+						GetFPSCamera().SetPosition( pos * (min_dist / dist) );
+				}
+			}
+
 			planet_data.viewProj		= GetCamera().ToViewProjMatrix();
 			planet_data.position		= vec4{ GetCamera().transform.position, 0.0f };
 			planet_data.clipPlanes		= GetViewRange();
 			planet_data.tessLevel		= TessLevel;
-			planet_data.radius			= 10.0f;
+			planet_data.radius			= Radius;
 			planet_data.lightDirection	= glm::inverse( GetCamera().transform.orientation ) * normalize(vec3( 0.0f, 0.0f, -1.0f ));
+
+			if ( UseVirtualTexture )
+			{
+				const float4	vt_params = _planet.virtualTexture.GetShaderParams();
+				planet_data.virtualTexture = vec4{ vt_params.x, vt_params.y, vt_params.z, vt_params.w };
+			}
 		}
 
 		// generate
@@ -312,6 +864,15 @@ namespace {
 			if ( gen_cmdbuf )
 				cmdbuf->AddDependency( gen_cmdbuf );
 
+			if ( not UseVirtualTexture )
+				_RegenerateTiles( cmdbuf );
+
+			if ( _validateHeightMap )
+			{
+				_validateHeightMap = false;
+				_ValidateHeightMap( cmdbuf );
+			}
+
 			if ( _showTimemap )
 				cmdbuf->BeginShaderTimeMap( surf_dim, EShaderStages::Fragment );
 
@@ -327,8 +888,32 @@ namespace {
 								);
 				CHECK_ERR( pass_id );
 
-				cmdbuf->AddTask( pass_id, _planet.cube.Draw( Lod ).SetPipeline( _planet.pipeline )
-									.AddResources( DescriptorSetID{"0"}, _planet.resources ));
+				if ( UseQuadTree )
+				{
+					SphericalCubeQuadTree::Settings	settings;
+					settings.tessLevel		= TessLevel;
+					settings.viewportHeight	= float(surf_dim.y);
+					settings.fovY			= GetCameraFov();
+					settings.maxHeight		= MaxHeight;
+
+					// planet is drawn relative to camera, see 'planet_data.position'
+					const auto	frustum = ExtractFrustum( planet_data.viewProj, vec3(planet_data.position), Radius );
+
+					_planet.quadTree.Update( -GetCamera().transform.position / Radius, settings, &frustum );
+
+					if ( UseVirtualTexture )
+					{
+						_RegenerateTiles( cmdbuf );
+						_GeneratePages( cmdbuf );
+					}
+
+					if ( _planet.quadTree.GetChunks().size() )
+						cmdbuf->AddTask( pass_id, _planet.quadTree.Draw( cmdbuf ).SetPipeline( _planet.pipeline )
+											.AddResources( DescriptorSetID{"0"}, _planet.resources ));
+				}
+				else
+					cmdbuf->AddTask( pass_id, _planet.cube.Draw( Lod ).SetPipeline( _planet.pipeline )
+										.AddResources( DescriptorSetID{"0"}, _planet.resources ));
 
 				cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _planet.ubuffer ).AddData( &planet_data, 1, 0_b ));
 				cmdbuf->AddTask( SubmitRenderPass{ pass_id });
@@ -366,11 +951,13 @@ namespace {
 
 		if ( action == EKeyAction::Down )
 		{
-			//if ( key == "right mb" )	_AddDecal( GetMousePos(), 0.1f );
+			if ( key == "right mb" )	_AddCrater( GetMousePos() );
+			if ( key == "C" )	_editor.RemoveCraters();
 
 			if ( key == "R" )	_recreatePlanet = true;
 			if ( key == "G" )	_debugPixel = GetMousePos() / vec2(GetSurfaceSize().x, GetSurfaceSize().y);
 			if ( key == "T" )	_showTimemap = not _showTimemap;
+			if ( key == "V" )	_validateHeightMap = true;
 		}
 	}
 	
@@ -383,6 +970,7 @@ namespace {
 	{
 	#ifdef FG_ENABLE_IMGUI
 		ImGui::SliderInt( "Surface scale", INOUT &_sufaceScaleIdx, -2, 1, _SurfaceScaleName( _sufaceScaleIdx ));
+		ImGui::Text( ("Regenerated tiles: "s << ToString( _regeneratedTiles )).c_str() );
 	#endif
 	}
 
@@ -391,6 +979,17 @@ namespace {
 
 // unit tests
 extern void UnitTest_SphericalCubeMath ();
+extern void UnitTest_SphericalCube ();
+extern void UnitTest_SphericalCubeQuadTree ();
+extern void UnitTest_PatchCulling ();
+extern void UnitTest_SphericalCubeVirtualTexture ();
+extern void UnitTest_PlanetTerrain ();
+extern void UnitTest_PlanetEditor ();
+
+// performance tests
+extern void PerfTest_SphericalCube ();
+extern void PerfTest_PatchCulling ();
+extern void PerfTest_PlanetTerrain ();
 
 
 /*
@@ -403,6 +1002,15 @@ int main ()
 	using namespace FG;
 
 	UnitTest_SphericalCubeMath();
+	UnitTest_SphericalCube();
+	UnitTest_SphericalCubeQuadTree();
+	UnitTest_PatchCulling();
+	UnitTest_SphericalCubeVirtualTexture();
+	UnitTest_PlanetTerrain();
+	UnitTest_PlanetEditor();
+	//PerfTest_SphericalCube();
+	//PerfTest_PatchCulling();
+	//PerfTest_PlanetTerrain();
 
 	auto	app = MakeShared<GenPlanetApp>();
 
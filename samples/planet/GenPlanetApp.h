@@ -2,7 +2,10 @@
 
 #pragma once
 
-#include "SphericalCube/SphericalCube.h"
+#include "SphericalCube/SphericalCubeQuadTree.h"
+#include "SphericalCube/SphericalCubeVirtualTexture.h"
+#include "PlanetCache.h"
+#include "PlanetEditor.h"
 #include "BaseSample.h"
 
 namespace FG
@@ -31,6 +34,8 @@ namespace FG
 			float			radius;
 
 			vec3			lightDirection;
+			float			_padding;
+			vec4			virtualTexture;
 
 			//PlanetMaterial	materials [256];
 		};
@@ -43,10 +48,13 @@ namespace FG
 
 		struct {
 			SphericalCube			cube;
-			ImageID					heightMap;
+			SphericalCubeQuadTree	quadTree;
+			SphericalCubeVirtualTexture	virtualTexture;
+			ImageID					heightMap;		// cube map or page atlas if virtual texture is used
 			ImageID					normalMap;
 			ImageID					albedoMap;		// albedo, material id
 			ImageID					emissionMap;	// temperature, emission
+			BufferID				craterBuffer;	// see 'PlanetEditor'
 			BufferID				ubuffer;
 			GPipelineID				pipeline;
 			PipelineResources		resources;
@@ -55,8 +63,24 @@ namespace FG
 		struct {
 		}						_atmosphere;
 
+		struct {
+			CPipelineID				heightPpln;
+			CPipelineID				colorPpln;
+			PipelineResources		heightRes;
+			PipelineResources		colorRes;
+		}						_pageGen;			// see '_GeneratePages', '_RegenerateTiles'
+
+		UniquePtr<PlanetCache>	_cache;				// generated maps and pinned pages, see '_GenerateHeightMap', '_GenerateColorMap', '_GeneratePages'
+		HashVal					_heightMapKey;
+		HashVal					_colorMapKey;
+
+		PlanetEditor			_editor;
+		Array<PlanetEditor::Tile>	_dirtyTiles;	// temporary
+		uint					_regeneratedTiles	= 0;	// in last edit, shown in UI
+
 		bool					_recreatePlanet	= true;
 		bool					_showTimemap	= false;
+		bool					_validateHeightMap	= false;
 		Optional<vec2>			_debugPixel;
 		
 		int						_sufaceScaleIdx		= 0;
@@ -89,8 +113,13 @@ namespace FG
 		bool  _CreatePlanet (const CommandBuffer &);
 		bool  _GenerateHeightMap (const CommandBuffer &);
 		bool  _GenerateColorMap (const CommandBuffer &);
+		void  _GeneratePages (const CommandBuffer &);
+		void  _RegenerateTiles (const CommandBuffer &);
+		void  _AddCrater (const vec2 &mousePos);
+		void  _ValidateHeightMap (const CommandBuffer &);
 		
 		ND_ static String  _LoadShader (NtStringView filename)	{ return BaseSample::_LoadShader( String{FG_DATA_PATH} + filename.c_str()); }
+		ND_ static HashVal _HashIncludes (StringView source);
 	};
 
 }	// FG
@@ -0,0 +1,226 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "PlanetCache.h"
+#include "stl/Algorithms/StringUtils.h"
+#include "stl/Stream/FileStream.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	constructor
+=================================================
+*/
+	PlanetCache::PlanetCache (const FrameGraph &fg, StringView folder) :
+		_frameGraph{ fg }, _folder{ folder }
+	{
+	#ifdef FS_HAS_FILESYSTEM
+		FS::create_directories( FS::path{ _folder });
+	#endif
+	}
+
+/*
+=================================================
+	_GetPath
+=================================================
+*/
+	String  PlanetCache::_GetPath (StringView name) const
+	{
+		return String{_folder} << "/" << name << ".bin";
+	}
+
+/*
+=================================================
+	_MakeHeader
+=================================================
+*/
+	PlanetCache::FileHeader  PlanetCache::_MakeHeader (const ImageDesc &desc, const uint2 &dimension, uint layers, uint mipmaps, HashVal key)
+	{
+		FileHeader	header;
+		header.magic	= Magic;
+		header.version	= Version;
+		header.key		= uint64_t(size_t(key));
+		header.format	= uint(desc.format);
+		header.width	= dimension.x;
+		header.height	= dimension.y;
+		header.layers	= layers;
+		header.mipmaps	= mipmaps;
+		return header;
+	}
+
+/*
+=================================================
+	Load
+=================================================
+*/
+	bool  PlanetCache::Load (const CommandBuffer &cmdbuf, RawImageID image, StringView name, HashVal key) const
+	{
+		const ImageDesc		desc	= _frameGraph->GetDescription( image );
+		const FileHeader	header	= _MakeHeader( desc, desc.dimension.xy(), desc.arrayLayers.Get(), desc.maxLevel.Get(), key );
+		Array<Region>		regions;
+
+		for (uint mip = 0; mip < header.mipmaps; ++mip)
+		for (uint layer = 0; layer < header.layers; ++layer)
+		{
+			regions.push_back({ int2{}, uint2{ Max( header.width >> mip, 1u ), Max( header.height >> mip, 1u )}, layer, mip });
+		}
+		return _Load( cmdbuf, image, name, header, regions );
+	}
+
+/*
+=================================================
+	LoadRegion
+=================================================
+*/
+	bool  PlanetCache::LoadRegion (const CommandBuffer &cmdbuf, RawImageID image, const int2 &offset, const uint2 &dimension, StringView name, HashVal key) const
+	{
+		const Region	region{ offset, dimension, 0, 0 };
+		return _Load( cmdbuf, image, name, _MakeHeader( _frameGraph->GetDescription( image ), dimension, 1, 1, key ), {region} );
+	}
+
+/*
+=================================================
+	_Load
+----
+	levels are read one by one, so only single level is kept in memory.
+	If file is truncated then some levels are already updated,
+	but image will be regenerated anyway.
+=================================================
+*/
+	bool  PlanetCache::_Load (const CommandBuffer &cmdbuf, RawImageID image, StringView name, const FileHeader &expected, ArrayView<Region> regions) const
+	{
+		FileRStream		file{ _GetPath( name )};
+		if ( not file.IsOpen() )
+			return false;
+
+		FileHeader		header;
+
+		if ( not file.Read( &header, BytesU::SizeOf(header) )	or
+			 header.magic	!= expected.magic					or
+			 header.version	!= expected.version					or
+			 header.key		!= expected.key						or
+			 header.format	!= expected.format					or
+			 header.width	!= expected.width					or
+			 header.height	!= expected.height					or
+			 header.layers	!= expected.layers					or
+			 header.mipmaps	!= expected.mipmaps )
+		{
+			FG_LOGI( "Planet cache '"s << name << "' is outdated" );
+			return false;
+		}
+
+		Array<uint8_t>	pixels;
+
+		for (auto& region : regions)
+		{
+			LevelHeader		level;
+
+			CHECK_ERR( file.Read( &level, BytesU::SizeOf(level) ));
+			CHECK_ERR( file.Read( size_t(level.size), OUT pixels ));
+
+			// data is copied to the staging buffer, so 'pixels' can be reused
+			cmdbuf->AddTask( UpdateImage{}.SetImage( image, region.offset, ImageLayer{region.layer}, MipmapLevel{region.mip} )
+										  .SetData( pixels.data(), ArraySizeOf(pixels), region.dimension, BytesU{level.rowPitch} ));
+		}
+
+		FG_LOGI( "Planet cache '"s << name << "' is loaded" );
+		return true;
+	}
+
+/*
+=================================================
+	Store
+=================================================
+*/
+	void  PlanetCache::Store (const CommandBuffer &cmdbuf, RawImageID image, StringView name, HashVal key) const
+	{
+		const ImageDesc		desc	= _frameGraph->GetDescription( image );
+		const FileHeader	header	= _MakeHeader( desc, desc.dimension.xy(), desc.arrayLayers.Get(), desc.maxLevel.Get(), key );
+		Array<Region>		regions;
+
+		for (uint mip = 0; mip < header.mipmaps; ++mip)
+		for (uint layer = 0; layer < header.layers; ++layer)
+		{
+			regions.push_back({ int2{}, uint2{ Max( header.width >> mip, 1u ), Max( header.height >> mip, 1u )}, layer, mip });
+		}
+		_Store( cmdbuf, image, name, header, regions );
+	}
+
+/*
+=================================================
+	StoreRegion
+=================================================
+*/
+	void  PlanetCache::StoreRegion (const CommandBuffer &cmdbuf, RawImageID image, const int2 &offset, const uint2 &dimension, StringView name, HashVal key) const
+	{
+		const Region	region{ offset, dimension, 0, 0 };
+		_Store( cmdbuf, image, name, _MakeHeader( _frameGraph->GetDescription( image ), dimension, 1, 1, key ), {region} );
+	}
+
+/*
+=================================================
+	_Store
+=================================================
+*/
+	void  PlanetCache::_Store (const CommandBuffer &cmdbuf, RawImageID image, StringView name, const FileHeader &header, ArrayView<Region> regions) const
+	{
+		struct Level
+		{
+			Array<uint8_t>	pixels;
+			BytesU			rowPitch;
+		};
+
+		struct ReadbackState
+		{
+			FileHeader		header;
+			Array<Level>	levels;			// same order as regions
+			uint			remaining	= 0;
+			String			path;
+		};
+
+		auto	state = MakeShared<ReadbackState>();
+
+		state->header		= header;
+		state->path			= _GetPath( name );
+		state->remaining	= uint(regions.size());
+		state->levels.resize( regions.size() );
+
+		const auto	WriteFile = [] (const ReadbackState &st)
+		{
+			FileWStream		file{ st.path };
+			CHECK_ERRV( file.IsOpen() );
+			CHECK_ERRV( file.Write( &st.header, BytesU::SizeOf(st.header) ));
+
+			for (auto& lvl : st.levels)
+			{
+				const LevelHeader	level{ uint64_t(lvl.pixels.size()), uint64_t(lvl.rowPitch) };
+
+				CHECK_ERRV( file.Write( &level, BytesU::SizeOf(level) ));
+				CHECK_ERRV( file.Write( lvl.pixels.data(), ArraySizeOf(lvl.pixels) ));
+			}
+			FG_LOGI( "Planet cache saved to '"s << st.path << "'" );
+		};
+
+		for (size_t idx = 0; idx < regions.size(); ++idx)
+		{
+			auto&	region = regions[idx];
+
+			cmdbuf->AddTask( ReadImage{}.SetImage( image, region.offset, region.dimension, ImageLayer{region.layer}, MipmapLevel{region.mip} )
+										.SetCallback( [state, idx, WriteFile] (const ImageView &view)
+										{
+											auto&	lvl = state->levels[idx];
+											lvl.rowPitch = view.RowPitch();
+
+											for (auto& part : view.Parts()) {
+												lvl.pixels.insert( lvl.pixels.end(), part.begin(), part.end() );
+											}
+
+											if ( --state->remaining == 0 )
+												WriteFile( *state );
+										}));
+		}
+	}
+
+
+}	// FG
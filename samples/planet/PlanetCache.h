@@ -0,0 +1,81 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	//
+	// Planet Cache
+	//
+
+	class PlanetCache final
+	{
+	// types
+	private:
+		struct FileHeader
+		{
+			uint		magic		= 0;
+			uint		version		= 0;
+			uint64_t	key			= 0;
+			uint		format		= 0;
+			uint		width		= 0;
+			uint		height		= 0;
+			uint		layers		= 0;
+			uint		mipmaps		= 0;
+			uint		_padding	= 0;
+		};
+
+		// file layout: 'FileHeader', then for each mipmap and each layer: 'LevelHeader' and pixels
+		struct LevelHeader
+		{
+			uint64_t	size		= 0;
+			uint64_t	rowPitch	= 0;
+		};
+
+		// part of image that is stored in the file
+		struct Region
+		{
+			int2		offset;
+			uint2		dimension;
+			uint		layer		= 0;
+			uint		mip			= 0;
+		};
+
+		static constexpr uint	Magic	= 0x48434c50;	// 'PLCH'
+		static constexpr uint	Version	= 1;
+
+
+	// variables
+	private:
+		FrameGraph		_frameGraph;
+		const String	_folder;
+
+
+	// methods
+	public:
+		PlanetCache (const FrameGraph &fg, StringView folder);
+
+		// uploads all mipmaps and layers, returns false if cache is missing or outdated
+		ND_ bool  Load (const CommandBuffer &cmdbuf, RawImageID image, StringView name, HashVal key) const;
+
+		// reads back image and writes it to the file when all levels are ready
+		void  Store (const CommandBuffer &cmdbuf, RawImageID image, StringView name, HashVal key) const;
+
+		// same as 'Load' and 'Store' but for single region of mipmap 0 and layer 0, used for pages of virtual texture
+		ND_ bool  LoadRegion (const CommandBuffer &cmdbuf, RawImageID image, const int2 &offset, const uint2 &dimension, StringView name, HashVal key) const;
+		void  StoreRegion (const CommandBuffer &cmdbuf, RawImageID image, const int2 &offset, const uint2 &dimension, StringView name, HashVal key) const;
+
+	private:
+		ND_ String  _GetPath (StringView name) const;
+
+		ND_ bool  _Load (const CommandBuffer &cmdbuf, RawImageID image, StringView name, const FileHeader &expected, ArrayView<Region> regions) const;
+		void  _Store (const CommandBuffer &cmdbuf, RawImageID image, StringView name, const FileHeader &header, ArrayView<Region> regions) const;
+
+		ND_ static FileHeader  _MakeHeader (const ImageDesc &desc, const uint2 &dimension, uint layers, uint mipmaps, HashVal key);
+	};
+
+
+}	// FG
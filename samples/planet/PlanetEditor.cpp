@@ -0,0 +1,152 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "PlanetEditor.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	Reset
+=================================================
+*/
+	void  PlanetEditor::Reset (uint faceSize, uint tilesPerSide)
+	{
+		CHECK( tilesPerSide > 0 and faceSize % tilesPerSide == 0 );
+
+		_faceSize		= faceSize;
+		_tilesPerSide	= tilesPerSide;
+		_tileSize		= faceSize / tilesPerSide;
+		_dirtyCount		= 0;
+
+		_dirtyTiles.assign( 6 * tilesPerSide * tilesPerSide, false );
+	}
+
+/*
+=================================================
+	AddCrater
+=================================================
+*/
+	bool  PlanetEditor::AddCrater (const float3 &center, float radius, float depth)
+	{
+		CHECK_ERR( radius > 0.0f );
+
+		if ( _craters.size() >= MaxCraters )
+			return false;
+
+		Crater	crater;
+		crater.center	= Normalize( center );
+		crater.radius	= radius;
+		crater.depth	= depth;
+
+		_craters.push_back( crater );
+		_MarkCrater( crater );
+		return true;
+	}
+
+/*
+=================================================
+	RemoveCraters
+=================================================
+*/
+	void  PlanetEditor::RemoveCraters ()
+	{
+		for (auto& crater : _craters) {
+			_MarkCrater( crater );
+		}
+		_craters.clear();
+	}
+
+/*
+=================================================
+	_MarkCrater
+----
+	normals are calculated from neighbour texels, so region is extended by texel size
+=================================================
+*/
+	void  PlanetEditor::_MarkCrater (const Crater &crater)
+	{
+		const float	texel = 2.0f / float(Max( _faceSize, 2u ) - 1);
+
+		MarkDirty( crater.center, crater.radius * PlanetTerrain::CraterRimScale + texel * 2.0f );
+	}
+
+/*
+=================================================
+	MarkDirty
+----
+	tile is approximated by bounding sphere on the unit sphere,
+	texel 0 is on the face edge, see 'gen_height.glsl'
+=================================================
+*/
+	void  PlanetEditor::MarkDirty (const float3 &center, float radius)
+	{
+		const float	scale = 2.0f / float(Max( _faceSize, 2u ) - 1);
+
+		for (uint face = 0; face < 6; ++face)
+		{
+			for (uint y = 0; y < _tilesPerSide; ++y)
+			for (uint x = 0; x < _tilesPerSide; ++x)
+			{
+				const uint	index = (face * _tilesPerSide + y) * _tilesPerSide + x;
+
+				if ( _dirtyTiles[index] )
+					continue;
+
+				const float2	begin		= float2{ float(x * _tileSize), float(y * _tileSize) } * scale - 1.0f;
+				const float2	end			= Min( float2{ float((x+1) * _tileSize - 1), float((y+1) * _tileSize - 1) } * scale - 1.0f, float2{1.0f} );
+				const float2	mid			= (begin + end) * 0.5f;
+				const float3	tile_center	= SphericalCube::ForwardProjection( mid, ECubeFace(face) );
+				float			tile_radius	= 0.0f;
+
+				for (uint i = 0; i < 9; ++i)
+				{
+					if ( i == 4 ) continue;
+
+					const float2	ncoord { i % 3 == 0 ? begin.x : i % 3 == 1 ? mid.x : end.x,
+											 i / 3 == 0 ? begin.y : i / 3 == 1 ? mid.y : end.y };
+
+					tile_radius = Max( tile_radius, Distance( tile_center, SphericalCube::ForwardProjection( ncoord, ECubeFace(face) )));
+				}
+
+				if ( Distance( tile_center, center ) <= tile_radius + radius )
+				{
+					_dirtyTiles[index] = true;
+					++_dirtyCount;
+				}
+			}
+		}
+	}
+
+/*
+=================================================
+	FlushDirtyTiles
+=================================================
+*/
+	void  PlanetEditor::FlushDirtyTiles (OUT Array<Tile> &tiles)
+	{
+		tiles.clear();
+
+		if ( _dirtyCount == 0 )
+			return;
+
+		for (size_t i = 0; i < _dirtyTiles.size(); ++i)
+		{
+			if ( not _dirtyTiles[i] )
+				continue;
+
+			const uint	x		= uint(i % _tilesPerSide);
+			const uint	y		= uint((i / _tilesPerSide) % _tilesPerSide);
+			Tile		tile;
+			tile.offset		= uint2{ x, y } * _tileSize;
+			tile.dimension	= uint2{ _tileSize };
+			tile.face		= uint(i / (_tilesPerSide * _tilesPerSide));
+
+			tiles.push_back( tile );
+			_dirtyTiles[i] = false;
+		}
+		_dirtyCount = 0;
+	}
+
+
+}	// FG
@@ -0,0 +1,72 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "PlanetTerrain.h"
+#include "SphericalCube/SphericalCube.h"
+
+namespace FG
+{
+
+	//
+	// Planet Editor
+	//
+	// Stores local features of the surface and tracks tiles of the face maps
+	// that must be regenerated after editing.
+	//
+
+	class PlanetEditor final
+	{
+	// types
+	public:
+		using Crater = PlanetTerrain::Crater;
+
+		// region of the face map, coordinates are in texels
+		struct Tile
+		{
+			uint2		offset;
+			uint2		dimension;
+			uint		face		= 0;
+		};
+
+		static constexpr uint	MaxCraters	= 256;
+
+
+	// variables
+	private:
+		Array<Crater>	_craters;
+		Array<bool>		_dirtyTiles;			// [face][y][x]
+		uint			_dirtyCount		= 0;
+		uint			_faceSize		= 0;
+		uint			_tileSize		= 0;
+		uint			_tilesPerSide	= 0;
+
+
+	// methods
+	public:
+		PlanetEditor () {}
+
+		// all tiles are marked as clean, features are not changed
+		void Reset (uint faceSize, uint tilesPerSide);
+
+		// 'center' - point on unit sphere, 'radius' and 'depth' are relative to planet radius,
+		// returns false if limit is reached
+		bool AddCrater (const float3 &center, float radius, float depth);
+		void RemoveCraters ();
+
+		// marks tiles that intersect sphere, 'center' and 'radius' are in planet space where planet radius is 1
+		void MarkDirty (const float3 &center, float radius);
+
+		// returns dirty tiles and marks them as clean
+		void FlushDirtyTiles (OUT Array<Tile> &tiles);
+
+		ND_ bool				HasDirtyTiles ()	const	{ return _dirtyCount > 0; }
+		ND_ ArrayView<Crater>	GetCraters ()		const	{ return _craters; }
+		ND_ uint				FaceSize ()			const	{ return _faceSize; }
+
+	private:
+		void  _MarkCrater (const Crater &crater);
+	};
+
+
+}	// FG
@@ -0,0 +1,281 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "PlanetTerrain.h"
+
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_AMD64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+#	define PLANET_TERRAIN_SSE
+#	include <emmintrin.h>
+#endif
+
+namespace FG
+{
+namespace {
+
+	// same as GLSL 'fract'
+	ND_ forceinline float  GLFract (float x)
+	{
+		return x - std::floor( x );
+	}
+
+#ifdef PLANET_TERRAIN_SSE
+	struct Float3x4
+	{
+		__m128	x, y, z;
+	};
+
+	// valid for |x| < 2^31, hash and noise arguments are much less
+	ND_ forceinline __m128  Floor4 (const __m128 &x)
+	{
+		const __m128	t = _mm_cvtepi32_ps( _mm_cvttps_epi32( x ));
+		return _mm_sub_ps( t, _mm_and_ps( _mm_cmpgt_ps( t, x ), _mm_set1_ps( 1.0f )));
+	}
+
+	ND_ forceinline __m128  Fract4 (const __m128 &x)
+	{
+		return _mm_sub_ps( x, Floor4( x ));
+	}
+
+/*
+=================================================
+	Hash4
+----
+	operations are in the same order as in scalar version
+=================================================
+*/
+	ND_ Float3x4  Hash4 (const __m128 &px, const __m128 &py, const __m128 &pz)
+	{
+		const __m128	bias	= _mm_set1_ps( 19.19f );
+		__m128			x		= Fract4( _mm_mul_ps( px, _mm_set1_ps( 0.1031f )));
+		__m128			y		= Fract4( _mm_mul_ps( py, _mm_set1_ps( 0.1030f )));
+		__m128			z		= Fract4( _mm_mul_ps( pz, _mm_set1_ps( 0.0973f )));
+		const __m128	d		= _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, _mm_add_ps( y, bias )), _mm_mul_ps( y, _mm_add_ps( x, bias ))),
+											  _mm_mul_ps( z, _mm_add_ps( z, bias )));
+		x = _mm_add_ps( x, d );
+		y = _mm_add_ps( y, d );
+		z = _mm_add_ps( z, d );
+
+		return Float3x4{ Fract4( _mm_mul_ps( _mm_add_ps( x, y ), z )),
+						 Fract4( _mm_mul_ps( _mm_add_ps( x, x ), y )),
+						 Fract4( _mm_mul_ps( _mm_add_ps( y, x ), x )) };
+	}
+
+/*
+=================================================
+	GradientNoise4
+=================================================
+*/
+	ND_ __m128  GradientNoise4 (const __m128 &px, const __m128 &py, const __m128 &pz)
+	{
+		const __m128	zero	= _mm_setzero_ps();
+		const __m128	one		= _mm_set1_ps( 1.0f );
+		const __m128	two		= _mm_set1_ps( 2.0f );
+		const __m128	ix		= Floor4( px );
+		const __m128	iy		= Floor4( py );
+		const __m128	iz		= Floor4( pz );
+		const __m128	wx		= _mm_sub_ps( px, ix );
+		const __m128	wy		= _mm_sub_ps( py, iy );
+		const __m128	wz		= _mm_sub_ps( pz, iz );
+
+		const auto		Quintic	= [&] (const __m128 &w) {
+			const __m128	p = _mm_add_ps( _mm_mul_ps( w, _mm_sub_ps( _mm_mul_ps( w, _mm_set1_ps( 6.0f )), _mm_set1_ps( 15.0f ))), _mm_set1_ps( 10.0f ));
+			return _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( w, w ), w ), p );
+		};
+		const __m128	ux		= Quintic( wx );
+		const __m128	uy		= Quintic( wy );
+		const __m128	uz		= Quintic( wz );
+
+		__m128	v[8];
+		for (uint c = 0; c < 8; ++c)
+		{
+			const __m128	ox	= (c & 1 ? one : zero);
+			const __m128	oy	= (c & 2 ? one : zero);
+			const __m128	oz	= (c & 4 ? one : zero);
+			const Float3x4	h	= Hash4( _mm_add_ps( ix, ox ), _mm_add_ps( iy, oy ), _mm_add_ps( iz, oz ));
+			const __m128	gx	= _mm_sub_ps( _mm_mul_ps( h.x, two ), one );
+			const __m128	gy	= _mm_sub_ps( _mm_mul_ps( h.y, two ), one );
+			const __m128	gz	= _mm_sub_ps( _mm_mul_ps( h.z, two ), one );
+
+			v[c] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( gx, _mm_sub_ps( wx, ox )), _mm_mul_ps( gy, _mm_sub_ps( wy, oy ))),
+							   _mm_mul_ps( gz, _mm_sub_ps( wz, oz )));
+		}
+
+		const __m128	uxy		= _mm_mul_ps( ux, uy );
+		const __m128	uyz		= _mm_mul_ps( uy, uz );
+		const __m128	uzx		= _mm_mul_ps( uz, ux );
+
+		__m128	r = v[0];
+		r = _mm_add_ps( r, _mm_mul_ps( ux, _mm_sub_ps( v[1], v[0] )));
+		r = _mm_add_ps( r, _mm_mul_ps( uy, _mm_sub_ps( v[2], v[0] )));
+		r = _mm_add_ps( r, _mm_mul_ps( uz, _mm_sub_ps( v[4], v[0] )));
+		r = _mm_add_ps( r, _mm_mul_ps( uxy, _mm_add_ps( _mm_sub_ps( _mm_sub_ps( v[0], v[1] ), v[2] ), v[3] )));
+		r = _mm_add_ps( r, _mm_mul_ps( uyz, _mm_add_ps( _mm_sub_ps( _mm_sub_ps( v[0], v[2] ), v[4] ), v[6] )));
+		r = _mm_add_ps( r, _mm_mul_ps( uzx, _mm_add_ps( _mm_sub_ps( _mm_sub_ps( v[0], v[1] ), v[4] ), v[5] )));
+
+		__m128	s = _mm_sub_ps( zero, v[0] );
+		s = _mm_add_ps( s, v[1] );	s = _mm_add_ps( s, v[2] );	s = _mm_sub_ps( s, v[3] );
+		s = _mm_add_ps( s, v[4] );	s = _mm_sub_ps( s, v[5] );	s = _mm_sub_ps( s, v[6] );	s = _mm_add_ps( s, v[7] );
+
+		return _mm_add_ps( r, _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( s, ux ), uy ), uz ));
+	}
+#endif	// PLANET_TERRAIN_SSE
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	Hash
+=================================================
+*/
+	float3  PlanetTerrain::Hash (const float3 &p)
+	{
+		float3		p3	{ GLFract( p.x * 0.1031f ), GLFract( p.y * 0.1030f ), GLFract( p.z * 0.0973f )};
+		const float	d	= p3.x * (p3.y + 19.19f) + p3.y * (p3.x + 19.19f) + p3.z * (p3.z + 19.19f);
+
+		p3.x += d;
+		p3.y += d;
+		p3.z += d;
+
+		return float3{ GLFract( (p3.x + p3.y) * p3.z ), GLFract( (p3.x + p3.x) * p3.y ), GLFract( (p3.y + p3.x) * p3.x )};
+	}
+
+/*
+=================================================
+	GradientNoise
+----
+	corner 'c' has offset '{ c & 1, (c >> 1) & 1, c >> 2 }'
+=================================================
+*/
+	float  PlanetTerrain::GradientNoise (const float3 &pos)
+	{
+		const float3	i	{ std::floor( pos.x ), std::floor( pos.y ), std::floor( pos.z )};
+		const float3	w	= pos - i;
+		const float3	u	= w * w * w * (w * (w * 6.0f - 15.0f) + 10.0f);
+		float			v[8];
+
+		for (uint c = 0; c < 8; ++c)
+		{
+			const float3	o	{ float(c & 1), float((c >> 1) & 1), float(c >> 2) };
+			const float3	g	= Hash( i + o ) * 2.0f - 1.0f;
+
+			v[c] = g.x * (w.x - o.x) + g.y * (w.y - o.y) + g.z * (w.z - o.z);
+		}
+
+		return	v[0] + u.x*(v[1]-v[0]) + u.y*(v[2]-v[0]) + u.z*(v[4]-v[0]) + (u.x*u.y)*(v[0]-v[1]-v[2]+v[3]) +
+				(u.y*u.z)*(v[0]-v[2]-v[4]+v[6]) + (u.z*u.x)*(v[0]-v[1]-v[4]+v[5]) + (-v[0]+v[1]+v[2]-v[3]+v[4]-v[5]-v[6]+v[7])*u.x*u.y*u.z;
+	}
+
+/*
+=================================================
+	FBM
+=================================================
+*/
+	float  PlanetTerrain::FBM (const float3 &pos)
+	{
+		float	total		= 0.0f;
+		float	amplitude	= 1.0f;
+		float	freq		= 1.0f;
+
+		for (uint i = 0; i < Octaves; ++i)
+		{
+			total		+= GradientNoise( pos * freq ) * amplitude;
+			freq		*= Lacunarity;
+			amplitude	*= Persistence;
+		}
+		return total;
+	}
+
+/*
+=================================================
+	Height
+=================================================
+*/
+	float  PlanetTerrain::Height (const float3 &dir)
+	{
+		return FBM( dir ) * HeightScale;
+	}
+
+/*
+=================================================
+	Height
+----
+	processes 4 points per iteration, remaining points are processed
+	by the scalar version
+=================================================
+*/
+	void  PlanetTerrain::Height (const float *dirX, const float *dirY, const float *dirZ, size_t count, OUT float *height)
+	{
+		size_t	i = 0;
+
+	#ifdef PLANET_TERRAIN_SSE
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128	x			= _mm_loadu_ps( dirX + i );
+			const __m128	y			= _mm_loadu_ps( dirY + i );
+			const __m128	z			= _mm_loadu_ps( dirZ + i );
+			__m128			total		= _mm_setzero_ps();
+			float			amplitude	= 1.0f;
+			float			freq		= 1.0f;
+
+			for (uint j = 0; j < Octaves; ++j)
+			{
+				const __m128	f = _mm_set1_ps( freq );
+				const __m128	n = GradientNoise4( _mm_mul_ps( x, f ), _mm_mul_ps( y, f ), _mm_mul_ps( z, f ));
+
+				total		 = _mm_add_ps( total, _mm_mul_ps( n, _mm_set1_ps( amplitude )));
+				freq		*= Lacunarity;
+				amplitude	*= Persistence;
+			}
+
+			_mm_storeu_ps( height + i, _mm_mul_ps( total, _mm_set1_ps( HeightScale )));
+		}
+	#endif
+
+		for (; i < count; ++i)
+		{
+			height[i] = Height( float3{ dirX[i], dirY[i], dirZ[i] });
+		}
+	}
+
+/*
+=================================================
+	CraterHeight
+----
+	'd' is a distance to the center divided by radius,
+	bowl is a parabola from '-0.7 * depth' in the center to '0.3 * depth' on the rim,
+	outside the rim height fades to zero at 'CraterRimScale'
+=================================================
+*/
+	float  PlanetTerrain::CraterHeight (const float3 &dir, const Crater &crater)
+	{
+		const float	d = Distance( dir, crater.center ) / crater.radius;
+
+		if ( d >= CraterRimScale )
+			return 0.0f;
+
+		if ( d < 1.0f )
+			return (d * d - 0.7f) * crater.depth;
+
+		const float	t = (CraterRimScale - d) / (CraterRimScale - 1.0f);
+		return 0.3f * t * t * crater.depth;
+	}
+
+/*
+=================================================
+	AddCraters
+=================================================
+*/
+	float  PlanetTerrain::AddCraters (const float3 &dir, float height, ArrayView<Crater> craters)
+	{
+		if ( craters.empty() )
+			return height;
+
+		for (auto& crater : craters) {
+			height += CraterHeight( dir, crater );
+		}
+		return Clamp( height, -MaxHeight, MaxHeight );
+	}
+
+
+}	// FG
@@ -0,0 +1,65 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "framegraph/FG.h"
+
+namespace FG
+{
+
+	//
+	// Planet Terrain
+	//
+	// CPU version of height function from 'shaders/gen_height.glsl',
+	// must be updated when shader is changed.
+	//
+
+	class PlanetTerrain final
+	{
+	// types
+	public:
+		// same layout as in 'gen_height.glsl'
+		struct Crater
+		{
+			float3		center;				// on unit sphere
+			float		radius		= 0.0f;	// distance from center to rim, relative to planet radius
+			float		depth		= 0.0f;	// relative to planet radius
+			float		_padding[3]	= {};
+		};
+
+
+	// variables
+	public:
+		static constexpr uint	Octaves			= 7;
+		static constexpr float	Lacunarity		= 2.5f;
+		static constexpr float	Persistence		= 0.5f;
+		static constexpr float	HeightScale		= 0.04f;
+		static constexpr float	MaxHeight		= 0.08f;	// height with craters is clamped to this value
+		static constexpr float	CraterRimScale	= 1.5f;		// crater changes height in 'radius * CraterRimScale'
+
+
+	// methods
+	public:
+		// 'DHash33' from 'Hash.glsl', range [0..1]
+		ND_ static float3  Hash (const float3 &p);
+
+		// 'GradientNoise' from 'Noise.glsl', range [-1..1]
+		ND_ static float  GradientNoise (const float3 &pos);
+
+		ND_ static float  FBM (const float3 &pos);
+
+		// 'dir' - point on unit sphere, returns height relative to planet radius
+		ND_ static float  Height (const float3 &dir);
+
+		// same as above for arrays of coordinates, 'count' may be not a multiple of 4
+		static void  Height (const float *dirX, const float *dirY, const float *dirZ, size_t count, OUT float *height);
+
+		// height offset of crater, bowl with rim
+		ND_ static float  CraterHeight (const float3 &dir, const Crater &crater);
+
+		// 'height' - result of 'Height( dir )', returns height with craters
+		ND_ static float  AddCraters (const float3 &dir, float height, ArrayView<Crater> craters);
+	};
+
+
+}	// FG
@@ -0,0 +1,96 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "PlanetEditor.h"
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Tile = PlanetEditor::Tile;
+
+
+	void Test_AddCrater ()
+	{
+		PlanetEditor	editor;
+		Array<Tile>		tiles;
+
+		editor.Reset( 1024, 16 );
+		TEST( not editor.HasDirtyTiles() );
+
+		// small crater in the center of the face, 2x2 tiles
+		const float3	center = SphericalCube::ForwardProjection( float2{0.0f}, ECubeFace::XPos );
+
+		TEST( editor.AddCrater( center, 0.01f, 0.001f ));
+		TEST( editor.GetCraters().size() == 1 );
+		TEST( editor.HasDirtyTiles() );
+
+		editor.FlushDirtyTiles( OUT tiles );
+		TEST( tiles.size() == 4 );
+		TEST( not editor.HasDirtyTiles() );
+
+		for (auto& tile : tiles)
+		{
+			TEST( tile.face == uint(ECubeFace::XPos) );
+			TEST( All( tile.dimension == uint2{64} ));
+			TEST( tile.offset.x == 448 or tile.offset.x == 512 );
+			TEST( tile.offset.y == 448 or tile.offset.y == 512 );
+		}
+
+		// removed crater must be regenerated too
+		editor.RemoveCraters();
+		TEST( editor.GetCraters().empty() );
+
+		editor.FlushDirtyTiles( OUT tiles );
+		TEST( tiles.size() == 4 );
+	}
+
+
+	void Test_FaceEdge ()
+	{
+		PlanetEditor	editor;
+		Array<Tile>		tiles;
+
+		editor.Reset( 1024, 16 );
+
+		// crater on the edge between faces
+		const float3	center = SphericalCube::ForwardProjection( float2{1.0f, 0.0f}, ECubeFace::XPos );
+
+		TEST( editor.AddCrater( center, 0.01f, 0.001f ));
+		editor.FlushDirtyTiles( OUT tiles );
+
+		uint	face_mask	= 0;
+		uint	face_count	= 0;
+
+		for (auto& tile : tiles) {
+			face_mask |= (1u << tile.face);
+		}
+		for (uint face = 0; face < 6; ++face) {
+			face_count += (face_mask >> face) & 1;
+		}
+		TEST( face_count == 2 );
+	}
+
+
+	void Test_Limit ()
+	{
+		PlanetEditor	editor;
+		editor.Reset( 256, 4 );
+
+		for (uint i = 0; i < PlanetEditor::MaxCraters; ++i) {
+			TEST( editor.AddCrater( float3{0.0f, 1.0f, 0.0f}, 0.1f, 0.001f ));
+		}
+		TEST( not editor.AddCrater( float3{0.0f, 1.0f, 0.0f}, 0.1f, 0.001f ));
+		TEST( editor.GetCraters().size() == PlanetEditor::MaxCraters );
+	}
+}
+
+extern void UnitTest_PlanetEditor ()
+{
+	Test_AddCrater();
+	Test_FaceEdge();
+	Test_Limit();
+
+	FG_LOGI( "UnitTest_PlanetEditor" );
+}
@@ -0,0 +1,162 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "PlanetTerrain.h"
+#include "stl/Algorithms/StringUtils.h"
+#include <chrono>
+#include <random>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Clock	= std::chrono::high_resolution_clock;
+
+
+	void GenRandomDirections (size_t count, std::mt19937 &gen, OUT Array<float> &x, OUT Array<float> &y, OUT Array<float> &z)
+	{
+		std::normal_distribution<float>	dist;
+
+		x.resize( count );
+		y.resize( count );
+		z.resize( count );
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float3	dir = Normalize( float3{ dist(gen), dist(gen), dist(gen) } + float3{0.001f} );
+			x[i] = dir.x;	y[i] = dir.y;	z[i] = dir.z;
+		}
+	}
+
+
+	void Test_Hash ()
+	{
+		std::mt19937							gen{ 1234 };
+		std::uniform_real_distribution<float>	coord{ -300.0f, 300.0f };
+
+		for (uint i = 0; i < 1000; ++i)
+		{
+			const float3	h = PlanetTerrain::Hash( float3{ std::floor( coord(gen) ), std::floor( coord(gen) ), std::floor( coord(gen) )});
+
+			TEST( All( h >= 0.0f ) and All( h < 1.0f ));
+		}
+	}
+
+
+	void Test_GradientNoise ()
+	{
+		// noise is zero in grid nodes
+		TEST( PlanetTerrain::GradientNoise( float3{ 0.0f, 0.0f, 0.0f }) == 0.0f );
+		TEST( PlanetTerrain::GradientNoise( float3{ 3.0f, -2.0f, 5.0f }) == 0.0f );
+		TEST( PlanetTerrain::GradientNoise( float3{ -7.0f, 11.0f, -1.0f }) == 0.0f );
+
+		// continuous across cell boundaries
+		for (float x : { 1.0f, -4.0f, 17.0f })
+		{
+			const float	a = PlanetTerrain::GradientNoise( float3{ x - 1.0e-4f, 0.3f, 0.7f });
+			const float	b = PlanetTerrain::GradientNoise( float3{ x + 1.0e-4f, 0.3f, 0.7f });
+
+			TEST( Abs( a - b ) < 1.0e-3f );
+		}
+	}
+
+
+	void Test_Height ()
+	{
+		std::mt19937	gen{ 1234 };
+		Array<float>	x, y, z, height;
+
+		for (size_t count : {0u, 1u, 3u, 4u, 17u, 1001u})
+		{
+			GenRandomDirections( count, gen, OUT x, OUT y, OUT z );
+			height.resize( count );
+
+			PlanetTerrain::Height( x.data(), y.data(), z.data(), count, OUT height.data() );
+
+			// batch version must produce the same result
+			for (size_t i = 0; i < count; ++i)
+			{
+				const float	h = PlanetTerrain::Height( float3{ x[i], y[i], z[i] });
+
+				TEST( h == height[i] );
+				TEST( Abs( h ) <= PlanetTerrain::MaxHeight );
+			}
+		}
+	}
+
+
+	void Test_Craters ()
+	{
+		PlanetTerrain::Crater	crater;
+		crater.center	= float3{ 0.0f, 0.0f, 1.0f };
+		crater.radius	= 0.1f;
+		crater.depth	= 0.01f;
+
+		const auto	DirAt = [&crater] (float dist) {
+			return Normalize( crater.center + float3{ dist, 0.0f, 0.0f });
+		};
+
+		// bowl and rim, continuous on the rim
+		TEST( PlanetTerrain::CraterHeight( crater.center, crater ) < 0.0f );
+		TEST( Abs( PlanetTerrain::CraterHeight( DirAt( 0.0999f ), crater ) - PlanetTerrain::CraterHeight( DirAt( 0.1001f ), crater )) < 1.0e-4f );
+		TEST( PlanetTerrain::CraterHeight( DirAt( 0.1f ), crater ) > 0.0f );
+		TEST( PlanetTerrain::CraterHeight( DirAt( 0.2f ), crater ) == 0.0f );
+
+		// no craters - same height
+		const float3	dir	= DirAt( 0.05f );
+		const float		h	= PlanetTerrain::Height( dir );
+
+		TEST( PlanetTerrain::AddCraters( dir, h, ArrayView<PlanetTerrain::Crater>{} ) == h );
+		TEST( PlanetTerrain::AddCraters( dir, h, {crater} ) == Clamp( h + PlanetTerrain::CraterHeight( dir, crater ), -PlanetTerrain::MaxHeight, PlanetTerrain::MaxHeight ));
+
+		// height is limited
+		crater.depth = 1.0f;
+		TEST( PlanetTerrain::AddCraters( crater.center, h, {crater, crater} ) == -PlanetTerrain::MaxHeight );
+	}
+}
+
+extern void UnitTest_PlanetTerrain ()
+{
+	Test_Hash();
+	Test_GradientNoise();
+	Test_Height();
+	Test_Craters();
+
+	FG_LOGI( "UnitTest_PlanetTerrain" );
+}
+
+
+extern void PerfTest_PlanetTerrain ()
+{
+	std::mt19937	gen{ 1234 };
+	Array<float>	x, y, z, height;
+	Nanoseconds		ref_time	{0};
+	Nanoseconds		simd_time	{0};
+	float			ref_sum		= 0.0f;
+
+	GenRandomDirections( 1u << 18, gen, OUT x, OUT y, OUT z );
+	height.resize( x.size() );
+
+	for (uint i = 0; i < 10; ++i)
+	{
+		auto	t0 = Clock::now();
+
+		for (size_t j = 0; j < x.size(); ++j) {
+			ref_sum += PlanetTerrain::Height( float3{ x[j], y[j], z[j] });
+		}
+
+		auto	t1 = Clock::now();
+		PlanetTerrain::Height( x.data(), y.data(), z.data(), x.size(), OUT height.data() );
+		auto	t2 = Clock::now();
+
+		ref_time  += std::chrono::duration_cast<Nanoseconds>( t1 - t0 );
+		simd_time += std::chrono::duration_cast<Nanoseconds>( t2 - t1 );
+	}
+
+	const double	count = double(x.size()) * 10.0;
+
+	FG_LOGI( "PerfTest_PlanetTerrain: "s << ToString( x.size() ) << " points, sum: " << ToString( ref_sum )
+			 << ", scalar: " << ToString( count / (double(ref_time.count()) * 1.0e-9) ) << " points/s"
+			 << ", batch: " << ToString( count / (double(simd_time.count()) * 1.0e-9) ) << " points/s" );
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+/*
+	Virtual texture for cube faces, see 'SphericalCubeVirtualTexture'.
+
+	params: x - face size, y - page size, z - page size with border, w - atlas size.
+	page table entry: slot.x | (slot.y << 12) | (mip << 24), where 'mip' is a mipmap of finest resident page.
+*/
+
+#include "Math.glsl"
+
+float2  VT_AtlasCoord (usampler2DArray pageTable, const float4 params, const float2 ncoord, const int face, const float lod)
+{
+	const int		mip		= clamp( int(lod), 0, textureQueryLevels( pageTable ) - 1 );
+	const float		border	= (params.z - params.y) * 0.5;
+	const float2	uv		= clamp( ToUNorm( ncoord ), 0.0, 1.0 );
+
+	// requested page
+	const float		dim		= float(int(params.x) >> mip);
+	const int2		page	= min( int2(uv * (dim - 1.0) / params.y), textureSize( pageTable, mip ).xy - 1 );
+	const uint		entry	= texelFetch( pageTable, int3(page, face), mip ).r;
+
+	// resident page covers the requested page, texel 0 is on the face edge, see 'gen_height.glsl'.
+	// page must not be recalculated from 'uv' because of 'dim - 1' mapping it may differ on page edges,
+	// texel is outside of the page by less than 1 texel in this case and it is in the border.
+	const int		rmip	= int(entry >> 24);
+	const float		rdim	= float(int(params.x) >> rmip);
+	const float2	slot	= float2( entry & 0xFFFu, (entry >> 12) & 0xFFFu );
+	const float2	rpage	= float2( page >> (rmip - mip) );
+	const float2	texel	= clamp( uv * (rdim - 1.0) - rpage * params.y, -border, params.y + border - 1.0 );
+
+	return (slot * params.z + border + texel + 0.5) / params.w;
+}
@@ -13,9 +13,14 @@ layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
 #include "Noise.glsl"
 #include "Color.glsl"
 
+// region of the face, the whole face or page of virtual texture
 layout(push_constant, std140) uniform PushConst {
 	int2	faceDim;
 	int		face;
+	int2	srcOffset;		// first texel of region on face
+	int2	dstOffset;		// first texel of region in output images
+	int2	regionDim;
+	int		craterCount;	// unused, same layout as in 'gen_height.glsl'
 } pc;
 
 // @discard
@@ -35,13 +40,14 @@ shared float3  s_Normals  [ gl_WorkGroupSize.x * gl_WorkGroupSize.y ];
 void main ()
 {
 	const int2	coord	= GetGlobalCoord().xy;
+	const int2	dst		= coord + pc.dstOffset;
 	
 	// read height map
 	float3	sphere_pos;
 	{
-		float	height	= imageLoad( un_HeightMap, coord ).r;
-		float3	norm	= imageLoad( un_NormalMap, coord ).rgb;
-		float2	ncoord	= ToSNorm( float2(coord) / float2(pc.faceDim - 1) );
+		float	height	= imageLoad( un_HeightMap, dst ).r;
+		float3	norm	= imageLoad( un_NormalMap, dst ).rgb;
+		float2	ncoord	= ToSNorm( float2(coord + pc.srcOffset) / float2(pc.faceDim - 1) );
 		sphere_pos		= PROJECTION( ncoord, pc.face );
 	
 		s_Positions[ GetLocalIndex() ] = sphere_pos * (1.0 + height);
@@ -68,6 +74,9 @@ void main ()
 	//albedo = (mtr_id == 0 ? float3(0.0, 0.0, 1.0) : float3(0.0));
 	albedo = HSVtoRGB( float3( biom, 1.0, 1.0 ));
 
-	imageStore( un_OutAlbedo, coord, float4(albedo, 0.0) );
-	imageStore( un_OutEmission, coord, float4(emission, temperature, 0.0, 0.0) );
+	if ( AllLess( coord, pc.regionDim ))
+	{
+		imageStore( un_OutAlbedo, dst, float4(albedo, 0.0) );
+		imageStore( un_OutEmission, dst, float4(emission, temperature, 0.0, 0.0) );
+	}
 }
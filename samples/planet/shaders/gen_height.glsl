@@ -13,9 +13,14 @@ layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z = 1) in;
 #include "Noise.glsl"
 
 
+// region of the face, the whole face or page of virtual texture
 layout(push_constant, std140) uniform PushConst {
 	int2	faceDim;
 	int		face;
+	int2	srcOffset;		// first texel of region on face
+	int2	dstOffset;		// first texel of region in output images
+	int2	regionDim;
+	int		craterCount;
 } pc;
 
 // @discard
@@ -24,6 +29,17 @@ layout(set=0, binding=0) writeonly restrict uniform image2D  un_OutHeight;
 // @discard
 layout(set=0, binding=1) writeonly restrict uniform image2D  un_OutNormal;
 
+// local features, see 'PlanetEditor'
+struct Crater
+{
+	float4	sphere;		// xyz - center on unit sphere, w - radius
+	float4	params;		// x - depth
+};
+
+layout(set=0, binding=2, std430) readonly restrict buffer un_CraterBuffer {
+	Crater	un_Craters[];
+};
+
 
 float FBM (in float3 coord)
 {
@@ -44,6 +60,23 @@ float FBM (in float3 coord)
 }
 
 
+// same as 'PlanetTerrain::CraterHeight'
+float CraterHeight (const float3 pos, const Crater crater)
+{
+	const float	rim	= 1.5;
+	const float	d	= distance( pos, crater.sphere.xyz ) / crater.sphere.w;
+
+	if ( d >= rim )
+		return 0.0;
+
+	if ( d < 1.0 )
+		return (d * d - 0.7) * crater.params.x;
+
+	const float	t = (rim - d) / (rim - 1.0);
+	return 0.3 * t * t * crater.params.x;
+}
+
+
 float4 GetPosition (const int2 coord)
 {
 	float2	ncoord	= ToSNorm( float2(coord) / float2(pc.faceDim - 1) );
@@ -55,6 +88,15 @@ float4 GetPosition (const int2 coord)
 	//float	height	= SDF_Sphere( Fract( pos * 4.0 ) - 0.5, 0.25 ) * 0.1;
 	//float	height	= GradientNoise( pos * 4.251 ) * 0.1;
 
+	// same as 'PlanetTerrain::AddCraters'
+	if ( pc.craterCount > 0 )
+	{
+		for (int i = 0; i < pc.craterCount; ++i) {
+			height += CraterHeight( pos, un_Craters[i] );
+		}
+		height = clamp( height, -0.08, 0.08 );
+	}
+
 	return float4( pos, height );
 }
 
@@ -75,9 +117,9 @@ void main ()
 	const int2		lsize		= GetLocalSize().xy - 2;
 	const int2		group		= GetGroupCoord().xy;
 	const int2		coord		= local + lsize * group;
-	const float4	pos_h		= GetPosition( coord );
+	const float4	pos_h		= GetPosition( coord + pc.srcOffset );
 	const float3	pos			= pos_h.xyz * (1.0 + pos_h.w);
-	const bool4		is_active	= bool4( greaterThanEqual( local, int2(0) ), lessThan( local, lsize ));
+	const bool4		is_active	= bool4( greaterThanEqual( local, int2(0) ), lessThan( local, lsize ) && lessThan( coord, pc.regionDim ));
 
 	s_Positions[ GetLocalIndex() ] = pos;
 
@@ -111,7 +153,7 @@ void main ()
 		normal += Cross( v3 - v4, v0 - v4 );	// 3-4, 0-4
 		normal  = Normalize( normal );
 
-		imageStore( un_OutHeight, coord, float4(pos_h.w) );
-		imageStore( un_OutNormal, coord, float4(normal, 0.0) );
+		imageStore( un_OutHeight, coord + pc.dstOffset, float4(pos_h.w) );
+		imageStore( un_OutNormal, coord + pc.dstOffset, float4(normal, 0.0) );
 	}
 }
@@ -7,6 +7,18 @@
 
 #include "Math.glsl"
 
+#if USE_CHUNKS
+#	include "CubeMap.glsl"
+#endif
+
+// surface maps are paged, texture coordinates are face coords and face, requires 'USE_CHUNKS'
+#if USE_VIRTUAL_TEXTURE
+#	include "VirtualTexture.glsl"
+#endif
+
+// tangents are available only in 'SphericalCube::EVertexLayout::Tangents', quad tree chunks use exact projection instead
+#define CURVED_PATCHES		(USE_QUADS && !USE_CHUNKS && TANGENT_VERTICES)
+
 #define SH_VERTEX			(1 << 0)
 #define SH_TESS_CONTROL		(1 << 1)
 #define SH_TESS_EVALUATION	(1 << 2)
@@ -29,24 +41,84 @@ layout(set=0, binding=0, std140) uniform un_PlanetData
 	float		radius;
 
 	float3		lightDirection;	// temp
+	float4		virtualTexture;	// see 'VT_AtlasCoord'
 
 	//Material	materials [256];
 } ub;
 #endif
+
+#if USE_CHUNKS && (SHADER & (SH_TESS_CONTROL | SH_TESS_EVALUATION))
+// patch edge between vertices 'a' and 'b' is shared with coarser chunk, see 'out_Stitch'
+bool  IsCoarserEdge (const float3 a, const float3 b)
+{
+	const uint	flags = uint(a.z + 0.5);
+
+	return	((flags & 1) != 0 && a.x == 0.0 && b.x == 0.0) ||
+			((flags & 2) != 0 && a.y == 0.0 && b.y == 0.0) ||
+			((flags & 4) != 0 && a.x == 1.0 && b.x == 1.0) ||
+			((flags & 8) != 0 && a.y == 1.0 && b.y == 1.0);
+}
+#endif
 //-----------------------------------------------------------------------------
 
 
 
-#if SHADER & SH_VERTEX
+#if (SHADER & SH_VERTEX) && USE_CHUNKS
+// chunk of the quad tree, see 'SphericalCubeQuadTree'
+layout(location=0) in float2  at_Position;		// grid coord in [0, 1]
+layout(location=1) in float3  at_ChunkOffset;	// min corner in face coords, size
+layout(location=2) in uint    at_ChunkFlags;	// face | (coarser edges << 8)
+
+layout(location=0) out float3  out_Texcoord;	// face coord, face
+layout(location=1) out float3  out_Stitch;		// grid coord, coarser edges
+
+void main ()
+{
+	const float2	ncoord	= at_ChunkOffset.xy + at_Position * at_ChunkOffset.z;
+	const int		face	= int(at_ChunkFlags & 0xFF);
+
+	gl_Position  = float4(PROJECTION( ncoord, face ), 1.0f);
+	out_Texcoord = float3(ncoord, float(face));
+	out_Stitch   = float3(at_Position, float(at_ChunkFlags >> 8));
+}
+
+#elif (SHADER & SH_VERTEX) && PACKED_VERTICES
+#include "Geometry.glsl"
+
+// octahedral encoded directions, see 'SphericalCube::PackedVertex'
+layout(location=0) in float2  at_Position;
+layout(location=1) in float2  at_TextureUV;
+
+layout(location=0) out float3  out_Texcoord;
+
+void main ()
+{
+	gl_Position  = float4(DecodeOctahedral( at_Position ), 1.0f);
+	out_Texcoord = DecodeOctahedral( at_TextureUV ) * 0.5f;
+}
+
+#elif SHADER & SH_VERTEX
 layout(location=0) in float3  at_Position;
 layout(location=1) in float3  at_TextureUV;
 
 layout(location=0) out float3  out_Texcoord;
 
+#if TANGENT_VERTICES
+layout(location=2) in float3  at_Tangent;
+layout(location=3) in float3  at_Bitangent;
+
+layout(location=1) out float3  out_Tangent;
+layout(location=2) out float3  out_Bitangent;
+#endif
+
 void main ()
 {
-	gl_Position  = float4(at_Position.xyz, 1.0f);
-	out_Texcoord = at_TextureUV.xyz;
+	gl_Position   = float4(at_Position.xyz, 1.0f);
+	out_Texcoord  = at_TextureUV.xyz;
+#if TANGENT_VERTICES
+	out_Tangent   = at_Tangent;
+	out_Bitangent = at_Bitangent;
+#endif
 }
 #endif	// SH_VERTEX
 //-----------------------------------------------------------------------------
@@ -59,6 +131,27 @@ layout(vertices = 4) out;
 layout(location=0) in  float3  in_Texcoord[];
 layout(location=0) out float3  out_Texcoord[];
 
+#if CURVED_PATCHES
+layout(location=1) in  float3  in_Tangent[];
+layout(location=2) in  float3  in_Bitangent[];
+layout(location=1) out float3  out_Tangent[];
+layout(location=2) out float3  out_Bitangent[];
+#endif
+
+#if USE_CHUNKS
+layout(location=1) in  float3  in_Stitch[];
+layout(location=1) out float3  out_Stitch[];
+
+// chunk edge that is shared with coarser chunk has half of tessellation level,
+// so both chunks have the same vertices on this edge
+float  EdgeTessLevel (const int i0, const int i1)
+{
+	return IsCoarserEdge( in_Stitch[i0], in_Stitch[i1] ) ? ub.tessLevel * 0.5 : ub.tessLevel;
+}
+#else
+float  EdgeTessLevel (const int i0, const int i1)	{ return ub.tessLevel; }
+#endif
+
 void main ()
 {
 #	define I	gl_InvocationID
@@ -66,13 +159,20 @@ void main ()
 	if ( I == 0 ) {
 		gl_TessLevelInner[0] = ub.tessLevel;
 		gl_TessLevelInner[1] = ub.tessLevel;
-		gl_TessLevelOuter[0] = ub.tessLevel;
-		gl_TessLevelOuter[1] = ub.tessLevel;
-		gl_TessLevelOuter[2] = ub.tessLevel;
-		gl_TessLevelOuter[3] = ub.tessLevel;
+		gl_TessLevelOuter[0] = EdgeTessLevel( 0, 3 );
+		gl_TessLevelOuter[1] = EdgeTessLevel( 0, 1 );
+		gl_TessLevelOuter[2] = EdgeTessLevel( 1, 2 );
+		gl_TessLevelOuter[3] = EdgeTessLevel( 3, 2 );
 	}
 	gl_out[I].gl_Position = gl_in[I].gl_Position;
 	out_Texcoord[I] = in_Texcoord[I];
+#if USE_CHUNKS
+	out_Stitch[I]   = in_Stitch[I];
+#endif
+#if CURVED_PATCHES
+	out_Tangent[I]   = in_Tangent[I];
+	out_Bitangent[I] = in_Bitangent[I];
+#endif
 }
 #endif	// SH_TESS_CONTROL
 //-----------------------------------------------------------------------------
@@ -104,7 +204,12 @@ void main ()
 
 
 #if SHADER & SH_TESS_EVALUATION
+#if USE_VIRTUAL_TEXTURE
+layout(set=0, binding=1) uniform sampler2D        un_HeightMap;
+layout(set=0, binding=5) uniform usampler2DArray  un_PageTable;
+#else
 layout(set=0, binding=1) uniform samplerCube  un_HeightMap;
+#endif
 
 layout(location=0) in  float3  in_Texcoord[];
 layout(location=0) out float3  out_Texcoord;
@@ -128,12 +233,85 @@ layout(location=0) out float3  out_Texcoord;
 # endif	// USE_QUADS
 
 
+# if USE_CHUNKS && USE_VIRTUAL_TEXTURE
+layout(location=1) in  float3  in_Stitch[];
+
+// vertex on edge that is shared with coarser chunk uses lod of coarser chunk, which is 'lod + 1',
+// so both chunks sample the same texel of the same page and heights on the edge are equal.
+// Tess coords on the patch edges are exactly 0 or 1, see 'Interpolate' for edge order.
+float  VertexLod (const float lod)
+{
+	const float2	tc		= gl_TessCoord.xy;
+	const bool		coarser	= (tc.x == 0.0 && IsCoarserEdge( in_Stitch[0], in_Stitch[3] )) ||
+							  (tc.y == 0.0 && IsCoarserEdge( in_Stitch[0], in_Stitch[1] )) ||
+							  (tc.x == 1.0 && IsCoarserEdge( in_Stitch[1], in_Stitch[2] )) ||
+							  (tc.y == 1.0 && IsCoarserEdge( in_Stitch[3], in_Stitch[2] ));
+
+	return coarser ? lod + 1.0 : lod;
+}
+# endif	// USE_CHUNKS && USE_VIRTUAL_TEXTURE
+
+
+# if CURVED_PATCHES
+layout(location=1) in  float3  in_Tangent[];
+layout(location=2) in  float3  in_Bitangent[];
+
+// cubic Hermite curve, tangents are scaled by projection of the chord,
+// so curve depends only on end points and tangent directions and neighbour patches have the same edges
+float3  HermiteCurve (const float3 p0, const float3 t0, const float3 p1, const float3 t1, const float s)
+{
+	const float3	d	= p1 - p0;
+	const float3	m0	= t0 * (dot( d, t0 ) / dot( t0, t0 ));
+	const float3	m1	= t1 * (dot( d, t1 ) / dot( t1, t1 ));
+	const float		s2	= s * s;
+	const float		s3	= s2 * s;
+
+	return (2.0*s3 - 3.0*s2 + 1.0) * p0 + (s3 - 2.0*s2 + s) * m0 + (3.0*s2 - 2.0*s3) * p1 + (s3 - s2) * m1;
+}
+
+// patch vertices 0 -> 1 and 3 -> 2 are along 'ncoord.x', see 'SphericalCube::GenerateIndices'
+float3  CurvedPatch ()
+{
+	const float		x	= gl_TessCoord.x;
+	const float3	p0	= HermiteCurve( gl_in[0].gl_Position.xyz, in_Tangent[0], gl_in[1].gl_Position.xyz, in_Tangent[1], x );
+	const float3	p1	= HermiteCurve( gl_in[3].gl_Position.xyz, in_Tangent[3], gl_in[2].gl_Position.xyz, in_Tangent[2], x );
+	const float3	t0	= mix( in_Bitangent[0], in_Bitangent[1], x );
+	const float3	t1	= mix( in_Bitangent[3], in_Bitangent[2], x );
+
+	return HermiteCurve( p0, t0, p1, t1, gl_TessCoord.y );
+}
+# endif	// CURVED_PATCHES
+
+
 void main ()
 {
+# if USE_CHUNKS
+	// interpolation in face coords is exact, so neighbour chunks have the same vertices on shared edges
+	float2	ncoord	= Interpolate( in_Texcoord, .xy );
+	int		face	= int(in_Texcoord[0].z + 0.5);
+#  if USE_VIRTUAL_TEXTURE
+	// one texel per tessellated segment, quad size is distance between vertices 0 and 2 along x,
+	// see 'SphericalCubeVirtualTexture::VertexLod'
+	float	lod		= VertexLod( log2( abs( in_Texcoord[2].x - in_Texcoord[0].x ) * 0.5 * ub.virtualTexture.x / ub.tessLevel ));
+	float3	texc	= float3( ncoord, float(face) );
+	float	height	= textureLod( un_HeightMap, VT_AtlasCoord( un_PageTable, ub.virtualTexture, ncoord, face, lod ), 0.0 ).r;
+#  else
+	float3	texc	= CM_IdentitySC_Forward( ncoord, face );
+	float	height	= texture( un_HeightMap, texc ).r;
+#  endif
+	float3	surf_n	= PROJECTION( ncoord, face );
+	float4	pos		= float4( 0.0, 0.0, 0.0, 1.0 );
+# else
 	float3	texc	= Interpolate( in_Texcoord, );
 	float	height	= texture( un_HeightMap, texc ).r;
+#  if CURVED_PATCHES
+	// follows the projection, so positions match texture coordinates without extra tessellation
+	float4	pos		= float4( CurvedPatch(), 1.0 );
+#  else
 	float4	pos		= Interpolate( gl_in, .gl_Position );
+#  endif
 	float3	surf_n	= normalize( pos.xyz );
+# endif
 	
 	out_Texcoord = texc;
 	pos.xyz		 = surf_n * ub.radius * (1.0 + height);
@@ -147,19 +325,35 @@ void main ()
 #if SHADER & SH_FRAGMENT
 layout(location=0) out float4  out_Color;
 
+#if USE_VIRTUAL_TEXTURE
+layout(set=0, binding=2) uniform sampler2D        un_NormalMap;
+layout(set=0, binding=3) uniform sampler2D        un_AlbedoMap;
+layout(set=0, binding=4) uniform sampler2D        un_EmissionMap;
+layout(set=0, binding=5) uniform usampler2DArray  un_PageTable;
+#else
 layout(set=0, binding=2) uniform samplerCube  un_NormalMap;
 layout(set=0, binding=3) uniform samplerCube  un_AlbedoMap;
 layout(set=0, binding=4) uniform samplerCube  un_EmissionMap;
+#endif
 
 layout(location=0) in float3  in_Texcoord;
 
 void main ()
 {
-	float3	norm	 = texture( un_NormalMap, in_Texcoord ).xyz;
+#if USE_VIRTUAL_TEXTURE
+	// patch doesn't cross the face, so derivatives are continuous
+	float2	texel	= in_Texcoord.xy * 0.5 * ub.virtualTexture.x;
+	float	lod		= log2( max( length( dFdx( texel )), length( dFdy( texel ))));
+	float2	uv		= VT_AtlasCoord( un_PageTable, ub.virtualTexture, in_Texcoord.xy, int(in_Texcoord.z + 0.5), lod );
+	float3	norm	= textureLod( un_NormalMap, uv, 0.0 ).xyz;
+	float3	albedo	= textureLod( un_AlbedoMap, uv, 0.0 ).rgb;
+#else
+	float3	norm	= texture( un_NormalMap, in_Texcoord ).xyz;
+	float3	albedo	= texture( un_AlbedoMap, in_Texcoord ).rgb;
+#endif
 	float	lighting = clamp( dot( norm, ub.lightDirection ), 0.2, 1.0 );
 
 	//out_Color = float4( norm * 0.5 + 0.5, 1.0 );
-	float3	albedo	= texture( un_AlbedoMap, in_Texcoord ).rgb;
 
 	out_Color = float4( albedo * lighting, 1.0 );
 }
@@ -1,8 +1,10 @@
 // Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
 
 #include "SceneApp.h"
+#include "SceneCache.h"
 #include "scene/Loader/Assimp/AssimpLoader.h"
 #include "scene/Loader/DevIL/DevILLoader.h"
+#include "Loader/ParallelImageLoader.h"
 #include "scene/Renderer/Prototype/RendererPrototype.h"
 #include "scene/SceneManager/Simple/SimpleRayTracingScene.h"
 #include "scene/SceneManager/DefaultSceneManager.h"
@@ -13,6 +15,7 @@ namespace FG
 {
 
 #define SCENE_PATH	FG_DATA_PATH "../../_data/"
+#define CACHE_PATH	FG_DATA_PATH "_cache/"
 	
 /*
 =================================================
@@ -86,9 +89,47 @@ namespace FG
 /*
 =================================================
 	_LoadScene2
+----
+	imported scene is cached, cache is rebuilt
+	when any file in source folders is changed
 =================================================
 */
 	SceneHierarchyPtr  SceneApp::_LoadScene2 (const CommandBuffer &cmdbuf) const
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		const auto		start_time	= Clock::now();
+		const HashVal	key			= SceneCache::SourceKey({ SCENE_PATH "sponza", SCENE_PATH "bunny" });
+
+		IntermScenePtr	scene = SceneCache::Load( CACHE_PATH "scene2.bin", key );
+		if ( not scene )
+		{
+			scene = _ImportScene2();
+			CHECK_ERR( scene );
+
+			if ( key != HashVal{} )
+				SceneCache::Store( CACHE_PATH "scene2.bin", *scene, key );
+		}
+
+		FG_LOGI( "Scene loaded in "s << ToString( std::chrono::duration_cast<Nanoseconds>( Clock::now() - start_time )));
+		
+		Transform	transform;
+		transform.scale	= 200.0f;
+
+		auto	hierarchy = MakeShared<SimpleRayTracingScene>();
+		CHECK_ERR( hierarchy->Create( cmdbuf, scene, _scene->GetImageCache(), transform ));
+
+		return hierarchy;
+	}
+	
+/*
+=================================================
+	_ImportScene2
+----
+	bunny is merged into sponza, so imported scene can be cached
+=================================================
+*/
+	IntermScenePtr  SceneApp::_ImportScene2 () const
 	{
 		AssimpLoader			loader;
 		AssimpLoader::Config	cfg;
@@ -96,8 +137,14 @@ namespace FG
 		IntermScenePtr	sponza = loader.Load( cfg, SCENE_PATH "sponza/sponza.gltf" );
 		CHECK_ERR( sponza );
 		
+		// textures are decoded in parallel, DevIL is not thread safe
+	#ifdef FG_ENABLE_STB
+		ParallelImageLoader	img_loader;
+		CHECK_ERR( img_loader.Load( sponza, {SCENE_PATH "sponza"} ));
+	#else
 		DevILLoader		img_loader;
 		CHECK_ERR( img_loader.Load( sponza, {SCENE_PATH "sponza"}, _scene->GetImageCache() ));
+	#endif
 		
 		IntermScenePtr	bunny = loader.Load( cfg, SCENE_PATH "bunny/bunny.obj" );
 		CHECK_ERR( bunny );
@@ -114,13 +161,7 @@ namespace FG
 		transform.scale = 0.2f;
 		sponza->Append( *bunny, transform );
 
-		transform.scale	= 200.0f;
-		transform.position = vec3(0.0f);
-
-		auto	hierarchy = MakeShared<SimpleRayTracingScene>();
-		CHECK_ERR( hierarchy->Create( cmdbuf, sponza, _scene->GetImageCache(), transform ));
-
-		return hierarchy;
+		return sponza;
 	}
 
 /*
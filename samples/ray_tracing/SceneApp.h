@@ -8,6 +8,7 @@
 
 #include "scene/Renderer/IRenderTechnique.h"
 #include "scene/SceneManager/ISceneManager.h"
+#include "scene/Loader/Intermediate/IntermScene.h"
 #include "BaseSample.h"
 
 
@@ -57,6 +58,7 @@ namespace FG
 
 	private:
 		ND_ SceneHierarchyPtr  _LoadScene2 (const CommandBuffer &) const;
+		ND_ IntermScenePtr     _ImportScene2 () const;
 	};
 
 
@@ -0,0 +1,662 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SceneCache.h"
+#include "Threading/ParallelFor.h"
+#include "stl/Algorithms/StringUtils.h"
+
+#ifdef FG_ENABLE_STB
+#	define STB_DXT_STATIC
+#	define STB_DXT_IMPLEMENTATION
+#	include <stb_dxt.h>
+#endif
+
+namespace FG
+{
+namespace {
+	// all headers and blobs are aligned, so file can be mapped to memory and used as is
+	static constexpr size_t		Align		= 16;
+	static constexpr uint8_t	Zeros[Align]	= {};
+
+/*
+=================================================
+	WriteAligned
+----
+	data is padded, so the next header or blob starts at aligned offset
+=================================================
+*/
+	bool  WriteAligned (FileWStream &file, const void *data, size_t size)
+	{
+		const size_t	padding = (Align - size % Align) % Align;
+
+		CHECK_ERR( size == 0 or file.Write( data, BytesU{size} ));
+		CHECK_ERR( padding == 0 or file.Write( Zeros, BytesU{padding} ));
+		return true;
+	}
+
+/*
+=================================================
+	SkipPadding
+=================================================
+*/
+	bool  SkipPadding (FileRStream &file, size_t size)
+	{
+		const size_t	padding = (Align - size % Align) % Align;
+		return padding == 0 or file.SeekFwd( BytesU{padding} );
+	}
+
+/*
+=================================================
+	ReadAligned
+=================================================
+*/
+	bool  ReadAligned (FileRStream &file, OUT void *data, size_t size)
+	{
+		CHECK_ERR( file.Read( data, BytesU{size} ));
+		CHECK_ERR( SkipPadding( file, size ));
+		return true;
+	}
+
+	bool  ReadAligned (FileRStream &file, size_t size, OUT Array<uint8_t> &data)
+	{
+		CHECK_ERR( file.Read( size, OUT data ));
+		CHECK_ERR( SkipPadding( file, size ));
+		return true;
+	}
+
+	bool  ReadAligned (FileRStream &file, size_t size, OUT String &str)
+	{
+		CHECK_ERR( file.Read( size, OUT str ));
+		CHECK_ERR( SkipPadding( file, size ));
+		return true;
+	}
+
+/*
+=================================================
+	EncodeBC
+----
+	8 bit RGB(A) image is encoded to BC1, or to BC3 if any pixel is not opaque,
+	edge blocks are padded by clamping coordinates, block rows are encoded in parallel.
+	Returns false if format is not supported, then image must be stored as is.
+=================================================
+*/
+	bool  EncodeBC (const uint3 &dim, EPixelFormat format, BytesU rowPitch, ArrayView<uint8_t> pixels,
+					OUT EPixelFormat &outFormat, OUT BytesU &outRowPitch, OUT Array<uint8_t> &outBlocks)
+	{
+	#ifdef FG_ENABLE_STB
+		uint	bpp	= 0;
+		bool	bgr	= false;
+
+		switch ( format )
+		{
+			case EPixelFormat::RGBA8_UNorm :	bpp = 4;				break;
+			case EPixelFormat::BGRA8_UNorm :	bpp = 4;  bgr = true;	break;
+			case EPixelFormat::RGB8_UNorm :		bpp = 3;				break;
+			case EPixelFormat::BGR8_UNorm :		bpp = 3;  bgr = true;	break;
+			default :							return false;
+		}
+
+		if ( dim.z != 1 or dim.x == 0 or dim.y == 0 or pixels.size() < size_t(rowPitch) * dim.y )
+			return false;
+
+		bool	has_alpha = false;
+		for (uint y = 0; bpp == 4 and y < dim.y and not has_alpha; ++y)
+		{
+			const uint8_t*	row = pixels.data() + size_t(rowPitch) * y;
+
+			for (uint x = 0; x < dim.x and not has_alpha; ++x) {
+				has_alpha = (row[x * 4 + 3] != 255);
+			}
+		}
+
+		const uint2		blocks		= (uint2{ dim.x, dim.y } + 3u) / 4u;
+		const size_t	block_size	= has_alpha ? 16 : 8;
+
+		outFormat	= has_alpha ? EPixelFormat::BC3_RGBA8_UNorm : EPixelFormat::BC1_RGB8_UNorm;
+		outRowPitch	= BytesU{ block_size * blocks.x };
+		outBlocks.resize( block_size * blocks.x * blocks.y );
+
+		ParallelFor( blocks.y, 1, [&] (uint by)
+			{
+				uint8_t		rgba [4*4*4];
+
+				for (uint bx = 0; bx < blocks.x; ++bx)
+				{
+					for (uint i = 0; i < 16; ++i)
+					{
+						const uint		x	= Min( bx * 4 + (i & 3), dim.x - 1 );
+						const uint		y	= Min( by * 4 + (i >> 2), dim.y - 1 );
+						const uint8_t*	src	= pixels.data() + size_t(rowPitch) * y + x * bpp;
+
+						rgba[i*4 + 0] = src[ bgr ? 2 : 0 ];
+						rgba[i*4 + 1] = src[1];
+						rgba[i*4 + 2] = src[ bgr ? 0 : 2 ];
+						rgba[i*4 + 3] = bpp == 4 ? src[3] : 255;
+					}
+
+					stb_compress_dxt_block( outBlocks.data() + block_size * (by * blocks.x + bx), rgba, int(has_alpha), STB_DXT_HIGHQUAL );
+				}
+			});
+		return true;
+
+	#else
+		Unused( dim, format, rowPitch, pixels, outFormat, outRowPitch, outBlocks );
+		return false;
+	#endif
+	}
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	SourceKey
+----
+	files are not read, modification time and size
+	are enough to detect changes in sources
+=================================================
+*/
+	HashVal  SceneCache::SourceKey (ArrayView<StringView> folders)
+	{
+	#ifdef FS_HAS_FILESYSTEM
+		struct SourceFile
+		{
+			String		path;
+			uint64_t	size;
+			int64_t		time;
+		};
+
+		Array<SourceFile>	files;
+		for (auto& folder : folders)
+		{
+			const FS::path	root{ folder };
+			if ( not FS::is_directory( root ))
+				return Default;
+
+			for (auto& entry : FS::recursive_directory_iterator{ root })
+			{
+				if ( not entry.is_regular_file() )
+					continue;
+
+				files.push_back({ FS::relative( entry.path(), root.parent_path() ).generic_string(),
+								  uint64_t(entry.file_size()),
+								  int64_t(entry.last_write_time().time_since_epoch().count()) });
+			}
+		}
+
+		// directory iteration order is unspecified
+		std::sort( files.begin(), files.end(), [] (auto& lhs, auto& rhs) { return lhs.path < rhs.path; });
+
+		HashVal	key = HashOf( files.size() );
+		for (auto& file : files) {
+			key << HashOf( file.path ) << HashOf( file.size ) << HashOf( file.time );
+		}
+		return key;
+
+	#else
+		Unused( folders );
+		return Default;
+	#endif
+	}
+
+/*
+=================================================
+	Load
+----
+	vertices, indices and pixels are read directly to arrays
+	that are moved into intermediate scene, nothing is copied
+=================================================
+*/
+	IntermScenePtr  SceneCache::Load (StringView filename, HashVal key)
+	{
+		if ( key == HashVal{} )
+			return null;
+
+		FileRStream		file{ filename };
+		if ( not file.IsOpen() )
+			return null;
+
+		FileHeader	header;
+		if ( not ReadAligned( file, &header, sizeof(header) )	or
+			 header.magic	!= Magic							or
+			 header.version	!= Version							or
+			 header.key		!= uint64_t(size_t(key)) )
+		{
+			FG_LOGI( "Scene cache '"s << filename << "' is outdated" );
+			return null;
+		}
+
+		// images
+		Array<IntermImagePtr>	images;
+		images.reserve( header.imageCount );
+
+		for (uint i = 0; i < header.imageCount; ++i)
+		{
+			ImageHeader		img;
+			String			path;
+			CHECK_ERR( ReadAligned( file, &img, sizeof(img) ));
+			CHECK_ERR( ReadAligned( file, img.pathLength, OUT path ));
+
+			IntermImage::Mipmaps_t	mipmaps;
+			mipmaps.resize( img.mipmaps );
+
+			for (uint mip = 0; mip < img.mipmaps; ++mip)
+			{
+				mipmaps[mip].resize( img.layers );
+
+				for (uint layer = 0; layer < img.layers; ++layer)
+				{
+					LevelHeader		lvl;
+					CHECK_ERR( ReadAligned( file, &lvl, sizeof(lvl) ));
+
+					auto&	dst = mipmaps[mip][layer];
+					dst.dimension	= uint3{ lvl.width, lvl.height, lvl.depth };
+					dst.format		= EPixelFormat(lvl.format);
+					dst.layer		= ImageLayer{ layer };
+					dst.mipmap		= MipmapLevel{ mip };
+					dst.rowPitch	= BytesU{ lvl.rowPitch };
+					dst.slicePitch	= BytesU{ lvl.slicePitch };
+					CHECK_ERR( ReadAligned( file, size_t(lvl.size), OUT dst.pixels ));
+				}
+			}
+			images.push_back( MakeShared<IntermImage>( std::move(mipmaps), EImage(img.type), path ));
+		}
+
+		// materials
+		const auto	GetProperty = [&images] (const PropertyHeader &src, OUT IntermMaterial::Property &dst) -> bool
+		{
+			BEGIN_ENUM_CHECKS();
+			switch ( src.type )
+			{
+				case EProperty::None :		dst = NullUnion{};	break;
+				case EProperty::Color :		dst = RGBA32f{ src.value[0], src.value[1], src.value[2], src.value[3] };	break;
+				case EProperty::Scalar :	dst = src.value[0];	break;
+				case EProperty::Texture :
+				{
+					CHECK_ERR( src.image < images.size() );
+
+					IntermMaterial::MtrTexture	tex;
+					tex.image			= images[ src.image ];
+					tex.addressModeU	= decltype(tex.addressModeU)( src.addressMode[0] );
+					tex.addressModeV	= decltype(tex.addressModeV)( src.addressMode[1] );
+					tex.addressModeW	= decltype(tex.addressModeW)( src.addressMode[2] );
+					tex.filter			= decltype(tex.filter)( src.filter );
+					tex.uvIndex			= src.uvIndex;
+					dst = tex;
+					break;
+				}
+			}
+			END_ENUM_CHECKS();
+			return true;
+		};
+
+		IntermScene::MaterialMap_t	material_map;
+		Array<IntermMaterialPtr>	materials;
+		materials.reserve( header.materialCount );
+
+		for (uint i = 0; i < header.materialCount; ++i)
+		{
+			MaterialHeader	src;
+			CHECK_ERR( ReadAligned( file, &src, sizeof(src) ));
+
+			auto	mtr		= MakeShared<IntermMaterial>();
+			auto&	dst		= mtr->EditSettings();
+
+			CHECK_ERR( GetProperty( src.albedo,			OUT dst.albedo ));
+			CHECK_ERR( GetProperty( src.specular,		OUT dst.specular ));
+			CHECK_ERR( GetProperty( src.ambient,		OUT dst.ambient ));
+			CHECK_ERR( GetProperty( src.emissive,		OUT dst.emissive ));
+			CHECK_ERR( GetProperty( src.heightMap,		OUT dst.heightMap ));
+			CHECK_ERR( GetProperty( src.normalsMap,		OUT dst.normalsMap ));
+			CHECK_ERR( GetProperty( src.reflectivity,	OUT dst.reflectivity ));
+			CHECK_ERR( GetProperty( src.opacityMap,		OUT dst.opacityMap ));
+			CHECK_ERR( GetProperty( src.shininessMap,	OUT dst.shininessMap ));
+
+			dst.opacity				= src.opacity;
+			dst.shininess			= src.shininess;
+			dst.shininessStrength	= src.shininessStrength;
+			dst.opticalDepth		= src.opticalDepth;
+			dst.refraction			= src.refraction;
+			dst.cullMode			= decltype(dst.cullMode)( src.cullMode );
+
+			material_map.insert_or_assign( mtr, i );
+			materials.push_back( std::move(mtr) );
+		}
+
+		// meshes
+		IntermScene::MeshMap_t		mesh_map;
+		Array<IntermMeshPtr>		meshes;
+		meshes.reserve( header.meshCount );
+
+		for (uint i = 0; i < header.meshCount; ++i)
+		{
+			MeshHeader			src;
+			VertexInputState	vert_input;
+			Array<uint8_t>		vertices;
+			Array<uint8_t>		indices;
+
+			CHECK_ERR( ReadAligned( file, &src, sizeof(src) ));
+			vert_input.Bind( Default, BytesU{src.vertexStride} );
+
+			for (uint j = 0; j < src.attribCount; ++j)
+			{
+				AttribHeader	attr;
+				CHECK_ERR( ReadAligned( file, &attr, sizeof(attr) ));
+				CHECK_ERR( attr.name[CountOf(attr.name)-1] == 0 );
+
+				vert_input.Add( VertexID{ StringView{attr.name} }, EVertexType(attr.type), BytesU{attr.offset} );
+			}
+
+			CHECK_ERR( ReadAligned( file, size_t(src.vertexSize), OUT vertices ));
+			CHECK_ERR( ReadAligned( file, size_t(src.indexSize), OUT indices ));
+
+			auto	mesh = MakeShared<IntermMesh>( std::move(vertices), MakeShared<VertexAttributes>( vert_input ), BytesU{src.vertexStride},
+												   EPrimitive(src.topology), std::move(indices), EIndex(src.indexType) );
+
+			mesh_map.insert_or_assign( mesh, i );
+			meshes.push_back( std::move(mesh) );
+		}
+
+		// nodes, parent is always stored before its children
+		IntermScene::SceneNode			root;
+		Array<IntermScene::SceneNode*>	nodes;
+		nodes.reserve( header.nodeCount );
+
+		for (uint i = 0; i < header.nodeCount; ++i)
+		{
+			NodeHeader	src;
+			CHECK_ERR( ReadAligned( file, &src, sizeof(src) ));
+			CHECK_ERR( (i == 0) == (src.parent == UMax) and (i == 0 or src.parent < i) );
+
+			// children are reserved, so pointers to nodes are not invalidated
+			IntermScene::SceneNode*	node = &root;
+			if ( i > 0 )
+			{
+				auto&	siblings = nodes[ src.parent ]->nodes;
+				CHECK_ERR( siblings.size() < siblings.capacity() );
+				node = &siblings.emplace_back();
+			}
+
+			node->localTransform.orientation	= quat{ src.orientation.w, src.orientation.x, src.orientation.y, src.orientation.z };
+			node->localTransform.position		= src.position;
+			node->localTransform.scale			= src.scale;
+			node->nodes.reserve( src.childCount );
+
+			for (uint j = 0; j < src.modelCount; ++j)
+			{
+				ModelHeader	model;
+				CHECK_ERR( ReadAligned( file, &model, sizeof(model) ));
+				CHECK_ERR( model.mesh < meshes.size() and model.material < materials.size() );
+
+				IntermScene::ModelData	data;
+				data.mesh			= meshes[ model.mesh ];
+				data.mtr			= materials[ model.material ];
+				data.levelOfDetail	= decltype(data.levelOfDetail)( model.detailLevel );
+				node->data.push_back( std::move(data) );
+			}
+			nodes.push_back( node );
+		}
+
+		FG_LOGI( "Scene cache '"s << filename << "' is loaded" );
+		return MakeShared<IntermScene>( std::move(material_map), std::move(mesh_map), std::move(root) );
+	}
+
+/*
+=================================================
+	Store
+----
+	only models are stored, lights and node names are skipped
+=================================================
+*/
+	bool  SceneCache::Store (StringView filename, const IntermScene &scene, HashVal key)
+	{
+		CHECK_ERR( key != HashVal{} );
+
+	#ifdef FS_HAS_FILESYSTEM
+		FS::create_directories( FS::path{ filename }.parent_path() );
+	#endif
+
+		// build tables, index is a position in file
+		HashMap< IntermImagePtr, uint >		image_idx;
+		HashMap< IntermMaterialPtr, uint >	mtr_idx;
+		HashMap< IntermMeshPtr, uint >		mesh_idx;
+		Array< IntermImagePtr >				images;
+		Array< IntermMaterialPtr >			materials;
+		Array< IntermMeshPtr >				meshes;
+
+		HashSet< IntermImagePtr >			color_images;	// block compressed
+
+		const auto	AddImage = [&] (const IntermMaterial::Property &prop, bool isColor)
+		{
+			auto*	tex = UnionGetIf<IntermMaterial::MtrTexture>( &prop );
+			if ( not tex or not tex->image )
+				return;
+
+			if ( image_idx.insert({ tex->image, uint(images.size()) }).second )
+				images.push_back( tex->image );
+
+			if ( isColor )
+				color_images.insert( tex->image );
+		};
+
+		for (auto& [mtr, idx] : scene.GetMaterials())
+		{
+			if ( not mtr_idx.insert({ mtr, uint(materials.size()) }).second )
+				continue;
+
+			materials.push_back( mtr );
+
+			auto&	src = mtr->GetSettings();
+			AddImage( src.albedo, true );			AddImage( src.specular, true );		AddImage( src.ambient, true );
+			AddImage( src.emissive, true );			AddImage( src.heightMap, false );	AddImage( src.normalsMap, false );
+			AddImage( src.reflectivity, false );	AddImage( src.opacityMap, false );	AddImage( src.shininessMap, false );
+		}
+
+		for (auto& [mesh, idx] : scene.GetMeshes())
+		{
+			if ( mesh_idx.insert({ mesh, uint(meshes.size()) }).second )
+				meshes.push_back( mesh );
+		}
+
+		// nodes in depth-first order
+		Array<Pair< IntermScene::SceneNode const*, uint >>	nodes;
+		{
+			Array<Pair< IntermScene::SceneNode const*, uint >>	stack;
+			stack.emplace_back( &scene.GetRoot(), UMax );
+
+			for (; not stack.empty();)
+			{
+				auto	item = stack.back();
+				stack.pop_back();
+
+				const uint	idx = uint(nodes.size());
+				nodes.push_back( item );
+
+				// reversed, so children are stored in the same order
+				for (auto iter = item.first->nodes.rbegin(); iter != item.first->nodes.rend(); ++iter) {
+					stack.emplace_back( &*iter, idx );
+				}
+			}
+		}
+
+		FileWStream		file{ filename };
+		CHECK_ERR( file.IsOpen() );
+
+		FileHeader	header;
+		header.magic			= Magic;
+		header.version			= Version;
+		header.key				= uint64_t(size_t(key));
+		header.imageCount		= uint(images.size());
+		header.materialCount	= uint(materials.size());
+		header.meshCount		= uint(meshes.size());
+		header.nodeCount		= uint(nodes.size());
+		CHECK_ERR( WriteAligned( file, &header, sizeof(header) ));
+
+		// images, data maps are stored as is because BC1 and BC3 distort them
+		Array<uint8_t>	blocks;
+
+		for (auto& image : images)
+		{
+			const bool	is_color = color_images.count( image ) > 0;
+			auto&		data	 = image->GetData();
+			ImageHeader	img;
+			img.type		= uint(image->GetType());
+			img.mipmaps		= uint(data.size());
+			img.layers		= data.empty() ? 0 : uint(data[0].size());
+			img.pathLength	= uint(image->GetPath().size());
+
+			CHECK_ERR( WriteAligned( file, &img, sizeof(img) ));
+			CHECK_ERR( WriteAligned( file, image->GetPath().data(), img.pathLength ));
+
+			for (auto& layers : data)
+			{
+				CHECK_ERR( layers.size() == img.layers );
+
+				for (auto& level : layers)
+				{
+					LevelHeader	lvl;
+					lvl.width		= level.dimension.x;
+					lvl.height		= level.dimension.y;
+					lvl.depth		= level.dimension.z;
+					lvl.format		= uint(level.format);
+					lvl.rowPitch	= uint64_t(level.rowPitch);
+					lvl.slicePitch	= uint64_t(level.slicePitch);
+					lvl.size		= uint64_t(level.pixels.size());
+
+					EPixelFormat	bc_format;
+					BytesU			bc_row_pitch;
+
+					if ( is_color and EncodeBC( level.dimension, level.format, level.rowPitch, level.pixels, OUT bc_format, OUT bc_row_pitch, OUT blocks ))
+					{
+						lvl.format		= uint(bc_format);
+						lvl.rowPitch	= uint64_t(bc_row_pitch);
+						lvl.slicePitch	= uint64_t(blocks.size());
+						lvl.size		= uint64_t(blocks.size());
+
+						CHECK_ERR( WriteAligned( file, &lvl, sizeof(lvl) ));
+						CHECK_ERR( WriteAligned( file, blocks.data(), blocks.size() ));
+						continue;
+					}
+
+					CHECK_ERR( WriteAligned( file, &lvl, sizeof(lvl) ));
+					CHECK_ERR( WriteAligned( file, level.pixels.data(), level.pixels.size() ));
+				}
+			}
+		}
+
+		// materials
+		const auto	SetProperty = [&image_idx] (const IntermMaterial::Property &src, OUT PropertyHeader &dst)
+		{
+			Visit( src,
+				[&dst] (const NullUnion &)		{ dst.type = EProperty::None; },
+				[&dst] (const RGBA32f &col)		{ dst.type = EProperty::Color;  dst.value[0] = col.r;  dst.value[1] = col.g;  dst.value[2] = col.b;  dst.value[3] = col.a; },
+				[&dst] (const float &val)		{ dst.type = EProperty::Scalar;  dst.value[0] = val; },
+				[&] (const IntermMaterial::MtrTexture &tex)
+				{
+					dst.type			= tex.image ? EProperty::Texture : EProperty::None;
+					dst.image			= tex.image ? image_idx[ tex.image ] : UMax;
+					dst.addressMode[0]	= uint(tex.addressModeU);
+					dst.addressMode[1]	= uint(tex.addressModeV);
+					dst.addressMode[2]	= uint(tex.addressModeW);
+					dst.filter			= uint(tex.filter);
+					dst.uvIndex			= tex.uvIndex;
+				});
+		};
+
+		for (auto& mtr : materials)
+		{
+			auto&			src = mtr->GetSettings();
+			MaterialHeader	dst;
+
+			SetProperty( src.albedo,		OUT dst.albedo );
+			SetProperty( src.specular,		OUT dst.specular );
+			SetProperty( src.ambient,		OUT dst.ambient );
+			SetProperty( src.emissive,		OUT dst.emissive );
+			SetProperty( src.heightMap,		OUT dst.heightMap );
+			SetProperty( src.normalsMap,	OUT dst.normalsMap );
+			SetProperty( src.reflectivity,	OUT dst.reflectivity );
+			SetProperty( src.opacityMap,	OUT dst.opacityMap );
+			SetProperty( src.shininessMap,	OUT dst.shininessMap );
+
+			dst.opacity				= src.opacity;
+			dst.shininess			= src.shininess;
+			dst.shininessStrength	= src.shininessStrength;
+			dst.opticalDepth		= src.opticalDepth;
+			dst.refraction			= src.refraction;
+			dst.cullMode			= uint(src.cullMode);
+
+			CHECK_ERR( WriteAligned( file, &dst, sizeof(dst) ));
+		}
+
+		// meshes
+		for (auto& mesh : meshes)
+		{
+			auto&		attribs	= mesh->GetAttribs()->GetVertexInput().vertices;
+			MeshHeader	dst;
+			dst.topology		= uint(mesh->GetTopology());
+			dst.indexType		= uint(mesh->GetIndexType());
+			dst.vertexStride	= uint(mesh->GetVertexStride());
+			dst.attribCount		= uint(attribs.size());
+			dst.vertexSize		= uint64_t(mesh->GetData().size());
+			dst.indexSize		= uint64_t(mesh->GetIndices().size());
+
+			CHECK_ERR( WriteAligned( file, &dst, sizeof(dst) ));
+
+			for (auto& [id, src] : attribs)
+			{
+				const StringView	name = id.GetName();
+				CHECK_ERR( name.size() < CountOf(AttribHeader{}.name) );
+
+				AttribHeader	attr;
+				std::memcpy( attr.name, name.data(), name.size() );
+				attr.type	= uint(src.type);
+				attr.offset	= uint(src.offset);
+				attr.index	= src.index;
+
+				CHECK_ERR( WriteAligned( file, &attr, sizeof(attr) ));
+			}
+
+			CHECK_ERR( WriteAligned( file, mesh->GetData().data(), mesh->GetData().size() ));
+			CHECK_ERR( WriteAligned( file, mesh->GetIndices().data(), mesh->GetIndices().size() ));
+		}
+
+		// nodes
+		for (auto& [node, parent] : nodes)
+		{
+			const auto&	tr = node->localTransform;
+			NodeHeader	dst;
+			dst.orientation	= float4{ tr.orientation.x, tr.orientation.y, tr.orientation.z, tr.orientation.w };
+			dst.position	= tr.position;
+			dst.scale		= tr.scale;
+			dst.parent		= parent;
+			dst.childCount	= uint(node->nodes.size());
+
+			for (auto& data : node->data) {
+				dst.modelCount += uint(UnionGetIf<IntermScene::ModelData>( &data ) != null);
+			}
+			CHECK_ERR( WriteAligned( file, &dst, sizeof(dst) ));
+
+			for (auto& data : node->data)
+			{
+				auto*	src = UnionGetIf<IntermScene::ModelData>( &data );
+				if ( not src )
+					continue;
+
+				auto	mesh	= mesh_idx.find( src->mesh );
+				auto	mtr		= mtr_idx.find( src->mtr );
+				CHECK_ERR( mesh != mesh_idx.end() and mtr != mtr_idx.end() );
+
+				ModelHeader	model;
+				model.mesh			= mesh->second;
+				model.material		= mtr->second;
+				model.detailLevel	= uint(src->levelOfDetail);
+				CHECK_ERR( WriteAligned( file, &model, sizeof(model) ));
+			}
+		}
+
+		FG_LOGI( "Scene cache saved to '"s << filename << "'" );
+		return true;
+	}
+
+
+}	// FG
@@ -0,0 +1,150 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "scene/Loader/Intermediate/IntermScene.h"
+#include "stl/Stream/FileStream.h"
+
+namespace FG
+{
+
+	//
+	// Scene Cache
+	//
+	// Binary container with imported scene: images, material table, vertex and index streams and scene nodes.
+	// Colour textures are encoded to BC1 or BC3 when cache is written, other images are stored decoded.
+	// Streams and pixels are stored as is and all data is aligned in file, so loading is a sequence of reads
+	// into the final arrays without any parsing, Assimp and DevIL are not used.
+	// Cache is keyed by hash of source files (path, size and modification time), outdated cache is ignored.
+	//
+
+	class SceneCache final
+	{
+	// types
+	private:
+		// file layout: 'FileHeader', images, materials, meshes, nodes
+		struct FileHeader
+		{
+			uint		magic			= 0;
+			uint		version			= 0;
+			uint64_t	key				= 0;
+			uint		imageCount		= 0;
+			uint		materialCount	= 0;
+			uint		meshCount		= 0;
+			uint		nodeCount		= 0;
+		};
+
+		// followed by source path, then 'LevelHeader' and pixels for each mipmap and layer
+		struct ImageHeader
+		{
+			uint		type			= 0;
+			uint		mipmaps			= 0;
+			uint		layers			= 0;
+			uint		pathLength		= 0;	// image cache may use path as a key
+		};
+
+		struct LevelHeader
+		{
+			uint		width			= 0;
+			uint		height			= 0;
+			uint		depth			= 0;
+			uint		format			= 0;	// 'EPixelFormat', block compressed for colour textures
+			uint64_t	rowPitch		= 0;	// row of blocks for block compressed format
+			uint64_t	slicePitch		= 0;
+			uint64_t	size			= 0;
+		};
+
+		enum class EProperty : uint
+		{
+			None,
+			Color,
+			Scalar,
+			Texture,
+		};
+
+		struct PropertyHeader
+		{
+			EProperty	type			= EProperty::None;
+			uint		image			= UMax;		// index in image table
+			uint		addressMode[3]	= {};
+			uint		filter			= 0;
+			uint		uvIndex			= 0;
+			float		value[4]		= {};
+		};
+
+		struct MaterialHeader
+		{
+			PropertyHeader	albedo;
+			PropertyHeader	specular;
+			PropertyHeader	ambient;
+			PropertyHeader	emissive;
+			PropertyHeader	heightMap;
+			PropertyHeader	normalsMap;
+			PropertyHeader	reflectivity;
+			PropertyHeader	opacityMap;
+			PropertyHeader	shininessMap;
+			float			opacity				= 0.0f;
+			float			shininess			= 0.0f;
+			float			shininessStrength	= 0.0f;
+			float			opticalDepth		= 0.0f;
+			float			refraction			= 0.0f;
+			uint			cullMode			= 0;
+		};
+
+		// followed by 'AttribHeader' for each attribute, vertices and indices
+		struct MeshHeader
+		{
+			uint		topology		= 0;
+			uint		indexType		= 0;
+			uint		vertexStride	= 0;
+			uint		attribCount		= 0;
+			uint64_t	vertexSize		= 0;
+			uint64_t	indexSize		= 0;
+		};
+
+		struct AttribHeader
+		{
+			char		name[32]		= {};
+			uint		type			= 0;
+			uint		offset			= 0;
+			uint		index			= 0;
+			uint		_padding		= 0;
+		};
+
+		// nodes are stored in depth-first order, followed by 'ModelHeader' for each model
+		struct NodeHeader
+		{
+			float4		orientation;
+			float3		position;
+			float		scale			= 1.0f;
+			uint		parent			= UMax;		// index of parent node, 'UMax' for root
+			uint		modelCount		= 0;
+			uint		childCount		= 0;
+			uint		_padding		= 0;
+		};
+
+		struct ModelHeader
+		{
+			uint		mesh			= 0;
+			uint		material		= 0;
+			uint		detailLevel		= 0;
+			uint		_padding		= 0;
+		};
+
+		static constexpr uint	Magic		= 0x48435353;	// 'SSCH'
+		static constexpr uint	Version		= 2;
+
+
+	// methods
+	public:
+		// hash of all files in source folders, returns zero if sources are not found
+		ND_ static HashVal  SourceKey (ArrayView<StringView> folders);
+
+		// returns null if cache is missing or outdated
+		ND_ static IntermScenePtr  Load (StringView filename, HashVal key);
+
+		static bool  Store (StringView filename, const IntermScene &scene, HashVal key);
+	};
+
+
+}	// FG
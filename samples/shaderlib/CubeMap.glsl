@@ -81,3 +81,33 @@ float3  CM_TangentialSC_Inverse (const float3 coord)
 	float2	c = ATan( coord_face.xy * tan_warp_theta ) / warp_theta;
 	return float3( c.xy, coord_face.w );
 }
+
+
+// Adjusted Spherical Cube Projection
+// polynomial warp, see 'AdjustedSphericalCube' in 'SphericalCubeMath.h'
+float3  CM_AdjustedSC_Forward (const float2 snormCoord, const int face)
+{
+	const float3	k		= float3( 0.746347207264, 0.123801575608, 0.129851217128 );
+	const float2	x2		= snormCoord * snormCoord;
+	float2			coord	= snormCoord * (k.x + x2 * (k.y + x2 * k.z));
+
+	return Normalize( CM_RotateVec( float3(coord.x, coord.y, 1.0), face ));
+}
+
+float3  CM_AdjustedSC_Inverse (const float3 coord)
+{
+	const float3	k		= float3( 0.746347207264, 0.123801575608, 0.129851217128 );
+	const float3	inv_k	= float3( 1.343150151512, -0.482312823340, 0.139162671828 );
+
+	float4	coord_face = CM_InverseRotation( coord );
+	coord_face.xy /= coord_face.z;
+
+	const float2	c	= coord_face.xy;
+	const float2	c2	= c * c;
+	float2			x	= c * (inv_k.x + c2 * (inv_k.y + c2 * inv_k.z));
+	const float2	x2	= x * x;
+
+	// single Newton iteration is enough for float precision
+	x -= (x * (k.x + x2 * (k.y + x2 * k.z)) - c) / (k.x + x2 * (3.0 * k.y + x2 * 5.0 * k.z));
+	return float3( x, coord_face.w );
+}
@@ -18,6 +18,18 @@ void  GetRayPerpendicular (const float3 dir, out float3 outLeft, out float3 outU
 }
 
 
+// inverse of octahedral encoding, 'e' in range [-1, 1]
+float3  DecodeOctahedral (const float2 e)
+{
+	float3	n = float3( e.x, e.y, 1.0 - Abs(e.x) - Abs(e.y) );
+
+	if ( n.z < 0.0 )
+		n.xy = float2( (1.0 - Abs(n.y)) * Sign(n.x), (1.0 - Abs(n.x)) * Sign(n.y) );
+
+	return Normalize( n );
+}
+
+
 float  ToLinearDepth (float nonLinearDepth, const float2 clipPlanes)
 {
 	//float  d = 2.0 * nonLinearDepth - 1.0;	// for OpenGL
@@ -0,0 +1,146 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "ParallelImageLoader.h"
+
+#ifdef FG_ENABLE_STB
+
+#include "Threading/ParallelFor.h"
+#include "stl/Algorithms/StringUtils.h"
+
+// symbols are static, so stb_image can be used in other targets too
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace FG
+{
+
+/*
+=================================================
+	_FindImage
+----
+	returns the first existing file in directories
+=================================================
+*/
+	String  ParallelImageLoader::_FindImage (StringView path, ArrayView<StringView> directories)
+	{
+	#ifdef FS_HAS_FILESYSTEM
+		for (auto& dir : directories)
+		{
+			const FS::path	fpath = FS::path{ dir } / FS::path{ path };
+
+			if ( FS::exists( fpath ))
+				return fpath.string();
+		}
+		return String{path};
+
+	#else
+		return directories.empty() ? String{path} : (String{directories.front()} << "/" << path);
+	#endif
+	}
+
+/*
+=================================================
+	Load
+----
+	each image is a separate task, decoding takes much more time
+	than scheduling, so batch size is 1
+=================================================
+*/
+	bool  ParallelImageLoader::Load (const IntermScenePtr &scene, ArrayView<StringView> directories) const
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		CHECK_ERR( scene );
+
+		// collect images without data, material map is unordered, so images are sorted by path
+		Array<IntermImagePtr>		images;
+		HashSet<IntermImage const*>	unique;
+
+		const auto	AddImage = [&] (const IntermMaterial::Property &prop)
+		{
+			if ( auto* tex = UnionGetIf<IntermMaterial::MtrTexture>( &prop ); tex and tex->image and tex->image->GetData().empty() and unique.insert( tex->image.get() ).second )
+				images.push_back( tex->image );
+		};
+
+		for (auto& [mtr, idx] : scene->GetMaterials())
+		{
+			auto&	src = mtr->GetSettings();
+			AddImage( src.albedo );			AddImage( src.specular );		AddImage( src.ambient );
+			AddImage( src.emissive );		AddImage( src.heightMap );		AddImage( src.normalsMap );
+			AddImage( src.reflectivity );	AddImage( src.opacityMap );		AddImage( src.shininessMap );
+		}
+
+		std::sort( images.begin(), images.end(), [] (auto& lhs, auto& rhs) { return lhs->GetPath() < rhs->GetPath(); });
+
+		struct Decoded
+		{
+			Array<uint8_t>	pixels;
+			uint2			dimension;
+			String			error;
+		};
+
+		const auto		start_time	= Clock::now();
+		Array<Decoded>	decoded;
+		decoded.resize( images.size() );
+
+		// stb_image has no global state except error message and flip flag that is not used
+		ParallelFor( uint(images.size()), 1, [&images, &decoded, directories] (uint i)
+		{
+			const String	path	= _FindImage( images[i]->GetPath(), directories );
+			auto&			dst		= decoded[i];
+			int				width	= 0;
+			int				height	= 0;
+			int				channels = 0;
+
+			stbi_uc*	pixels = stbi_load( path.c_str(), OUT &width, OUT &height, OUT &channels, STBI_rgb_alpha );
+			if ( not pixels )
+			{
+				dst.error = "failed to load image '"s << path << "'";
+				return;
+			}
+
+			dst.dimension = uint2{ uint(width), uint(height) };
+			dst.pixels.assign( pixels, pixels + size_t(width) * size_t(height) * 4 );
+			stbi_image_free( pixels );
+		});
+
+		const auto	decode_time = Clock::now();
+
+		// attach data in order
+		bool	result = true;
+		for (size_t i = 0; i < images.size(); ++i)
+		{
+			auto&	src = decoded[i];
+			if ( not src.error.empty() )
+			{
+				FG_LOGE( src.error );
+				result = false;
+				continue;
+			}
+
+			IntermImage::Level	level;
+			level.dimension		= uint3{ src.dimension, 1u };
+			level.format		= EPixelFormat::RGBA8_UNorm;
+			level.layer			= 0_layer;
+			level.mipmap		= 0_mipmap;
+			level.rowPitch		= BytesU{ src.dimension.x * 4ull };
+			level.slicePitch	= level.rowPitch * src.dimension.y;
+			level.pixels		= std::move(src.pixels);
+
+			IntermImage::Mipmaps_t	mipmaps;
+			mipmaps.resize( 1 );
+			mipmaps[0].push_back( std::move(level) );
+
+			images[i]->SetData( std::move(mipmaps), EImage_2D );
+		}
+
+		FG_LOGI( "Decoded "s << ToString( images.size() ) << " images on " << ToString( Max( 1u, std::thread::hardware_concurrency() )) << " threads in "
+				 << ToString( std::chrono::duration_cast<Nanoseconds>( decode_time - start_time )) );
+		return result;
+	}
+
+
+}	// FG
+
+#endif	// FG_ENABLE_STB
@@ -0,0 +1,37 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "scene/Loader/Intermediate/IntermScene.h"
+
+#ifdef FG_ENABLE_STB
+
+namespace FG
+{
+
+	//
+	// Parallel Image Loader
+	//
+	// Loads images of scene materials, used instead of 'DevILLoader' which is not thread safe.
+	// Images are decoded by stb_image on worker threads, then decoded data is attached to
+	// intermediate images on the calling thread in the same order for any number of threads.
+	// Images are uploaded later by the image cache in a single command buffer.
+	//
+
+	class ParallelImageLoader final
+	{
+	// methods
+	public:
+		ParallelImageLoader () {}
+
+		// loads images that have no data, returns 'false' if any image is not loaded
+		ND_ bool  Load (const IntermScenePtr &scene, ArrayView<StringView> directories) const;
+
+	private:
+		ND_ static String  _FindImage (StringView path, ArrayView<StringView> directories);
+	};
+
+
+}	// FG
+
+#endif	// FG_ENABLE_STB
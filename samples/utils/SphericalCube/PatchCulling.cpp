@@ -0,0 +1,231 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "PatchCulling.h"
+
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_AMD64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+#	define PATCH_CULLING_SSE
+#	include <emmintrin.h>
+#endif
+
+namespace FG
+{
+namespace {
+
+	//
+	// Horizon
+	//
+	struct Horizon
+	{
+		float3	dir;				// from origin to camera
+		float	plane		= 0.0f;	// distance from origin to the plane of horizon circle
+		float	sinAngle	= 0.0f;	// half angle of the cone from camera tangent to occluder
+		float	cosAngle	= 0.0f;
+		bool	enabled		= false;
+	};
+
+	ND_ Horizon  CalcHorizon (const PatchCulling::Params &params)
+	{
+		Horizon		result;
+		const float	dist	= Length( params.camera );
+
+		result.enabled = params.horizonCulling and params.occluderRadius > 0.0f and dist > params.occluderRadius;
+
+		if ( result.enabled )
+		{
+			result.dir		= params.camera / dist;
+			result.plane	= Square( params.occluderRadius ) / dist;
+			result.sinAngle	= params.occluderRadius / dist;
+			result.cosAngle	= Sqrt( 1.0f - Square( result.sinAngle ));
+		}
+		return result;
+	}
+
+/*
+=================================================
+	IsVisibleImpl
+----
+	Horizon: sphere is occluded if it is inside the cone from camera tangent
+	to occluder and behind the plane of horizon circle.
+	Distance from sphere center to the cone side is 'sin(a) * t - cos(a) * |v x axis|'.
+
+	Backface: all triangles are backfacing if 'Dot( center - camera, coneAxis ) >= coneCutoff * Distance( center, camera ) + radius'.
+=================================================
+*/
+	ND_ bool  IsVisibleImpl (const PatchCulling::Bounds &b, size_t i, const PatchCulling::Params &params, const Horizon &horizon)
+	{
+		const float3	center	{ b.centerX[i], b.centerY[i], b.centerZ[i] };
+		const float		radius	= b.radius[i];
+
+		if ( params.frustumCulling )
+		{
+			for (auto& plane : params.frustum)
+			{
+				if ( Dot( float3{ plane.x, plane.y, plane.z }, center ) + (plane.w + radius) < 0.0f )
+					return false;
+			}
+		}
+
+		const float3	v	= center - params.camera;
+		const float		dv2	= Dot( v, v );
+
+		if ( horizon.enabled )
+		{
+			const float		t		= -Dot( v, horizon.dir );
+			const float		side	= horizon.sinAngle * t - horizon.cosAngle * Sqrt( Max( 0.0f, dv2 - t*t ));
+
+			if ( side >= radius and Dot( center, horizon.dir ) + radius <= horizon.plane )
+				return false;
+		}
+
+		if ( params.backfaceCulling and b.cutoff[i] < 1.0f )
+		{
+			const float3	axis { b.axisX[i], b.axisY[i], b.axisZ[i] };
+
+			if ( Dot( v, axis ) >= b.cutoff[i] * Sqrt( dv2 ) + radius )
+				return false;
+		}
+		return true;
+	}
+
+}	// namespace
+//-----------------------------------------------------------------------------
+
+
+/*
+=================================================
+	Bounds::Resize
+=================================================
+*/
+	void  PatchCulling::Bounds::Resize (size_t count)
+	{
+		centerX.resize( count );	centerY.resize( count );	centerZ.resize( count );	radius.resize( count );
+		axisX.resize( count );		axisY.resize( count );		axisZ.resize( count );		cutoff.resize( count );
+	}
+
+/*
+=================================================
+	Bounds::Set
+=================================================
+*/
+	void  PatchCulling::Bounds::Set (size_t i, const float3 &center, float rad, const float3 &coneAxis, float coneCutoff)
+	{
+		centerX[i] = center.x;		centerY[i] = center.y;		centerZ[i] = center.z;		radius[i] = rad;
+		axisX[i]   = coneAxis.x;	axisY[i]   = coneAxis.y;	axisZ[i]   = coneAxis.z;	cutoff[i] = coneCutoff;
+	}
+
+/*
+=================================================
+	IsVisible
+=================================================
+*/
+	bool  PatchCulling::IsVisible (const Bounds &bounds, size_t i, const Params &params)
+	{
+		return IsVisibleImpl( bounds, i, params, CalcHorizon( params ));
+	}
+
+/*
+=================================================
+	Cull
+----
+	processes 4 patches per iteration, remaining patches are processed
+	by the scalar version
+=================================================
+*/
+	void  PatchCulling::Cull (const Bounds &b, const Params &params, OUT Array<uint> &visible)
+	{
+		const Horizon	horizon	= CalcHorizon( params );
+		size_t			i		= 0;
+
+		visible.clear();
+		visible.reserve( b.size() );
+
+	#ifdef PATCH_CULLING_SSE
+		const __m128	zero	= _mm_setzero_ps();
+		const __m128	one		= _mm_set1_ps( 1.0f );
+		const __m128	cam_x	= _mm_set1_ps( params.camera.x );
+		const __m128	cam_y	= _mm_set1_ps( params.camera.y );
+		const __m128	cam_z	= _mm_set1_ps( params.camera.z );
+
+		for (; i + 4 <= b.size(); i += 4)
+		{
+			const __m128	cx		= _mm_loadu_ps( b.centerX.data() + i );
+			const __m128	cy		= _mm_loadu_ps( b.centerY.data() + i );
+			const __m128	cz		= _mm_loadu_ps( b.centerZ.data() + i );
+			const __m128	r		= _mm_loadu_ps( b.radius.data() + i );
+			const __m128	vx		= _mm_sub_ps( cx, cam_x );
+			const __m128	vy		= _mm_sub_ps( cy, cam_y );
+			const __m128	vz		= _mm_sub_ps( cz, cam_z );
+			const __m128	dv2		= _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, vx ), _mm_mul_ps( vy, vy )), _mm_mul_ps( vz, vz ));
+			__m128			culled	= zero;
+
+			if ( params.frustumCulling )
+			{
+				for (auto& plane : params.frustum)
+				{
+					const __m128	d = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, _mm_set1_ps( plane.x )), _mm_mul_ps( cy, _mm_set1_ps( plane.y ))),
+															   _mm_mul_ps( cz, _mm_set1_ps( plane.z ))),
+												   _mm_add_ps( _mm_set1_ps( plane.w ), r ));
+					culled = _mm_or_ps( culled, _mm_cmplt_ps( d, zero ));
+				}
+			}
+
+			if ( horizon.enabled )
+			{
+				const __m128	t		= _mm_sub_ps( zero, _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, _mm_set1_ps( horizon.dir.x )), _mm_mul_ps( vy, _mm_set1_ps( horizon.dir.y ))),
+																	_mm_mul_ps( vz, _mm_set1_ps( horizon.dir.z ))));
+				const __m128	perp	= _mm_sqrt_ps( _mm_max_ps( zero, _mm_sub_ps( dv2, _mm_mul_ps( t, t ))));
+				const __m128	side	= _mm_sub_ps( _mm_mul_ps( t, _mm_set1_ps( horizon.sinAngle )), _mm_mul_ps( perp, _mm_set1_ps( horizon.cosAngle )));
+				const __m128	height	= _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, _mm_set1_ps( horizon.dir.x )), _mm_mul_ps( cy, _mm_set1_ps( horizon.dir.y ))),
+															  _mm_mul_ps( cz, _mm_set1_ps( horizon.dir.z ))), r );
+				const __m128	hidden	= _mm_and_ps( _mm_cmpge_ps( side, r ), _mm_cmple_ps( height, _mm_set1_ps( horizon.plane )));
+
+				culled = _mm_or_ps( culled, hidden );
+			}
+
+			if ( params.backfaceCulling )
+			{
+				const __m128	ax		= _mm_loadu_ps( b.axisX.data() + i );
+				const __m128	ay		= _mm_loadu_ps( b.axisY.data() + i );
+				const __m128	az		= _mm_loadu_ps( b.axisZ.data() + i );
+				const __m128	cutoff	= _mm_loadu_ps( b.cutoff.data() + i );
+				const __m128	d		= _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, ax ), _mm_mul_ps( vy, ay )), _mm_mul_ps( vz, az ));
+				const __m128	limit	= _mm_add_ps( _mm_mul_ps( cutoff, _mm_sqrt_ps( dv2 )), r );
+				const __m128	back	= _mm_and_ps( _mm_cmplt_ps( cutoff, one ), _mm_cmpge_ps( d, limit ));
+
+				culled = _mm_or_ps( culled, back );
+			}
+
+			const uint	mask = ~uint(_mm_movemask_ps( culled ));
+
+			for (uint j = 0; j < 4; ++j)
+			{
+				if ( mask & (1u << j) )
+					visible.push_back( uint(i + j) );
+			}
+		}
+	#endif
+
+		for (; i < b.size(); ++i)
+		{
+			if ( IsVisibleImpl( b, i, params, horizon ))
+				visible.push_back( uint(i) );
+		}
+	}
+
+/*
+=================================================
+	NormalizePlanes
+=================================================
+*/
+	PatchCulling::Frustum_t  PatchCulling::NormalizePlanes (const Frustum_t &planes)
+	{
+		Frustum_t	result;
+		for (size_t i = 0; i < planes.size(); ++i)
+		{
+			result[i] = planes[i] / Length( float3{ planes[i].x, planes[i].y, planes[i].z });
+		}
+		return result;
+	}
+
+
+}	// FG
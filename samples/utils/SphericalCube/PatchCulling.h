@@ -0,0 +1,57 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "SphericalCubeMath.h"
+
+namespace FG
+{
+
+	//
+	// Patch Culling
+	//
+
+	class PatchCulling final
+	{
+	// types
+	public:
+		// normalized planes, 'xyz' - normal, 'w' - distance, point is inside if 'Dot( xyz, p ) + w >= 0'
+		using Frustum_t	= StaticArray< float4, 6 >;
+
+		// patch bounds in SoA layout
+		struct Bounds
+		{
+			Array<float>	centerX, centerY, centerZ, radius;		// bounding sphere
+			Array<float>	axisX, axisY, axisZ, cutoff;			// normal cone, see 'SphericalCube::Meshlet'
+
+			void  Resize (size_t count);
+			void  Set (size_t i, const float3 &center, float radius, const float3 &coneAxis = float3{0.0f}, float coneCutoff = 1.0f);
+
+			ND_ size_t  size ()	const	{ return centerX.size(); }
+		};
+
+		struct Params
+		{
+			Frustum_t	frustum;
+			float3		camera;
+			float		occluderRadius	= 0.0f;		// all patches are outside of occluder sphere with center in origin
+			bool		frustumCulling	= false;
+			bool		horizonCulling	= false;
+			bool		backfaceCulling	= false;
+		};
+
+
+	// methods
+	public:
+		// writes indices of visible patches
+		static void  Cull (const Bounds &bounds, const Params &params, OUT Array<uint> &visible);
+
+		// scalar version, used as reference
+		ND_ static bool  IsVisible (const Bounds &bounds, size_t i, const Params &params);
+
+		// 'planes' - unnormalized planes in the same form as 'Frustum_t'
+		ND_ static Frustum_t  NormalizePlanes (const Frustum_t &planes);
+	};
+
+
+}	// FG
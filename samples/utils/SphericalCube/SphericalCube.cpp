@@ -1,20 +1,95 @@
 // Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
 
 #include "SphericalCube.h"
+#include "Threading/ParallelFor.h"
 #include "stl/Algorithms/StringUtils.h"
 
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_AMD64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+#	define SPHERICAL_CUBE_SSE
+#	include <emmintrin.h>
+#endif
+
 namespace FG
 {
 namespace {
-
-	ND_ inline uint  CalcVertCount (uint lod)
+	// small grids are generated on the calling thread, see 'ParallelFor'
+	static constexpr uint	MinVerticesPerBatch = 4096;
+	
+	// sum of squares: 1^2 + 2^2 + ... + n^2
+	ND_ inline constexpr uint  SumOfSquares (uint n)
 	{
-		return (lod+2) * (lod+2) * 6;
+		return n * (n+1) * (2*n+1) / 6;
 	}
 	
-	ND_ inline uint  CalcIndexCount (uint lod, bool useQuads)
+	// 1 + 2 + ... + n
+	ND_ inline constexpr uint  SumOfNumbers (uint n)
 	{
-		return 6*(useQuads ? 4 : 6) * (lod+1) * (lod+1);
+		return n * (n+1) / 2;
+	}
+
+	// tolerance for segment parameter in 'RayCast'
+	static constexpr float	RayEpsilon = 0.0001f;
+
+	// roots of 'Distance( begin + mu * (end - begin), center ) == radius', 'mu1 <= mu2',
+	// operations are in the same order as in SIMD version of 'RayCast'
+	ND_ inline bool  IntersectSphere (const float3 &center, float radius, const float3 &begin, const float3 &end, OUT float &mu1, OUT float &mu2)
+	{
+		const float3	d		= end - begin;
+		const float3	m		= begin - center;
+		const float		a		= d.x * d.x + d.y * d.y + d.z * d.z;
+		const float		b		= m.x * d.x + m.y * d.y + m.z * d.z;
+		const float		c		= (m.x * m.x + m.y * m.y + m.z * m.z) - radius * radius;
+		const float		disc	= b * b - a * c;
+
+		if ( not (disc >= 0.0f) )
+			return false;
+
+		const float		sq		= Sqrt( disc );
+
+		mu1 = (-b - sq) / a;
+		mu2 = (-b + sq) / a;
+		return true;
+	}
+
+	// nearest point of segment on sphere
+	ND_ inline bool  IntersectSphereSurface (const float3 &center, float radius, const float3 &begin, const float3 &end, OUT float &mu)
+	{
+		float	mu1, mu2;
+		if ( not IntersectSphere( center, radius, begin, end, OUT mu1, OUT mu2 ))
+			return false;
+
+		const bool	mu1_valid	= (mu1 > -RayEpsilon) & (mu1 < 1.0f + RayEpsilon);
+		const bool	mu2_valid	= (mu2 > -RayEpsilon) & (mu2 < 1.0f + RayEpsilon);
+
+		mu = mu1_valid ? mu1 : mu2;
+		return mu1_valid | mu2_valid;
+	}
+
+	// nearest point of segment inside of the ball
+	ND_ inline bool  IntersectSphereSolid (const float3 &center, float radius, const float3 &begin, const float3 &end, OUT float &mu)
+	{
+		float	mu1, mu2;
+		if ( not IntersectSphere( center, radius, begin, end, OUT mu1, OUT mu2 ))
+			return false;
+
+		mu = Max( mu1, 0.0f );
+		return (mu2 > -RayEpsilon) & (mu1 < 1.0f + RayEpsilon);
+	}
+
+	// quad diagonals are mirrored in each quarter of face to make grid symmetric
+	ND_ inline bool  UseMainDiagonal (uint x, uint y, uint quadCount)
+	{
+		return (x < quadCount/2 and y < quadCount/2) or (x >= quadCount/2 and y >= quadCount/2);
+	}
+
+	ND_ inline uint  PackSNorm16 (float x)
+	{
+		return uint(int(std::round( Clamp( x, -1.0f, 1.0f ) * 32767.0f )) & 0xFFFF);
+	}
+
+	ND_ inline float  UnpackSNorm16 (uint x)
+	{
+		return Max( float(int16_t(x & 0xFFFF)) / 32767.0f, -1.0f );
 	}
 }
 //-----------------------------------------------------------------------------
@@ -28,6 +103,7 @@ namespace {
 	SphericalCube::~SphericalCube ()
 	{
 		CHECK( not _vertexBuffer );
+		CHECK( not _tangentBuffer );
 		CHECK( not _indexBuffer );
 	}
 
@@ -39,10 +115,10 @@ namespace {
 	lod = x -- has {(x+1)*(x+2)*4 + x*x*2} vertices, (6*6*(x+1)^2) indices
 =================================================
 */
-	bool  SphericalCube::Create (const CommandBuffer &cmdbuf, uint minLod, uint maxLod, bool quads)
+	bool  SphericalCube::Create (const CommandBuffer &cmdbuf, uint minLod, uint maxLod, bool quads, EVertexLayout layout)
 	{
 		CHECK_ERR( minLod <= maxLod );
-		CHECK_ERR( maxLod < 32 );
+		CHECK_ERR( maxLod < MaxLods );
 		CHECK_ERR( cmdbuf );
 
 		FrameGraph	fg	= cmdbuf->GetFrameGraph();
@@ -50,113 +126,524 @@ namespace {
 		Destroy( fg );
 		_minLod = minLod;	_maxLod = maxLod;
 		_quads = quads;
+		_layout = layout;
 
-		// calculate total memory size
-		uint64_t	vert_count	= 0;
-		uint64_t	index_count	= 0;
+		const bool		packed		= (layout == EVertexLayout::Packed);
+		const bool		tangents	= (layout == EVertexLayout::Tangents);
+		const BytesU	vert_stride	= GetVertexStride( layout );
 
+		// calculate offsets and total memory size
+		for (uint lod = minLod; lod <= maxLod+1; ++lod)
+		{
+			_vertOffsets[lod - minLod] = packed ? CalcPackedVertOffset( minLod, lod ) : CalcVertOffset( minLod, lod );
+		}
+
+		// index count is always even, so 32 bit indices that follows 16 bit indices are correctly aligned
+		_indexOffsets[0] = 0_b;
 		for (uint lod = minLod; lod <= maxLod; ++lod)
 		{
-			vert_count  += CalcVertCount( lod );
-			index_count += CalcIndexCount( lod, _quads );
+			_indexOffsets[lod+1 - minLod] = _indexOffsets[lod - minLod] + GetIndexStride( GetIndexType( lod, layout )) * CalcIndexCount( lod, _quads );
 		}
 
+		const uint64_t	vert_count	= _vertOffsets[maxLod+1 - minLod];
+		const BytesU	index_size	= _indexOffsets[maxLod+1 - minLod];
+
 		// create resources
-		_vertexBuffer	= fg->CreateBuffer( BufferDesc{ SizeOf<Vertex> * vert_count, EBufferUsage::Vertex | EBufferUsage::Transfer | EBufferUsage::Storage },
+		_vertexBuffer	= fg->CreateBuffer( BufferDesc{ vert_stride * vert_count, EBufferUsage::Vertex | EBufferUsage::Transfer | EBufferUsage::Storage },
 											Default, "SphericalCube.Vertices" );
-		_indexBuffer	= fg->CreateBuffer( BufferDesc{ SizeOf<uint> * index_count, EBufferUsage::Index | EBufferUsage::Transfer },
+		_indexBuffer	= fg->CreateBuffer( BufferDesc{ index_size, EBufferUsage::Index | EBufferUsage::Transfer },
 											Default, "SphericalCube.Indices" );
 		CHECK_ERR( _vertexBuffer and _indexBuffer );
+
+		if ( tangents )
+		{
+			_tangentBuffer = fg->CreateBuffer( BufferDesc{ SizeOf<TangentVertex> * vert_count, EBufferUsage::Vertex | EBufferUsage::Transfer },
+											   Default, "SphericalCube.Tangents" );
+			CHECK_ERR( _tangentBuffer );
+		}
 		
-		vert_count = index_count = 0;
 		BytesU	vert_offset;
 		BytesU	index_offset;
 
 
 		for (uint lod = minLod; lod <= maxLod; ++lod)
 		{
-			const BytesU	vert_size	= SizeOf<Vertex> * CalcVertCount( lod );
-			const BytesU	idx_size	= SizeOf<uint> * CalcIndexCount( lod, _quads );
+			const BytesU	vert_size	= vert_stride * (_vertOffsets[lod+1 - minLod] - _vertOffsets[lod - minLod]);
+			const BytesU	idx_size	= _indexOffsets[lod+1 - minLod] - _indexOffsets[lod - minLod];
+			const bool		idx_16bit	= (GetIndexType( lod, layout ) == EIndex::UShort);
 			RawBufferID		staging_vb,	staging_ib;
 			BytesU			vb_offset,	ib_offset;
-			Vertex *		vb_mapped	= null;
-			uint *			ib_mapped	= null;
+			void *			ib_mapped	= null;
 
-			CHECK_ERR( cmdbuf->AllocBuffer( vert_size, SizeOf<Vertex>, OUT staging_vb, OUT vb_offset, OUT vb_mapped ));
 			CHECK_ERR( cmdbuf->AllocBuffer( idx_size, SizeOf<uint>, OUT staging_ib, OUT ib_offset, OUT ib_mapped ));
+
+			if ( packed )
+			{
+				PackedVertex*	vb_mapped = null;
+				CHECK_ERR( cmdbuf->AllocBuffer( vert_size, vert_stride, OUT staging_vb, OUT vb_offset, OUT vb_mapped ));
+
+				if ( idx_16bit )
+					GeneratePacked( lod, quads, OUT vb_mapped, OUT Cast<uint16_t>( ib_mapped ));
+				else
+					GeneratePacked( lod, quads, OUT vb_mapped, OUT Cast<uint>( ib_mapped ));
+			}
+			else
+			{
+				Vertex*		vb_mapped = null;
+				CHECK_ERR( cmdbuf->AllocBuffer( vert_size, vert_stride, OUT staging_vb, OUT vb_offset, OUT vb_mapped ));
+
+				if ( idx_16bit )
+					GenerateIndices( lod, quads, OUT Cast<uint16_t>( ib_mapped ));
+				else
+					GenerateIndices( lod, quads, OUT Cast<uint>( ib_mapped ));
+
+				if ( tangents )
+				{
+					const BytesU	tan_size	= SizeOf<TangentVertex> * (_vertOffsets[lod+1 - minLod] - _vertOffsets[lod - minLod]);
+					const BytesU	tan_offset	= SizeOf<TangentVertex> * _vertOffsets[lod - minLod];
+					TangentVertex*	tb_mapped	= null;
+					RawBufferID		staging_tb;
+					BytesU			tb_offset;
+
+					CHECK_ERR( cmdbuf->AllocBuffer( tan_size, SizeOf<float>, OUT staging_tb, OUT tb_offset, OUT tb_mapped ));
+
+					GenerateVertices( lod, OUT vb_mapped, OUT tb_mapped );
+					cmdbuf->AddTask( CopyBuffer{}.From( staging_tb ).To( _tangentBuffer ).AddRegion( tb_offset, tan_offset, tan_size ));
+				}
+				else
+					GenerateVertices( lod, OUT vb_mapped );
+			}
 			
 			cmdbuf->AddTask( CopyBuffer{}.From( staging_vb ).To( _vertexBuffer ).AddRegion( vb_offset, vert_offset, vert_size ));
 			cmdbuf->AddTask( CopyBuffer{}.From( staging_ib ).To( _indexBuffer ).AddRegion( ib_offset, index_offset, idx_size ));
 
 			vert_offset  += vert_size;
 			index_offset += idx_size;
+		}
+
+		return true;
+	}
+	
+/*
+=================================================
+	CalcVertCount
+=================================================
+*/
+	uint  SphericalCube::CalcVertCount (uint lod)
+	{
+		return (lod+2) * (lod+2) * 6;
+	}
+	
+/*
+=================================================
+	CalcIndexCount
+=================================================
+*/
+	uint  SphericalCube::CalcIndexCount (uint lod, bool useQuads)
+	{
+		return 6*(useQuads ? 4 : 6) * (lod+1) * (lod+1);
+	}
+	
+/*
+=================================================
+	CalcPackedVertCount
+----
+	same as 'CalcVertCount' but edge and corner vertices are not duplicated
+=================================================
+*/
+	uint  SphericalCube::CalcPackedVertCount (uint lod)
+	{
+		const uint	n = lod + 2;
+		return 6*n*n - 12*n + 8;
+	}
+
+/*
+=================================================
+	CalcVertOffset
+----
+	sum of (i+2)^2 * 6 for i in [minLod, lod)
+=================================================
+*/
+	uint  SphericalCube::CalcVertOffset (uint minLod, uint lod)
+	{
+		ASSERT( minLod <= lod );
+		return 6 * (SumOfSquares( lod+1 ) - SumOfSquares( minLod+1 ));
+	}
+	
+/*
+=================================================
+	CalcPackedVertOffset
+----
+	sum of (6*n^2 - 12*n + 8) for n in [minLod+2, lod+2)
+=================================================
+*/
+	uint  SphericalCube::CalcPackedVertOffset (uint minLod, uint lod)
+	{
+		ASSERT( minLod <= lod );
+		return 6 * (SumOfSquares( lod+1 ) - SumOfSquares( minLod+1 )) -
+			   12 * (SumOfNumbers( lod+1 ) - SumOfNumbers( minLod+1 )) +
+			   8 * (lod - minLod);
+	}
+	
+/*
+=================================================
+	CalcIndexOffset
+----
+	sum of (i+1)^2 * 6 * (4 or 6) for i in [minLod, lod)
+=================================================
+*/
+	uint  SphericalCube::CalcIndexOffset (uint minLod, uint lod, bool useQuads)
+	{
+		ASSERT( minLod <= lod );
+		return 6*(useQuads ? 4 : 6) * (SumOfSquares( lod ) - SumOfSquares( minLod ));
+	}
+	
+/*
+=================================================
+	GetIndexType
+----
+	indices are relative to the first vertex of LOD,
+	so 16 bit indices can be used up to LOD ~100
+=================================================
+*/
+	EIndex  SphericalCube::GetIndexType (uint lod, EVertexLayout layout)
+	{
+		const uint	vert_count = (layout == EVertexLayout::Packed ? CalcPackedVertCount( lod ) : CalcVertCount( lod ));
 
-			// for cube sides
-			const uint	vcount	= lod + 2;
-			const uint	icount	= lod + 1;
-			uint		vert_i	= 0;
-			uint		index_i	= 0;
+		return vert_count <= (1u << 16) ? EIndex::UShort : EIndex::UInt;
+	}
+	
+/*
+=================================================
+	GetIndexStride
+=================================================
+*/
+	BytesU  SphericalCube::GetIndexStride (EIndex type)
+	{
+		ASSERT( type == EIndex::UShort or type == EIndex::UInt );
+		return type == EIndex::UShort ? SizeOf<uint16_t> : SizeOf<uint>;
+	}
+
+/*
+=================================================
+	GenerateIndices
+=================================================
+*/
+	void  SphericalCube::GenerateIndices (uint lod, bool quads, OUT uint *indices)
+	{
+		_GenerateIndices( lod, quads, OUT indices );
+	}
+	
+	void  SphericalCube::GenerateIndices (uint lod, bool quads, OUT uint16_t *indices)
+	{
+		ASSERT( CalcVertCount( lod ) <= (1u << 16) );
+		_GenerateIndices( lod, quads, OUT indices );
+	}
+	
+	template <typename T>
+	void  SphericalCube::_GenerateIndices (uint lod, bool quads, OUT T *indices)
+	{
+		const uint	vcount			= lod + 2;
+		const uint	icount			= lod + 1;
+		const uint	face_indices	= (quads ? 4 : 6) * icount * icount;
+		const uint	faces_per_batch	= Clamp( MinVerticesPerBatch / (vcount * vcount), 1u, 6u );
 
-			// for top/bottom faces
-			for (uint face = 0; face < 6; ++face)
+		ParallelFor( 6, faces_per_batch, [&] (uint face)
 			{
-				//FG_LOGI( "Lod: "s << ToString(lod) << ", Face: " << ToString(face) );
-				
-				// generate indices
+				const uint	vert_i	= face * vcount * vcount;
+				uint		index_i	= face * face_indices;
+
 				for (uint y = 0; y < icount; ++y)
 				for (uint x = 0; x < icount; ++x)
 				{
-					const uint	indices[4] = { vert_i + (x+0) + (y+0)*vcount, vert_i + (x+1) + (y+0)*vcount,
-											   vert_i + (x+0) + (y+1)*vcount, vert_i + (x+1) + (y+1)*vcount };
+					const T		idx[4] = { T(vert_i + (x+0) + (y+0)*vcount), T(vert_i + (x+1) + (y+0)*vcount),
+										   T(vert_i + (x+0) + (y+1)*vcount), T(vert_i + (x+1) + (y+1)*vcount) };
 					
 					if ( quads )
 					{
-						ib_mapped[index_i++] = indices[0];	ib_mapped[index_i++] = indices[1];
-						ib_mapped[index_i++] = indices[3];	ib_mapped[index_i++] = indices[2];
+						indices[index_i++] = idx[0];	indices[index_i++] = idx[1];
+						indices[index_i++] = idx[3];	indices[index_i++] = idx[2];
 					}
 					else
+					if ( UseMainDiagonal( x, y, icount ))
 					{
-						if ( (x < icount/2 and y < icount/2) or (x >= icount/2 and y >= icount/2) )
-						{
-							ib_mapped[index_i++] = indices[0];	ib_mapped[index_i++] = indices[1];	ib_mapped[index_i++] = indices[3];
-							ib_mapped[index_i++] = indices[0];	ib_mapped[index_i++] = indices[3];	ib_mapped[index_i++] = indices[2];
-						}
-						else
-						if ( (x >= icount/2 and y < icount/2) or (x < icount/2 and y >= icount/2) )
-						{
-							ib_mapped[index_i++] = indices[0];	ib_mapped[index_i++] = indices[1];	ib_mapped[index_i++] = indices[2];
-							ib_mapped[index_i++] = indices[2];	ib_mapped[index_i++] = indices[1];	ib_mapped[index_i++] = indices[3];
-						}
+						indices[index_i++] = idx[0];	indices[index_i++] = idx[1];	indices[index_i++] = idx[3];
+						indices[index_i++] = idx[0];	indices[index_i++] = idx[3];	indices[index_i++] = idx[2];
+					}
+					else
+					{
+						indices[index_i++] = idx[0];	indices[index_i++] = idx[1];	indices[index_i++] = idx[2];
+						indices[index_i++] = idx[2];	indices[index_i++] = idx[1];	indices[index_i++] = idx[3];
 					}
-
-					//FG_LOGI( "Indices: "s << ToString(ib_mapped[index_i-6]) << ", " << ToString(ib_mapped[index_i-5]) << ", "
-					//				<< ToString(ib_mapped[index_i-4]) << ", " << ToString(ib_mapped[index_i-3]) << ", "
-					//				<< ToString(ib_mapped[index_i-2]) << ", " << ToString(ib_mapped[index_i-1]) );
 				}
+				ASSERT( index_i == (face+1) * face_indices );
+			});
+	}
+	
+/*
+=================================================
+	GenerateVertices
+----
+	The position projection is separable, so 'Warp' (which may contain
+	'tan' calls) is evaluated once per grid line instead of twice per vertex,
+	then each vertex is a linear combination of face axes in float precision.
+	Tangents are optional and calculated in the same way, see 'ForwardTangents'.
+	Rows of all faces are generated in parallel.
+=================================================
+*/
+	void  SphericalCube::GenerateVertices (uint lod, OUT Vertex *vertices, OUT TangentVertex *tangents)
+	{
+		const uint		vcount			= lod + 2;
+		const uint		rows_per_batch	= Max( 1u, MinVerticesPerBatch / vcount );
+		Array<float>	warp;			warp.resize( vcount );
+		Array<float>	warp_deriv;		warp_deriv.resize( vcount );
+
+		for (uint i = 0; i < vcount; ++i)
+		{
+			const double	x = double(i) / (vcount-1) * 2.0 - 1.0;
+			warp[i]			= float(Projection_t::Warp( x ));
+			warp_deriv[i]	= float(Projection_t::WarpDerivative( x ));
+		}
+
+		ParallelFor( 6 * vcount, rows_per_batch, [&] (uint row)
+			{
+				const uint		face	= row / vcount;
+				const uint		y		= row % vcount;
+				const float3	axis_x	= float3(RotateVec( double3{1.0, 0.0, 0.0}, ECubeFace(face) ));
+				const float3	axis_y	= float3(RotateVec( double3{0.0, 1.0, 0.0}, ECubeFace(face) ));
+				const float3	axis_z	= float3(RotateVec( double3{0.0, 0.0, 1.0}, ECubeFace(face) ));
+				const float3	origin	= axis_y * warp[y] + axis_z;
+				Vertex *		dst		= vertices + row * vcount;
+				TangentVertex *	dst_tan	= tangents ? tangents + row * vcount : null;
 
-				// generate vertices
-				for (uint y = 0; y < vcount; ++y)
 				for (uint x = 0; x < vcount; ++x)
 				{
-					double2		ncoord	= double2{ double(x)/(vcount-1), double(y)/(vcount-1) } * 2.0 - 1.0;
-					
-					vb_mapped[vert_i++] = Vertex{ float3(ForwardProjection( ncoord, ECubeFace(face) )),
-												  float3(ForwardTexProjection( ncoord, ECubeFace(face) )) };
-					
-					//FG_LOGI( "Vertex["s << ToString(vert_i-1) << "] = " << ToString(vb_mapped[vert_i-1].position)
-					//			<< "; TC: " << ToString(vb_mapped[vert_i-1].texcoord) );
+					float3			pos		= origin + axis_x * warp[x];
+					float3			tan		= axis_x * warp_deriv[x];
+					float3			bitan	= axis_y * warp_deriv[y];
+					const double2	ncoord	= double2{ double(x)/(vcount-1), double(y)/(vcount-1) } * 2.0 - 1.0;
+
+					if constexpr( Projection_t::IsNormalized )
+					{
+						const float		len	= Length( pos );
+						pos		= pos / len;
+						tan		= (tan - pos * Dot( pos, tan )) / len;
+						bitan	= (bitan - pos * Dot( pos, bitan )) / len;
+					}
+
+					dst[x] = Vertex{ pos, float3(ForwardTexProjection( ncoord, ECubeFace(face) ))};
+
+					if ( dst_tan )
+						dst_tan[x] = TangentVertex{ tan, bitan };
+				}
+			});
+	}
+
+/*
+=================================================
+	GeneratePacked
+----
+	Generates default layout and then merges vertices that lie on
+	the same cube lattice point. Projections are odd functions
+	with Warp(+-1) == +-1, so these vertices are equal and shared
+	indices keep the mesh seam-free.
+=================================================
+*/
+	void  SphericalCube::GeneratePacked (uint lod, bool quads, OUT PackedVertex *vertices, OUT uint *indices)
+	{
+		_GeneratePacked( lod, quads, OUT vertices, OUT indices );
+	}
+	
+	void  SphericalCube::GeneratePacked (uint lod, bool quads, OUT PackedVertex *vertices, OUT uint16_t *indices)
+	{
+		ASSERT( CalcPackedVertCount( lod ) <= (1u << 16) );
+		_GeneratePacked( lod, quads, OUT vertices, OUT indices );
+	}
+	
+	template <typename T>
+	void  SphericalCube::_GeneratePacked (uint lod, bool quads, OUT PackedVertex *vertices, OUT T *indices)
+	{
+		const uint		vcount		= lod + 2;
+		const uint		side		= 2 * vcount - 1;
+		const int		half		= int(vcount - 1);
+		Array<Vertex>	src_verts;	src_verts.resize( CalcVertCount( lod ));
+		Array<uint>		src_indices;src_indices.resize( CalcIndexCount( lod, quads ));
+		Array<uint>		remap;		remap.resize( src_verts.size() );
+		Array<uint>		lattice;	lattice.resize( side * side * side, UMax );
+		uint			vert_i		= 0;
+
+		GenerateVertices( lod, OUT src_verts.data() );
+		GenerateIndices( lod, quads, OUT src_indices.data() );
+
+		for (uint face = 0; face < 6; ++face)
+		for (uint y = 0; y < vcount; ++y)
+		for (uint x = 0; x < vcount; ++x)
+		{
+			const uint	src		= x + (y + face * vcount) * vcount;
+			const int3	c		= int3(RotateVec( double3{ double(2*int(x) - half), double(2*int(y) - half), double(half) }, ECubeFace(face) ));
+			const uint	key		= uint(c.x + half) + (uint(c.y + half) + uint(c.z + half) * side) * side;
+			uint&		dst		= lattice[key];
+
+			if ( dst == UMax )
+			{
+				dst = vert_i++;
+				vertices[dst].position = PackOctahedral( src_verts[src].position );
+				vertices[dst].texcoord = PackOctahedral( src_verts[src].texcoord );
+			}
+			remap[src] = dst;
+		}
+		ASSERT( vert_i == CalcPackedVertCount( lod ));
+
+		for (size_t i = 0; i < src_indices.size(); ++i) {
+			indices[i] = T(remap[ src_indices[i] ]);
+		}
+	}
+	
+/*
+=================================================
+	BuildMeshlets
+----
+	Tile size is the largest that fits into vertex and triangle
+	limits, for 64 vertices and 124 triangles it is 7x7 quads.
+	Triangles have the same diagonals as in 'GenerateIndices'.
+=================================================
+*/
+	void  SphericalCube::BuildMeshlets (uint lod, OUT Meshlets &result)
+	{
+		const uint		vcount	= lod + 2;
+		const uint		icount	= lod + 1;
+		uint			tile	= 1;
+		Array<Vertex>	verts;	verts.resize( CalcVertCount( lod ));
+
+		while ( Square(tile+2) <= MeshletMaxVertices and 2*Square(tile+1) <= MeshletMaxTriangles ) {
+			++tile;
+		}
+		
+		GenerateVertices( lod, OUT verts.data() );
+
+		const uint	tiles_per_side = (icount + tile - 1) / tile;
+
+		result.meshlets.clear();
+		result.vertices.clear();
+		result.triangles.clear();
+		result.meshlets.reserve( 6 * tiles_per_side * tiles_per_side );
+
+		for (uint face = 0; face < 6; ++face)
+		for (uint ty = 0; ty < tiles_per_side; ++ty)
+		for (uint tx = 0; tx < tiles_per_side; ++tx)
+		{
+			const uint2	qmin	{ tx * tile, ty * tile };
+			const uint2	qmax	= Min( qmin + tile, uint2{icount} );
+			const uint	vsize	= qmax.x - qmin.x + 1;
+			Meshlet		m;
+
+			m.vertexOffset		= uint(result.vertices.size());
+			m.triangleOffset	= uint(result.triangles.size());
+
+			for (uint y = qmin.y; y <= qmax.y; ++y)
+			for (uint x = qmin.x; x <= qmax.x; ++x) {
+				result.vertices.push_back( face * vcount * vcount + x + y * vcount );
+			}
+
+			for (uint y = qmin.y; y < qmax.y; ++y)
+			for (uint x = qmin.x; x < qmax.x; ++x)
+			{
+				const uint		lx		= x - qmin.x;
+				const uint		ly		= y - qmin.y;
+				const uint8_t	idx[4]	= { uint8_t((lx+0) + (ly+0)*vsize), uint8_t((lx+1) + (ly+0)*vsize),
+											uint8_t((lx+0) + (ly+1)*vsize), uint8_t((lx+1) + (ly+1)*vsize) };
+				auto&			dst		= result.triangles;
+
+				if ( UseMainDiagonal( x, y, icount ))
+				{
+					dst.push_back( idx[0] );	dst.push_back( idx[1] );	dst.push_back( idx[3] );
+					dst.push_back( idx[0] );	dst.push_back( idx[3] );	dst.push_back( idx[2] );
+				}
+				else
+				{
+					dst.push_back( idx[0] );	dst.push_back( idx[1] );	dst.push_back( idx[2] );
+					dst.push_back( idx[2] );	dst.push_back( idx[1] );	dst.push_back( idx[3] );
 				}
 			}
 
-			//FG_LOGI( "--------------------------------\n\n" );
+			m.vertexCount	= uint(result.vertices.size()) - m.vertexOffset;
+			m.triangleCount	= (uint(result.triangles.size()) - m.triangleOffset) / 3;
+			ASSERT( m.vertexCount <= MeshletMaxVertices );
+			ASSERT( m.triangleCount <= MeshletMaxTriangles );
+
+			const auto	GetPos = [&] (uint i) -> const float3& { return verts[ result.vertices[ m.vertexOffset + result.triangles[ m.triangleOffset + i ]]].position; };
 			
-			ASSERT( SizeOf<Vertex> * vert_i == vert_size );
-			ASSERT( SizeOf<uint> * index_i == idx_size );
+			// bounding sphere
+			for (uint i = 0; i < m.vertexCount; ++i) {
+				m.center += verts[ result.vertices[ m.vertexOffset + i ]].position;
+			}
+			m.center /= float(m.vertexCount);
+
+			for (uint i = 0; i < m.vertexCount; ++i) {
+				m.radius = Max( m.radius, Distance( m.center, verts[ result.vertices[ m.vertexOffset + i ]].position ));
+			}
+
+			// normal cone, surface is convex so normals are oriented outside
+			Array<float3>	normals;	normals.resize( m.triangleCount );
+
+			for (uint i = 0; i < m.triangleCount; ++i)
+			{
+				const float3&	p0	= GetPos( i*3+0 );
+				float3			n	= Normalize( Cross( GetPos( i*3+1 ) - p0, GetPos( i*3+2 ) - p0 ));
+
+				normals[i]	= Dot( n, p0 ) < 0.0f ? -n : n;
+				m.coneAxis	+= normals[i];
+			}
+			m.coneAxis = Normalize( m.coneAxis );
+
+			float	min_dot = 1.0f;
+			for (auto& n : normals) {
+				min_dot = Min( min_dot, Dot( n, m.coneAxis ));
+			}
+
+			// cone angle is less than 90 degrees, 'coneCutoff' is a sine of cone angle
+			m.coneCutoff = min_dot > 0.0f ? Sqrt( 1.0f - Square( min_dot )) : 1.0f;
+
+			result.meshlets.push_back( m );
 		}
+	}
 
-		return true;
+/*
+=================================================
+	PackOctahedral
+=================================================
+*/
+	uint  SphericalCube::PackOctahedral (const float3 &dir)
+	{
+		const float3	n = dir / (Abs(dir.x) + Abs(dir.y) + Abs(dir.z));
+		float2			p = float2{ n.x, n.y };
+
+		if ( n.z < 0.0f )
+			p = float2{ (1.0f - Abs(n.y)) * (n.x < 0.0f ? -1.0f : 1.0f),
+						(1.0f - Abs(n.x)) * (n.y < 0.0f ? -1.0f : 1.0f) };
+
+		return PackSNorm16( p.x ) | (PackSNorm16( p.y ) << 16);
 	}
 	
+/*
+=================================================
+	UnpackOctahedral
+=================================================
+*/
+	float3  SphericalCube::UnpackOctahedral (uint packed)
+	{
+		const float2	e = float2{ UnpackSNorm16( packed ), UnpackSNorm16( packed >> 16 )};
+		float3			n = float3{ e.x, e.y, 1.0f - Abs(e.x) - Abs(e.y) };
+
+		if ( n.z < 0.0f )
+		{
+			const float2	p = float2{ n.x, n.y };
+			n.x = (1.0f - Abs(p.y)) * (p.x < 0.0f ? -1.0f : 1.0f);
+			n.y = (1.0f - Abs(p.x)) * (p.y < 0.0f ? -1.0f : 1.0f);
+		}
+		return Normalize( n );
+	}
+
 /*
 =================================================
 	Destroy
@@ -165,6 +652,7 @@ namespace {
 	void  SphericalCube::Destroy (const FrameGraph &fg)
 	{
 		fg->ReleaseResource( _vertexBuffer );
+		fg->ReleaseResource( _tangentBuffer );
 		fg->ReleaseResource( _indexBuffer );
 	}
 	
@@ -173,15 +661,46 @@ namespace {
 	GetAttribs
 =================================================
 */
-	VertexInputState  SphericalCube::GetAttribs ()
+	VertexInputState  SphericalCube::GetAttribs (EVertexLayout layout)
 	{
 		VertexInputState	vert_input;
-		vert_input.Bind( Default, SizeOf<Vertex> );
-		vert_input.Add( VertexID{"at_Position"}, &Vertex::position );
-		vert_input.Add( VertexID{"at_TextureUV"}, &Vertex::texcoord );
+		vert_input.Bind( Default, GetVertexStride( layout ));
+
+		BEGIN_ENUM_CHECKS();
+		switch ( layout )
+		{
+			case EVertexLayout::Default :
+				vert_input.Add( VertexID{"at_Position"}, &Vertex::position );
+				vert_input.Add( VertexID{"at_TextureUV"}, &Vertex::texcoord );
+				break;
+
+			case EVertexLayout::Tangents :
+				vert_input.Bind( VertexBufferID{"tangents"}, SizeOf<TangentVertex> );
+				vert_input.Add( VertexID{"at_Position"}, &Vertex::position );
+				vert_input.Add( VertexID{"at_TextureUV"}, &Vertex::texcoord );
+				vert_input.Add( VertexID{"at_Tangent"}, EVertexType::Float3, OffsetOf( &TangentVertex::tangent ), VertexBufferID{"tangents"} );
+				vert_input.Add( VertexID{"at_Bitangent"}, EVertexType::Float3, OffsetOf( &TangentVertex::bitangent ), VertexBufferID{"tangents"} );
+				break;
+
+			case EVertexLayout::Packed :
+				vert_input.Add( VertexID{"at_Position"}, EVertexType::Short2_Norm, OffsetOf( &PackedVertex::position ));
+				vert_input.Add( VertexID{"at_TextureUV"}, EVertexType::Short2_Norm, OffsetOf( &PackedVertex::texcoord ));
+				break;
+		}
+		END_ENUM_CHECKS();
 		return vert_input;
 	}
 	
+/*
+=================================================
+	GetVertexStride
+=================================================
+*/
+	BytesU  SphericalCube::GetVertexStride (EVertexLayout layout)
+	{
+		return layout == EVertexLayout::Packed ? SizeOf<PackedVertex> : SizeOf<Vertex>;
+	}
+	
 /*
 =================================================
 	Draw
@@ -190,20 +709,18 @@ namespace {
 	DrawIndexed  SphericalCube::Draw (uint lod) const
 	{
 		CHECK( lod >= _minLod and lod <= _maxLod );
-		lod = Min( lod, _maxLod );
-
-		BytesU	vb_offset, ib_offset;
+		lod = Clamp( lod, _minLod, _maxLod );
 
-		for (uint i = _minLod; i < lod; ++i)
-		{
-			vb_offset += SizeOf<Vertex> * CalcVertCount( i );
-			ib_offset += SizeOf<uint> * CalcIndexCount( i, _quads );
-		}
+		const BytesU	vb_offset	= GetVertexStride( _layout ) * _vertOffsets[lod - _minLod];
+		const BytesU	ib_offset	= _indexOffsets[lod - _minLod];
 
 		DrawIndexed		task;
-		task.SetVertexInput( GetAttribs() );
+		task.SetVertexInput( GetAttribs( _layout ));
 		task.AddVertexBuffer( Default, _vertexBuffer, vb_offset );
-		task.SetIndexBuffer( _indexBuffer, ib_offset, EIndex::UInt );
+
+		if ( _layout == EVertexLayout::Tangents )
+			task.AddVertexBuffer( VertexBufferID{"tangents"}, _tangentBuffer, SizeOf<TangentVertex> * _vertOffsets[lod - _minLod] );
+		task.SetIndexBuffer( _indexBuffer, ib_offset, GetIndexType( lod, _layout ));
 		task.Draw( CalcIndexCount( lod, _quads ));
 		task.SetTopology( EPrimitive::TriangleList );
 		task.SetFrontFaceCCW( false );
@@ -216,57 +733,235 @@ namespace {
 	RayCast
 ----
 	from http://paulbourke.net/geometry/circlesphere/index.html#linesphere
+	with half 'b' coefficient.
+	Single root is handled as two equal roots.
 =================================================
 */
 	bool  SphericalCube::RayCast (const float3 &center, float radius, const float3 &begin, const float3 &end, OUT float3 &outIntersection) const
 	{
-		float	a = Square(end.x - begin.x) + Square(end.y - begin.y) + Square(end.z - begin.z);
+		float	mu;
+		if ( not IntersectSphereSurface( center, radius, begin, end, OUT mu ))
+			return false;
 
-		float	b = 2.0f * ( (end.x - begin.x)*(begin.x - center.x) + (end.y - begin.y)*(begin.y - center.y) + (end.z - begin.z)*(begin.z - center.z) );
+		outIntersection = begin + mu * (end - begin);
+		return true;
+	}
+	
+	void  SphericalCube::RayCast (const float3 &center, float radius, const RaySegments &segments, OUT RayHits &hits)
+	{
+		_RayCast( center, radius, false, segments, OUT hits );
+	}
 
-		float	c = Square(center.x) + Square(center.y) + Square(center.z) + Square(begin.x) + Square(begin.y) + Square(begin.z) -
-					2.0f * ( center.x*begin.x + center.y*begin.y + center.z*begin.z ) - Square(radius);
+/*
+=================================================
+	RaySegments
+=================================================
+*/
+	void  SphericalCube::RaySegments::Resize (size_t count)
+	{
+		beginX.resize( count );		beginY.resize( count );		beginZ.resize( count );
+		endX.resize( count );		endY.resize( count );		endZ.resize( count );
+	}
 
-		float	i = b * b - 4 * a * c;
-		
-		// no intersection
-		if ( i < 0.0f )
+	void  SphericalCube::RaySegments::Set (size_t i, const float3 &begin, const float3 &end)
+	{
+		beginX[i] = begin.x;	beginY[i] = begin.y;	beginZ[i] = begin.z;
+		endX[i]   = end.x;		endY[i]   = end.y;		endZ[i]   = end.z;
+	}
+
+/*
+=================================================
+	_RayCast
+----
+	processes 4 segments per iteration, remaining segments are processed
+	by the scalar version.
+	'solid' - returns nearest point inside of the ball instead of the sphere surface.
+=================================================
+*/
+	void  SphericalCube::_RayCast (const float3 &center, float radius, bool solid, const RaySegments &segs, OUT RayHits &hits)
+	{
+		const size_t	count	= segs.size();
+		size_t			i		= 0;
+
+		hits.mask.clear();
+		hits.mask.resize( (count + 31) / 32 );
+		hits.pointX.resize( count );
+		hits.pointY.resize( count );
+		hits.pointZ.resize( count );
+
+	#ifdef SPHERICAL_CUBE_SSE
+		const __m128	zero		= _mm_setzero_ps();
+		const __m128	min_mu		= _mm_set1_ps( -RayEpsilon );
+		const __m128	max_mu		= _mm_set1_ps( 1.0f + RayEpsilon );
+		const __m128	center_x	= _mm_set1_ps( center.x );
+		const __m128	center_y	= _mm_set1_ps( center.y );
+		const __m128	center_z	= _mm_set1_ps( center.z );
+		const __m128	radius_sq	= _mm_set1_ps( radius * radius );
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128	bx		= _mm_loadu_ps( segs.beginX.data() + i );
+			const __m128	by		= _mm_loadu_ps( segs.beginY.data() + i );
+			const __m128	bz		= _mm_loadu_ps( segs.beginZ.data() + i );
+			const __m128	dx		= _mm_sub_ps( _mm_loadu_ps( segs.endX.data() + i ), bx );
+			const __m128	dy		= _mm_sub_ps( _mm_loadu_ps( segs.endY.data() + i ), by );
+			const __m128	dz		= _mm_sub_ps( _mm_loadu_ps( segs.endZ.data() + i ), bz );
+			const __m128	mx		= _mm_sub_ps( bx, center_x );
+			const __m128	my		= _mm_sub_ps( by, center_y );
+			const __m128	mz		= _mm_sub_ps( bz, center_z );
+			const __m128	a		= _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy )), _mm_mul_ps( dz, dz ));
+			const __m128	b		= _mm_add_ps( _mm_add_ps( _mm_mul_ps( mx, dx ), _mm_mul_ps( my, dy )), _mm_mul_ps( mz, dz ));
+			const __m128	c		= _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( mx, mx ), _mm_mul_ps( my, my )), _mm_mul_ps( mz, mz )), radius_sq );
+			const __m128	disc	= _mm_sub_ps( _mm_mul_ps( b, b ), _mm_mul_ps( a, c ));
+			const __m128	has_root= _mm_cmpge_ps( disc, zero );
+			const __m128	sq		= _mm_sqrt_ps( _mm_max_ps( disc, zero ));
+			const __m128	neg_b	= _mm_sub_ps( zero, b );
+			const __m128	mu1		= _mm_div_ps( _mm_sub_ps( neg_b, sq ), a );
+			const __m128	mu2		= _mm_div_ps( _mm_add_ps( neg_b, sq ), a );
+			__m128			hit;
+			__m128			mu;
+
+			if ( solid )
+			{
+				hit	= _mm_and_ps( has_root, _mm_and_ps( _mm_cmpgt_ps( mu2, min_mu ), _mm_cmplt_ps( mu1, max_mu )));
+				mu	= _mm_max_ps( mu1, zero );
+			}
+			else
+			{
+				const __m128	mu1_valid	= _mm_and_ps( _mm_cmpgt_ps( mu1, min_mu ), _mm_cmplt_ps( mu1, max_mu ));
+				const __m128	mu2_valid	= _mm_and_ps( _mm_cmpgt_ps( mu2, min_mu ), _mm_cmplt_ps( mu2, max_mu ));
+
+				hit	= _mm_and_ps( has_root, _mm_or_ps( mu1_valid, mu2_valid ));
+				mu	= _mm_or_ps( _mm_and_ps( mu1_valid, mu1 ), _mm_andnot_ps( mu1_valid, mu2 ));
+			}
+
+			// 'mu' is zero for misses to avoid NaN in points
+			mu = _mm_and_ps( hit, mu );
+
+			_mm_storeu_ps( hits.pointX.data() + i, _mm_add_ps( bx, _mm_mul_ps( dx, mu )));
+			_mm_storeu_ps( hits.pointY.data() + i, _mm_add_ps( by, _mm_mul_ps( dy, mu )));
+			_mm_storeu_ps( hits.pointZ.data() + i, _mm_add_ps( bz, _mm_mul_ps( dz, mu )));
+
+			hits.mask[i >> 5] |= uint(_mm_movemask_ps( hit )) << (i & 31);
+		}
+	#endif
+
+		for (; i < count; ++i)
+		{
+			const float3	begin	= segs.Begin( i );
+			const float3	end		= segs.End( i );
+			float			mu		= 0.0f;
+			const bool		hit		= solid ? IntersectSphereSolid( center, radius, begin, end, OUT mu ) :
+											  IntersectSphereSurface( center, radius, begin, end, OUT mu );
+			const float3	point	= begin + (end - begin) * (hit ? mu : 0.0f);
+
+			hits.pointX[i] = point.x;
+			hits.pointY[i] = point.y;
+			hits.pointZ[i] = point.z;
+			hits.mask[i >> 5] |= uint(hit) << (i & 31);
+		}
+	}
+
+/*
+=================================================
+	RayCastSurface
+----
+	samples segment between outer and inner bounding spheres,
+	first sample below the surface is refined by bisection.
+	Thin features between samples may be missed.
+=================================================
+*/
+	bool  SphericalCube::RayCastSurface (const float3 &center, float radius, float maxHeight, const HeightFn_t &height,
+										 const float3 &begin, const float3 &end, OUT float3 &outIntersection, uint steps)
+	{
+		ASSERT( steps > 0 );
+
+		const float		outer_radius	= radius * (1.0f + maxHeight);
+		const float		inner_radius	= radius * (1.0f - maxHeight);
+		float			mu1, mu2;
+
+		if ( not IntersectSphere( center, outer_radius, begin, end, OUT mu1, OUT mu2 ))
 			return false;
-		
-		// one intersection
-		if ( i == 0.0f )
+
+		if ( mu2 < 0.0f or mu1 > 1.0f )
+			return false;
+
+		float	start	= Max( mu1, 0.0f );
+		float	stop	= Min( mu2, 1.0f );
+
+		// surface must be crossed before segment enters inner sphere
+		if ( IntersectSphere( center, inner_radius, begin, end, OUT mu1, OUT mu2 ) and mu1 >= start )
+			stop = Min( stop, mu1 );
+
+		const float3	dir			= end - begin;
+		const auto		surface_dist	= [&] (float mu)
 		{
-			float	mu	= -b / (2.0f * a);
-			
-			if ( (mu < 0.0001f) & (mu > 1.0f) )
-				return false;
+			const float3	p	= begin + dir * mu - center;
+			const float		len	= Length( p );
+			return len - radius * (1.0f + height( p / len ));
+		};
 
-			outIntersection = begin + mu * (end - begin);
+		// begin is under the surface
+		if ( surface_dist( start ) <= 0.0f )
+		{
+			outIntersection = begin + dir * start;
 			return true;
 		}
-		
-		// two intersections
-		float	mu1			= (-b + Sqrt( Square(b) - 4.0f * a * c )) / (2.0f * a);
-		bool	mu1_valid	= (mu1 > -0.0001f) & (mu1 < 1.0001f);
-		float	mu2			= (-b - Sqrt( Square(b) - 4.0f * a * c )) / (2.0f * a);
-		bool	mu2_valid	= (mu2 > -0.0001f) & (mu2 < 1.0001f);
-		float	mu;
-		
-		if ( mu1_valid & mu2_valid )
-			mu = Min( mu1, mu2 );
-		else
-		if ( mu1_valid )
-			mu = mu1;
-		else
-		if ( mu2_valid )
-			mu = mu2;
-		else
-			return false;
 
-		outIntersection = begin + mu * (end - begin);
-		return true;
+		float	prev_mu = start;
+
+		for (uint i = 1; i <= steps; ++i)
+		{
+			const float	mu = start + (stop - start) * (float(i) / float(steps));
+
+			if ( surface_dist( mu ) > 0.0f )
+			{
+				prev_mu = mu;
+				continue;
+			}
+
+			float	lo = prev_mu;
+			float	hi = mu;
+
+			for (uint j = 0; j < 20; ++j)
+			{
+				const float	mid = (lo + hi) * 0.5f;
+
+				if ( surface_dist( mid ) > 0.0f )
+					lo = mid;
+				else
+					hi = mid;
+			}
+
+			outIntersection = begin + dir * hi;
+			return true;
+		}
+		return false;
 	}
-	
+
+	void  SphericalCube::RayCastSurface (const float3 &center, float radius, float maxHeight, const HeightFn_t &height,
+										 const RaySegments &segments, OUT RayHits &hits, uint steps)
+	{
+		// most of segments are rejected by bounding sphere
+		_RayCast( center, radius * (1.0f + maxHeight), true, segments, OUT hits );
+
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			if ( not hits.IsHit( i ))
+				continue;
+
+			float3	point;
+			if ( RayCastSurface( center, radius, maxHeight, height, segments.Begin( i ), segments.End( i ), OUT point, steps ))
+			{
+				hits.pointX[i] = point.x;
+				hits.pointY[i] = point.y;
+				hits.pointZ[i] = point.z;
+			}
+			else
+				hits.mask[i >> 5] &= ~(1u << (i & 31));
+		}
+	}
+
 /*
 =================================================
 	GetVertexBuffer
@@ -276,12 +971,9 @@ namespace {
 	{
 		CHECK_ERR( lod >= _minLod and lod <= _maxLod );
 		CHECK_ERR( face < 6 );
+		CHECK_ERR( _layout != EVertexLayout::Packed );
 		
-		offset = 0_b;
-		for (uint i = _minLod; i < lod; ++i) {
-			offset += SizeOf<Vertex> * CalcVertCount( i );
-		}
-
+		offset		= SizeOf<Vertex> * _vertOffsets[lod - _minLod];
 		vertCount = uint2{ lod+2 };
 
 		BytesU	face_size = SizeOf<Vertex> * CalcVertCount( lod );
@@ -303,14 +995,10 @@ namespace {
 		CHECK_ERR( lod >= _minLod and lod <= _maxLod );
 		CHECK_ERR( face < 6 );
 		
-		offset = 0_b;
-		for (uint i = _minLod; i < lod; ++i) {
-			offset += SizeOf<uint> * CalcIndexCount( i, _quads );
-		}
-
+		offset		= _indexOffsets[lod - _minLod];
 		indexCount = CalcIndexCount( lod, _quads );
 
-		BytesU	face_size = SizeOf<uint> * indexCount;
+		BytesU	face_size = GetIndexStride( GetIndexType( lod, _layout )) * indexCount;
 
 		size	= face_size / 6;
 		offset += (face_size * face) / 6;
@@ -318,6 +1006,36 @@ namespace {
 
 		return true;
 	}
+	
+/*
+=================================================
+	GetFaceRanges
+=================================================
+*/
+	bool  SphericalCube::GetFaceRanges (uint lod, OUT FaceRanges_t &ranges) const
+	{
+		CHECK_ERR( lod >= _minLod and lod <= _maxLod );
+
+		const bool		packed		= (_layout == EVertexLayout::Packed);
+		const BytesU	vert_stride	= GetVertexStride( _layout );
+		const BytesU	vb_offset	= vert_stride * _vertOffsets[lod - _minLod];
+		const BytesU	ib_offset	= _indexOffsets[lod - _minLod];
+		const EIndex	index_type	= GetIndexType( lod, _layout );
+		const uint		vert_count	= packed ? CalcPackedVertCount( lod ) : CalcVertCount( lod ) / 6;
+		const uint		index_count	= CalcIndexCount( lod, _quads ) / 6;
+
+		for (uint face = 0; face < 6; ++face)
+		{
+			auto&	dst = ranges[face];
+			dst.vertexSize		= vert_stride * vert_count;
+			dst.vertexOffset	= vb_offset + (packed ? 0_b : dst.vertexSize * face);
+			dst.indexSize		= GetIndexStride( index_type ) * index_count;
+			dst.indexOffset		= ib_offset + dst.indexSize * face;
+			dst.indexCount		= index_count;
+			dst.indexType		= index_type;
+		}
+		return true;
+	}
 
 
 }	// FG
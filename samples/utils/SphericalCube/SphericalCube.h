@@ -28,6 +28,10 @@ namespace FG
 
 		ND_ static Pair<double2, ECubeFace>  InverseProjection (const double3 &coord);
 		ND_ static Pair<float2, ECubeFace>   InverseProjection (const float3 &coord);
+
+		// analytic partial derivatives of 'ForwardProjection' by 'ncoord.x' and 'ncoord.y'
+		ND_ static Pair<double3, double3>  ForwardTangents (const double2 &ncoord, ECubeFace face);
+		ND_ static Pair<float3, float3>    ForwardTangents (const float2 &ncoord, ECubeFace face);
 		
 		// texture coordinate projection
 		ND_ static double3  ForwardTexProjection (const double2 &ncoord, ECubeFace face);
@@ -53,20 +57,112 @@ namespace FG
 			float		_padding1;
 			float3		texcoord;
 			float		_padding2;
-			//float3	tangent;	// TODO: use it for distortion correction and for tessellation (instead of linear interpolation)
 
 			Vertex () {}
 			Vertex (const float3 &pos, const float3 &texc) : position{pos}, texcoord{texc} {}
 		};
 
+		// second vertex stream in 'EVertexLayout::Tangents'
+		struct TangentVertex
+		{
+			float3		tangent;	// derivative of position by 'ncoord.x'
+			float3		bitangent;	// derivative of position by 'ncoord.y'
+
+			TangentVertex () {}
+			TangentVertex (const float3 &tan, const float3 &bitan) : tangent{tan}, bitangent{bitan} {}
+		};
+
+		// vertices on cube edges and corners are shared between faces
+		struct PackedVertex
+		{
+			uint		position;	// octahedral encoded direction, 2x snorm16
+			uint		texcoord;	// octahedral encoded direction, 2x snorm16
+		};
+
+		enum class EVertexLayout : uint
+		{
+			Default,	// 'Vertex', each face has its own vertices
+			Packed,		// 'PackedVertex'
+			Tangents,	// 'Vertex' and 'TangentVertex' in separate buffer, opt-in, used only for curved tessellation
+		};
+
+		struct FaceRange
+		{
+			BytesU		vertexOffset;	// for packed layout it is a range of all faces
+			BytesU		vertexSize;
+			BytesU		indexOffset;
+			BytesU		indexSize;
+			uint		indexCount	= 0;	// per face
+			EIndex		indexType	= EIndex::UInt;
+		};
+		using FaceRanges_t	= StaticArray< FaceRange, 6 >;
+
+		// cluster of triangles, 'center' and 'radius' are bounding sphere,
+		// cluster is backfacing for any camera where 'Dot( center - camera, coneAxis ) >= coneCutoff * Distance( center, camera ) + radius'
+		struct Meshlet
+		{
+			float3		center;
+			float		radius			= 0.0f;
+			float3		coneAxis;
+			float		coneCutoff		= 1.0f;		// 1 - cone test never passes
+			uint		vertexOffset	= 0;		// in 'Meshlets::vertices'
+			uint		triangleOffset	= 0;		// in 'Meshlets::triangles', 3 elements per triangle
+			uint		vertexCount		= 0;
+			uint		triangleCount	= 0;
+		};
+
+		struct Meshlets
+		{
+			Array<Meshlet>		meshlets;
+			Array<uint>			vertices;		// index of vertex in LOD, same as in 'GenerateVertices'
+			Array<uint8_t>		triangles;		// index in 'vertices' relative to 'Meshlet::vertexOffset'
+		};
+
+		// line segments in SoA layout, see 'RayCast'
+		struct RaySegments
+		{
+			Array<float>	beginX, beginY, beginZ;
+			Array<float>	endX, endY, endZ;
+
+			void  Resize (size_t count);
+			void  Set (size_t i, const float3 &begin, const float3 &end);
+
+			ND_ float3  Begin (size_t i)	const	{ return float3{ beginX[i], beginY[i], beginZ[i] }; }
+			ND_ float3  End (size_t i)		const	{ return float3{ endX[i], endY[i], endZ[i] }; }
+			ND_ size_t  size ()				const	{ return beginX.size(); }
+		};
+
+		struct RayHits
+		{
+			Array<uint>		mask;						// bit per segment, segment 'i' is bit 'i % 32' of 'mask[i / 32]'
+			Array<float>	pointX, pointY, pointZ;		// undefined if segment has no hit
+
+			ND_ bool    IsHit (size_t i)	const	{ return ((mask[i >> 5] >> (i & 31)) & 1) != 0; }
+			ND_ float3  Point (size_t i)	const	{ return float3{ pointX[i], pointY[i], pointZ[i] }; }
+		};
+
+		// returns height relative to radius for direction from planet center,
+		// surface point is 'center + dir * radius * (1 + height)'
+		using HeightFn_t	= Function< float (const float3 &dir) >;
+
+		static constexpr uint	MaxLods				= 32;
+		static constexpr uint	MeshletMaxVertices	= 64;
+		static constexpr uint	MeshletMaxTriangles	= 124;
+
 
 	// variables
 	private:
 		BufferID		_vertexBuffer;
+		BufferID		_tangentBuffer;		// only for 'EVertexLayout::Tangents'
 		BufferID		_indexBuffer;
 		uint			_minLod			= 0;
 		uint			_maxLod			= 0;
 		bool			_quads			= false;
+		EVertexLayout	_layout			= Default;
+
+		// offsets of each LOD, indexed by 'lod - _minLod', last element is total size
+		StaticArray< uint, MaxLods+1 >		_vertOffsets	= {};	// in elements
+		StaticArray< BytesU, MaxLods+1 >	_indexOffsets	= {};	// in bytes, index type depends on LOD
 
 
 	// methods
@@ -74,17 +170,76 @@ namespace FG
 		SphericalCube () {}
 		~SphericalCube ();
 
-		bool Create (const CommandBuffer &cmdbuf, uint minLod, uint maxLod, bool quads);
+		bool Create (const CommandBuffer &cmdbuf, uint minLod, uint maxLod, bool quads, EVertexLayout layout = Default);
 		void Destroy (const FrameGraph &fg);
 
 		ND_ DrawIndexed  Draw (uint lod) const;
 
+			// only for default and tangents layout, returns first vertex stream
 			bool GetVertexBuffer (uint lod, uint face, OUT RawBufferID &id, OUT BytesU &offset, OUT BytesU &size, OUT uint2 &vertCount) const;
 			bool GetIndexBuffer (uint lod, uint face, OUT RawBufferID &id, OUT BytesU &offset, OUT BytesU &size, OUT uint &indexCount) const;
 
+			// returns ranges for all faces in single call
+			bool GetFaceRanges (uint lod, OUT FaceRanges_t &ranges) const;
+
+		ND_ RawBufferID	VertexBuffer ()		const	{ return _vertexBuffer; }
+		ND_ RawBufferID	TangentBuffer ()	const	{ return _tangentBuffer; }
+		ND_ RawBufferID	IndexBuffer ()		const	{ return _indexBuffer; }
+
 		ND_ bool RayCast (const float3 &center, float radius, const float3 &begin, const float3 &end, OUT float3 &outIntersection) const;
 
-		ND_ static VertexInputState	GetAttribs ();
+		// intersects all segments with sphere, returns nearest intersection for each segment
+		static void  RayCast (const float3 &center, float radius, const RaySegments &segments, OUT RayHits &hits);
+
+		// intersects segment with displaced surface, 'maxHeight' - upper bound of 'Abs( height( dir ))',
+		// 'steps' - number of samples between bounding spheres, then result is refined by bisection
+		ND_ static bool  RayCastSurface (const float3 &center, float radius, float maxHeight, const HeightFn_t &height,
+										 const float3 &begin, const float3 &end, OUT float3 &outIntersection, uint steps = 64);
+			static void  RayCastSurface (const float3 &center, float radius, float maxHeight, const HeightFn_t &height,
+										 const RaySegments &segments, OUT RayHits &hits, uint steps = 64);
+
+		ND_ EVertexLayout  GetVertexLayout ()	const	{ return _layout; }
+
+		ND_ static VertexInputState	GetAttribs (EVertexLayout layout = Default);
+		ND_ static BytesU			GetVertexStride (EVertexLayout layout);		// of the first vertex stream
+
+		// 16 bit indices are used when all LOD vertices are addressable
+		ND_ static EIndex			GetIndexType (uint lod, EVertexLayout layout);
+		ND_ static BytesU			GetIndexStride (EIndex type);
+
+		ND_ static uint  CalcVertCount (uint lod);
+		ND_ static uint  CalcPackedVertCount (uint lod);
+		ND_ static uint  CalcIndexCount (uint lod, bool quads);
+
+		// total count of elements in LODs [minLod, lod), closed form
+		ND_ static uint  CalcVertOffset (uint minLod, uint lod);
+		ND_ static uint  CalcPackedVertOffset (uint minLod, uint lod);
+		ND_ static uint  CalcIndexOffset (uint minLod, uint lod, bool quads);
+
+		// CPU side geometry generation, output arrays must have space for 'CalcVertCount()' and 'CalcIndexCount()' elements,
+		// 'tangents' is optional
+		static void  GenerateVertices (uint lod, OUT Vertex *vertices, OUT TangentVertex *tangents = null);
+		static void  GenerateIndices (uint lod, bool quads, OUT uint *indices);
+		static void  GenerateIndices (uint lod, bool quads, OUT uint16_t *indices);
+
+		// output arrays must have space for 'CalcPackedVertCount()' and 'CalcIndexCount()' elements
+		static void  GeneratePacked (uint lod, bool quads, OUT PackedVertex *vertices, OUT uint *indices);
+		static void  GeneratePacked (uint lod, bool quads, OUT PackedVertex *vertices, OUT uint16_t *indices);
+
+		// splits each face into tiles with at most 'MeshletMaxVertices' vertices and 'MeshletMaxTriangles' triangles, only for default layout
+		static void  BuildMeshlets (uint lod, OUT Meshlets &result);
+
+		ND_ static uint    PackOctahedral (const float3 &dir);
+		ND_ static float3  UnpackOctahedral (uint packed);
+
+	private:
+		static void  _RayCast (const float3 &center, float radius, bool solid, const RaySegments &segments, OUT RayHits &hits);
+
+		template <typename T>
+		static void  _GenerateIndices (uint lod, bool quads, OUT T *indices);
+
+		template <typename T>
+		static void  _GeneratePacked (uint lod, bool quads, OUT PackedVertex *vertices, OUT T *indices);
 	};
 
 	
@@ -125,6 +280,40 @@ namespace FG
 		return { float2(c), face };
 	}
 	
+/*
+=================================================
+	ForwardTangents
+----
+	position is 'RotateVec( v, face )' or 'Normalize( RotateVec( v, face ))'
+	where 'v = { Warp(x), Warp(y), 1 }', rotation is linear,
+	derivative of 'v / |v|' is '(dv - n * Dot( n, dv )) / |v|' where 'n = v / |v|'.
+=================================================
+*/
+	template <typename PP, typename TP>
+	inline Pair<double3, double3>  SphericalCubeProjection<PP,TP>::ForwardTangents (const double2 &ncoord, ECubeFace face)
+	{
+		const double3	v	{ Projection_t::Warp( ncoord.x ), Projection_t::Warp( ncoord.y ), 1.0 };
+		double3			tx	{ Projection_t::WarpDerivative( ncoord.x ), 0.0, 0.0 };
+		double3			ty	{ 0.0, Projection_t::WarpDerivative( ncoord.y ), 0.0 };
+
+		if constexpr( Projection_t::IsNormalized )
+		{
+			const double	len	= Length( v );
+			const double3	n	= v / len;
+
+			tx = (tx - n * Dot( n, tx )) / len;
+			ty = (ty - n * Dot( n, ty )) / len;
+		}
+		return { RotateVec( tx, face ), RotateVec( ty, face )};
+	}
+	
+	template <typename PP, typename TP>
+	inline Pair<float3, float3>  SphericalCubeProjection<PP,TP>::ForwardTangents (const float2 &ncoord, ECubeFace face)
+	{
+		auto[tx, ty] = ForwardTangents( double2(ncoord), face );
+		return { float3(tx), float3(ty) };
+	}
+	
 /*
 =================================================
 	ForwardTexProjection
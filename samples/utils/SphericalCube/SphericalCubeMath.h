@@ -78,6 +78,19 @@ namespace FGC
 */
 	struct OriginCube
 	{
+		// separable form: Forward() == RotateVec( double3{ Warp(x), Warp(y), 1.0 }, face )
+		static constexpr bool	IsNormalized = false;
+
+		ND_ static double  Warp (double x)
+		{
+			return x;
+		}
+
+		ND_ static double  WarpDerivative (double)
+		{
+			return 1.0;
+		}
+
 		ND_ static double3  Forward (const double2 &ncoord, ECubeFace face)
 		{
 			return RotateVec( double3{ ncoord, 1.0 }, face );
@@ -97,6 +110,19 @@ namespace FGC
 */
 	struct IdentitySphericalCube
 	{
+		// separable form: Forward() == Normalize( RotateVec( double3{ Warp(x), Warp(y), 1.0 }, face ))
+		static constexpr bool	IsNormalized = true;
+
+		ND_ static double  Warp (double x)
+		{
+			return x;
+		}
+
+		ND_ static double  WarpDerivative (double)
+		{
+			return 1.0;
+		}
+
 		ND_ static double3  Forward (const double2 &ncoord, ECubeFace face)
 		{
 			return Normalize( RotateVec( double3{ ncoord, 1.0 }, face ));
@@ -120,12 +146,22 @@ namespace FGC
 		static constexpr double  warp_theta		= 0.868734829276;
 		static constexpr double  tan_warp_theta	= 1.182286685546; //tan( warp_theta );
 		
-		ND_ static double3  Forward (const double2 &ncoord, ECubeFace face)
+		// separable form: Forward() == Normalize( RotateVec( double3{ Warp(x), Warp(y), 1.0 }, face ))
+		static constexpr bool	IsNormalized = true;
+
+		ND_ static double  Warp (double x)
 		{
-			double	x = tan( warp_theta * ncoord.x ) / tan_warp_theta;
-			double	y = tan( warp_theta * ncoord.y ) / tan_warp_theta;
+			return tan( warp_theta * x ) / tan_warp_theta;
+		}
 
-			return Normalize( RotateVec( double3{x, y, 1.0}, face ));
+		ND_ static double  WarpDerivative (double x)
+		{
+			return warp_theta / (tan_warp_theta * Square( cos( warp_theta * x )));
+		}
+
+		ND_ static double3  Forward (const double2 &ncoord, ECubeFace face)
+		{
+			return Normalize( RotateVec( double3{ Warp( ncoord.x ), Warp( ncoord.y ), 1.0 }, face ));
 		}
 
 		ND_ static Pair<double2, ECubeFace>  Inverse (const double3 &coord)
@@ -147,6 +183,52 @@ namespace FGC
 */
 	struct AdjustedSphericalCube
 	{
+		// odd polynomial 'x * (c0 + c1 * x^2 + c2 * x^4)' with 'Warp(1) == 1',
+		// coefficients are fitted to minimize variance of texel area on sphere
+		static constexpr double  warp_coeff[]		= { 0.746347207264, 0.123801575608, 0.129851217128 };
+
+		// initial approximation of inverse warp in the same form, max error is 0.00085
+		static constexpr double  inv_warp_coeff[]	= { 1.343150151512, -0.482312823340, 0.139162671828 };
+		
+		// separable form: Forward() == Normalize( RotateVec( double3{ Warp(x), Warp(y), 1.0 }, face ))
+		static constexpr bool	IsNormalized = true;
+
+		ND_ static constexpr double  Warp (double x)
+		{
+			const double	x2 = x * x;
+			return x * (warp_coeff[0] + x2 * (warp_coeff[1] + x2 * warp_coeff[2]));
+		}
+
+		ND_ static constexpr double  WarpDerivative (double x)
+		{
+			const double	x2 = x * x;
+			return warp_coeff[0] + x2 * (3.0 * warp_coeff[1] + x2 * 5.0 * warp_coeff[2]);
+		}
+
+		// two Newton iterations are enough for double precision
+		ND_ static constexpr double  InverseWarp (double c)
+		{
+			const double	c2	= c * c;
+			double			x	= c * (inv_warp_coeff[0] + c2 * (inv_warp_coeff[1] + c2 * inv_warp_coeff[2]));
+
+			for (int i = 0; i < 2; ++i) {
+				x -= (Warp( x ) - c) / WarpDerivative( x );
+			}
+			return x;
+		}
+
+		ND_ static double3  Forward (const double2 &ncoord, ECubeFace face)
+		{
+			return Normalize( RotateVec( double3{ Warp( ncoord.x ), Warp( ncoord.y ), 1.0 }, face ));
+		}
+
+		ND_ static Pair<double2, ECubeFace>  Inverse (const double3 &coord)
+		{
+			auto[c, z, face] = InverseRotation( coord );
+			c /= z;
+
+			return { double2( InverseWarp( c.x ), InverseWarp( c.y )), face };
+		}
 	};
 	
 /*
@@ -0,0 +1,373 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SphericalCubeQuadTree.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	constructor
+----
+	Calculates upper bound of the projection jacobian and then
+	upper bound of patch diameter on each level. Selection is stable
+	(neighbour levels differ by at most 1) only if patch diameter
+	is not greater than '_levelDiameter', see '_Select'.
+=================================================
+*/
+	SphericalCubeQuadTree::SphericalCubeQuadTree ()
+	{
+		static constexpr uint	count	= 64;
+		double					max_j	= 0.0;
+
+		for (uint y = 0; y <= count; ++y)
+		for (uint x = 0; x <= count; ++x)
+		{
+			const double2	c		= double2{ double(x), double(y) } / double(count) * 2.0 - 1.0;
+			auto[dx, dy]			= SphericalCube::ForwardTangents( c, ECubeFace::ZPos );
+
+			// frobenius norm is not less than operator norm
+			max_j = Max( max_j, Sqrt( Dot( dx, dx ) + Dot( dy, dy )));
+		}
+
+		// patch size on level 0 is 2 in face coords, 1% is reserved for approximation error
+		for (uint level = 0; level <= MaxLevels; ++level) {
+			_levelDiameter[level] = float(max_j * 1.01 * 2.0 * Sqrt(2.0) / double(1u << level));
+		}
+	}
+
+/*
+=================================================
+	destructor
+=================================================
+*/
+	SphericalCubeQuadTree::~SphericalCubeQuadTree ()
+	{
+		CHECK( not _vertexBuffer );
+		CHECK( not _indexBuffer );
+		CHECK( not _instanceBuffer );
+	}
+
+/*
+=================================================
+	Create
+=================================================
+*/
+	bool  SphericalCubeQuadTree::Create (const CommandBuffer &cmdbuf)
+	{
+		STATIC_ASSERT( (GridSize+1) * (GridSize+1) <= (1u << 16) );
+		CHECK_ERR( cmdbuf );
+
+		FrameGraph	fg	= cmdbuf->GetFrameGraph();
+
+		Destroy( fg );
+
+		const BytesU	vb_size	= SizeOf<float2> * (GridSize+1) * (GridSize+1);
+		const BytesU	ib_size	= SizeOf<uint16_t> * 4 * GridSize * GridSize;
+
+		_vertexBuffer	= fg->CreateBuffer( BufferDesc{ vb_size, EBufferUsage::Vertex | EBufferUsage::Transfer }, Default, "PlanetChunk.Vertices" );
+		_indexBuffer	= fg->CreateBuffer( BufferDesc{ ib_size, EBufferUsage::Index | EBufferUsage::Transfer }, Default, "PlanetChunk.Indices" );
+		_instanceBuffer	= fg->CreateBuffer( BufferDesc{ SizeOf<ChunkInstance> * MinInstances, EBufferUsage::Vertex | EBufferUsage::Transfer }, Default, "PlanetChunk.Instances" );
+		CHECK_ERR( _vertexBuffer and _indexBuffer and _instanceBuffer );
+		_instanceCapacity = MinInstances;
+
+		RawBufferID		staging_vb,	staging_ib;
+		BytesU			vb_offset,	ib_offset;
+		float2 *		vb_mapped	= null;
+		uint16_t *		ib_mapped	= null;
+
+		CHECK_ERR( cmdbuf->AllocBuffer( vb_size, SizeOf<float2>, OUT staging_vb, OUT vb_offset, OUT vb_mapped ));
+		CHECK_ERR( cmdbuf->AllocBuffer( ib_size, SizeOf<uint>, OUT staging_ib, OUT ib_offset, OUT ib_mapped ));
+
+		GenerateGrid( GridSize, OUT vb_mapped, OUT ib_mapped );
+
+		cmdbuf->AddTask( CopyBuffer{}.From( staging_vb ).To( _vertexBuffer ).AddRegion( vb_offset, 0_b, vb_size ));
+		cmdbuf->AddTask( CopyBuffer{}.From( staging_ib ).To( _indexBuffer ).AddRegion( ib_offset, 0_b, ib_size ));
+
+		return true;
+	}
+
+/*
+=================================================
+	Destroy
+=================================================
+*/
+	void  SphericalCubeQuadTree::Destroy (const FrameGraph &fg)
+	{
+		fg->ReleaseResource( _vertexBuffer );
+		fg->ReleaseResource( _indexBuffer );
+		fg->ReleaseResource( _instanceBuffer );
+		_instanceCapacity = 0;
+
+		_chunks.clear();
+		_leaves.clear();
+	}
+
+/*
+=================================================
+	Update
+----
+	Screen-space error of the patch is proportional to 'diameter / distance',
+	so split condition is 'distance < splitScale * diameter'.
+	If 'splitScale >= 1' then parent of the finer neighbour is too close
+	to the coarser patch and levels of neighbours differ by at most 1.
+=================================================
+*/
+	void  SphericalCubeQuadTree::Update (const float3 &camera, const Settings &settings, const PatchCulling::Frustum_t *frustum)
+	{
+		ASSERT( settings.maxLevel <= MaxLevels );
+
+		const float	proj_scale	= settings.viewportHeight / (2.0f * std::tan( float(settings.fovY) * 0.5f ));
+		const float	split_scale	= Max( 1.0f, proj_scale / (float(GridSize) * settings.tessLevel * settings.pixelError ));
+
+		_chunks.clear();
+		_leaves.clear();
+
+		for (uint face = 0; face < 6; ++face) {
+			_Select( camera, settings, ECubeFace(face), 0, uint2{0}, split_scale );
+		}
+
+		_Cull( camera, settings, frustum );
+		_FindCoarserEdges( settings.maxLevel );
+	}
+
+/*
+=================================================
+	_Select
+=================================================
+*/
+	void  SphericalCubeQuadTree::_Select (const float3 &camera, const Settings &settings, ECubeFace face, uint level, const uint2 &coord, float splitScale)
+	{
+		const Chunk	chunk	= _CalcChunk( face, level, coord );
+		const float	dist	= Max( 0.0f, Distance( camera, chunk.center ) - chunk.radius - settings.maxHeight );
+
+		// culling is not used here, otherwise visible neighbours may have level difference greater than 1
+		if ( level >= settings.maxLevel or dist >= splitScale * _levelDiameter[level] )
+		{
+			_leaves.insert( _LeafKey( face, level, coord ));
+			_chunks.push_back( chunk );
+			return;
+		}
+
+		for (uint i = 0; i < 4; ++i) {
+			_Select( camera, settings, face, level+1, coord*2 + uint2{i&1, i>>1}, splitScale );
+		}
+	}
+
+/*
+=================================================
+	_CalcChunk
+=================================================
+*/
+	SphericalCubeQuadTree::Chunk  SphericalCubeQuadTree::_CalcChunk (ECubeFace face, uint level, const uint2 &coord) const
+	{
+		Chunk	chunk;
+		chunk.size		= 2.0f / float(1u << level);
+		chunk.offset	= float2(coord) * chunk.size - 1.0f;
+		chunk.face		= uint(face);
+		chunk.level		= level;
+		chunk.center	= SphericalCube::ForwardProjection( chunk.offset + chunk.size * 0.5f, face );
+
+		// corners and edge centers
+		for (uint i = 0; i < 9; ++i)
+		{
+			const float3	pos = SphericalCube::ForwardProjection( chunk.offset + chunk.size * 0.5f * float2{ float(i%3), float(i/3) }, face );
+			chunk.radius = Max( chunk.radius, Distance( chunk.center, pos ));
+		}
+
+		ASSERT( chunk.radius * 2.0f <= _levelDiameter[level] );
+		return chunk;
+	}
+
+/*
+=================================================
+	_Cull
+----
+	removes chunks that are outside of frustum or behind the horizon,
+	bounding sphere is extended by max height
+=================================================
+*/
+	void  SphericalCubeQuadTree::_Cull (const float3 &camera, const Settings &settings, const PatchCulling::Frustum_t *frustum)
+	{
+		PatchCulling::Params	params;
+		params.camera			= camera;
+		params.occluderRadius	= 1.0f - settings.maxHeight;
+		params.horizonCulling	= true;
+		params.frustumCulling	= (frustum != null);
+
+		if ( frustum )
+			params.frustum = *frustum;
+
+		_bounds.Resize( _chunks.size() );
+
+		for (size_t i = 0; i < _chunks.size(); ++i) {
+			_bounds.Set( i, _chunks[i].center, _chunks[i].radius + settings.maxHeight );
+		}
+
+		PatchCulling::Cull( _bounds, params, OUT _visible );
+
+		// indices are sorted, so chunks can be moved in place
+		for (size_t i = 0; i < _visible.size(); ++i) {
+			_chunks[i] = _chunks[ _visible[i] ];
+		}
+		_chunks.resize( _visible.size() );
+	}
+
+/*
+=================================================
+	_FindCoarserEdges
+----
+	neighbour level is a level of leaf that contains point
+	outside of the chunk edge at the quarter of chunk size
+=================================================
+*/
+	void  SphericalCubeQuadTree::_FindCoarserEdges (uint maxLevel)
+	{
+		for (auto& chunk : _chunks)
+		{
+			const float2	mid		= chunk.offset + chunk.size * 0.5f;
+			const float		d		= chunk.size * 0.75f;
+			const float2	points[] = { float2{mid.x - d, mid.y}, float2{mid.x, mid.y - d}, float2{mid.x + d, mid.y}, float2{mid.x, mid.y + d} };
+
+			for (uint i = 0; i < CountOf(points); ++i)
+			{
+				if ( FindLevel( points[i], ECubeFace(chunk.face), maxLevel ) < chunk.level )
+					chunk.coarserEdges |= (1u << i);
+			}
+		}
+	}
+
+/*
+=================================================
+	FindLevel
+=================================================
+*/
+	uint  SphericalCubeQuadTree::FindLevel (const float2 &ncoord, ECubeFace face, uint maxLevel) const
+	{
+		float2	nc	= ncoord;
+
+		// project to the neighbour face
+		if ( Any( Abs(nc) > 1.0f ))
+		{
+			auto[c, f] = IdentitySphericalCube::Inverse( OriginCube::Forward( double2(nc), face ));
+			nc		= float2(c);
+			face	= f;
+		}
+
+		for (uint level = 0; level <= maxLevel; ++level)
+		{
+			const int	count	= int(1u << level);
+			const int2	coord	= Clamp( int2((nc + 1.0f) * 0.5f * float(count)), int2(0), int2(count-1) );
+
+			if ( _leaves.count( _LeafKey( face, level, uint2(coord) )))
+				return level;
+		}
+		return UMax;
+	}
+
+/*
+=================================================
+	_LeafKey
+=================================================
+*/
+	uint64_t  SphericalCubeQuadTree::_LeafKey (ECubeFace face, uint level, const uint2 &coord)
+	{
+		STATIC_ASSERT( MaxLevels <= 28 );
+		return uint64_t(face) | (uint64_t(level) << 3) | (uint64_t(coord.x) << 8) | (uint64_t(coord.y) << 36);
+	}
+
+/*
+=================================================
+	GenerateGrid
+=================================================
+*/
+	void  SphericalCubeQuadTree::GenerateGrid (uint gridSize, OUT float2 *vertices, OUT uint16_t *indices)
+	{
+		const uint	vcount	= gridSize + 1;
+		uint		index_i	= 0;
+
+		for (uint y = 0; y < vcount; ++y)
+		for (uint x = 0; x < vcount; ++x) {
+			vertices[x + y * vcount] = float2{ float(x), float(y) } / float(gridSize);
+		}
+
+		// same order as in 'SphericalCube::GenerateIndices'
+		for (uint y = 0; y < gridSize; ++y)
+		for (uint x = 0; x < gridSize; ++x)
+		{
+			indices[index_i++] = uint16_t((x+0) + (y+0)*vcount);
+			indices[index_i++] = uint16_t((x+1) + (y+0)*vcount);
+			indices[index_i++] = uint16_t((x+1) + (y+1)*vcount);
+			indices[index_i++] = uint16_t((x+0) + (y+1)*vcount);
+		}
+	}
+
+/*
+=================================================
+	GetAttribs
+=================================================
+*/
+	VertexInputState  SphericalCubeQuadTree::GetAttribs ()
+	{
+		VertexInputState	vert_input;
+		vert_input.Bind( VertexBufferID{"grid"}, SizeOf<float2>, 0, EVertexInputRate::Vertex );
+		vert_input.Bind( VertexBufferID{"chunk"}, SizeOf<ChunkInstance>, 1, EVertexInputRate::Instance );
+
+		vert_input.Add( VertexID{"at_Position"},    EVertexType::Float2, 0_b,                                 VertexBufferID{"grid"} );
+		vert_input.Add( VertexID{"at_ChunkOffset"}, EVertexType::Float3, OffsetOf( &ChunkInstance::offset ), VertexBufferID{"chunk"} );
+		vert_input.Add( VertexID{"at_ChunkFlags"},  EVertexType::UInt,   OffsetOf( &ChunkInstance::flags ),  VertexBufferID{"chunk"} );
+		return vert_input;
+	}
+
+/*
+=================================================
+	Draw
+----
+	old instance buffer is released after it is no longer used by GPU
+=================================================
+*/
+	DrawIndexed  SphericalCubeQuadTree::Draw (const CommandBuffer &cmdbuf)
+	{
+		if ( _chunks.size() > _instanceCapacity )
+		{
+			FrameGraph	fg			= cmdbuf->GetFrameGraph();
+			uint		capacity	= Max( _instanceCapacity, MinInstances );
+
+			for (; capacity < _chunks.size(); capacity <<= 1) {}
+
+			FG_LOGI( "Planet chunk instance buffer is resized to "s << ToString( capacity ));
+
+			fg->ReleaseResource( _instanceBuffer );
+			_instanceBuffer = fg->CreateBuffer( BufferDesc{ SizeOf<ChunkInstance> * capacity, EBufferUsage::Vertex | EBufferUsage::Transfer }, Default, "PlanetChunk.Instances" );
+			CHECK( _instanceBuffer );
+			_instanceCapacity = _instanceBuffer ? capacity : 0;
+		}
+
+		// chunks that don't fit are not drawn only if buffer can't be created
+		const size_t			count	= Min( _chunks.size(), size_t(_instanceCapacity) );
+		Array<ChunkInstance>	instances;
+		instances.resize( count );
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto&	src = _chunks[i];
+			instances[i] = ChunkInstance{ src.offset, src.size, src.face | (src.coarserEdges << 8) };
+		}
+
+		if ( instances.size() )
+			cmdbuf->AddTask( UpdateBuffer{}.SetBuffer( _instanceBuffer ).AddData( instances.data(), instances.size(), 0_b ));
+
+		DrawIndexed		task;
+		task.SetVertexInput( GetAttribs() );
+		task.AddVertexBuffer( VertexBufferID{"grid"}, _vertexBuffer );
+		task.AddVertexBuffer( VertexBufferID{"chunk"}, _instanceBuffer );
+		task.SetIndexBuffer( _indexBuffer, 0_b, EIndex::UShort );
+		task.Draw( 4 * GridSize * GridSize, uint(instances.size()) );
+		task.SetTopology( EPrimitive::TriangleList );
+		task.SetFrontFaceCCW( false );
+
+		return task;
+	}
+
+
+}	// FG
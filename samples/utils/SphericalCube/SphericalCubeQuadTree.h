@@ -0,0 +1,115 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "SphericalCube.h"
+#include "PatchCulling.h"
+
+namespace FG
+{
+
+	//
+	// Spherical Cube Quad Tree
+	//
+
+	class SphericalCubeQuadTree final
+	{
+	// types
+	public:
+		// bit mask, neighbour chunk on this edge has lower level
+		enum EEdge : uint
+		{
+			Edge_XNeg	= 1 << 0,
+			Edge_YNeg	= 1 << 1,
+			Edge_XPos	= 1 << 2,
+			Edge_YPos	= 1 << 3,
+		};
+
+		struct Chunk
+		{
+			float2		offset;				// min corner in face coords [-1, 1]
+			float		size			= 0.0f;	// in face coords
+			uint		face			= 0;
+			uint		level			= 0;
+			uint		coarserEdges	= 0;	// 'EEdge'
+			float3		center;				// bounding sphere of patch on unit sphere, without height
+			float		radius			= 0.0f;
+		};
+
+		// per instance data for shader
+		struct ChunkInstance
+		{
+			float2		offset;
+			float		size;
+			uint		flags;				// face | (coarserEdges << 8)
+		};
+
+		struct Settings
+		{
+			uint		maxLevel		= 14;
+			float		tessLevel		= 12.0f;	// must be even, chunk edge shared with coarser chunk uses half of it
+			float		pixelError		= 2.0f;		// max screen-space error in pixels
+			float		viewportHeight	= 1080.0f;
+			Rad			fovY			= 60_deg;
+			float		maxHeight		= 0.1f;		// relative to radius
+		};
+
+		static constexpr uint	MaxLevels		= 24;
+		static constexpr uint	MinInstances	= 1u << 14;	// initial capacity of instance buffer
+		static constexpr uint	GridSize		= 16;			// quads per chunk side
+
+
+	// variables
+	private:
+		BufferID				_vertexBuffer;		// grid in [0, 1]
+		BufferID				_indexBuffer;
+		BufferID				_instanceBuffer;
+		uint					_instanceCapacity	= 0;
+
+		Array<Chunk>			_chunks;			// visible leaves
+		HashSet<uint64_t>		_leaves;			// all leaves, see '_LeafKey'
+
+		PatchCulling::Bounds	_bounds;			// temporary
+		Array<uint>				_visible;			// temporary
+
+		// upper bound of patch diameter on each level
+		StaticArray< float, MaxLevels+1 >	_levelDiameter	= {};
+
+
+	// methods
+	public:
+		SphericalCubeQuadTree ();
+		~SphericalCubeQuadTree ();
+
+		bool Create (const CommandBuffer &cmdbuf);
+		void Destroy (const FrameGraph &fg);
+
+		// 'camera' - camera position in planet space where planet radius is 1,
+		// 'frustum' - normalized frustum planes in the same space, optional
+		void Update (const float3 &camera, const Settings &settings, const PatchCulling::Frustum_t *frustum = null);
+
+		// uploads visible chunks and returns instanced draw task, instance buffer grows if needed
+		ND_ DrawIndexed  Draw (const CommandBuffer &cmdbuf);
+
+		ND_ ArrayView<Chunk>	GetChunks ()	const	{ return _chunks; }
+
+		// returns level of leaf that contains point, 'ncoord' may be outside of face
+		ND_ uint  FindLevel (const float2 &ncoord, ECubeFace face, uint maxLevel) const;
+
+		ND_ static VertexInputState  GetAttribs ();
+
+		// CPU side geometry generation, output arrays must have space for '(gridSize+1)^2' and '4 * gridSize^2' elements
+		static void  GenerateGrid (uint gridSize, OUT float2 *vertices, OUT uint16_t *indices);
+
+	private:
+		void  _Select (const float3 &camera, const Settings &settings, ECubeFace face, uint level, const uint2 &coord, float splitScale);
+		void  _Cull (const float3 &camera, const Settings &settings, const PatchCulling::Frustum_t *frustum);
+		void  _FindCoarserEdges (uint maxLevel);
+
+		ND_ Chunk  _CalcChunk (ECubeFace face, uint level, const uint2 &coord) const;
+
+		ND_ static uint64_t  _LeafKey (ECubeFace face, uint level, const uint2 &coord);
+	};
+
+
+}	// FG
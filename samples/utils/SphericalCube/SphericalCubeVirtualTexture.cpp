@@ -0,0 +1,502 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SphericalCubeVirtualTexture.h"
+
+namespace FG
+{
+
+/*
+=================================================
+	destructor
+=================================================
+*/
+	SphericalCubeVirtualTexture::~SphericalCubeVirtualTexture ()
+	{
+		CHECK( not _pageTableImage );
+	}
+
+/*
+=================================================
+	Create
+=================================================
+*/
+	bool  SphericalCubeVirtualTexture::Create (const FrameGraph &fg, const Settings &settings)
+	{
+		Destroy( fg );
+		Reset( settings );
+
+		_pageTableImage = fg->CreateImage( ImageDesc{}.SetView( EImage_2DArray ).SetDimension( uint2{ _PagesPerSide(0) }).SetArrayLayers( 6 )
+												.SetFormat( EPixelFormat::R32U ).SetMaxMipmaps( _maxMip + 1 )
+												.SetUsage( EImageUsage::Transfer | EImageUsage::Sampled ),
+										   Default, "Planet.PageTable" );
+		CHECK_ERR( _pageTableImage );
+		return true;
+	}
+
+/*
+=================================================
+	Destroy
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::Destroy (const FrameGraph &fg)
+	{
+		fg->ReleaseResource( _pageTableImage );
+
+		_pageTable.clear();
+		_pageSlot.clear();
+		_slots.clear();
+		_pending.clear();
+	}
+
+/*
+=================================================
+	Reset
+----
+	pages of the coarsest mipmap are pinned,
+	so any part of the face can be sampled even if finer pages are not generated yet
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::Reset (const Settings &settings)
+	{
+		CHECK( settings.pageSize > 0 and settings.faceSize % settings.pageSize == 0 );
+		CHECK( IsPowerOfTwo( settings.faceSize / settings.pageSize ));
+		CHECK( settings.cacheSize * settings.cacheSize > 6 and settings.cacheSize <= MaxCacheSize );
+
+		_settings	= settings;
+		_maxMip		= IntLog2( settings.faceSize / settings.pageSize );
+		_frame		= 0;
+		_lruFirst	= UMax;
+		_lruLast	= UMax;
+
+		_mipOffset.resize( _maxMip + 1 );
+
+		uint	count = 0;
+		for (uint mip = 0; mip <= _maxMip; ++mip)
+		{
+			_mipOffset[mip]  = count;
+			count			+= 6 * _PagesPerSide( mip ) * _PagesPerSide( mip );
+		}
+
+		_pageTable.assign( count, InvalidEntry );
+		_pageSlot.assign( count, UMax );
+
+		_slots.clear();
+		_slots.resize( settings.cacheSize * settings.cacheSize );
+		_pending.clear();
+
+		for (auto& dirty : _dirtyMips) {
+			dirty = (2u << _maxMip) - 1;
+		}
+
+		for (uint face = 0; face < 6; ++face)
+		{
+			_slots[face].pinned = true;
+			_MakeResident( face, face, _maxMip, uint2{0} );
+		}
+
+		for (uint i = 6; i < _slots.size(); ++i) {
+			_PushBack( i );
+		}
+	}
+
+/*
+=================================================
+	Update
+----
+	pending pages are accumulated until 'Upload' call.
+	pages are generated from coarse to fine, so if cache is full
+	or generation budget is exceeded then chunk uses coarser page
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::Update (ArrayView<Chunk> chunks)
+	{
+		++_frame;
+		_requests.clear();
+
+		for (auto& chunk : chunks)
+		{
+			// texel 0 is on the face edge, see 'gen_height.glsl'
+			const uint		mip		= ChunkMipmap( chunk );
+			const float		scale	= float(_settings.faceSize >> mip) - 1.0f;
+			const uint2		last	= uint2{ _PagesPerSide( mip ) - 1 };
+			const uint2		begin	= Min( uint2( (chunk.offset + 1.0f) * 0.5f * scale ) / _settings.pageSize, last );
+			const uint2		end		= Min( uint2( (chunk.offset + chunk.size + 1.0f) * 0.5f * scale ) / _settings.pageSize, last );
+
+			for (uint y = begin.y; y <= end.y; ++y)
+			for (uint x = begin.x; x <= end.x; ++x)
+			{
+				const uint	page	= _PageIndex( chunk.face, mip, uint2{x, y} );
+				const uint	slot	= _pageSlot[page];
+
+				if ( slot == UMax )
+					_requests.push_back( page );
+				else
+					_Touch( slot );
+			}
+		}
+
+		// coarser mipmaps have greater indices
+		std::sort( _requests.begin(), _requests.end(), std::greater<uint>{} );
+		_requests.erase( std::unique( _requests.begin(), _requests.end() ), _requests.end() );
+
+		for (uint page : _requests)
+		{
+			if ( _pending.size() >= _settings.maxPagesPerFrame )
+				break;
+
+			const uint	slot = _AllocSlot();
+			if ( slot == UMax )
+				break;	// all pages are used in this frame
+
+			uint	face, mip;
+			uint2	coord;
+			_DecodePage( page, OUT face, OUT mip, OUT coord );
+			_MakeResident( slot, face, mip, coord );
+		}
+	}
+
+/*
+=================================================
+	Invalidate
+----
+	border texels of the page and rounding of texel coordinates
+	on coarser mipmaps are covered by extending the region
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::Invalidate (ECubeFace face, const uint2 &offset, const uint2 &dimension)
+	{
+		if ( dimension.x == 0 or dimension.y == 0 )
+			return;
+
+		const uint	margin	= _settings.pageBorder + 1;
+
+		for (uint mip = 0; mip <= _maxMip; ++mip)
+		{
+			const uint2		last	= uint2{ _PagesPerSide( mip ) - 1 };
+			const uint2		first	{ offset.x >> mip, offset.y >> mip };
+			const uint2		end		{ (offset.x + dimension.x - 1) >> mip, (offset.y + dimension.y - 1) >> mip };
+			const uint2		begin	= Min( (Max( first, uint2{margin} ) - margin) / _settings.pageSize, last );
+			const uint2		stop	= Min( (end + margin) / _settings.pageSize, last );
+
+			for (uint y = begin.y; y <= stop.y; ++y)
+			for (uint x = begin.x; x <= stop.x; ++x)
+			{
+				const uint	slot = _pageSlot[ _PageIndex( uint(face), mip, uint2{x, y} )];
+
+				if ( slot == UMax )
+					continue;
+
+				const Page	page	= _GetPage( slot );
+				const bool	found	= std::any_of( _pending.begin(), _pending.end(), [&page] (const Page &p) { return All( p.dstOffset == page.dstOffset ); });
+
+				if ( not found )
+					_pending.push_back( page );
+			}
+		}
+	}
+
+/*
+=================================================
+	Upload
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::Upload (const CommandBuffer &cmdbuf)
+	{
+		// pages must be generated in the same command buffer
+		_pending.clear();
+
+		if ( not _pageTableImage )
+			return;
+
+		for (uint face = 0; face < 6; ++face)
+		{
+			for (uint mip = 0; mip <= _maxMip; ++mip)
+			{
+				if ( not (_dirtyMips[face] & (1u << mip)) )
+					continue;
+
+				const uint		count	= _PagesPerSide( mip );
+				const uint *	data	= _pageTable.data() + _PageIndex( face, mip, uint2{0} );
+
+				cmdbuf->AddTask( UpdateImage{}.SetImage( _pageTableImage, int2{}, ImageLayer{face}, MipmapLevel{mip} )
+											  .SetData( data, SizeOf<uint> * count * count, uint2{count}, SizeOf<uint> * count ));
+			}
+			_dirtyMips[face] = 0;
+		}
+	}
+
+/*
+=================================================
+	GetShaderParams
+=================================================
+*/
+	float4  SphericalCubeVirtualTexture::GetShaderParams () const
+	{
+		return float4{ float(_settings.faceSize), float(_settings.pageSize), float(_SlotSize()), float(AtlasDimension().x) };
+	}
+
+/*
+=================================================
+	ChunkMipmap
+----
+	chunk covers 'size * 0.5 * faceSize' texels on mipmap 0
+=================================================
+*/
+	uint  SphericalCubeVirtualTexture::ChunkMipmap (const Chunk &chunk) const
+	{
+		const float	texels	= chunk.size * 0.5f * float(_settings.faceSize);
+		const float	mip		= std::log2( Max( texels / _settings.chunkTexels, 1.0f ));
+
+		return Min( uint(mip + 0.5f), _maxMip );
+	}
+
+/*
+=================================================
+	VertexLod
+----
+	one texel per tessellated segment of grid quad
+=================================================
+*/
+	float  SphericalCubeVirtualTexture::VertexLod (const Chunk &chunk, float tessLevel, bool onCoarserEdge) const
+	{
+		const float	quad_size	= chunk.size / float(SphericalCubeQuadTree::GridSize);
+		const float	lod			= std::log2( quad_size * 0.5f * float(_settings.faceSize) / tessLevel );
+
+		return onCoarserEdge ? lod + 1.0f : lod;
+	}
+
+/*
+=================================================
+	ResidentMipmap
+=================================================
+*/
+	uint  SphericalCubeVirtualTexture::ResidentMipmap (ECubeFace face, uint mip, const uint2 &coord) const
+	{
+		ASSERT( mip <= _maxMip and coord.x < _PagesPerSide( mip ) and coord.y < _PagesPerSide( mip ));
+
+		const uint	entry = _pageTable[ _PageIndex( uint(face), mip, coord )];
+
+		return entry != InvalidEntry ? (entry >> 24) : UMax;
+	}
+
+/*
+=================================================
+	AtlasCoord
+----
+	must be same as 'VT_AtlasCoord' in 'VirtualTexture.glsl'
+=================================================
+*/
+	float2  SphericalCubeVirtualTexture::AtlasCoord (ECubeFace face, const float2 &ncoord, uint mip) const
+	{
+		mip = Min( mip, _maxMip );
+
+		const float		page_size	= float(_settings.pageSize);
+		const float		border		= float(_settings.pageBorder);
+		const float2	uv			= Clamp( (ncoord + 1.0f) * 0.5f, float2(0.0f), float2(1.0f) );
+
+		// requested page
+		const float		dim		= float(_settings.faceSize >> mip);
+		const uint2		page	= Min( uint2(uv * (dim - 1.0f) / page_size), uint2{ _PagesPerSide( mip ) - 1 });
+		const uint		entry	= _pageTable[ _PageIndex( uint(face), mip, page )];
+		ASSERT( entry != InvalidEntry );
+
+		// resident page
+		const uint		rmip	= entry >> 24;
+		const float		rdim	= float(_settings.faceSize >> rmip);
+		const float2	slot	= float2{ float(entry & 0xFFFu), float((entry >> 12) & 0xFFFu) };
+		const float2	rpage	= float2( uint2{ page.x >> (rmip - mip), page.y >> (rmip - mip) });
+		const float2	texel	= Clamp( uv * (rdim - 1.0f) - rpage * page_size, float2(-border), float2(page_size + border - 1.0f) );
+
+		return (slot * float(_SlotSize()) + border + texel + 0.5f) / float(AtlasDimension().x);
+	}
+
+/*
+=================================================
+	_PageIndex
+=================================================
+*/
+	uint  SphericalCubeVirtualTexture::_PageIndex (uint face, uint mip, const uint2 &coord) const
+	{
+		const uint	count = _PagesPerSide( mip );
+		return _mipOffset[mip] + (face * count + coord.y) * count + coord.x;
+	}
+
+/*
+=================================================
+	_DecodePage
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::_DecodePage (uint page, OUT uint &face, OUT uint &mip, OUT uint2 &coord) const
+	{
+		for (mip = _maxMip; _mipOffset[mip] > page; --mip) {}
+
+		const uint	count	= _PagesPerSide( mip );
+		const uint	local	= page - _mipOffset[mip];
+
+		face	= local / (count * count);
+		coord	= uint2{ local % count, (local / count) % count };
+	}
+
+/*
+=================================================
+	_PackEntry
+=================================================
+*/
+	uint  SphericalCubeVirtualTexture::_PackEntry (uint slot, uint mip) const
+	{
+		STATIC_ASSERT( MaxCacheSize <= (1u << 12) );
+		return (slot % _settings.cacheSize) | ((slot / _settings.cacheSize) << 12) | (mip << 24);
+	}
+
+/*
+=================================================
+	_AllocSlot
+----
+	returns free or least recently used slot,
+	slot can't be reused if page is used in current frame
+=================================================
+*/
+	uint  SphericalCubeVirtualTexture::_AllocSlot ()
+	{
+		const uint	index = _lruFirst;
+		if ( index == UMax )
+			return UMax;
+
+		auto&	slot = _slots[index];
+
+		if ( slot.page != UMax )
+		{
+			if ( slot.lastFrame == _frame )
+				return UMax;
+
+			_pageSlot[slot.page] = UMax;
+			_UpdateEntries( slot.face, slot.mip, slot.coord );
+			slot.page = UMax;
+		}
+
+		_Touch( index );
+		return index;
+	}
+
+/*
+=================================================
+	_MakeResident
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::_MakeResident (uint index, uint face, uint mip, const uint2 &coord)
+	{
+		auto&	slot = _slots[index];
+		slot.page		= _PageIndex( face, mip, coord );
+		slot.face		= face;
+		slot.mip		= mip;
+		slot.coord		= coord;
+		slot.lastFrame	= _frame;
+
+		_pageSlot[slot.page] = index;
+		_UpdateEntries( face, mip, coord );
+
+		_pending.push_back( _GetPage( index ));
+	}
+
+/*
+=================================================
+	_GetPage
+=================================================
+*/
+	SphericalCubeVirtualTexture::Page  SphericalCubeVirtualTexture::_GetPage (uint index) const
+	{
+		auto&	slot = _slots[index];
+		Page	page;
+		page.srcOffset	= int2(slot.coord * _settings.pageSize) - int(_settings.pageBorder);
+		page.dstOffset	= uint2{ index % _settings.cacheSize, index / _settings.cacheSize } * _SlotSize();
+		page.dimension	= _SlotSize();
+		page.faceSize	= _settings.faceSize >> slot.mip;
+		page.face		= slot.face;
+		page.mip		= slot.mip;
+		return page;
+	}
+
+/*
+=================================================
+	_UpdateEntries
+----
+	updates entries of the page and all finer pages that it covers,
+	entry of non-resident page is copied from coarser mipmap
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::_UpdateEntries (uint face, uint mip, const uint2 &coord)
+	{
+		for (uint k = mip+1; k-- > 0;)
+		{
+			const uint	shift	= mip - k;
+			const uint2	begin	{ coord.x << shift, coord.y << shift };
+			const uint2	end		{ (coord.x + 1) << shift, (coord.y + 1) << shift };
+
+			for (uint y = begin.y; y < end.y; ++y)
+			for (uint x = begin.x; x < end.x; ++x)
+			{
+				const uint	page	= _PageIndex( face, k, uint2{x, y} );
+				const uint	slot	= _pageSlot[page];
+
+				_pageTable[page] = (slot != UMax ? _PackEntry( slot, k ) :
+									k < _maxMip  ? _pageTable[ _PageIndex( face, k+1, uint2{x >> 1, y >> 1} )] :
+												   InvalidEntry);
+			}
+			_dirtyMips[face] |= (1u << k);
+		}
+	}
+
+/*
+=================================================
+	_Touch
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::_Touch (uint index)
+	{
+		auto&	slot = _slots[index];
+		slot.lastFrame = _frame;
+
+		if ( slot.pinned or index == _lruLast )
+			return;
+
+		_Unlink( index );
+		_PushBack( index );
+	}
+
+/*
+=================================================
+	_Unlink
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::_Unlink (uint index)
+	{
+		auto&	slot = _slots[index];
+
+		if ( slot.prev != UMax )	_slots[slot.prev].next = slot.next;
+		else						_lruFirst = slot.next;
+
+		if ( slot.next != UMax )	_slots[slot.next].prev = slot.prev;
+		else						_lruLast = slot.prev;
+
+		slot.prev = slot.next = UMax;
+	}
+
+/*
+=================================================
+	_PushBack
+=================================================
+*/
+	void  SphericalCubeVirtualTexture::_PushBack (uint index)
+	{
+		auto&	slot = _slots[index];
+		slot.prev = _lruLast;
+		slot.next = UMax;
+
+		if ( _lruLast != UMax )		_slots[_lruLast].next = index;
+		else						_lruFirst = index;
+
+		_lruLast = index;
+	}
+
+
+}	// FG
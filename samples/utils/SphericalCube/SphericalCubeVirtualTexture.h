@@ -0,0 +1,144 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "SphericalCubeQuadTree.h"
+
+namespace FG
+{
+
+	//
+	// Spherical Cube Virtual Texture
+	//
+
+	class SphericalCubeVirtualTexture final
+	{
+	// types
+	public:
+		using Chunk = SphericalCubeQuadTree::Chunk;
+
+		struct Settings
+		{
+			uint		faceSize			= 1u << 14;	// virtual face size on mipmap 0, must be 'pageSize * 2^N'
+			uint		pageSize			= 128;		// in texels, without border
+			uint		pageBorder			= 1;		// for filtering and normal calculation
+			uint		cacheSize			= 24;		// number of pages per atlas side
+			uint		maxPagesPerFrame	= 16;
+			float		chunkTexels			= 192.0f;	// required number of texels per chunk side
+		};
+
+		// page that must be generated in this frame, coordinates are in texels
+		struct Page
+		{
+			int2		srcOffset;			// first texel on face mipmap, including border
+			uint2		dstOffset;			// first texel in atlas
+			uint		dimension	= 0;	// page size including border
+			uint		faceSize	= 0;	// face size on page mipmap
+			uint		face		= 0;
+			uint		mip			= 0;
+		};
+
+		// page table entry: slot.x | (slot.y << 12) | (mip << 24), see 'VirtualTexture.glsl'
+		static constexpr uint	InvalidEntry	= UMax;
+		static constexpr uint	MaxCacheSize	= 1u << 12;
+
+	private:
+		struct Slot
+		{
+			uint		page		= UMax;		// index in '_pageSlot'
+			uint		face		= 0;
+			uint		mip			= 0;
+			uint2		coord;
+			uint		prev		= UMax;		// LRU list, pinned slots are not in the list
+			uint		next		= UMax;
+			uint		lastFrame	= 0;
+			bool		pinned		= false;
+		};
+
+
+	// variables
+	private:
+		ImageID					_pageTableImage;	// R32U, layer per face
+
+		Settings				_settings;
+		uint					_maxMip		= 0;
+		uint					_frame		= 0;
+
+		Array<uint>				_pageTable;			// [mip][face][y][x], finest resident page that covers this page
+		Array<uint>				_pageSlot;			// same layout, slot of resident page or 'UMax'
+		Array<uint>				_mipOffset;			// first page of mipmap
+		StaticArray< uint, 6 >	_dirtyMips	= {};	// bit mask of modified mipmaps for each face
+
+		Array<Slot>				_slots;				// [x + y * cacheSize]
+		uint					_lruFirst	= UMax;	// least recently used
+		uint					_lruLast	= UMax;
+
+		Array<Page>				_pending;
+		Array<uint>				_requests;			// temporary
+
+
+	// methods
+	public:
+		SphericalCubeVirtualTexture () {}
+		~SphericalCubeVirtualTexture ();
+
+		bool Create (const FrameGraph &fg, const Settings &settings);
+		void Destroy (const FrameGraph &fg);
+
+		// removes all pages from cache, coarsest mipmap is added to pending list, CPU side only
+		void Reset (const Settings &settings);
+
+		// requests pages for visible chunks, missing pages are added to pending list
+		void Update (ArrayView<Chunk> chunks);
+
+		// adds resident pages that intersect region to pending list, pages keep their slots,
+		// region is in texels on mipmap 0
+		void Invalidate (ECubeFace face, const uint2 &offset, const uint2 &dimension);
+
+		// uploads modified part of page table and clears pending list
+		void Upload (const CommandBuffer &cmdbuf);
+
+		ND_ ArrayView<Page>	GetPendingPages ()	const	{ return _pending; }
+		ND_ RawImageID		GetPageTable ()		const	{ return _pageTableImage; }
+		ND_ uint2			AtlasDimension ()	const	{ return uint2{ _settings.cacheSize * _SlotSize() }; }
+		ND_ uint			MaxMipmap ()		const	{ return _maxMip; }
+		ND_ Settings const&	GetSettings ()		const	{ return _settings; }
+
+		// x - face size, y - page size, z - page size with border, w - atlas size
+		ND_ float4  GetShaderParams () const;
+
+		// returns mipmap that is required to draw chunk
+		ND_ uint  ChunkMipmap (const Chunk &chunk) const;
+
+		// returns lod of tessellated vertex, same as 'VertexLod' in 'planet.glsl',
+		// vertex on edge that is shared with coarser chunk uses lod of coarser chunk
+		ND_ float  VertexLod (const Chunk &chunk, float tessLevel, bool onCoarserEdge) const;
+
+		// returns mipmap of finest resident page that covers the page, or 'UMax'
+		ND_ uint  ResidentMipmap (ECubeFace face, uint mip, const uint2 &coord) const;
+
+		// returns normalized coordinate in atlas, same as 'VT_AtlasCoord' in shader, used for tests
+		ND_ float2  AtlasCoord (ECubeFace face, const float2 &ncoord, uint mip) const;
+
+		// returns page of the coarsest mipmap, it is always resident
+		ND_ Page  GetPinnedPage (ECubeFace face) const	{ return _GetPage( uint(face) ); }
+
+	private:
+		ND_ uint  _SlotSize ()				const	{ return _settings.pageSize + _settings.pageBorder * 2; }
+		ND_ uint  _PagesPerSide (uint mip)	const	{ return (_settings.faceSize / _settings.pageSize) >> mip; }
+		ND_ uint  _PageIndex (uint face, uint mip, const uint2 &coord) const;
+		void  _DecodePage (uint page, OUT uint &face, OUT uint &mip, OUT uint2 &coord) const;
+		ND_ uint  _PackEntry (uint slot, uint mip) const;
+		ND_ Page  _GetPage (uint slot) const;
+
+		ND_ uint  _AllocSlot ();
+		void  _MakeResident (uint slot, uint face, uint mip, const uint2 &coord);
+		void  _UpdateEntries (uint face, uint mip, const uint2 &coord);
+
+		void  _Touch (uint slot);
+		void  _Unlink (uint slot);
+		void  _PushBack (uint slot);
+	};
+
+
+}	// FG
@@ -0,0 +1,230 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "PatchCulling.h"
+#include "SphericalCube.h"
+#include "stl/Algorithms/StringUtils.h"
+#include <chrono>
+#include <random>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Clock		= std::chrono::high_resolution_clock;
+	using Params	= PatchCulling::Params;
+	using Bounds	= PatchCulling::Bounds;
+
+
+	// symmetric perspective frustum, 'tanHalfFov' - for both directions
+	ND_ PatchCulling::Frustum_t  MakeFrustum (const float3 &pos, const float3 &forward, const float3 &up, float tanHalfFov, float nearPlane, float farPlane)
+	{
+		const float3	right	= Normalize( Cross( forward, up ));
+		const float3	top		= Cross( right, forward );
+
+		const auto		plane	= [&pos] (const float3 &n) { return float4{ n.x, n.y, n.z, -Dot( n, pos )}; };
+
+		PatchCulling::Frustum_t		planes;
+		planes[0] = plane( forward + right * tanHalfFov );		// left
+		planes[1] = plane( forward - right * tanHalfFov );		// right
+		planes[2] = plane( forward + top * tanHalfFov );		// bottom
+		planes[3] = plane( forward - top * tanHalfFov );		// top
+		planes[4] = plane( forward ) + float4{ 0.0f, 0.0f, 0.0f, -nearPlane };
+		planes[5] = plane( -forward ) + float4{ 0.0f, 0.0f, 0.0f, farPlane };
+
+		return PatchCulling::NormalizePlanes( planes );
+	}
+
+
+	void GenRandomBounds (size_t count, std::mt19937 &gen, OUT Bounds &bounds)
+	{
+		std::uniform_real_distribution<float>	coord	{ -2.0f, 2.0f };
+		std::uniform_real_distribution<float>	rad		{ 0.001f, 0.3f };
+		std::uniform_real_distribution<float>	cutoff	{ 0.0f, 1.2f };
+
+		bounds.Resize( count );
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float3	center { coord(gen), coord(gen), coord(gen) };
+			const float3	axis   = Normalize( float3{ coord(gen), coord(gen), coord(gen) } + float3{0.001f} );
+
+			bounds.Set( i, center, rad(gen), axis, Min( cutoff(gen), 1.0f ));
+		}
+	}
+
+
+	void Test_Frustum ()
+	{
+		Params	params;
+		params.frustum			= MakeFrustum( float3{0.0f}, float3{0.0f, 0.0f, 1.0f}, float3{0.0f, 1.0f, 0.0f}, 1.0f, 0.1f, 10.0f );
+		params.frustumCulling	= true;
+
+		Bounds	bounds;
+		bounds.Resize( 6 );
+		bounds.Set( 0, float3{ 0.0f, 0.0f,  5.0f }, 0.1f );		// inside
+		bounds.Set( 1, float3{ 0.0f, 0.0f, -5.0f }, 0.1f );		// behind
+		bounds.Set( 2, float3{ 6.0f, 0.0f,  5.0f }, 0.1f );		// right
+		bounds.Set( 3, float3{ 6.0f, 0.0f,  5.0f }, 2.0f );		// intersects right plane
+		bounds.Set( 4, float3{ 0.0f, 0.0f, 12.0f }, 1.0f );		// far
+		bounds.Set( 5, float3{ 0.0f, 0.0f, 11.0f }, 1.5f );		// intersects far plane
+
+		Array<uint>	visible;
+		PatchCulling::Cull( bounds, params, OUT visible );
+
+		TEST(( visible == Array<uint>{ 0, 3, 5 } ));
+	}
+
+
+	void Test_Horizon ()
+	{
+		Params	params;
+		params.camera			= float3{ 0.0f, 0.0f, 2.0f };
+		params.occluderRadius	= 1.0f;
+		params.horizonCulling	= true;
+
+		Bounds	bounds;
+		bounds.Resize( 5 );
+		bounds.Set( 0, float3{ 0.0f, 0.0f,  1.0f }, 0.1f );		// front
+		bounds.Set( 1, float3{ 0.0f, 0.0f, -1.0f }, 0.1f );		// back
+		bounds.Set( 2, float3{ 0.0f, 0.0f, -1.0f }, 2.0f );		// back, but bounding sphere is outside of the shadow cone
+		bounds.Set( 3, float3{ 1.0f, 0.0f,  0.0f }, 0.2f );		// behind the horizon, but bounding sphere intersects the shadow cone
+		bounds.Set( 4, float3{ 0.0f, 0.0f, -3.0f }, 0.1f );		// far behind
+
+		Array<uint>	visible;
+		PatchCulling::Cull( bounds, params, OUT visible );
+
+		TEST(( visible == Array<uint>{ 0, 2, 3 } ));
+
+		// camera inside occluder, culling is disabled
+		params.camera = float3{ 0.0f, 0.0f, 0.5f };
+		PatchCulling::Cull( bounds, params, OUT visible );
+
+		TEST( visible.size() == bounds.size() );
+	}
+
+
+	void Test_Backface ()
+	{
+		SphericalCube::Meshlets		meshlets;
+		SphericalCube::BuildMeshlets( 31, OUT meshlets );
+
+		Bounds	bounds;
+		bounds.Resize( meshlets.meshlets.size() );
+
+		for (size_t i = 0; i < meshlets.meshlets.size(); ++i)
+		{
+			auto&	m = meshlets.meshlets[i];
+			bounds.Set( i, m.center, m.radius, m.coneAxis, m.coneCutoff );
+		}
+
+		Params	params;
+		params.camera			= float3{ 0.0f, 0.0f, 3.0f };
+		params.backfaceCulling	= true;
+
+		Array<uint>	visible;
+		PatchCulling::Cull( bounds, params, OUT visible );
+
+		// about half of the sphere is backfacing, meshlets which are facing the camera must be visible
+		TEST( visible.size() > bounds.size() / 4 and visible.size() < bounds.size() * 3 / 4 );
+
+		for (size_t i = 0, j = 0; i < bounds.size(); ++i)
+		{
+			const bool	is_visible	= (j < visible.size() and visible[j] == i);
+			auto&		m			= meshlets.meshlets[i];
+
+			if ( Dot( Normalize( m.center ), Normalize( params.camera - m.center )) > 0.1f )
+				TEST( is_visible );
+
+			j += uint(is_visible);
+		}
+	}
+
+
+	void Test_CompareWithScalar ()
+	{
+		std::mt19937	gen{ 1234 };
+		Bounds			bounds;
+		Array<uint>		visible;
+		Array<uint>		ref;
+
+		for (size_t count : {0u, 1u, 7u, 64u, 1001u})
+		{
+			GenRandomBounds( count, gen, OUT bounds );
+
+			for (uint flags = 0; flags < 8; ++flags)
+			{
+				Params	params;
+				params.frustum			= MakeFrustum( float3{0.0f, 0.5f, 2.5f}, Normalize(float3{0.1f, -0.2f, -1.0f}), float3{0.0f, 1.0f, 0.0f}, 0.8f, 0.1f, 4.0f );
+				params.camera			= float3{ 0.0f, 0.5f, 2.5f };
+				params.occluderRadius	= 0.9f;
+				params.frustumCulling	= (flags & 1) != 0;
+				params.horizonCulling	= (flags & 2) != 0;
+				params.backfaceCulling	= (flags & 4) != 0;
+
+				PatchCulling::Cull( bounds, params, OUT visible );
+
+				ref.clear();
+				for (size_t i = 0; i < count; ++i) {
+					if ( PatchCulling::IsVisible( bounds, i, params ))
+						ref.push_back( uint(i) );
+				}
+
+				TEST( visible == ref );
+			}
+		}
+	}
+}
+
+extern void UnitTest_PatchCulling ()
+{
+	Test_Frustum();
+	Test_Horizon();
+	Test_Backface();
+	Test_CompareWithScalar();
+
+	FG_LOGI( "UnitTest_PatchCulling" );
+}
+
+
+extern void PerfTest_PatchCulling ()
+{
+	std::mt19937	gen{ 1234 };
+	Bounds			bounds;
+	Array<uint>		visible;
+	Nanoseconds		ref_time	{0};
+	Nanoseconds		simd_time	{0};
+	size_t			ref_count	= 0;
+
+	GenRandomBounds( 1u << 16, gen, OUT bounds );
+
+	Params	params;
+	params.frustum			= MakeFrustum( float3{0.0f, 0.5f, 2.5f}, Normalize(float3{0.1f, -0.2f, -1.0f}), float3{0.0f, 1.0f, 0.0f}, 0.8f, 0.1f, 4.0f );
+	params.camera			= float3{ 0.0f, 0.5f, 2.5f };
+	params.occluderRadius	= 0.9f;
+	params.frustumCulling	= true;
+	params.horizonCulling	= true;
+	params.backfaceCulling	= true;
+
+	for (uint i = 0; i < 100; ++i)
+	{
+		auto	t0 = Clock::now();
+
+		for (size_t j = 0; j < bounds.size(); ++j) {
+			ref_count += size_t(PatchCulling::IsVisible( bounds, j, params ));
+		}
+
+		auto	t1 = Clock::now();
+		PatchCulling::Cull( bounds, params, OUT visible );
+		auto	t2 = Clock::now();
+
+		ref_time  += std::chrono::duration_cast<Nanoseconds>( t1 - t0 );
+		simd_time += std::chrono::duration_cast<Nanoseconds>( t2 - t1 );
+	}
+
+	CHECK( ref_count == visible.size() * 100 );
+
+	FG_LOGI( "PerfTest_PatchCulling: 100 x "s << ToString( bounds.size() ) << " patches, visible: " << ToString( visible.size() )
+			 << ", scalar: " << ToString( ref_time ) << ", batch: " << ToString( simd_time ));
+}
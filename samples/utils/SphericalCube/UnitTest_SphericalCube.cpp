@@ -0,0 +1,456 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SphericalCube.h"
+#include "stl/Algorithms/StringUtils.h"
+#include <chrono>
+#include <algorithm>
+#include <random>
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Vertex		= SphericalCube::Vertex;
+	using TangentVertex	= SphericalCube::TangentVertex;
+	using Clock		= std::chrono::high_resolution_clock;
+
+	// serial double precision reference, same as the original generator
+	void GenerateVerticesRef (uint lod, OUT Vertex *vertices, OUT TangentVertex *tangents = null)
+	{
+		const uint	vcount	= lod + 2;
+		uint		vert_i	= 0;
+
+		for (uint face = 0; face < 6; ++face)
+		for (uint y = 0; y < vcount; ++y)
+		for (uint x = 0; x < vcount; ++x)
+		{
+			const double2	ncoord = double2{ double(x)/(vcount-1), double(y)/(vcount-1) } * 2.0 - 1.0;
+
+			if ( tangents )
+			{
+				auto[tan, bitan] = SphericalCube::ForwardTangents( ncoord, ECubeFace(face) );
+				tangents[vert_i] = TangentVertex{ float3(tan), float3(bitan) };
+			}
+
+			vertices[vert_i++] = Vertex{ float3(SphericalCube::ForwardProjection( ncoord, ECubeFace(face) )),
+										 float3(SphericalCube::ForwardTexProjection( ncoord, ECubeFace(face) ))};
+		}
+	}
+
+
+	void Test_GenerateVertices ()
+	{
+		static constexpr float	err = 1.0e-5f;
+
+		// tangents are in separate stream, default vertex size must not grow
+		TEST( SphericalCube::GetVertexStride( SphericalCube::EVertexLayout::Default ) == 32_b );
+		TEST( SphericalCube::GetVertexStride( SphericalCube::EVertexLayout::Tangents ) == 32_b );
+
+		for (uint lod : {0u, 1u, 9u, 31u})
+		{
+			const uint				count = SphericalCube::CalcVertCount( lod );
+			Array<Vertex>			ref;		ref.resize( count );
+			Array<Vertex>			vert;		vert.resize( count );
+			Array<TangentVertex>	ref_tan;	ref_tan.resize( count );
+			Array<TangentVertex>	vert_tan;	vert_tan.resize( count );
+
+			GenerateVerticesRef( lod, OUT ref.data(), OUT ref_tan.data() );
+			SphericalCube::GenerateVertices( lod, OUT vert.data(), OUT vert_tan.data() );
+
+			for (uint i = 0; i < count; ++i)
+			{
+				TEST( Distance( ref[i].position, vert[i].position ) < err );
+				TEST( Distance( ref[i].texcoord, vert[i].texcoord ) < err );
+				TEST( Distance( ref_tan[i].tangent, vert_tan[i].tangent ) < err );
+				TEST( Distance( ref_tan[i].bitangent, vert_tan[i].bitangent ) < err );
+			}
+		}
+	}
+
+
+	template <typename Projection>
+	void Test_ForwardTangents ()
+	{
+		using Proj = SphericalCubeProjection< Projection, TextureProjection >;
+
+		static constexpr double	h	= 1.0e-6;
+		static constexpr double	err	= 1.0e-6;
+
+		for (uint face = 0; face < 6; ++face)
+		for (uint y = 0; y <= 8; ++y)
+		for (uint x = 0; x <= 8; ++x)
+		{
+			const double2	ncoord	= double2{ double(x), double(y) } / 8.0 * 1.9 - 0.95;
+			auto[tx, ty]			= Proj::ForwardTangents( ncoord, ECubeFace(face) );
+
+			// central differences
+			const double3	ref_tx	= (Proj::ForwardProjection( ncoord + double2{h, 0.0}, ECubeFace(face) ) -
+									   Proj::ForwardProjection( ncoord - double2{h, 0.0}, ECubeFace(face) )) / (2.0 * h);
+			const double3	ref_ty	= (Proj::ForwardProjection( ncoord + double2{0.0, h}, ECubeFace(face) ) -
+									   Proj::ForwardProjection( ncoord - double2{0.0, h}, ECubeFace(face) )) / (2.0 * h);
+
+			TEST( Distance( tx, ref_tx ) < err );
+			TEST( Distance( ty, ref_ty ) < err );
+		}
+	}
+
+
+	void Test_GenerateIndices ()
+	{
+		for (bool quads : {false, true})
+		for (uint lod : {0u, 2u, 9u})
+		{
+			Array<uint>		indices;	indices.resize( SphericalCube::CalcIndexCount( lod, quads ));
+
+			SphericalCube::GenerateIndices( lod, quads, OUT indices.data() );
+
+			for (uint idx : indices) {
+				TEST( idx < SphericalCube::CalcVertCount( lod ));
+			}
+		}
+	}
+
+
+	void Test_LodOffsets ()
+	{
+		for (bool quads : {false, true})
+		for (uint min_lod = 0; min_lod < SphericalCube::MaxLods; ++min_lod)
+		{
+			uint	vert_offset		= 0;
+			uint	packed_offset	= 0;
+			uint	index_offset	= 0;
+
+			for (uint lod = min_lod; lod <= SphericalCube::MaxLods; ++lod)
+			{
+				TEST( SphericalCube::CalcVertOffset( min_lod, lod ) == vert_offset );
+				TEST( SphericalCube::CalcPackedVertOffset( min_lod, lod ) == packed_offset );
+				TEST( SphericalCube::CalcIndexOffset( min_lod, lod, quads ) == index_offset );
+
+				vert_offset		+= SphericalCube::CalcVertCount( lod );
+				packed_offset	+= SphericalCube::CalcPackedVertCount( lod );
+				index_offset	+= SphericalCube::CalcIndexCount( lod, quads );
+			}
+		}
+	}
+
+
+	void Test_GeneratePacked ()
+	{
+		static constexpr float	err = 1.0e-4f;
+
+		for (uint lod : {0u, 1u, 9u, 31u})
+		{
+			Array<Vertex>						ref;		ref.resize( SphericalCube::CalcVertCount( lod ));
+			Array<uint>							ref_idx;	ref_idx.resize( SphericalCube::CalcIndexCount( lod, true ));
+			Array<SphericalCube::PackedVertex>	packed;		packed.resize( SphericalCube::CalcPackedVertCount( lod ));
+			Array<uint>							indices;	indices.resize( ref_idx.size() );
+
+			SphericalCube::GenerateVertices( lod, OUT ref.data() );
+			SphericalCube::GenerateIndices( lod, true, OUT ref_idx.data() );
+			SphericalCube::GeneratePacked( lod, true, OUT packed.data(), OUT indices.data() );
+
+			// each remapped vertex must be equal to the source vertex, this also means that shared vertices are equal on all faces
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				TEST( indices[i] < packed.size() );
+
+				const Vertex&	src		= ref[ ref_idx[i] ];
+				const float3	pos		= SphericalCube::UnpackOctahedral( packed[ indices[i] ].position );
+				const float3	texc	= SphericalCube::UnpackOctahedral( packed[ indices[i] ].texcoord ) * 0.5f;
+
+				TEST( Distance( src.position, pos ) < err );
+				TEST( Distance( src.texcoord, texc ) < err );
+			}
+		}
+	}
+
+
+	void Test_Indices16 ()
+	{
+		using EVertexLayout = SphericalCube::EVertexLayout;
+
+		TEST( SphericalCube::GetIndexType( 9, EVertexLayout::Default ) == EIndex::UShort );
+		TEST( SphericalCube::GetIndexType( 102, EVertexLayout::Default ) == EIndex::UShort );
+		TEST( SphericalCube::GetIndexType( 103, EVertexLayout::Default ) == EIndex::UInt );
+		TEST( SphericalCube::GetIndexType( 103, EVertexLayout::Packed ) == EIndex::UShort );
+		TEST( SphericalCube::GetIndexType( 104, EVertexLayout::Packed ) == EIndex::UInt );
+
+		for (bool quads : {false, true})
+		for (uint lod : {0u, 9u, 102u})
+		{
+			const uint		count = SphericalCube::CalcIndexCount( lod, quads );
+			Array<uint>		ref;	ref.resize( count );
+			Array<uint16_t>	ind;	ind.resize( count );
+
+			SphericalCube::GenerateIndices( lod, quads, OUT ref.data() );
+			SphericalCube::GenerateIndices( lod, quads, OUT ind.data() );
+
+			for (uint i = 0; i < count; ++i) {
+				TEST( ref[i] == ind[i] );
+			}
+
+			Array<SphericalCube::PackedVertex>	packed;	packed.resize( SphericalCube::CalcPackedVertCount( lod ));
+
+			SphericalCube::GeneratePacked( lod, quads, OUT packed.data(), OUT ref.data() );
+			SphericalCube::GeneratePacked( lod, quads, OUT packed.data(), OUT ind.data() );
+			
+			for (uint i = 0; i < count; ++i) {
+				TEST( ref[i] == ind[i] );
+			}
+		}
+	}
+
+
+	void Test_Meshlets ()
+	{
+		using Triangle = StaticArray< uint, 3 >;
+		
+		static constexpr float	err = 1.0e-5f;
+
+		for (uint lod : {0u, 1u, 9u, 31u})
+		{
+			SphericalCube::Meshlets	meshlets;
+			Array<Vertex>			verts;		verts.resize( SphericalCube::CalcVertCount( lod ));
+			Array<uint>				indices;	indices.resize( SphericalCube::CalcIndexCount( lod, false ));
+			Array<Triangle>			ref_tris;
+			Array<Triangle>			tris;
+
+			SphericalCube::GenerateVertices( lod, OUT verts.data() );
+			SphericalCube::GenerateIndices( lod, false, OUT indices.data() );
+			SphericalCube::BuildMeshlets( lod, OUT meshlets );
+
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				ref_tris.push_back({ indices[i], indices[i+1], indices[i+2] });
+			}
+
+			for (auto& m : meshlets.meshlets)
+			{
+				TEST( m.vertexCount <= SphericalCube::MeshletMaxVertices );
+				TEST( m.triangleCount <= SphericalCube::MeshletMaxTriangles );
+
+				const float	min_dot = Sqrt( 1.0f - Square( m.coneCutoff ));
+
+				for (uint i = 0; i < m.triangleCount; ++i)
+				{
+					Triangle	tri;
+					for (uint j = 0; j < 3; ++j)
+					{
+						const uint	local = meshlets.triangles[ m.triangleOffset + i*3 + j ];
+						TEST( local < m.vertexCount );
+
+						tri[j] = meshlets.vertices[ m.vertexOffset + local ];
+						TEST( Distance( verts[tri[j]].position, m.center ) <= m.radius + err );
+					}
+					tris.push_back( tri );
+
+					// all triangle normals must be inside cone
+					const float3	p0	= verts[tri[0]].position;
+					float3			n	= Normalize( Cross( verts[tri[1]].position - p0, verts[tri[2]].position - p0 ));
+					n = Dot( n, p0 ) < 0.0f ? -n : n;
+
+					TEST( Dot( n, m.coneAxis ) >= min_dot - err );
+				}
+			}
+
+			// each triangle must be used once
+			std::sort( ref_tris.begin(), ref_tris.end() );
+			std::sort( tris.begin(), tris.end() );
+			TEST( ref_tris == tris );
+		}
+	}
+
+
+	void GenRandomSegments (size_t count, std::mt19937 &gen, OUT SphericalCube::RaySegments &segments)
+	{
+		std::uniform_real_distribution<float>	coord{ -3.0f, 3.0f };
+
+		segments.Resize( count );
+
+		for (size_t i = 0; i < count; ++i) {
+			segments.Set( i, float3{ coord(gen), coord(gen), coord(gen) }, float3{ coord(gen), coord(gen), coord(gen) });
+		}
+	}
+
+
+	void Test_RayCast ()
+	{
+		static constexpr float	err = 1.0e-4f;
+
+		const SphericalCube		cube;
+		const float3			center	{ 0.1f, -0.2f, 0.3f };
+		const float				radius	= 1.5f;
+		float3					point;
+
+		// tangent segment, single root is outside of segment
+		TEST( not cube.RayCast( float3{0.0f}, 1.0f, float3{1.0f, 1.0f, 0.0f}, float3{2.0f, 1.0f, 0.0f}, OUT point ));
+		TEST( cube.RayCast( float3{0.0f}, 1.0f, float3{-1.0f, 1.0f, 0.0f}, float3{1.0f, 1.0f, 0.0f}, OUT point ));
+		TEST( Distance( point, float3{0.0f, 1.0f, 0.0f} ) < err );
+
+		// nearest intersection
+		TEST( cube.RayCast( float3{0.0f}, 1.0f, float3{0.0f, 0.0f, 3.0f}, float3{0.0f, 0.0f, -3.0f}, OUT point ));
+		TEST( Distance( point, float3{0.0f, 0.0f, 1.0f} ) < err );
+
+		// begin is inside of sphere
+		TEST( cube.RayCast( float3{0.0f}, 1.0f, float3{0.0f}, float3{0.0f, 0.0f, -3.0f}, OUT point ));
+		TEST( Distance( point, float3{0.0f, 0.0f, -1.0f} ) < err );
+
+		// batch version must be same as scalar version
+		std::mt19937				gen{ 1234 };
+		SphericalCube::RaySegments	segments;
+		SphericalCube::RayHits		hits;
+
+		for (size_t count : {0u, 3u, 4u, 33u, 1001u})
+		{
+			GenRandomSegments( count, gen, OUT segments );
+			SphericalCube::RayCast( center, radius, segments, OUT hits );
+
+			TEST( hits.mask.size() == (count + 31) / 32 );
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				const bool	hit = cube.RayCast( center, radius, segments.Begin( i ), segments.End( i ), OUT point );
+
+				TEST( hit == hits.IsHit( i ));
+				if ( hit ) {
+					TEST( Distance( point, hits.Point( i )) < err );
+					TEST( Abs( Distance( point, center ) - radius ) < err );
+				}
+			}
+		}
+	}
+
+
+	void Test_RayCastSurface ()
+	{
+		static constexpr float	err			= 1.0e-3f;
+		static constexpr float	max_height	= 0.1f;
+
+		const SphericalCube::HeightFn_t		height = [] (const float3 &dir) { return max_height * Sin( dir.x * 10.0f ) * Cos( dir.y * 7.0f ); };
+
+		const float3	center	{ 0.0f, 0.0f, 0.0f };
+		const float		radius	= 2.0f;
+		float3			point;
+
+		// from above
+		TEST( SphericalCube::RayCastSurface( center, radius, max_height, height, float3{0.0f, 0.0f, 5.0f}, float3{0.0f, 0.0f, -5.0f}, OUT point ));
+		TEST( Distance( point, float3{0.0f, 0.0f, radius} ) < err );
+
+		// segment is above the surface
+		TEST( not SphericalCube::RayCastSurface( center, radius, max_height, height, float3{0.0f, 0.0f, 5.0f}, float3{0.0f, 0.0f, 2.5f}, OUT point ));
+
+		std::mt19937				gen{ 4321 };
+		SphericalCube::RaySegments	segments;
+		SphericalCube::RayHits		hits;
+
+		GenRandomSegments( 1001, gen, OUT segments );
+		SphericalCube::RayCastSurface( center, radius, max_height, height, segments, OUT hits );
+
+		uint	hit_count = 0;
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			const bool	hit = SphericalCube::RayCastSurface( center, radius, max_height, height, segments.Begin( i ), segments.End( i ), OUT point );
+
+			TEST( hit == hits.IsHit( i ));
+			if ( not hit )
+				continue;
+
+			++hit_count;
+			TEST( Distance( point, hits.Point( i )) < err );
+
+			// intersection is on the surface or segment begins under the surface
+			const float3	begin	= segments.Begin( i );
+			const float3	dir		= Normalize( point - center );
+
+			if ( Distance( begin, center ) <= radius * (1.0f + height( Normalize( begin - center ))))
+				TEST( Distance( point, begin ) < err );
+			else
+				TEST( Abs( Distance( point, center ) - radius * (1.0f + height( dir ))) < err );
+		}
+		TEST( hit_count > 0 );
+	}
+}
+
+extern void UnitTest_SphericalCube ()
+{
+	Test_ForwardTangents< OriginCube >();
+	Test_ForwardTangents< IdentitySphericalCube >();
+	Test_ForwardTangents< TangentialSphericalCube >();
+	Test_ForwardTangents< AdjustedSphericalCube >();
+	Test_GenerateVertices();
+	Test_GenerateIndices();
+	Test_LodOffsets();
+	Test_GeneratePacked();
+	Test_Indices16();
+	Test_Meshlets();
+	Test_RayCast();
+	Test_RayCastSurface();
+
+	FG_LOGI( "UnitTest_SphericalCube" );
+}
+
+
+extern void PerfTest_SphericalCube ()
+{
+	Nanoseconds	ref_time	{0};
+	Nanoseconds	new_time	{0};
+
+	for (uint lod = 0; lod < 32; ++lod)
+	{
+		Array<Vertex>	vert;	vert.resize( SphericalCube::CalcVertCount( lod ));
+
+		auto	t0 = Clock::now();
+		GenerateVerticesRef( lod, OUT vert.data() );
+		auto	t1 = Clock::now();
+		SphericalCube::GenerateVertices( lod, OUT vert.data() );
+		auto	t2 = Clock::now();
+
+		ref_time += std::chrono::duration_cast<Nanoseconds>( t1 - t0 );
+		new_time += std::chrono::duration_cast<Nanoseconds>( t2 - t1 );
+	}
+
+	FG_LOGI( "PerfTest_SphericalCube: vertex generation for LOD [0..31], reference: "s << ToString( ref_time ) << ", parallel: " << ToString( new_time ));
+
+	// ray casting
+	{
+		const SphericalCube			cube;
+		std::mt19937				gen{ 1234 };
+		SphericalCube::RaySegments	segments;
+		SphericalCube::RayHits		hits;
+		float3						point;
+		uint						hit_count	= 0;
+
+		GenRandomSegments( 1u << 20, gen, OUT segments );
+
+		auto	t0 = Clock::now();
+		for (size_t i = 0; i < segments.size(); ++i) {
+			hit_count += uint(cube.RayCast( float3{0.0f}, 1.5f, segments.Begin( i ), segments.End( i ), OUT point ));
+		}
+		auto	t1 = Clock::now();
+		SphericalCube::RayCast( float3{0.0f}, 1.5f, segments, OUT hits );
+		auto	t2 = Clock::now();
+
+		const auto	rays_per_sec = [&segments] (Nanoseconds dt) { return ToString( uint64_t(double(segments.size()) / (double(dt.count()) * 1.0e-9)) ); };
+
+		FG_LOGI( "PerfTest_SphericalCube: ray cast of "s << ToString( segments.size() ) << " segments, hits: " << ToString( hit_count )
+				 << ", scalar: " << rays_per_sec( std::chrono::duration_cast<Nanoseconds>( t1 - t0 ))
+				 << " rays/s, batch: " << rays_per_sec( std::chrono::duration_cast<Nanoseconds>( t2 - t1 )) << " rays/s" );
+	}
+
+	// vertex memory usage
+	String	str = "PerfTest_SphericalCube: vertex memory per LOD, default / packed / saved\n";
+	BytesU	total_saved;
+
+	for (uint lod = 0; lod < SphericalCube::MaxLods; ++lod)
+	{
+		const BytesU	def_size	= SphericalCube::GetVertexStride( SphericalCube::EVertexLayout::Default ) * SphericalCube::CalcVertCount( lod );
+		const BytesU	packed_size	= SphericalCube::GetVertexStride( SphericalCube::EVertexLayout::Packed ) * SphericalCube::CalcPackedVertCount( lod );
+
+		total_saved += def_size - packed_size;
+		str << "  LOD " << ToString( lod ) << ": " << ToString( def_size ) << " / " << ToString( packed_size ) << " / " << ToString( def_size - packed_size ) << "\n";
+	}
+	str << "  total saved: " << ToString( total_saved );
+
+	FG_LOGI( str );
+}
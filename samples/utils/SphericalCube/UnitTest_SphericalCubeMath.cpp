@@ -31,6 +31,60 @@ namespace
 			}
 		}
 	}
+
+
+	// returns max / min ratio of texel area on sphere
+	template <typename Projection>
+	ND_ double  CalcAreaDistortion ()
+	{
+		static constexpr uint	count	= 64;
+		static constexpr double	step	= 2.0 / count;
+
+		double	min_area	= std::numeric_limits<double>::max();
+		double	max_area	= 0.0;
+
+		for (uint y = 0; y < count; ++y)
+		for (uint x = 0; x < count; ++x)
+		{
+			const double2	ncoord	= double2{ double(x), double(y) } * step - 1.0;
+			const double3	p0		= Projection::Forward( ncoord, ECubeFace::ZPos );
+			const double3	p1		= Projection::Forward( ncoord + double2{step, 0.0}, ECubeFace::ZPos );
+			const double3	p2		= Projection::Forward( ncoord + double2{0.0, step}, ECubeFace::ZPos );
+			const double	area	= Length( Cross( p1 - p0, p2 - p0 ));
+
+			min_area = Min( min_area, area );
+			max_area = Max( max_area, area );
+		}
+		return max_area / min_area;
+	}
+
+
+	void Test_AdjustedSphericalCube ()
+	{
+		using Proj = AdjustedSphericalCube;
+
+		// coefficients are evaluated at compile time
+		STATIC_ASSERT( Proj::Warp( 0.0 ) == 0.0 );
+		STATIC_ASSERT( Proj::Warp( 1.0 ) > 1.0 - 1.0e-12 and Proj::Warp( 1.0 ) < 1.0 + 1.0e-12 );
+		STATIC_ASSERT( Proj::Warp( -1.0 ) < -1.0 + 1.0e-12 and Proj::Warp( -1.0 ) > -1.0 - 1.0e-12 );
+
+		for (uint i = 0; i <= 1000; ++i)
+		{
+			const double	x = double(i) / 1000.0 * 2.0 - 1.0;
+
+			TEST( Proj::WarpDerivative( x ) > 0.0 );
+			TEST(Equals( Proj::InverseWarp( Proj::Warp( x )), x, 1.0e-12 ));
+		}
+
+		// texel area must be more uniform than in other projections
+		const double	identity	= CalcAreaDistortion< IdentitySphericalCube >();
+		const double	tangential	= CalcAreaDistortion< TangentialSphericalCube >();
+		const double	adjusted	= CalcAreaDistortion< AdjustedSphericalCube >();
+
+		TEST( adjusted < tangential );
+		TEST( adjusted < identity );
+		TEST( adjusted < 1.35 );
+	}
 }
 
 extern void UnitTest_SphericalCubeMath ()
@@ -38,6 +92,8 @@ extern void UnitTest_SphericalCubeMath ()
 	Test_ForwardInverseProjection< OriginCube >();
 	Test_ForwardInverseProjection< IdentitySphericalCube >();
 	Test_ForwardInverseProjection< TangentialSphericalCube >();
+	Test_ForwardInverseProjection< AdjustedSphericalCube >();
+	Test_AdjustedSphericalCube();
 
 	FG_LOGI( "UnitTest_SphericalCubeMath" );
 }
@@ -0,0 +1,145 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SphericalCubeQuadTree.h"
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Settings	= SphericalCubeQuadTree::Settings;
+	using Chunk		= SphericalCubeQuadTree::Chunk;
+
+
+	// checks that levels of neighbours differ by at most 1 and edge flags are valid
+	void CheckBalance (const SphericalCubeQuadTree &tree, const Settings &settings)
+	{
+		for (auto& chunk : tree.GetChunks())
+		{
+			const float		eps	= chunk.size * 0.01f;
+
+			for (uint edge = 0; edge < 4; ++edge)
+			{
+				uint	min_level = UMax;
+
+				for (uint i = 0; i < 4; ++i)
+				{
+					const float		t		= chunk.size * (float(i) + 0.5f) / 4.0f;
+					const float2	points[] = { chunk.offset + float2{ -eps, t },				chunk.offset + float2{ t, -eps },
+												 chunk.offset + float2{ chunk.size + eps, t },	chunk.offset + float2{ t, chunk.size + eps }};
+					const uint		level	= tree.FindLevel( points[edge], ECubeFace(chunk.face), settings.maxLevel );
+
+					TEST( level != UMax );
+					TEST( level + 1 >= chunk.level and level <= chunk.level + 1 );
+
+					min_level = Min( min_level, level );
+				}
+
+				TEST( ((chunk.coarserEdges >> edge) & 1) == uint(min_level < chunk.level) );
+			}
+		}
+	}
+
+
+	void Test_Coverage ()
+	{
+		SphericalCubeQuadTree	tree;
+		Settings				settings;
+		settings.maxLevel	= 6;
+		settings.maxHeight	= 0.2f;
+
+		// camera is inside occluder, all chunks are visible
+		tree.Update( float3{0.0f, 0.0f, 0.5f}, settings );
+
+		float	area [6] = {};
+		uint	max_level = 0;
+
+		for (auto& chunk : tree.GetChunks())
+		{
+			area[chunk.face] += chunk.size * chunk.size;
+			max_level = Max( max_level, chunk.level );
+		}
+
+		for (uint face = 0; face < 6; ++face) {
+			TEST( Abs( area[face] - 4.0f ) < 1.0e-4f );
+		}
+		TEST( max_level > 0 and max_level <= settings.maxLevel );
+
+		CheckBalance( tree, settings );
+	}
+
+
+	void Test_Balance ()
+	{
+		SphericalCubeQuadTree	tree;
+		Settings				settings;
+		settings.maxLevel	= 12;
+		settings.maxHeight	= 0.01f;
+
+		for (float3 camera : { float3{0.0f, 0.0f, 1.05f}, float3{0.7f, 0.7f, 0.2f}, float3{1.0f, 1.0f, 1.0f} / 1.7f, float3{-2.0f, 0.5f, 0.1f} })
+		{
+			settings.pixelError = 2.0f;
+			tree.Update( camera, settings );
+			CheckBalance( tree, settings );
+
+			settings.pixelError = 1.0f;
+			tree.Update( camera, settings );
+			CheckBalance( tree, settings );
+		}
+	}
+
+
+	void Test_Horizon ()
+	{
+		SphericalCubeQuadTree	tree;
+		Settings				settings;
+		settings.maxHeight	= 0.05f;
+
+		// far camera, planet is drawn with lowest LOD
+		tree.Update( float3{0.0f, 0.0f, 1000.0f}, settings );
+
+		TEST( tree.GetChunks().size() <= 6 );
+		for (auto& chunk : tree.GetChunks()) {
+			TEST( chunk.level == 0 );
+		}
+
+		// near camera, chunks behind the horizon are culled
+		tree.Update( float3{0.0f, 0.0f, 1.1f}, settings );
+
+		for (auto& chunk : tree.GetChunks())
+		{
+			TEST( chunk.face != uint(ECubeFace::ZNeg) );
+			TEST( chunk.center.z > -0.5f );
+		}
+	}
+
+
+	void Test_Grid ()
+	{
+		for (uint size : {1u, 16u, 255u})
+		{
+			Array<float2>	vertices;	vertices.resize( (size+1) * (size+1) );
+			Array<uint16_t>	indices;	indices.resize( 4 * size * size );
+
+			SphericalCubeQuadTree::GenerateGrid( size, OUT vertices.data(), OUT indices.data() );
+
+			TEST( All( vertices.front() == float2{0.0f} ));
+			TEST( All( vertices.back() == float2{1.0f} ));
+
+			for (uint idx : indices) {
+				TEST( idx < vertices.size() );
+			}
+		}
+	}
+}
+
+extern void UnitTest_SphericalCubeQuadTree ()
+{
+	Test_Coverage();
+	Test_Balance();
+	Test_Horizon();
+	Test_Grid();
+
+	FG_LOGI( "UnitTest_SphericalCubeQuadTree" );
+}
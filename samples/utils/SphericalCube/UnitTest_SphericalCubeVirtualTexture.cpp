@@ -0,0 +1,335 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#include "SphericalCubeVirtualTexture.h"
+
+using namespace FG;
+
+#define TEST	CHECK_FATAL
+
+namespace
+{
+	using Settings	= SphericalCubeVirtualTexture::Settings;
+	using Chunk		= SphericalCubeVirtualTexture::Chunk;
+
+
+	ND_ Chunk  MakeChunk (ECubeFace face, const float2 &offset, float size)
+	{
+		Chunk	chunk;
+		chunk.face		= uint(face);
+		chunk.offset	= offset;
+		chunk.size		= size;
+		return chunk;
+	}
+
+
+	// 8x8 pages on mipmap 0, 3 free slots in cache
+	ND_ Settings  SmallSettings ()
+	{
+		Settings	settings;
+		settings.faceSize			= 1024;
+		settings.pageSize			= 128;
+		settings.cacheSize			= 3;
+		settings.maxPagesPerFrame	= 2;
+		settings.chunkTexels		= 256.0f;
+		return settings;
+	}
+
+
+	void Test_ChunkMipmap ()
+	{
+		SphericalCubeVirtualTexture	vt;
+		vt.Reset( Settings{} );
+
+		TEST( vt.MaxMipmap() == 7 );
+		TEST( vt.ChunkMipmap( MakeChunk( ECubeFace::XPos, float2{-1.0f}, 2.0f )) == 6 );
+		TEST( vt.ChunkMipmap( MakeChunk( ECubeFace::XPos, float2{-1.0f}, 2.0f / 64.0f )) == 0 );
+		TEST( vt.ChunkMipmap( MakeChunk( ECubeFace::XPos, float2{-1.0f}, 2.0f / 128.0f )) == 0 );
+	}
+
+
+	void Test_Reset ()
+	{
+		SphericalCubeVirtualTexture	vt;
+		vt.Reset( SmallSettings() );
+
+		// coarsest mipmap for all faces
+		TEST( vt.MaxMipmap() == 3 );
+		TEST( vt.GetPendingPages().size() == 6 );
+		TEST( vt.AtlasDimension().x == 3 * 130 );
+
+		for (auto& page : vt.GetPendingPages())
+		{
+			TEST( page.mip == 3 );
+			TEST( page.faceSize == 128 );
+			TEST( All( page.srcOffset == int2{-1} ));
+		}
+
+		for (uint face = 0; face < 6; ++face) {
+			TEST( vt.ResidentMipmap( ECubeFace(face), 0, uint2{7} ) == 3 );
+		}
+	}
+
+
+	void Test_Fallback ()
+	{
+		Settings	settings = SmallSettings();
+		settings.chunkTexels = 128.0f;
+
+		SphericalCubeVirtualTexture	vt;
+		vt.Reset( settings );
+		vt.Upload( CommandBuffer{} );
+
+		// single page on mipmap 1
+		vt.Update({ MakeChunk( ECubeFace::XPos, float2{-1.0f}, 0.5f )});
+
+		TEST( vt.GetPendingPages().size() == 1 );
+		TEST( vt.GetPendingPages()[0].mip == 1 );
+		TEST( All( vt.GetPendingPages()[0].dstOffset == uint2{0, 260} ));	// first slot after pinned pages
+
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 1, uint2{0, 0} ) == 1 );
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{1, 1} ) == 1 );
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{2, 1} ) == 3 );
+		TEST( vt.ResidentMipmap( ECubeFace::XNeg, 0, uint2{0, 0} ) == 3 );
+
+		// finer page inside
+		vt.Upload( CommandBuffer{} );
+		vt.Update({ MakeChunk( ECubeFace::XPos, float2{-1.0f}, 0.25f )});
+
+		TEST( vt.GetPendingPages().size() == 1 );
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{0, 0} ) == 0 );
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{1, 0} ) == 1 );
+	}
+
+
+	void Test_LRU ()
+	{
+		SphericalCubeVirtualTexture	vt;
+		vt.Reset( SmallSettings() );
+		vt.Upload( CommandBuffer{} );
+
+		// 2x2 pages on mipmap 0, only 2 pages per frame
+		const Chunk		chunk_a = MakeChunk( ECubeFace::XPos, float2{-1.0f}, 0.5f );
+		const Chunk		chunk_b = MakeChunk( ECubeFace::YPos, float2{-1.0f}, 0.5f );
+
+		vt.Update({ chunk_a });
+		TEST( vt.GetPendingPages().size() == 2 );
+		vt.Upload( CommandBuffer{} );
+
+		// only one free slot, other slots are used in this frame
+		vt.Update({ chunk_a });
+		TEST( vt.GetPendingPages().size() == 1 );
+		vt.Upload( CommandBuffer{} );
+
+		uint	resident = 0;
+		for (uint i = 0; i < 4; ++i) {
+			resident += uint(vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{i&1, i>>1} ) == 0);
+		}
+		TEST( resident == 3 );
+
+		// least recently used pages are replaced
+		vt.Update({ chunk_b });
+		TEST( vt.GetPendingPages().size() == 2 );
+
+		resident = 0;
+		for (uint i = 0; i < 4; ++i) {
+			resident += uint(vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{i&1, i>>1} ) == 0);
+			TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{i&1, i>>1} ) != UMax );
+		}
+		TEST( resident == 1 );
+	}
+
+
+	void Test_Invalidate ()
+	{
+		Settings	settings = SmallSettings();
+		settings.chunkTexels = 128.0f;
+
+		SphericalCubeVirtualTexture	vt;
+		vt.Reset( settings );
+		vt.Upload( CommandBuffer{} );
+
+		vt.Update({ MakeChunk( ECubeFace::XPos, float2{-1.0f}, 0.5f )});
+		vt.Upload( CommandBuffer{} );
+
+		// pinned page and page on mipmap 1
+		vt.Invalidate( ECubeFace::XPos, uint2{10, 10}, uint2{4, 4} );
+		TEST( vt.GetPendingPages().size() == 2 );
+		TEST( vt.GetPendingPages()[0].mip == 1 );
+		TEST( All( vt.GetPendingPages()[0].dstOffset == uint2{0, 260} ));
+		TEST( vt.GetPendingPages()[1].mip == 3 );
+
+		// resident pages are not changed
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{0, 0} ) == 1 );
+
+		// same pages are not duplicated
+		vt.Invalidate( ECubeFace::XPos, uint2{20, 20}, uint2{1, 1} );
+		TEST( vt.GetPendingPages().size() == 2 );
+		vt.Upload( CommandBuffer{} );
+
+		// only pinned page of other face
+		vt.Invalidate( ECubeFace::YNeg, uint2{500, 500}, uint2{100, 100} );
+		TEST( vt.GetPendingPages().size() == 1 );
+		TEST( vt.GetPendingPages()[0].face == uint(ECubeFace::YNeg) );
+
+		// empty region
+		vt.Upload( CommandBuffer{} );
+		vt.Invalidate( ECubeFace::XPos, uint2{0, 0}, uint2{0, 0} );
+		TEST( vt.GetPendingPages().empty() );
+	}
+
+
+	// atlas coordinate must point to texel of resident page that is same as requested texel
+	void Test_AtlasCoord ()
+	{
+		using Page = SphericalCubeVirtualTexture::Page;
+
+		Settings	settings = SmallSettings();
+		settings.cacheSize			= 4;
+		settings.maxPagesPerFrame	= 8;
+		settings.chunkTexels		= 51.2f;
+
+		SphericalCubeVirtualTexture	vt;
+		vt.Reset( settings );
+
+		Array<Page>		pages;
+		for (uint face = 0; face < 6; ++face) {
+			pages.push_back( vt.GetPinnedPage( ECubeFace(face) ));
+		}
+		vt.Upload( CommandBuffer{} );
+
+		// page (1,1) on mipmap 1 and page (5,5) on mipmap 0
+		vt.Update({ MakeChunk( ECubeFace::XPos, float2{-0.49f}, 0.2f ), MakeChunk( ECubeFace::XPos, float2{0.3f}, 0.05f )});
+		TEST( vt.GetPendingPages().size() == 2 );
+
+		pages.insert( pages.end(), vt.GetPendingPages().begin(), vt.GetPendingPages().end() );
+		vt.Upload( CommandBuffer{} );
+
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{2, 2} ) == 1 );
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{5, 5} ) == 0 );
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 1, uint2{2, 2} ) == 3 );
+
+		const float		atlas_size	= float(vt.AtlasDimension().x);
+		const float		err			= 1.0e-3f;
+
+		const auto	TestCoord = [&] (const float2 &uv, uint mip)
+		{
+			const float2	atlas	= vt.AtlasCoord( ECubeFace::XPos, uv * 2.0f - 1.0f, mip ) * atlas_size - 0.5f;
+			const float		dim		= float(settings.faceSize >> mip);
+			const uint2		req		= Min( uint2(uv * (dim - 1.0f) / float(settings.pageSize)), uint2{(settings.faceSize / settings.pageSize >> mip) - 1} );
+
+			auto	iter = std::find_if( pages.begin(), pages.end(), [&atlas] (const Page &p) {
+									return All( atlas >= float2(p.dstOffset) - 0.5f ) and All( atlas <= float2(p.dstOffset + p.dimension - 1) + 0.5f ); });
+			TEST( iter != pages.end() );
+			TEST( iter->face == uint(ECubeFace::XPos) );
+			TEST( iter->mip == vt.ResidentMipmap( ECubeFace::XPos, mip, req ));
+
+			// texel 0 is on the face edge
+			const float2	expected	= uv * (float(iter->faceSize) - 1.0f);
+			const float2	texel		= float2(iter->srcOffset) + (atlas - float2(iter->dstOffset));
+
+			TEST( Equals( texel.x, expected.x, err ));
+			TEST( Equals( texel.y, expected.y, err ));
+		};
+
+		// page edges on all mipmaps and texels between them
+		Array<float>	samples;
+		for (uint mip = 0; mip <= vt.MaxMipmap(); ++mip)
+		{
+			const float		dim = float(settings.faceSize >> mip) - 1.0f;
+			for (uint i = 0; i <= (settings.faceSize >> mip) / settings.pageSize; ++i)
+			{
+				const float	edge = float(i * settings.pageSize) / dim;
+				samples.push_back( Max( edge - 0.01f / dim, 0.0f ));
+				samples.push_back( Min( edge, 1.0f ));
+				samples.push_back( Min( edge + 0.01f / dim, 1.0f ));
+			}
+		}
+		for (uint i = 0; i <= 1000; ++i) {
+			samples.push_back( float(i) / 1000.0f );
+		}
+
+		for (uint mip = 0; mip <= vt.MaxMipmap(); ++mip)
+		for (float y : {0.0f, 130.0f / 1023.0f, 256.0f / 1023.0f, 300.0f / 1023.0f, 680.0f / 1023.0f, 1.0f})
+		for (float x : samples)
+		{
+			TestCoord( float2{x, y}, mip );
+			TestCoord( float2{y, x}, mip );
+		}
+
+		// requested page 2 uses page 1 on mipmap 1, texel is in the border
+		const float2	uv		= float2{256.0f / 1023.0f};
+		const float2	atlas	= vt.AtlasCoord( ECubeFace::XPos, uv * 2.0f - 1.0f, 0 ) * atlas_size - 0.5f;
+		const float2	local	= atlas - float2(pages[6].dstOffset);
+
+		TEST( pages[6].mip == 1 );
+		TEST( local.x > 0.0f and local.x < 1.0f );
+		TEST( local.y > 0.0f and local.y < 1.0f );
+	}
+
+
+	// vertices on edge between chunks of different size must sample the same texel, otherwise there are cracks
+	void Test_EdgeLod ()
+	{
+		static constexpr float	tess_level	= 3.0f;
+
+		Settings	settings = SmallSettings();
+		settings.chunkTexels = float(SphericalCubeQuadTree::GridSize) * tess_level;
+
+		SphericalCubeVirtualTexture	vt;
+		vt.Reset( settings );
+		vt.Upload( CommandBuffer{} );
+
+		// 'coarse' is the neighbour of 'fine' on the XPos edge
+		Chunk	fine	= MakeChunk( ECubeFace::XPos, float2{-1.0f}, 0.125f );
+		Chunk	coarse	= MakeChunk( ECubeFace::XPos, float2{-0.875f, -1.0f}, 0.25f );
+		fine.coarserEdges = SphericalCubeQuadTree::Edge_XPos;
+
+		// page (0,0) on mipmap 0 and on mipmap 1
+		vt.Update({ fine, coarse });
+		TEST( vt.GetPendingPages().size() == 2 );
+		vt.Upload( CommandBuffer{} );
+
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 0, uint2{0, 0} ) == 0 );
+		TEST( vt.ResidentMipmap( ECubeFace::XPos, 1, uint2{0, 0} ) == 1 );
+
+		const auto	ToMip = [] (float lod) { return uint(Max( lod, 0.0f )); };
+
+		const uint	fine_mip	= ToMip( vt.VertexLod( fine, tess_level, false ));
+		const uint	edge_mip	= ToMip( vt.VertexLod( fine, tess_level, true ));
+		const uint	coarse_mip	= ToMip( vt.VertexLod( coarse, tess_level, false ));
+
+		TEST( fine_mip == 0 );
+		TEST( coarse_mip == 1 );
+		TEST( edge_mip == coarse_mip );
+
+		// vertices of coarse chunk on the shared edge, fine chunk has the same vertices
+		const uint	segments = SphericalCubeQuadTree::GridSize * uint(tess_level);
+		bool		differs	 = false;
+
+		for (uint i = 0; i <= segments / 2; ++i)
+		{
+			const float2	ncoord		= float2{ coarse.offset.x, coarse.offset.y + coarse.size * float(i) / float(segments) };
+			const float2	fine_uv		= vt.AtlasCoord( ECubeFace::XPos, ncoord, edge_mip );
+			const float2	coarse_uv	= vt.AtlasCoord( ECubeFace::XPos, ncoord, coarse_mip );
+
+			TEST( All( fine_uv == coarse_uv ));
+
+			// lod of the fine chunk samples the other page
+			differs |= Any( vt.AtlasCoord( ECubeFace::XPos, ncoord, fine_mip ) != coarse_uv );
+		}
+		TEST( differs );
+	}
+}
+
+extern void UnitTest_SphericalCubeVirtualTexture ()
+{
+	Test_ChunkMipmap();
+	Test_Reset();
+	Test_Fallback();
+	Test_LRU();
+	Test_Invalidate();
+	Test_AtlasCoord();
+	Test_EdgeLod();
+
+	FG_LOGI( "UnitTest_SphericalCubeVirtualTexture" );
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2018-2020,  Zhirnov Andrey. For more information see 'LICENSE'
+
+#pragma once
+
+#include "stl/Common.h"
+#include <atomic>
+#include <thread>
+
+namespace FGC
+{
+
+/*
+=================================================
+	ParallelFor
+----
+	calls 'fn(i)' for each 'i' in [0, count).
+	Work is split into batches of 'batchSize' elements that are
+	distributed between the calling thread and temporary worker threads.
+	If there is only one batch then all work is done on the calling thread.
+=================================================
+*/
+	template <typename Fn>
+	inline void  ParallelFor (uint count, uint batchSize, Fn &&fn)
+	{
+		ASSERT( batchSize > 0 );
+
+		const uint	num_batches	= (count + batchSize - 1) / batchSize;
+		const uint	num_threads	= Min( num_batches, Max( 1u, std::thread::hardware_concurrency() ));
+
+		if ( num_threads <= 1 )
+		{
+			for (uint i = 0; i < count; ++i) {
+				fn( i );
+			}
+			return;
+		}
+
+		std::atomic<uint>	next_batch {0};
+
+		const auto	worker = [&] ()
+		{
+			for (;;)
+			{
+				const uint	batch = next_batch.fetch_add( 1, std::memory_order_relaxed );
+				if ( batch >= num_batches )
+					break;
+
+				for (uint i = batch * batchSize, end = Min( i + batchSize, count ); i < end; ++i) {
+					fn( i );
+				}
+			}
+		};
+
+		Array<std::thread>	threads;
+		threads.reserve( num_threads - 1 );
+
+		for (uint i = 1; i < num_threads; ++i) {
+			threads.emplace_back( worker );
+		}
+
+		worker();
+
+		for (auto& t : threads) {
+			t.join();
+		}
+	}
+
+}	// FGC